@@ -82,20 +82,25 @@ void AudioManager::PushToOutput(const QByteArray &samples)
   emit OutputPushed(samples);
 }
 
-void AudioManager::StartOutput(const QString &filename, qint64 offset, int playback_speed)
+void AudioManager::StartOutput(MappedPCMPtr pcm, qint64 offset, int playback_speed)
 {
+  int session = output_manager_.BeginSession();
+
   QMetaObject::invokeMethod(&output_manager_,
                             "PullFromDevice",
                             Qt::QueuedConnection,
-                            Q_ARG(const QString&, filename),
+                            OLIVE_NS_ARG(MappedPCMPtr, pcm),
                             Q_ARG(qint64, offset),
-                            Q_ARG(int, playback_speed));
+                            Q_ARG(int, playback_speed),
+                            Q_ARG(int, session));
 
-  emit OutputDeviceStarted(filename, offset, playback_speed);
+  emit OutputDeviceStarted(pcm, offset, playback_speed);
 }
 
 void AudioManager::StopOutput()
 {
+  output_manager_.BeginSession();
+
   QMetaObject::invokeMethod(&output_manager_,
                             "ResetToPushMode",
                             Qt::QueuedConnection);
@@ -57,17 +57,28 @@ public:
   void PushToOutput(const QByteArray& samples);
 
   /**
-   * @brief Start playing audio from QIODevice
+   * @brief Start playing audio from mapped PCM
    *
-   * This takes ownership of the QIODevice and will delete it when StopOutput() is called
+   * The output holds a reference to `pcm` until StopOutput() is called. `offset` is in samples.
    */
-  void StartOutput(const QString& filename, qint64 offset, int playback_speed);
+  void StartOutput(MappedPCMPtr pcm, qint64 offset, int playback_speed);
 
   /**
    * @brief Stop audio output immediately
    */
   void StopOutput();
 
+  /**
+   * @brief How much audio the output has played since the last StartOutput() in microseconds
+   *
+   * Follows the device rather than the wall clock, so playback can be synced to what's actually being heard. Returns
+   * -1 if output hasn't started yet or has been stopped. Thread-safe.
+   */
+  qint64 GetOutputPlayedUSecs() const
+  {
+    return output_manager_.GetPlayedUSecs();
+  }
+
   void SetOutputDevice(const QAudioDeviceInfo& info);
 
   void SetOutputParams(const AudioParams& params);
@@ -86,7 +97,7 @@ signals:
 
   void OutputNotified();
 
-  void OutputDeviceStarted(const QString& filename, qint64 offset, int playback_speed);
+  void OutputDeviceStarted(MappedPCMPtr pcm, qint64 offset, int playback_speed);
 
   void AudioParamsChanged(const AudioParams& params);
 
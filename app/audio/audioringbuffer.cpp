@@ -0,0 +1,101 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "audioringbuffer.h"
+
+#include <cstring>
+
+OLIVE_NAMESPACE_ENTER
+
+AudioRingBuffer::AudioRingBuffer() :
+  write_pos_(0),
+  read_pos_(0)
+{
+}
+
+void AudioRingBuffer::Allocate(qint64 capacity)
+{
+  buffer_.resize(static_cast<int>(capacity));
+  Clear();
+}
+
+void AudioRingBuffer::Clear()
+{
+  write_pos_.store(0, std::memory_order_relaxed);
+  read_pos_.store(0, std::memory_order_relaxed);
+}
+
+qint64 AudioRingBuffer::Write(const char *data, qint64 length)
+{
+  qint64 write_pos = write_pos_.load(std::memory_order_relaxed);
+
+  // Acquire so the consumer is done with the bytes we're about to overwrite
+  qint64 space = buffer_.size() - (write_pos - read_pos_.load(std::memory_order_acquire));
+
+  length = qMin(length, space);
+
+  if (length <= 0) {
+    return 0;
+  }
+
+  qint64 start = write_pos % buffer_.size();
+  qint64 first = qMin(length, buffer_.size() - start);
+
+  memcpy(buffer_.data() + start, data, static_cast<size_t>(first));
+  memcpy(buffer_.data(), data + first, static_cast<size_t>(length - first));
+
+  // Release so the consumer sees the bytes before it sees the new position
+  write_pos_.store(write_pos + length, std::memory_order_release);
+
+  return length;
+}
+
+qint64 AudioRingBuffer::WriteSpace() const
+{
+  return buffer_.size() - (write_pos_.load(std::memory_order_relaxed) - read_pos_.load(std::memory_order_acquire));
+}
+
+qint64 AudioRingBuffer::Read(char *data, qint64 length)
+{
+  qint64 read_pos = read_pos_.load(std::memory_order_relaxed);
+
+  length = qMin(length, write_pos_.load(std::memory_order_acquire) - read_pos);
+
+  if (length <= 0) {
+    return 0;
+  }
+
+  qint64 start = read_pos % buffer_.size();
+  qint64 first = qMin(length, buffer_.size() - start);
+
+  memcpy(data, buffer_.constData() + start, static_cast<size_t>(first));
+  memcpy(data + first, buffer_.constData(), static_cast<size_t>(length - first));
+
+  read_pos_.store(read_pos + length, std::memory_order_release);
+
+  return length;
+}
+
+qint64 AudioRingBuffer::ReadAvailable() const
+{
+  return write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_relaxed);
+}
+
+OLIVE_NAMESPACE_EXIT
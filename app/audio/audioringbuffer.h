@@ -0,0 +1,94 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <atomic>
+#include <QByteArray>
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Lock-free single-producer/single-consumer byte ring for handing audio to the output device
+ *
+ * One thread may Write() while another Read()s without either ever blocking, so the audio device's callback can't be
+ * held up by disk access or anything else the producer is doing. Any other use must be synchronized by the caller.
+ */
+class AudioRingBuffer
+{
+public:
+  AudioRingBuffer();
+
+  DISABLE_COPY_MOVE(AudioRingBuffer)
+
+  /**
+   * @brief Resize and empty the ring
+   *
+   * Not thread-safe, neither side may be using the ring while this is called.
+   */
+  void Allocate(qint64 capacity);
+
+  /**
+   * @brief Discard everything in the ring
+   *
+   * Not thread-safe, neither side may be using the ring while this is called.
+   */
+  void Clear();
+
+  qint64 capacity() const
+  {
+    return buffer_.size();
+  }
+
+  /**
+   * @brief Producer only: copy up to `length` bytes in, returning how many fit
+   */
+  qint64 Write(const char* data, qint64 length);
+
+  /**
+   * @brief Producer only: how many bytes can be written right now
+   */
+  qint64 WriteSpace() const;
+
+  /**
+   * @brief Consumer only: copy up to `length` bytes out, returning how many there were
+   */
+  qint64 Read(char* data, qint64 length);
+
+  /**
+   * @brief Consumer only: how many bytes can be read right now
+   */
+  qint64 ReadAvailable() const;
+
+private:
+  QByteArray buffer_;
+
+  // Total bytes ever written/read. Each is only stored by its own side, the other side only loads it.
+  std::atomic<qint64> write_pos_;
+  std::atomic<qint64> read_pos_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // AUDIORINGBUFFER_H
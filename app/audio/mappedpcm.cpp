@@ -0,0 +1,648 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "mappedpcm.h"
+
+#include <QDebug>
+
+OLIVE_NAMESPACE_ENTER
+
+// At 48kHz this starts at ~20 seconds per extent and grows to ~6 minutes
+const qint64 MappedPCM::kInitialExtentSamples = 1 << 20;
+const qint64 MappedPCM::kMaximumExtentSamples = 1 << 24;
+
+template<typename Func>
+void MappedPCM::ForEachRun(const QVector<Segment> &runs, Func func)
+{
+  // Calls func(position in run list, sample count, extent, index in extent) for each piece of contiguous memory
+  qint64 pos = 0;
+
+  foreach (const Segment& s, runs) {
+    if (s.physical < 0) {
+      func(pos, s.count, nullptr, 0);
+      pos += s.count;
+      continue;
+    }
+
+    qint64 physical = s.physical;
+    qint64 remaining = s.count;
+
+    while (remaining > 0) {
+      qint64 contiguous;
+      ExtentPtr e = ExtentAt(physical, &contiguous);
+      qint64 n = qMin(remaining, contiguous);
+
+      func(pos, n, e.get(), physical - e->start);
+
+      pos += n;
+      physical += n;
+      remaining -= n;
+    }
+  }
+}
+
+MappedPCM::MappedPCM(const QString &filename, const AudioParams &params, Layout layout) :
+  filename_(filename),
+  params_(params),
+  layout_(layout),
+  length_(0),
+  capacity_(0),
+  pins_(std::make_shared<PinTable>())
+{
+}
+
+qint64 MappedPCM::length()
+{
+  QMutexLocker locker(&lock_);
+
+  return length_;
+}
+
+void MappedPCM::Resize(qint64 length)
+{
+  QMutexLocker locker(&lock_);
+
+  ResizeInternal(length);
+}
+
+void MappedPCM::Insert(qint64 at, qint64 count)
+{
+  QMutexLocker locker(&lock_);
+
+  if (count <= 0) {
+    return;
+  }
+
+  if (at >= length_) {
+    ResizeInternal(at + count);
+    return;
+  }
+
+  segments_.insert(SplitAt(at), {count, -1});
+  length_ += count;
+
+  Coalesce();
+}
+
+void MappedPCM::Remove(qint64 at, qint64 count)
+{
+  QMutexLocker locker(&lock_);
+
+  count = qMin(count, length_ - at);
+
+  if (count <= 0) {
+    return;
+  }
+
+  int first = SplitAt(at);
+  int last = SplitAt(at + count);
+
+  ReleaseSegments(first, last);
+  segments_.remove(first, last - first);
+  length_ -= count;
+
+  Coalesce();
+}
+
+void MappedPCM::WriteSilence(qint64 at, qint64 count)
+{
+  QMutexLocker locker(&lock_);
+
+  if (count <= 0) {
+    return;
+  }
+
+  if (at + count > length_) {
+    ResizeInternal(at + count);
+  }
+
+  int first = SplitAt(at);
+  int last = SplitAt(at + count);
+
+  // Silence doesn't need any storage at all
+  ReleaseSegments(first, last);
+  segments_.remove(first, last - first);
+  segments_.insert(first, {count, -1});
+
+  Coalesce();
+}
+
+void MappedPCM::Write(qint64 at, SampleBufferPtr samples, qint64 offset, qint64 count)
+{
+  QMutexLocker locker(&lock_);
+
+  if (params_.format() != SampleFormat::SAMPLE_FMT_FLT) {
+    qWarning() << "Tried to write a SampleBuffer to non-float PCM storage";
+    return;
+  }
+
+  count = qMin(count, samples->sample_count() - offset);
+
+  if (count <= 0) {
+    return;
+  }
+
+  int channels = params_.channel_count();
+  float** src = samples->data();
+
+  ForEachRun(PrepareWrite(at, count), [this, channels, src, offset](qint64 pos, qint64 n, Extent* e, qint64 index){
+    if (!e) {
+      return;
+    }
+
+    if (layout_ == kInterleaved) {
+      float* dst = reinterpret_cast<float*>(e->data.at(0)) + index * channels;
+
+      for (qint64 i=0;i<n;i++) {
+        for (int j=0;j<channels;j++) {
+          *dst = src[j][offset + pos + i];
+          dst++;
+        }
+      }
+    } else {
+      for (int j=0;j<channels;j++) {
+        memcpy(reinterpret_cast<float*>(e->data.at(j)) + index, src[j] + offset + pos, n * sizeof(float));
+      }
+    }
+  });
+
+  Coalesce();
+}
+
+void MappedPCM::WritePacked(qint64 at, const char *data, qint64 count)
+{
+  QMutexLocker locker(&lock_);
+
+  if (count <= 0) {
+    return;
+  }
+
+  int channels = params_.channel_count();
+  int sample_sz = params_.bytes_per_sample_per_channel();
+  int frame_sz = sample_sz * channels;
+
+  ForEachRun(PrepareWrite(at, count), [this, data, channels, sample_sz, frame_sz](qint64 pos, qint64 n, Extent* e, qint64 index){
+    if (!e) {
+      return;
+    }
+
+    const char* src = data + pos * frame_sz;
+
+    if (layout_ == kInterleaved) {
+      memcpy(e->data.at(0) + index * frame_sz, src, n * frame_sz);
+    } else {
+      for (qint64 i=0;i<n;i++) {
+        for (int j=0;j<channels;j++) {
+          memcpy(e->data.at(j) + (index + i) * sample_sz, src, sample_sz);
+          src += sample_sz;
+        }
+      }
+    }
+  });
+
+  Coalesce();
+}
+
+QVector<MappedPCM::View> MappedPCM::Map(qint64 at, qint64 count)
+{
+  QMutexLocker locker(&lock_);
+
+  QVector<View> views;
+
+  count = qMin(count, length_ - at);
+
+  if (at < 0 || count <= 0) {
+    return views;
+  }
+
+  qint64 start = 0;
+  qint64 lane_sample_sz = LaneSampleBytes();
+
+  foreach (const Segment& s, segments_) {
+    qint64 in = qMax(at, start);
+    qint64 out = qMin(at + count, start + s.count);
+
+    if (in < out) {
+      if (s.physical < 0) {
+        views.append({out - in, QVector<const char*>(), nullptr});
+      } else {
+        qint64 physical = s.physical + (in - start);
+        qint64 remaining = out - in;
+
+        while (remaining > 0) {
+          qint64 contiguous;
+          ExtentPtr e = ExtentAt(physical, &contiguous);
+          qint64 n = qMin(remaining, contiguous);
+
+          // Pin this range so it can't be reused or overwritten while the view exists
+          std::shared_ptr<PinTable> pins = pins_;
+          pins->Pin(physical, n);
+
+          std::shared_ptr<void> keep_alive(e.get(), [e, pins, physical, n](void*){
+            pins->Unpin(physical, n);
+          });
+
+          View v = {n, QVector<const char*>(e->data.size()), keep_alive};
+          for (int i=0;i<e->data.size();i++) {
+            v.data[i] = reinterpret_cast<const char*>(e->data.at(i)) + (physical - e->start) * lane_sample_sz;
+          }
+          views.append(v);
+
+          physical += n;
+          remaining -= n;
+        }
+      }
+    }
+
+    start += s.count;
+
+    if (start >= at + count) {
+      break;
+    }
+  }
+
+  return views;
+}
+
+qint64 MappedPCM::ReadPacked(qint64 at, char *dst, qint64 count)
+{
+  int channels = params_.channel_count();
+  int sample_sz = params_.bytes_per_sample_per_channel();
+  int frame_sz = sample_sz * channels;
+
+  qint64 read = 0;
+
+  foreach (const View& v, Map(at, count)) {
+    if (v.data.isEmpty()) {
+      memset(dst, 0, v.count * frame_sz);
+      dst += v.count * frame_sz;
+    } else if (layout_ == kInterleaved) {
+      memcpy(dst, v.data.at(0), v.count * frame_sz);
+      dst += v.count * frame_sz;
+    } else {
+      for (qint64 i=0;i<v.count;i++) {
+        for (int j=0;j<channels;j++) {
+          memcpy(dst, v.data.at(j) + i * sample_sz, sample_sz);
+          dst += sample_sz;
+        }
+      }
+    }
+
+    read += v.count;
+  }
+
+  return read;
+}
+
+SampleBufferPtr MappedPCM::ReadSamples(qint64 at, qint64 count)
+{
+  if (params_.format() != SampleFormat::SAMPLE_FMT_FLT || count <= 0) {
+    return nullptr;
+  }
+
+  SampleBufferPtr buffer = SampleBuffer::CreateAllocated(params_, count);
+  int channels = params_.channel_count();
+  qint64 pos = 0;
+
+  foreach (const View& v, Map(at, count)) {
+    if (v.data.isEmpty()) {
+      buffer->fill(0, pos, pos + v.count);
+    } else if (layout_ == kInterleaved) {
+      const float* src = reinterpret_cast<const float*>(v.data.at(0));
+
+      for (qint64 i=0;i<v.count;i++) {
+        for (int j=0;j<channels;j++) {
+          buffer->data()[j][pos + i] = *src;
+          src++;
+        }
+      }
+    } else {
+      for (int j=0;j<channels;j++) {
+        memcpy(buffer->data()[j] + pos, v.data.at(j), v.count * sizeof(float));
+      }
+    }
+
+    pos += v.count;
+  }
+
+  // Anything past the end is silent
+  if (pos < count) {
+    buffer->fill(0, pos, count);
+  }
+
+  return buffer;
+}
+
+MappedPCM::Extent::~Extent()
+{
+  for (int i=0;i<files.size();i++) {
+    if (i < data.size()) {
+      files.at(i)->unmap(data.at(i));
+    }
+
+    files.at(i)->close();
+    files.at(i)->remove();
+    delete files.at(i);
+  }
+}
+
+int MappedPCM::LaneCount() const
+{
+  return (layout_ == kInterleaved) ? 1 : params_.channel_count();
+}
+
+qint64 MappedPCM::LaneSampleBytes() const
+{
+  qint64 sz = params_.bytes_per_sample_per_channel();
+
+  if (layout_ == kInterleaved) {
+    sz *= params_.channel_count();
+  }
+
+  return sz;
+}
+
+void MappedPCM::ResizeInternal(qint64 length)
+{
+  if (length > length_) {
+    segments_.append({length - length_, -1});
+  } else if (length < length_) {
+    int first = SplitAt(length);
+
+    ReleaseSegments(first, segments_.size());
+    segments_.resize(first);
+  }
+
+  length_ = length;
+
+  Coalesce();
+}
+
+int MappedPCM::SplitAt(qint64 at)
+{
+  qint64 start = 0;
+
+  for (int i=0;i<segments_.size();i++) {
+    if (start == at) {
+      return i;
+    }
+
+    const Segment& s = segments_.at(i);
+
+    if (at < start + s.count) {
+      // Split this segment in two
+      qint64 first_count = at - start;
+
+      Segment second = {s.count - first_count, (s.physical < 0) ? -1 : s.physical + first_count};
+
+      segments_[i].count = first_count;
+      segments_.insert(i + 1, second);
+
+      return i + 1;
+    }
+
+    start += s.count;
+  }
+
+  return segments_.size();
+}
+
+void MappedPCM::Coalesce()
+{
+  for (int i=1;i<segments_.size();i++) {
+    Segment& prev = segments_[i - 1];
+    const Segment& s = segments_.at(i);
+
+    if ((prev.physical < 0 && s.physical < 0)
+        || (prev.physical >= 0 && prev.physical + prev.count == s.physical)) {
+      prev.count += s.count;
+      segments_.remove(i);
+      i--;
+    }
+  }
+}
+
+void MappedPCM::ReleaseSegments(int first, int last)
+{
+  for (int i=first;i<last;i++) {
+    if (segments_.at(i).physical >= 0) {
+      Release(segments_.at(i).physical, segments_.at(i).count);
+    }
+  }
+}
+
+void MappedPCM::Allocate(qint64 count, QVector<Segment> *pieces)
+{
+  ReclaimReleased();
+
+  while (count > 0) {
+    if (free_.isEmpty() && !Grow()) {
+      // Out of space, leave the rest silent
+      pieces->append({count, -1});
+      return;
+    }
+
+    // Use the lowest free space first to keep the storage compact
+    QMap<qint64, qint64>::iterator it = free_.begin();
+    qint64 start = it.key();
+    qint64 available = it.value();
+    qint64 n = qMin(count, available);
+
+    free_.erase(it);
+    if (n < available) {
+      free_.insert(start + n, available - n);
+    }
+
+    pieces->append({n, start});
+    count -= n;
+  }
+}
+
+void MappedPCM::Free(qint64 physical, qint64 count)
+{
+  // Merge with neighboring free ranges
+  QMap<qint64, qint64>::iterator next = free_.lowerBound(physical);
+
+  if (next != free_.begin()) {
+    QMap<qint64, qint64>::iterator prev = next - 1;
+
+    if (prev.key() + prev.value() == physical) {
+      physical = prev.key();
+      count += prev.value();
+      next = free_.erase(prev);
+    }
+  }
+
+  if (next != free_.end() && next.key() == physical + count) {
+    count += next.value();
+    free_.erase(next);
+  }
+
+  free_.insert(physical, count);
+}
+
+void MappedPCM::Release(qint64 physical, qint64 count)
+{
+  if (pins_->IsPinned(physical, count)) {
+    released_.insert(physical, count);
+  } else {
+    Free(physical, count);
+  }
+}
+
+void MappedPCM::ReclaimReleased()
+{
+  QMap<qint64, qint64>::iterator it = released_.begin();
+
+  while (it != released_.end()) {
+    if (pins_->IsPinned(it.key(), it.value())) {
+      it++;
+    } else {
+      Free(it.key(), it.value());
+      it = released_.erase(it);
+    }
+  }
+}
+
+bool MappedPCM::Grow()
+{
+  qint64 count = qMin(kInitialExtentSamples << qMin(extents_.size(), 8), kMaximumExtentSamples);
+
+  ExtentPtr e = std::make_shared<Extent>();
+  e->start = capacity_;
+  e->count = count;
+
+  for (int i=0;i<LaneCount();i++) {
+    QFile* f = new QFile(QStringLiteral("%1.%2.%3").arg(filename_,
+                                                         QString::number(extents_.size()),
+                                                         QString::number(i)));
+    e->files.append(f);
+
+    if (!f->open(QFile::ReadWrite | QFile::Truncate) || !f->resize(count * LaneSampleBytes())) {
+      qWarning() << "Failed to create PCM storage" << f->fileName();
+      return false;
+    }
+
+    uchar* data = f->map(0, f->size());
+
+    if (!data) {
+      qWarning() << "Failed to map PCM storage" << f->fileName();
+      return false;
+    }
+
+    e->data.append(data);
+  }
+
+  extents_.append(e);
+  Free(capacity_, count);
+  capacity_ += count;
+
+  return true;
+}
+
+MappedPCM::ExtentPtr MappedPCM::ExtentAt(qint64 physical, qint64 *contiguous) const
+{
+  for (int i=extents_.size()-1;i>=0;i--) {
+    const ExtentPtr& e = extents_.at(i);
+
+    if (e->start <= physical) {
+      *contiguous = e->start + e->count - physical;
+      return e;
+    }
+  }
+
+  *contiguous = 0;
+  return nullptr;
+}
+
+QVector<MappedPCM::Segment> MappedPCM::PrepareWrite(qint64 at, qint64 count)
+{
+  if (at + count > length_) {
+    ResizeInternal(at + count);
+  }
+
+  int first = SplitAt(at);
+  int last = SplitAt(at + count);
+
+  for (int i=first;i<last;i++) {
+    const Segment& s = segments_.at(i);
+
+    // Storage a view is reading from is replaced rather than overwritten
+    bool pinned = (s.physical >= 0 && pins_->IsPinned(s.physical, s.count));
+
+    if (s.physical < 0 || pinned) {
+      if (pinned) {
+        Release(s.physical, s.count);
+      }
+
+      QVector<Segment> pieces;
+      Allocate(segments_.at(i).count, &pieces);
+
+      segments_.remove(i);
+      for (int j=0;j<pieces.size();j++) {
+        segments_.insert(i + j, pieces.at(j));
+      }
+
+      last += pieces.size() - 1;
+      i += pieces.size() - 1;
+    }
+  }
+
+  return segments_.mid(first, last - first);
+}
+
+void MappedPCM::PinTable::Pin(qint64 physical, qint64 count)
+{
+  QMutexLocker locker(&lock);
+
+  ranges.insert(physical, count);
+}
+
+void MappedPCM::PinTable::Unpin(qint64 physical, qint64 count)
+{
+  QMutexLocker locker(&lock);
+
+  // Only one entry, another view may have pinned the same range
+  QMultiMap<qint64, qint64>::iterator it = ranges.find(physical, count);
+
+  if (it != ranges.end()) {
+    ranges.erase(it);
+  }
+}
+
+bool MappedPCM::PinTable::IsPinned(qint64 physical, qint64 count)
+{
+  QMutexLocker locker(&lock);
+
+  for (QMultiMap<qint64, qint64>::const_iterator it=ranges.constBegin(); it!=ranges.constEnd(); it++) {
+    // Sorted by start, so nothing after this can overlap
+    if (it.key() >= physical + count) {
+      break;
+    }
+
+    if (it.key() + it.value() > physical) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,251 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MAPPEDPCM_H
+#define MAPPEDPCM_H
+
+#include <memory>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QVector>
+
+#include "codec/samplebuffer.h"
+#include "render/audioparams.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Memory-mapped PCM storage that can be edited without moving any audio around
+ *
+ * Audio is stored in memory-mapped extents on disk. A segment table maps each logical range of samples either to a
+ * physical range in those extents or to silence, so inserting, removing or silencing a range only changes the table.
+ * Physical space that's no longer referenced is reused by later writes.
+ *
+ * Samples are stored either interleaved (one lane holding whole frames, ready to send to an audio device) or planar
+ * (one lane per channel, matching SampleBuffer). Readers can take zero-copy views of the mapped memory with Map(),
+ * which stay valid even if the storage is edited or destroyed afterwards. The memory a view points to is pinned for as
+ * long as the view exists: it isn't reused, and writes over it go to new storage instead, so a view always shows the
+ * samples as they were when it was taken.
+ *
+ * All positions and lengths are in samples per channel. This class is thread-safe.
+ */
+class MappedPCM
+{
+public:
+  enum Layout {
+    kInterleaved,
+    kPlanar
+  };
+
+  /**
+   * @brief Create storage whose extents are files named after `filename`
+   *
+   * The files are removed once the storage and all views of it are destroyed.
+   */
+  MappedPCM(const QString& filename, const AudioParams& params, Layout layout = kInterleaved);
+
+  DISABLE_COPY_MOVE(MappedPCM)
+
+  const AudioParams& params() const
+  {
+    return params_;
+  }
+
+  Layout layout() const
+  {
+    return layout_;
+  }
+
+  qint64 length();
+
+  /**
+   * @brief Truncate or extend (with silence) to this length
+   */
+  void Resize(qint64 length);
+
+  /**
+   * @brief Insert silence, moving everything after `at` later
+   */
+  void Insert(qint64 at, qint64 count);
+
+  /**
+   * @brief Remove samples, moving everything after them earlier
+   */
+  void Remove(qint64 at, qint64 count);
+
+  void WriteSilence(qint64 at, qint64 count);
+
+  /**
+   * @brief Write `count` samples starting at `offset` in `samples`
+   *
+   * The storage must be in float format (as SampleBuffers always are).
+   */
+  void Write(qint64 at, SampleBufferPtr samples, qint64 offset, qint64 count);
+
+  /**
+   * @brief Write interleaved samples in the storage's format
+   */
+  void WritePacked(qint64 at, const char* data, qint64 count);
+
+  /**
+   * @brief A contiguous run of samples in mapped memory
+   */
+  struct View {
+    qint64 count;
+
+    /// One pointer for interleaved storage or one per channel for planar storage, empty if this run is silent
+    QVector<const char*> data;
+
+    /// Keeps the memory above mapped and pinned for as long as this view exists
+    std::shared_ptr<void> keep_alive;
+  };
+
+  /**
+   * @brief Returns zero-copy views of a range, which may be shorter than requested if it extends past the end
+   */
+  QVector<View> Map(qint64 at, qint64 count);
+
+  /**
+   * @brief Copy a range into `dst` as interleaved samples, returns the number of samples copied
+   */
+  qint64 ReadPacked(qint64 at, char* dst, qint64 count);
+
+  /**
+   * @brief Copy a range into a new SampleBuffer (storage must be in float format)
+   */
+  SampleBufferPtr ReadSamples(qint64 at, qint64 count);
+
+private:
+  struct Extent {
+    ~Extent();
+
+    qint64 start;
+    qint64 count;
+
+    // One file per lane
+    QVector<QFile*> files;
+    QVector<uchar*> data;
+  };
+
+  using ExtentPtr = std::shared_ptr<Extent>;
+
+  /**
+   * @brief Physical ranges referenced by views
+   *
+   * Shared with the views themselves, which unpin their range when they're destroyed, so it has its own lock.
+   */
+  struct PinTable {
+    void Pin(qint64 physical, qint64 count);
+
+    void Unpin(qint64 physical, qint64 count);
+
+    bool IsPinned(qint64 physical, qint64 count);
+
+    QMutex lock;
+
+    // Start -> count, one entry per view
+    QMultiMap<qint64, qint64> ranges;
+  };
+
+  struct Segment {
+    qint64 count;
+
+    // Start in physical storage, or -1 if this segment is silent
+    qint64 physical;
+  };
+
+  int LaneCount() const;
+
+  qint64 LaneSampleBytes() const;
+
+  void ResizeInternal(qint64 length);
+
+  int SplitAt(qint64 at);
+
+  void Coalesce();
+
+  void ReleaseSegments(int first, int last);
+
+  void Allocate(qint64 count, QVector<Segment>* pieces);
+
+  void Free(qint64 physical, qint64 count);
+
+  /**
+   * @brief Free a physical range once no views reference it
+   */
+  void Release(qint64 physical, qint64 count);
+
+  /**
+   * @brief Free any released ranges whose views have since been destroyed
+   */
+  void ReclaimReleased();
+
+  bool Grow();
+
+  /**
+   * @brief Returns the extent containing this physical position and how many samples are contiguous from it
+   */
+  ExtentPtr ExtentAt(qint64 physical, qint64* contiguous) const;
+
+  /**
+   * @brief Make sure [at, at+count) is backed by physical storage and return its physical runs
+   */
+  QVector<Segment> PrepareWrite(qint64 at, qint64 count);
+
+  template <typename Func>
+  void ForEachRun(const QVector<Segment>& runs, Func func);
+
+  static const qint64 kInitialExtentSamples;
+  static const qint64 kMaximumExtentSamples;
+
+  QString filename_;
+
+  AudioParams params_;
+
+  Layout layout_;
+
+  QMutex lock_;
+
+  qint64 length_;
+
+  QVector<Segment> segments_;
+
+  QVector<ExtentPtr> extents_;
+
+  qint64 capacity_;
+
+  // Unused physical ranges (start -> count)
+  QMap<qint64, qint64> free_;
+
+  // Ranges that were released while pinned by a view (start -> count)
+  QMap<qint64, qint64> released_;
+
+  std::shared_ptr<PinTable> pins_;
+
+};
+
+using MappedPCMPtr = std::shared_ptr<MappedPCM>;
+
+OLIVE_NAMESPACE_EXIT
+
+Q_DECLARE_METATYPE(OLIVE_NAMESPACE::MappedPCMPtr)
+
+#endif // MAPPEDPCM_H
@@ -20,81 +20,56 @@
 
 #include "outputdeviceproxy.h"
 
-#include "audiomanager.h"
+#include <cstring>
+
+#include "common/trace.h"
 
 OLIVE_NAMESPACE_ENTER
 
-AudioOutputDeviceProxy::~AudioOutputDeviceProxy()
+AudioOutputDeviceProxy::AudioOutputDeviceProxy(AudioRingBuffer *ring, AudioPlaybackFeeder *feeder) :
+  ring_(ring),
+  feeder_(feeder)
 {
-  if (file_.isOpen()) {
-    file_.close();
-  }
 }
 
-void AudioOutputDeviceProxy::SetParameters(const AudioParams &params)
+AudioOutputDeviceProxy::~AudioOutputDeviceProxy()
 {
-  params_ = params;
+  close();
 }
 
-void AudioOutputDeviceProxy::SetDevice(const QString &filename, qint64 offset, int playback_speed)
+void AudioOutputDeviceProxy::SetParameters(const AudioParams &params)
 {
-  if (file_.isOpen()) {
-    file_.close();
-  }
-
-  file_.setFileName(filename);
-
-  if (!file_.open(QFile::ReadOnly)) {
-    qCritical() << "Failed to open" << filename << "for audio playback";
-    return;
-  }
-
-  file_.seek(offset);
-
-  playback_speed_ = playback_speed;
-
-  if (qAbs(playback_speed_) != 1) {
-    tempo_processor_.Open(params_, qAbs(playback_speed_));
-  }
+  params_ = params;
 }
 
 void AudioOutputDeviceProxy::close()
 {
   QIODevice::close();
-
-  file_.close();
-
-  if (tempo_processor_.IsOpen()) {
-    tempo_processor_.Close();
-  }
 }
 
 qint64 AudioOutputDeviceProxy::readData(char *data, qint64 maxlen)
 {
-  if (!file_.isOpen()) {
+  if (!params_.is_valid()) {
     return 0;
   }
 
-  qint64 read_count;
-
-  if (tempo_processor_.IsOpen()) {
-
-    while ((read_count = tempo_processor_.Pull(data, static_cast<int>(maxlen))) == 0) {
-      int dev_read = static_cast<int>(ReverseAwareRead(data, maxlen));
+  // Only hand over whole samples
+  maxlen -= maxlen % params_.samples_to_bytes(1);
 
-      if (!dev_read) {
-        break;
-      }
+  qint64 read_count = ring_->Read(data, maxlen);
 
-      tempo_processor_.Push(data, dev_read);
+  if (read_count < maxlen) {
+    if (!feeder_->IsFinished()) {
+      TRACE_SCOPE_ARG("audio", "Underrun", maxlen - read_count);
     }
 
-  } else {
-    // If we aren't doing any tempo processing, simply passthrough the read signal
-    read_count = ReverseAwareRead(data, maxlen);
+    // Unsigned 8-bit audio is centered on 128, everything else on 0
+    memset(data + read_count,
+           (params_.format() == SampleFormat::SAMPLE_FMT_U8) ? 0x80 : 0,
+           static_cast<size_t>(maxlen - read_count));
   }
 
-  return read_count;
+  return maxlen;
 }
 
 qint64 AudioOutputDeviceProxy::writeData(const char *data, qint64 maxSize)
@@ -105,33 +80,4 @@ qint64 AudioOutputDeviceProxy::writeData(const char *data, qint64 maxSize)
   return 0;
 }
 
-qint64 AudioOutputDeviceProxy::ReverseAwareRead(char *data, qint64 maxlen)
-{
-  qint64 new_pos = -1;
-
-  if (playback_speed_ < 0) {
-    // If we're reversing, we'll seek back by maxlen bytes before we read
-    new_pos = file_.pos() - maxlen;
-
-    if (new_pos < 0) {
-      maxlen = file_.pos();
-
-      new_pos = 0;
-    }
-
-    file_.seek(new_pos);
-  }
-
-  qint64 read_count = file_.read(data, maxlen);
-
-  if (playback_speed_ < 0) {
-    file_.seek(new_pos);
-
-    // Reverse the samples here
-    AudioManager::ReverseBuffer(data, static_cast<int>(read_count), params_.samples_to_bytes(1));
-  }
-
-  return read_count;
-}
-
 OLIVE_NAMESPACE_EXIT
@@ -21,28 +21,30 @@
 #ifndef AUDIOOUTPUTDEVICEPROXY_H
 #define AUDIOOUTPUTDEVICEPROXY_H
 
-#include <QFile>
+#include <QIODevice>
 
+#include "audio/playbackfeeder.h"
 #include "common/define.h"
-#include "tempoprocessor.h"
 
 OLIVE_NAMESPACE_ENTER
 
 /**
- * @brief QIODevice wrapper that can adjust speed/reverse an audio file
+ * @brief QIODevice the audio output pulls from during playback
+ *
+ * Only pops from the ring an AudioPlaybackFeeder fills, so reads never wait on anything. If the ring runs dry, the
+ * rest of the read is silence rather than a short read so the device (and the playback clock following it) keeps
+ * running.
  */
 class AudioOutputDeviceProxy : public QIODevice
 {
   Q_OBJECT
 public:
-  AudioOutputDeviceProxy() = default;
+  AudioOutputDeviceProxy(AudioRingBuffer* ring, AudioPlaybackFeeder* feeder);
 
   virtual ~AudioOutputDeviceProxy() override;
 
   void SetParameters(const AudioParams& params);
 
-  void SetDevice(const QString &filename, qint64 offset, int playback_speed);
-
   virtual void close() override;
 
 protected:
@@ -51,16 +53,12 @@ protected:
   virtual qint64 writeData(const char *data, qint64 maxSize) override;
 
 private:
-  qint64 ReverseAwareRead(char* data, qint64 maxlen);
-
-  QFile file_;
+  AudioRingBuffer* ring_;
 
-  TempoProcessor tempo_processor_;
+  AudioPlaybackFeeder* feeder_;
 
   AudioParams params_;
 
-  int playback_speed_;
-
 };
 
 OLIVE_NAMESPACE_EXIT
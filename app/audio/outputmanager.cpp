@@ -27,16 +27,34 @@
 
 OLIVE_NAMESPACE_ENTER
 
+const int AudioOutputManager::kRingMilliseconds = 500;
+
 AudioOutputManager::AudioOutputManager(QObject *parent) :
   QObject(parent),
   output_(nullptr),
-  push_device_(nullptr)
+  push_device_(nullptr),
+  feeder_(&ring_),
+  device_proxy_(&ring_, &feeder_),
+  null_sink_timer_(this),
+  null_sink_consumed_(0),
+  requested_session_(0),
+  active_session_(-1),
+  played_usecs_(0)
 {
+  feeder_thread_.setObjectName(QStringLiteral("AudioFeeder"));
+  feeder_thread_.start(QThread::HighPriority);
+  feeder_.moveToThread(&feeder_thread_);
+
+  null_sink_timer_.setInterval(10);
+  connect(&null_sink_timer_, &QTimer::timeout, this, &AudioOutputManager::NullSinkPull);
 }
 
 AudioOutputManager::~AudioOutputManager()
 {
   Close();
+
+  feeder_thread_.quit();
+  feeder_thread_.wait();
 }
 
 void AudioOutputManager::Push(const QByteArray& samples)
@@ -57,12 +75,10 @@ void AudioOutputManager::Push(const QByteArray& samples)
 
 void AudioOutputManager::ResetToPushMode()
 {
+  StopPulling();
+
   // If we have a null push device, then we currently have the output in pull mode. We restore it to push mode here.
   if (output_ && !push_device_) {
-    output_->stop();
-
-    device_proxy_.close();
-
     // Put QAudioOutput back into push mode
     push_device_ = output_->start();
   }
@@ -75,33 +91,80 @@ void AudioOutputManager::SetParameters(AudioParams params)
 
 void AudioOutputManager::Close()
 {
+  StopPulling();
+
   if (output_) {
     output_->stop();
 
-    if (device_proxy_.isOpen()) {
-      device_proxy_.close();
-    }
-
     output_->deleteLater();
     output_ = nullptr;
   }
 }
 
-void AudioOutputManager::PullFromDevice(const QString &filename, qint64 offset, int playback_speed)
+void AudioOutputManager::PullFromDevice(MappedPCMPtr pcm, qint64 offset, int playback_speed, int session)
 {
-  if (!output_) {
-    return;
+  // Stop any current output and disable push mode
+  StopPulling();
+
+  if (output_) {
+    output_->stop();
   }
 
-  // Stop any current output and disable push mode
-  output_->stop();
   push_device_ = nullptr;
   push_samples_.clear();
 
-  // Pull from the device
-  device_proxy_.SetDevice(filename, offset, playback_speed);
+  if (!pcm) {
+    return;
+  }
+
+  pull_params_ = pcm->params();
+
+  // Neither side is using the ring now, so it's safe to reset
+  qint64 ring_size = pull_params_.samples_to_bytes(pull_params_.sample_rate() * kRingMilliseconds / 1000);
+  if (ring_.capacity() != ring_size) {
+    ring_.Allocate(ring_size);
+  } else {
+    ring_.Clear();
+  }
+
+  // Blocks until the ring has been filled so the device doesn't start on silence
+  QMetaObject::invokeMethod(&feeder_,
+                            "Start",
+                            Qt::BlockingQueuedConnection,
+                            OLIVE_NS_ARG(MappedPCMPtr, pcm),
+                            Q_ARG(qint64, offset),
+                            Q_ARG(int, playback_speed));
+
+  // Reset before publishing the session so readers never see the last session's time
+  played_usecs_.store(0, std::memory_order_relaxed);
+  active_session_.store(session, std::memory_order_release);
+
+  device_proxy_.SetParameters(pull_params_);
   device_proxy_.open(QIODevice::ReadOnly);
-  output_->start(&device_proxy_);
+
+  if (output_) {
+    output_->start(&device_proxy_);
+  } else {
+    null_sink_consumed_ = 0;
+    null_sink_clock_.start();
+    null_sink_timer_.start();
+  }
+}
+
+void AudioOutputManager::StopPulling()
+{
+  if (device_proxy_.isOpen()) {
+    if (output_) {
+      output_->stop();
+    }
+
+    null_sink_timer_.stop();
+
+    device_proxy_.close();
+
+    // Blocks so that the ring is guaranteed to be idle afterwards
+    QMetaObject::invokeMethod(&feeder_, "Stop", Qt::BlockingQueuedConnection);
+  }
 }
 
 void AudioOutputManager::PushMoreSamples()
@@ -139,12 +202,48 @@ void AudioOutputManager::SetOutputDevice(QAudioDeviceInfo info, QAudioFormat for
   output_->setNotifyInterval(1);
   push_device_ = output_->start();
   connect(output_, &QAudioOutput::notify, this, &AudioOutputManager::PushMoreSamples);
+  connect(output_, &QAudioOutput::notify, this, &AudioOutputManager::UpdatePlayedTime);
   connect(output_, &QAudioOutput::notify, this, &AudioOutputManager::OutputNotified);
 
   // Un-comment this to get debug information about what the audio output is doing
   //connect(output_, &QAudioOutput::stateChanged, this, &AudioOutputManager::OutputStateChanged);
 }
 
+void AudioOutputManager::UpdatePlayedTime()
+{
+  if (output_ && !push_device_) {
+    // processedUSecs() counts what's been handed to the device, so take off what's still waiting in its buffer
+    qint64 queued_bytes = qMax(0, output_->bufferSize() - output_->bytesFree());
+    qint64 played = output_->processedUSecs() - output_->format().durationForBytes(static_cast<qint32>(queued_bytes));
+
+    // Never step the clock backwards if the buffer level reads high for a moment
+    played = qMax(played, played_usecs_.load(std::memory_order_relaxed));
+
+    played_usecs_.store(played, std::memory_order_relaxed);
+  }
+}
+
+void AudioOutputManager::NullSinkPull()
+{
+  // Consume whatever a real device would have by now
+  qint64 elapsed_usecs = null_sink_clock_.nsecsElapsed() / 1000;
+  qint64 due = elapsed_usecs * pull_params_.sample_rate() / 1000000 - null_sink_consumed_;
+
+  if (due > 0) {
+    int bytes = pull_params_.samples_to_bytes(static_cast<int>(due));
+
+    if (null_sink_buffer_.size() < bytes) {
+      null_sink_buffer_.resize(bytes);
+    }
+
+    device_proxy_.read(null_sink_buffer_.data(), bytes);
+
+    null_sink_consumed_ += due;
+  }
+
+  played_usecs_.store(null_sink_consumed_ * 1000000 / pull_params_.sample_rate(), std::memory_order_relaxed);
+}
+
 void AudioOutputManager::OutputStateChanged(QAudio::State state)
 {
   qDebug() << state << output_->error();
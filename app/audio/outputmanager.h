@@ -21,14 +21,19 @@
 #ifndef AUDIOHYBRIDDEVICE_H
 #define AUDIOHYBRIDDEVICE_H
 
+#include <atomic>
 #include <memory>
 #include <QAudioOutput>
 #include <QBuffer>
+#include <QElapsedTimer>
 #include <QIODevice>
 #include <QMutex>
 #include <QThread>
+#include <QTimer>
 
+#include "audioringbuffer.h"
 #include "outputdeviceproxy.h"
+#include "playbackfeeder.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -43,17 +48,45 @@ public:
   // Thread-safe
   void Push(const QByteArray &samples);
 
+  /**
+   * @brief Invalidate the playback clock ahead of starting or stopping output
+   *
+   * Thread-safe. Returns the session to pass to PullFromDevice(). GetPlayedUSecs() returns -1 until that session has
+   * started, so nothing from an earlier session can leak into the new one.
+   */
+  int BeginSession()
+  {
+    return ++requested_session_;
+  }
+
+  /**
+   * @brief Microseconds of audio the output has consumed in the current session, or -1 if it hasn't started
+   *
+   * Thread-safe.
+   */
+  qint64 GetPlayedUSecs() const
+  {
+    if (active_session_.load(std::memory_order_acquire) != requested_session_.load(std::memory_order_relaxed)) {
+      return -1;
+    }
+
+    return played_usecs_.load(std::memory_order_relaxed);
+  }
+
 public slots:
   // Queued
   void SetOutputDevice(QAudioDeviceInfo info, QAudioFormat format);
 
   /**
-   * @brief Connect a QIODevice (e.g. QFile) to start sending to the audio output
+   * @brief Connect mapped PCM audio to start sending to the audio output
+   *
+   * This will clear any pushed samples or audio currently being read and will start reading from this next time
+   * the audio output requests data. `offset` is in samples. `session` comes from BeginSession().
    *
-   * This will clear any pushed samples or QIODevices currently being read and will start reading from this next time
-   * the audio output requests data.
+   * If there's no output device, a null sink consumes the audio in real time instead so the playback clock still
+   * runs.
    */
-  void PullFromDevice(const QString &filename, qint64 offset, int playback_speed);
+  void PullFromDevice(OLIVE_NAMESPACE::MappedPCMPtr pcm, qint64 offset, int playback_speed, int session);
 
   // Queued
   void ResetToPushMode();
@@ -68,6 +101,8 @@ signals:
   void OutputNotified();
 
 private:
+  void StopPulling();
+
   QAudioOutput* output_;
   QIODevice* push_device_;
 
@@ -75,11 +110,33 @@ private:
   QByteArray push_samples_;
   int push_sample_index_;
 
+  AudioRingBuffer ring_;
+
+  QThread feeder_thread_;
+  AudioPlaybackFeeder feeder_;
+
   AudioOutputDeviceProxy device_proxy_;
 
+  AudioParams pull_params_;
+
+  QTimer null_sink_timer_;
+  QElapsedTimer null_sink_clock_;
+  qint64 null_sink_consumed_;
+  QByteArray null_sink_buffer_;
+
+  std::atomic<int> requested_session_;
+  std::atomic<int> active_session_;
+  std::atomic<qint64> played_usecs_;
+
+  static const int kRingMilliseconds;
+
 private slots:
   void PushMoreSamples();
 
+  void UpdatePlayedTime();
+
+  void NullSinkPull();
+
   void OutputStateChanged(QAudio::State state);
 
 };
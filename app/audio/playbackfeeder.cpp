@@ -0,0 +1,155 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "playbackfeeder.h"
+
+#include "audiomanager.h"
+#include "common/trace.h"
+
+OLIVE_NAMESPACE_ENTER
+
+AudioPlaybackFeeder::AudioPlaybackFeeder(AudioRingBuffer *ring, QObject *parent) :
+  QObject(parent),
+  ring_(ring),
+  fill_timer_(this),
+  position_(0),
+  playback_speed_(0),
+  finished_(true)
+{
+  // Well within the time it takes the device to drain the ring
+  fill_timer_.setInterval(10);
+  connect(&fill_timer_, &QTimer::timeout, this, &AudioPlaybackFeeder::Fill);
+}
+
+void AudioPlaybackFeeder::Start(MappedPCMPtr pcm, qint64 offset, int playback_speed)
+{
+  Stop();
+
+  if (!pcm) {
+    qCritical() << "No audio provided for audio playback";
+    return;
+  }
+
+  pcm_ = pcm;
+  params_ = pcm_->params();
+  position_ = offset;
+  playback_speed_ = playback_speed;
+
+  if (qAbs(playback_speed_) != 1) {
+    tempo_processor_.Open(params_, qAbs(playback_speed_));
+  }
+
+  // Read in chunks of about 10ms
+  chunk_.resize(static_cast<int>(params_.samples_to_bytes(qMax(1, params_.sample_rate() / 100))));
+
+  finished_.store(false, std::memory_order_release);
+
+  Fill();
+
+  fill_timer_.start();
+}
+
+void AudioPlaybackFeeder::Stop()
+{
+  fill_timer_.stop();
+
+  pcm_ = nullptr;
+
+  if (tempo_processor_.IsOpen()) {
+    tempo_processor_.Close();
+  }
+
+  finished_.store(true, std::memory_order_release);
+}
+
+void AudioPlaybackFeeder::Fill()
+{
+  if (!pcm_) {
+    return;
+  }
+
+  TRACE_SCOPE("audio", "FillRing");
+
+  while (ring_->WriteSpace() >= chunk_.size()) {
+    qint64 read_count = Read(chunk_.data(), chunk_.size());
+
+    if (read_count == 0) {
+      // Nothing left to play, the device will drain what's in the ring
+      fill_timer_.stop();
+      finished_.store(true, std::memory_order_release);
+      break;
+    }
+
+    ring_->Write(chunk_.constData(), read_count);
+  }
+}
+
+qint64 AudioPlaybackFeeder::Read(char *data, qint64 maxlen)
+{
+  qint64 read_count;
+
+  if (tempo_processor_.IsOpen()) {
+
+    while ((read_count = tempo_processor_.Pull(data, static_cast<int>(maxlen))) == 0) {
+      int dev_read = static_cast<int>(ReverseAwareRead(data, maxlen));
+
+      if (!dev_read) {
+        break;
+      }
+
+      tempo_processor_.Push(data, dev_read);
+    }
+
+  } else {
+    read_count = ReverseAwareRead(data, maxlen);
+  }
+
+  return read_count;
+}
+
+qint64 AudioPlaybackFeeder::ReverseAwareRead(char *data, qint64 maxlen)
+{
+  qint64 max_samples = maxlen / params_.samples_to_bytes(1);
+
+  if (playback_speed_ < 0) {
+    // If we're reversing, we'll seek back by maxlen before we read
+    max_samples = qMin(max_samples, position_);
+    position_ -= max_samples;
+  } else {
+    max_samples = qMin(max_samples, pcm_->length() - position_);
+  }
+
+  if (max_samples <= 0) {
+    return 0;
+  }
+
+  qint64 read_count = params_.samples_to_bytes(pcm_->ReadPacked(position_, data, max_samples));
+
+  if (playback_speed_ < 0) {
+    // Reverse the samples here
+    AudioManager::ReverseBuffer(data, static_cast<int>(read_count), params_.samples_to_bytes(1));
+  } else {
+    position_ += max_samples;
+  }
+
+  return read_count;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,97 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef AUDIOPLAYBACKFEEDER_H
+#define AUDIOPLAYBACKFEEDER_H
+
+#include <atomic>
+#include <QTimer>
+
+#include "audio/audioringbuffer.h"
+#include "audio/mappedpcm.h"
+#include "tempoprocessor.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Keeps an AudioRingBuffer topped up from an AudioPlaybackCache's PCM
+ *
+ * Lives on its own thread so that reading the cache (which may have to wait on the disk), reversing and tempo
+ * processing all happen away from the audio device's callback. The callback only has to pop from the ring.
+ */
+class AudioPlaybackFeeder : public QObject
+{
+  Q_OBJECT
+public:
+  AudioPlaybackFeeder(AudioRingBuffer* ring, QObject* parent = nullptr);
+
+  /**
+   * @brief Whether every sample up to the end of the PCM has been written to the ring
+   *
+   * Thread-safe.
+   */
+  bool IsFinished() const
+  {
+    return finished_.load(std::memory_order_acquire);
+  }
+
+public slots:
+  /**
+   * @brief Fill the ring from `pcm` starting at sample `offset` and keep it full until Stop()
+   *
+   * The ring must be empty and not being read from. It's filled before this returns so the device has audio as
+   * soon as it starts.
+   */
+  void Start(OLIVE_NAMESPACE::MappedPCMPtr pcm, qint64 offset, int playback_speed);
+
+  void Stop();
+
+private:
+  qint64 Read(char* data, qint64 maxlen);
+
+  qint64 ReverseAwareRead(char* data, qint64 maxlen);
+
+  AudioRingBuffer* ring_;
+
+  QTimer fill_timer_;
+
+  MappedPCMPtr pcm_;
+
+  AudioParams params_;
+
+  // Current read position in samples
+  qint64 position_;
+
+  int playback_speed_;
+
+  TempoProcessor tempo_processor_;
+
+  QByteArray chunk_;
+
+  std::atomic<bool> finished_;
+
+private slots:
+  void Fill();
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // AUDIOPLAYBACKFEEDER_H
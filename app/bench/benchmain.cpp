@@ -0,0 +1,238 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+/**
+ * olive-bench: times Olive's rendering pipeline on synthetic projects
+ *
+ * Runs headless and without a GPU, writing results as JSON so runs can be compared across commits and machines.
+ */
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavfilter/avfilter.h>
+}
+
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+
+#include "bench/benchmark.h"
+#include "bench/benchmarksuite.h"
+#include "bench/syntheticproject.h"
+#include "common/trace.h"
+#include "config/config.h"
+#include "core.h"
+#include "node/factory.h"
+#include "render/colormanager.h"
+#include "render/diskmanager.h"
+#include "render/pixelformat.h"
+
+int main(int argc, char *argv[]) {
+  // No display is needed, so don't require one
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QGuiApplication a(argc, argv);
+
+  QCoreApplication::setOrganizationName("olivevideoeditor.org");
+  QCoreApplication::setOrganizationDomain("olivevideoeditor.org");
+  QCoreApplication::setApplicationName("Olive");
+
+  QString app_version = APPVERSION;
+#ifdef GITHASH
+  app_version.append("-");
+  app_version.append(GITHASH);
+#endif
+
+  QCoreApplication::setApplicationVersion(app_version);
+
+  // Keep the user's config and caches out of it
+  QStandardPaths::setTestModeEnabled(true);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(QCoreApplication::translate("main", "Benchmarks Olive's rendering pipeline."));
+  parser.addHelpOption();
+  parser.addVersionOption();
+
+  QCommandLineOption frames_option(QStringLiteral("frames"),
+                                   QCoreApplication::translate("main", "Length of the synthetic sequence."),
+                                   QCoreApplication::translate("main", "frames"),
+                                   QStringLiteral("120"));
+  parser.addOption(frames_option);
+
+  QCommandLineOption width_option(QStringLiteral("width"),
+                                  QCoreApplication::translate("main", "Width of the synthetic sequence."),
+                                  QCoreApplication::translate("main", "pixels"),
+                                  QStringLiteral("1920"));
+  parser.addOption(width_option);
+
+  QCommandLineOption height_option(QStringLiteral("height"),
+                                   QCoreApplication::translate("main", "Height of the synthetic sequence."),
+                                   QCoreApplication::translate("main", "pixels"),
+                                   QStringLiteral("1080"));
+  parser.addOption(height_option);
+
+  QCommandLineOption video_tracks_option(QStringLiteral("video-tracks"),
+                                         QCoreApplication::translate("main", "Number of stacked video tracks."),
+                                         QCoreApplication::translate("main", "count"),
+                                         QStringLiteral("3"));
+  parser.addOption(video_tracks_option);
+
+  QCommandLineOption audio_tracks_option(QStringLiteral("audio-tracks"),
+                                         QCoreApplication::translate("main", "Number of audio tracks."),
+                                         QCoreApplication::translate("main", "count"),
+                                         QStringLiteral("2"));
+  parser.addOption(audio_tracks_option);
+
+  QCommandLineOption iterations_option(QStringLiteral("iterations"),
+                                       QCoreApplication::translate("main", "Timed runs of each stage."),
+                                       QCoreApplication::translate("main", "count"),
+                                       QStringLiteral("5"));
+  parser.addOption(iterations_option);
+
+  QCommandLineOption stages_option(QStringLiteral("stages"),
+                                   QCoreApplication::translate("main", "Comma-separated stages to run (default all)."),
+                                   QCoreApplication::translate("main", "stages"));
+  parser.addOption(stages_option);
+
+  QCommandLineOption output_option({QStringLiteral("o"), QStringLiteral("output")},
+                                   QCoreApplication::translate("main", "Write results to a file instead of stdout."),
+                                   QCoreApplication::translate("main", "file"));
+  parser.addOption(output_option);
+
+  QCommandLineOption trace_option(QStringLiteral("trace"),
+                                  QCoreApplication::translate("main", "Record a performance trace of the run."),
+                                  QCoreApplication::translate("main", "file"));
+  parser.addOption(trace_option);
+
+  parser.process(a);
+
+  if (parser.isSet(trace_option)) {
+    OLIVE_NAMESPACE::Trace::SetEnabled(true);
+  }
+
+  OLIVE_NAMESPACE::SyntheticProject::Settings settings;
+  settings.frames = qMax(2, parser.value(frames_option).toInt());
+  settings.width = qMax(16, parser.value(width_option).toInt());
+  settings.height = qMax(16, parser.value(height_option).toInt());
+  settings.video_tracks = qMax(1, parser.value(video_tracks_option).toInt());
+  settings.audio_tracks = qMax(1, parser.value(audio_tracks_option).toInt());
+
+  int iterations = parser.value(iterations_option).toInt();
+
+  QStringList stages;
+  if (parser.isSet(stages_option)) {
+    stages = parser.value(stages_option).split(',', QString::SkipEmptyParts);
+  }
+
+  // Register FFmpeg codecs and filters (deprecated in 4.0+)
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+  av_register_all();
+#endif
+#if LIBAVFILTER_VERSION_INT < AV_VERSION_INT(7, 14, 100)
+  avfilter_register_all();
+#endif
+
+  // Media, caches and exports all go in here and are deleted on exit
+  QTemporaryDir working_dir;
+  if (!working_dir.isValid()) {
+    qCritical() << "Failed to create working directory";
+    return 1;
+  }
+
+  OLIVE_NAMESPACE::Config::Current().SetDefaults();
+  OLIVE_NAMESPACE::Config::Current()["DiskCachePath"] = working_dir.filePath(QStringLiteral("cache"));
+
+  OLIVE_NAMESPACE::Core::DeclareTypesForQt();
+  OLIVE_NAMESPACE::NodeFactory::Initialize();
+  OLIVE_NAMESPACE::ColorManager::SetUpDefaultConfig();
+  OLIVE_NAMESPACE::DiskManager::CreateInstance();
+  OLIVE_NAMESPACE::PixelFormat::CreateInstance();
+
+  int ret = 0;
+
+  {
+    OLIVE_NAMESPACE::SyntheticProject project(settings, working_dir.path());
+
+    qInfo() << "Creating synthetic project...";
+
+    if (project.Create()) {
+      OLIVE_NAMESPACE::Benchmark benchmark(iterations);
+      OLIVE_NAMESPACE::BenchmarkSuite suite(&project, &benchmark, stages, working_dir.path());
+
+      suite.Run();
+
+      QJsonObject config;
+      config.insert(QStringLiteral("width"), settings.width);
+      config.insert(QStringLiteral("height"), settings.height);
+      config.insert(QStringLiteral("timebase"), settings.timebase.toString());
+      config.insert(QStringLiteral("frames"), settings.frames);
+      config.insert(QStringLiteral("video_tracks"), settings.video_tracks);
+      config.insert(QStringLiteral("audio_tracks"), settings.audio_tracks);
+      config.insert(QStringLiteral("sample_rate"), settings.sample_rate);
+      config.insert(QStringLiteral("iterations"), iterations);
+
+      QJsonObject root;
+      root.insert(QStringLiteral("version"), app_version);
+      root.insert(QStringLiteral("qt_version"), QString::fromLatin1(qVersion()));
+      root.insert(QStringLiteral("threads"), QThread::idealThreadCount());
+      root.insert(QStringLiteral("config"), config);
+      root.insert(QStringLiteral("results"), benchmark.ToJson());
+
+      QByteArray json = QJsonDocument(root).toJson();
+
+      if (parser.isSet(output_option)) {
+        QFile output(parser.value(output_option));
+
+        if (output.open(QFile::WriteOnly)) {
+          output.write(json);
+        } else {
+          qCritical() << "Failed to write" << output.fileName();
+          ret = 1;
+        }
+      } else {
+        QFile output;
+        output.open(stdout, QFile::WriteOnly);
+        output.write(json);
+      }
+    } else {
+      qCritical().noquote() << "Failed to create synthetic project:" << project.error();
+      ret = 1;
+    }
+  }
+
+  if (parser.isSet(trace_option) && !OLIVE_NAMESPACE::Trace::WriteChromeJSON(parser.value(trace_option))) {
+    qCritical() << "Failed to write trace to" << parser.value(trace_option);
+    ret = 1;
+  }
+
+  OLIVE_NAMESPACE::PixelFormat::DestroyInstance();
+  OLIVE_NAMESPACE::DiskManager::DestroyInstance();
+  OLIVE_NAMESPACE::NodeFactory::Destroy();
+
+  return ret;
+}
@@ -0,0 +1,157 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+OLIVE_NAMESPACE_ENTER
+
+Benchmark::Benchmark(int iterations) :
+  iterations_(qMax(1, iterations))
+{
+}
+
+void Benchmark::Run(const QString &name, qint64 items, const QString &unit, std::function<void ()> function, std::function<void ()> setup)
+{
+  Result r;
+  r.name = name;
+  r.items = items;
+  r.unit = unit;
+
+  // Warm up
+  if (setup) {
+    setup();
+  }
+  function();
+
+  QElapsedTimer timer;
+
+  for (int i=0;i<iterations_;i++) {
+    if (setup) {
+      setup();
+    }
+
+    timer.start();
+    function();
+    r.nsecs.append(timer.nsecsElapsed());
+  }
+
+  results_.append(r);
+
+  QVector<qint64> sorted = r.nsecs;
+  std::sort(sorted.begin(), sorted.end());
+  qInfo().noquote() << QStringLiteral("%1: %2 ms (median of %3)").arg(name,
+                                                                      QString::number(sorted.at(sorted.size() / 2) * 0.000001, 'f', 3),
+                                                                      QString::number(iterations_));
+}
+
+void Benchmark::Skip(const QString &name, const QString &reason)
+{
+  Result r;
+  r.name = name;
+  r.items = 0;
+  r.skipped = reason;
+
+  results_.append(r);
+
+  qWarning().noquote() << QStringLiteral("%1: skipped (%2)").arg(name, reason);
+}
+
+void Benchmark::SetCounter(const QString &name, const QString &counter, qint64 value)
+{
+  for (int i=results_.size()-1;i>=0;i--) {
+    if (results_.at(i).name == name) {
+      results_[i].counters.insert(counter, value);
+
+      qInfo().noquote() << QStringLiteral("%1: %2 = %3").arg(name, counter, QString::number(value));
+      return;
+    }
+  }
+
+  qWarning() << "No results to attach counter" << counter << "to for" << name;
+}
+
+bool Benchmark::IsSelected(const QString &name, const QStringList &filter)
+{
+  if (filter.isEmpty()) {
+    return true;
+  }
+
+  return filter.contains(name) || filter.contains(name.section('.', 0, 0));
+}
+
+QJsonArray Benchmark::ToJson() const
+{
+  QJsonArray array;
+
+  foreach (const Result& r, results_) {
+    QJsonObject obj;
+
+    obj.insert(QStringLiteral("name"), r.name);
+
+    if (!r.skipped.isEmpty()) {
+      obj.insert(QStringLiteral("skipped"), r.skipped);
+      array.append(obj);
+      continue;
+    }
+
+    QVector<qint64> sorted = r.nsecs;
+    std::sort(sorted.begin(), sorted.end());
+
+    qint64 total = 0;
+    foreach (qint64 t, sorted) {
+      total += t;
+    }
+
+    double median_ms = sorted.at(sorted.size() / 2) * 0.000001;
+
+    obj.insert(QStringLiteral("iterations"), sorted.size());
+    obj.insert(QStringLiteral("items"), r.items);
+    obj.insert(QStringLiteral("unit"), r.unit);
+    obj.insert(QStringLiteral("min_ms"), sorted.first() * 0.000001);
+    obj.insert(QStringLiteral("median_ms"), median_ms);
+    obj.insert(QStringLiteral("mean_ms"), static_cast<double>(total) / sorted.size() * 0.000001);
+    obj.insert(QStringLiteral("max_ms"), sorted.last() * 0.000001);
+
+    if (median_ms > 0) {
+      obj.insert(QStringLiteral("%1_per_second").arg(r.unit), r.items / (median_ms * 0.001));
+    }
+
+    if (!r.counters.isEmpty()) {
+      QJsonObject counters;
+
+      for (auto it=r.counters.cbegin();it!=r.counters.cend();it++) {
+        counters.insert(it.key(), it.value());
+      }
+
+      obj.insert(QStringLiteral("counters"), counters);
+    }
+
+    array.append(obj);
+  }
+
+  return array;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,95 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <QJsonArray>
+#include <QMap>
+#include <QStringList>
+#include <QVector>
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Times named stages and collects their results as JSON
+ *
+ * Each stage is run once untimed to warm up caches and then a fixed number of timed iterations. Results report the
+ * minimum, median, mean and maximum time of an iteration along with throughput in the stage's unit (frames, samples,
+ * operations, etc.), so runs on different machines or commits can be compared directly.
+ */
+class Benchmark
+{
+public:
+  Benchmark(int iterations);
+
+  /**
+   * @brief Time `function`, which processes `items` units of work per call
+   *
+   * If set, `setup` is called before every run (including the warm-up) and isn't included in the time.
+   */
+  void Run(const QString& name,
+           qint64 items,
+           const QString& unit,
+           std::function<void()> function,
+           std::function<void()> setup = nullptr);
+
+  /**
+   * @brief Record a stage that couldn't run, e.g. because its prerequisites failed
+   */
+  void Skip(const QString& name, const QString& reason);
+
+  /**
+   * @brief Attach a value counted during the last run of stage `name`, e.g. cache hits, to its results
+   */
+  void SetCounter(const QString& name, const QString& counter, qint64 value);
+
+  /**
+   * @brief Returns whether a stage should be run given a comma-separated filter (empty runs everything)
+   *
+   * A stage matches if its name or the part of its name before the first '.' is in the filter, so "micro" selects
+   * every micro-benchmark.
+   */
+  static bool IsSelected(const QString& name, const QStringList& filter);
+
+  QJsonArray ToJson() const;
+
+private:
+  struct Result {
+    QString name;
+    qint64 items;
+    QString unit;
+    QVector<qint64> nsecs;
+    QString skipped;
+    QMap<QString, qint64> counters;
+  };
+
+  int iterations_;
+
+  QVector<Result> results_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // BENCHMARK_H
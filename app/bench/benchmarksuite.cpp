@@ -0,0 +1,604 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "benchmarksuite.h"
+
+#include <random>
+#include <QDir>
+#include <QEventLoop>
+#include <QtConcurrent/QtConcurrent>
+
+#include "bench/cpubackend.h"
+#include "cli/clitask/clitaskdialog.h"
+#include "codec/decoder.h"
+#include "common/memorypool.h"
+#include "common/ticktime.h"
+#include "node/audio/mix/mix.h"
+#include "node/filter/blur/blur.h"
+#include "node/nodehasher.h"
+#include "node/traverser.h"
+#include "render/backend/opengl/opengltexturecache.h"
+#include "render/framehashcache.h"
+#include "task/export/export.h"
+
+OLIVE_NAMESPACE_ENTER
+
+BenchmarkSuite::BenchmarkSuite(SyntheticProject *project, Benchmark *benchmark, const QStringList &filter, const QString &working_dir) :
+  project_(project),
+  benchmark_(benchmark),
+  filter_(filter),
+  working_dir_(working_dir)
+{
+  times_ = project_->GetFrameTimes();
+}
+
+void BenchmarkSuite::Run()
+{
+  // Disk cache stages store frames under their real hashes
+  hashes_ = NodeHasher::HashFrames(project_->viewer()->texture_input()->get_connected_node(),
+                                   project_->viewer()->video_params(),
+                                   times_);
+
+  RunTraversal();
+  RunHash();
+  RunDecode();
+  RunPixelConversion();
+  RunDiskCache();
+  RunRender();
+  RunExport();
+
+  RunMemoryPool();
+  RunBlur();
+  RunTime();
+  RunMix();
+  RunTextureCache();
+}
+
+void BenchmarkSuite::RunTraversal()
+{
+  if (!IsSelected(QStringLiteral("traversal"))) {
+    return;
+  }
+
+  ViewerOutput* viewer = project_->viewer();
+  rational timebase = viewer->video_params().time_base();
+
+  benchmark_->Run(QStringLiteral("traversal"), times_.size(), QStringLiteral("frames"), [this, viewer, timebase]{
+    NodeTraverser traverser;
+
+    foreach (const rational& t, times_) {
+      traverser.GenerateTable(viewer, TimeRange(t, t + timebase));
+    }
+  });
+}
+
+void BenchmarkSuite::RunHash()
+{
+  const Node* node = project_->viewer()->texture_input()->get_connected_node();
+  VideoParams params = project_->viewer()->video_params();
+
+  if (IsSelected(QStringLiteral("hash"))) {
+    benchmark_->Run(QStringLiteral("hash"), times_.size(), QStringLiteral("frames"), [this, node, params]{
+      NodeHasher::HashFrames(node, params, times_);
+    });
+  }
+
+  if (IsSelected(QStringLiteral("hash.per_frame"))) {
+    // Without a shared Memo, for comparison with the batched hash above
+    benchmark_->Run(QStringLiteral("hash.per_frame"), times_.size(), QStringLiteral("frames"), [this, node, params]{
+      foreach (const rational& t, times_) {
+        NodeHasher::HashFrame(node, params, t);
+      }
+    });
+
+    // Frames cached under one function's keys must be found with the other's
+    for (int i=0;i<times_.size();i++) {
+      if (NodeHasher::HashFrame(node, params, times_.at(i)) != hashes_.at(i)) {
+        qWarning() << "HashFrame() and HashFrames() disagree at" << times_.at(i).toDouble();
+        break;
+      }
+    }
+  }
+}
+
+void BenchmarkSuite::RunDecode()
+{
+  if (!IsSelected(QStringLiteral("decode"))) {
+    return;
+  }
+
+  StreamPtr stream = project_->video_stream();
+
+  DecoderPtr decoder = Decoder::CreateFromID(stream->footage()->decoder());
+
+  if (!decoder) {
+    benchmark_->Skip(QStringLiteral("decode"), QStringLiteral("no decoder for test pattern"));
+    return;
+  }
+
+  decoder->set_stream(stream);
+
+  if (!decoder->Open()) {
+    benchmark_->Skip(QStringLiteral("decode"), QStringLiteral("failed to open test pattern"));
+    return;
+  }
+
+  benchmark_->Run(QStringLiteral("decode"), times_.size(), QStringLiteral("frames"), [this, decoder]{
+    foreach (const rational& t, times_) {
+      decoder->RetrieveVideo(t, 1);
+    }
+  });
+
+  decoder->Close();
+}
+
+void BenchmarkSuite::RunPixelConversion()
+{
+  struct Conversion {
+    const char* name;
+    PixelFormat::Format from;
+    PixelFormat::Format to;
+  };
+
+  static const Conversion conversions[] = {
+    {"pixel_conversion.rgba8_to_rgba16f", PixelFormat::PIX_FMT_RGBA8, PixelFormat::PIX_FMT_RGBA16F},
+    {"pixel_conversion.rgba8_to_rgba32f", PixelFormat::PIX_FMT_RGBA8, PixelFormat::PIX_FMT_RGBA32F},
+    {"pixel_conversion.rgba16f_to_rgba8", PixelFormat::PIX_FMT_RGBA16F, PixelFormat::PIX_FMT_RGBA8},
+    {"pixel_conversion.rgba32f_to_rgba16u", PixelFormat::PIX_FMT_RGBA32F, PixelFormat::PIX_FMT_RGBA16U}
+  };
+
+  const int frames_per_run = 8;
+
+  VideoParams params = project_->viewer()->video_params();
+  FramePtr pattern = SyntheticProject::CreateTestPattern(params.width(), params.height(), 0);
+
+  for (const Conversion& c : conversions) {
+    QString name = QString::fromLatin1(c.name);
+
+    if (!IsSelected(name)) {
+      continue;
+    }
+
+    FramePtr source = (c.from == pattern->format()) ? pattern : PixelFormat::ConvertPixelFormat(pattern, c.from);
+    PixelFormat::Format to = c.to;
+
+    benchmark_->Run(name, frames_per_run, QStringLiteral("frames"), [source, to, frames_per_run]{
+      for (int i=0;i<frames_per_run;i++) {
+        PixelFormat::ConvertPixelFormat(source, to);
+      }
+    });
+  }
+}
+
+void BenchmarkSuite::RunDiskCache()
+{
+  bool write = IsSelected(QStringLiteral("disk_cache.write"));
+  bool read = IsSelected(QStringLiteral("disk_cache.read"));
+
+  if (!write && !read) {
+    return;
+  }
+
+  // Cache frames in the sequence's format as a render would. A handful of distinct frames is cycled through so
+  // memory use doesn't scale with the number of frames.
+  const int distinct_frames = 8;
+
+  VideoParams params = project_->viewer()->video_params();
+
+  QVector<FramePtr> frames(distinct_frames);
+  for (int i=0;i<distinct_frames;i++) {
+    frames[i] = PixelFormat::ConvertPixelFormat(SyntheticProject::CreateTestPattern(params.width(),
+                                                                                    params.height(),
+                                                                                    i),
+                                                params.format());
+  }
+
+  auto write_all = [this, frames]{
+    for (int i=0;i<hashes_.size();i++) {
+      FrameHashCache::SaveCacheFrame(hashes_.at(i), frames.at(i % frames.size()));
+    }
+  };
+
+  if (write) {
+    benchmark_->Run(QStringLiteral("disk_cache.write"), hashes_.size(), QStringLiteral("frames"), write_all);
+  } else {
+    write_all();
+  }
+
+  if (read) {
+    benchmark_->Run(QStringLiteral("disk_cache.read"), hashes_.size(), QStringLiteral("frames"), [this]{
+      foreach (const QByteArray& hash, hashes_) {
+        FrameHashCache::LoadCacheFrame(hash);
+      }
+    });
+  }
+}
+
+void BenchmarkSuite::RunRender()
+{
+  bool video = IsSelected(QStringLiteral("render.video"));
+  bool audio = IsSelected(QStringLiteral("render.audio"));
+
+  if (!video && !audio) {
+    return;
+  }
+
+  ViewerOutput* viewer = project_->viewer();
+
+  CPUBackend backend;
+  backend.SetViewerNode(viewer);
+  backend.SetVideoParams(viewer->video_params());
+  backend.SetAudioParams(viewer->audio_params());
+  backend.SetRenderMode(RenderMode::kOnline);
+
+  if (video) {
+    benchmark_->Run(QStringLiteral("render.video"), times_.size(), QStringLiteral("frames"), [this, &backend]{
+      QVector<RenderTicketPtr> tickets(times_.size());
+
+      for (int i=0;i<times_.size();i++) {
+        tickets[i] = backend.RenderFrame(times_.at(i));
+      }
+
+      WaitForTickets(tickets);
+    });
+  }
+
+  if (audio) {
+    // Render in one second chunks like ExportTask does
+    rational length = viewer->GetLength();
+    QVector<TimeRange> ranges;
+
+    for (rational r=0;r<length;r+=rational(1)) {
+      ranges.append(TimeRange(r, qMin(r + rational(1), length)));
+    }
+
+    qint64 samples = viewer->audio_params().time_to_samples(length);
+
+    benchmark_->Run(QStringLiteral("render.audio"), samples, QStringLiteral("samples"), [&backend, ranges]{
+      QVector<RenderTicketPtr> tickets(ranges.size());
+
+      for (int i=0;i<ranges.size();i++) {
+        tickets[i] = backend.RenderAudio(ranges.at(i));
+      }
+
+      WaitForTickets(tickets);
+    });
+  }
+}
+
+void BenchmarkSuite::RunExport()
+{
+  if (!IsSelected(QStringLiteral("export"))) {
+    return;
+  }
+
+  ViewerOutput* viewer = project_->viewer();
+  ColorManager* color_manager = project_->project()->color_manager();
+
+  CPUBackend backend;
+  backend.SetViewerNode(viewer);
+  backend.SetVideoParams(viewer->video_params());
+  backend.SetAudioParams(viewer->audio_params());
+
+  // Same codecs as a headless export from the command line
+  ExportParams params;
+  params.SetFilename(QDir(working_dir_).filePath(QStringLiteral("export.mp4")));
+  params.SetExportLength(viewer->GetLength());
+  params.EnableVideo(viewer->video_params(), ExportCodec::kCodecH264);
+  params.set_video_pix_fmt(ExportCodec::GetPixelFormatsForCodec(ExportCodec::kCodecH264).first());
+  params.set_color_transform(color_manager->GetDefaultInputColorSpace());
+  params.EnableAudio(AudioParams(viewer->audio_params().sample_rate(),
+                                 viewer->audio_params().channel_layout(),
+                                 SampleFormat::kInternalFormat),
+                     ExportCodec::kCodecAAC);
+
+  bool success = true;
+
+  benchmark_->Run(QStringLiteral("export"), times_.size(), QStringLiteral("frames"),
+                  [&backend, color_manager, params, &success]{
+    ExportTask task(&backend, color_manager, params);
+
+    if (!CLITaskDialog::RunInEventLoop(&task)) {
+      qWarning() << "Export failed:" << task.GetError();
+      success = false;
+    }
+  });
+
+  if (!success) {
+    qWarning() << "Export results are not valid";
+  }
+}
+
+void BenchmarkSuite::RunMemoryPool()
+{
+  const int ops_per_thread = 100000;
+
+  // Small elements so the pool itself dominates rather than memory bandwidth
+  MemoryPool<float> pool(1024);
+
+  auto churn = [&pool, ops_per_thread]{
+    for (int i=0;i<ops_per_thread;i++) {
+      MemoryPool<float>::ElementPtr e = pool.Get();
+      e->data()[0] = static_cast<float>(i);
+    }
+  };
+
+  if (IsSelected(QStringLiteral("micro.memory_pool.single"))) {
+    benchmark_->Run(QStringLiteral("micro.memory_pool.single"), ops_per_thread, QStringLiteral("ops"), churn);
+  }
+
+  if (IsSelected(QStringLiteral("micro.memory_pool.contended"))) {
+    int threads = QThread::idealThreadCount();
+
+    benchmark_->Run(QStringLiteral("micro.memory_pool.contended"), static_cast<qint64>(ops_per_thread) * threads,
+                    QStringLiteral("ops"), [threads, churn]{
+      QVector< QFuture<void> > futures(threads);
+
+      for (int i=0;i<threads;i++) {
+        futures[i] = QtConcurrent::run(churn);
+      }
+
+      foreach (QFuture<void> f, futures) {
+        f.waitForFinished();
+      }
+    });
+  }
+}
+
+void BenchmarkSuite::RunBlur()
+{
+  struct BlurCase {
+    const char* name;
+    BlurFilterNode::Method method;
+    double radius;
+  };
+
+  static const BlurCase cases[] = {
+    {"micro.blur.box_r4", BlurFilterNode::kBox, 4},
+    {"micro.blur.box_r64", BlurFilterNode::kBox, 64},
+    {"micro.blur.gaussian_r4", BlurFilterNode::kGaussian, 4},
+    {"micro.blur.gaussian_r64", BlurFilterNode::kGaussian, 64}
+  };
+
+  VideoParams params = project_->viewer()->video_params();
+  FramePtr source = PixelFormat::ConvertPixelFormat(SyntheticProject::CreateTestPattern(params.width(),
+                                                                                        params.height(),
+                                                                                        0),
+                                                    PixelFormat::PIX_FMT_RGBA32F);
+
+  for (const BlurCase& c : cases) {
+    QString name = QString::fromLatin1(c.name);
+
+    if (!IsSelected(name)) {
+      continue;
+    }
+
+    BlurFilterNode::Method method = c.method;
+    double radius = c.radius;
+
+    benchmark_->Run(name, 1, QStringLiteral("frames"), [source, method, radius]{
+      BlurFilterNode::BlurFrame(source, method, radius, true, true, false);
+    });
+  }
+
+  if (IsSelected(QStringLiteral("micro.blur.kernel"))) {
+    const int max_radius = 256;
+
+    benchmark_->Run(QStringLiteral("micro.blur.kernel"), max_radius, QStringLiteral("kernels"), [max_radius]{
+      for (int i=1;i<=max_radius;i++) {
+        BlurFilterNode::CreateKernel(BlurFilterNode::kGaussian, i);
+      }
+    });
+  }
+}
+
+void BenchmarkSuite::RunTime()
+{
+  const int count = 100000;
+
+  // Fixed seed so every run does the same work
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> frame_dist(0, 100000);
+  std::uniform_int_distribution<int> length_dist(1, 240);
+
+  rational timebase = project_->viewer()->video_params().time_base();
+
+  QVector<rational> times(count);
+  QVector<TimeRange> ranges(count);
+  for (int i=0;i<count;i++) {
+    times[i] = rational(frame_dist(rng)) * timebase;
+    ranges[i] = TimeRange(times.at(i), times.at(i) + rational(length_dist(rng)) * timebase);
+  }
+
+  if (IsSelected(QStringLiteral("micro.rational"))) {
+    benchmark_->Run(QStringLiteral("micro.rational"), count, QStringLiteral("ops"), [times]{
+      rational sum;
+      int less = 0;
+
+      for (int i=1;i<times.size();i++) {
+        sum += times.at(i);
+
+        if (times.at(i) < times.at(i - 1)) {
+          less++;
+        }
+      }
+
+      Q_UNUSED(less)
+    });
+  }
+
+  if (IsSelected(QStringLiteral("micro.tick_conversion"))) {
+    TickTimebase tb(timebase);
+
+    benchmark_->Run(QStringLiteral("micro.tick_conversion"), count, QStringLiteral("ops"), [times, tb]{
+      int64_t sum = 0;
+
+      foreach (const rational& t, times) {
+        sum += tb.ToTicks(t);
+      }
+
+      Q_UNUSED(sum)
+    });
+  }
+
+  if (IsSelected(QStringLiteral("micro.timerangelist"))) {
+    // Lists of invalidated ranges rarely hold more than a few thousand entries
+    const int list_ops = 5000;
+
+    benchmark_->Run(QStringLiteral("micro.timerangelist"), list_ops * 2, QStringLiteral("ops"), [ranges, list_ops]{
+      TimeRangeList list;
+
+      for (int i=0;i<list_ops;i++) {
+        list.InsertTimeRange(ranges.at(i));
+      }
+
+      for (int i=0;i<list_ops;i++) {
+        list.RemoveTimeRange(ranges.at(list_ops + i));
+      }
+    });
+  }
+}
+
+void BenchmarkSuite::RunMix()
+{
+  if (!IsSelected(QStringLiteral("micro.mix"))) {
+    return;
+  }
+
+  // Ten seconds of stereo audio
+  const int count = project_->viewer()->audio_params().sample_rate() * 2 * 10;
+
+  QVector<float> src(count, 0.5f);
+  QVector<float> dst(count, 0.0f);
+
+  benchmark_->Run(QStringLiteral("micro.mix"), count, QStringLiteral("samples"), [&src, &dst, count]{
+    MixNode::Accumulate(dst.data(), src.constData(), count, 0.5f);
+  });
+}
+
+namespace {
+
+/**
+ * @brief Hands out textures that are never created so the cache's bookkeeping can be timed without a GPU
+ */
+class NullTextureAllocator : public OpenGLTextureAllocator
+{
+public:
+  virtual OpenGLTexturePtr Allocate(QOpenGLContext*, const VideoParams&) override
+  {
+    return std::make_shared<OpenGLTexture>();
+  }
+};
+
+}
+
+void BenchmarkSuite::RunTextureCache()
+{
+  if (!IsSelected(QStringLiteral("micro.texture_cache"))) {
+    return;
+  }
+
+  const int count = 100000;
+
+  // Renders hold on to a few textures at once, released in the order they were taken
+  const int in_flight = 8;
+
+  // A mix of sequence and proxy sizes in each format a render might use
+  const int sizes[][2] = {{3840, 2160}, {1920, 1080}, {1280, 720}, {960, 540}};
+  const PixelFormat::Format formats[] = {PixelFormat::PIX_FMT_RGBA8,
+                                         PixelFormat::PIX_FMT_RGBA16F,
+                                         PixelFormat::PIX_FMT_RGBA32F};
+
+  QVector<VideoParams> params;
+  for (const auto& size : sizes) {
+    for (PixelFormat::Format format : formats) {
+      params.append(VideoParams(size[0], size[1], format));
+    }
+  }
+
+  // Fixed seed so every run requests the same textures. Most requests go to a few keys like a real render's do.
+  std::mt19937 rng(1);
+  std::geometric_distribution<int> key_dist(0.3);
+
+  QVector<int> requests(count);
+  for (int i=0;i<count;i++) {
+    requests[i] = qMin(key_dist(rng), params.size() - 1);
+  }
+
+  NullTextureAllocator allocator;
+  OpenGLTextureCache::Stats stats = OpenGLTextureCache::Stats();
+
+  benchmark_->Run(QStringLiteral("micro.texture_cache"), count, QStringLiteral("ops"),
+                  [&allocator, &stats, params, requests, in_flight]{
+    OpenGLTextureCache cache(&allocator);
+
+    // Enough for a handful of the largest textures so eviction is exercised too
+    cache.SetBudget(Q_INT64_C(268435456));
+
+    QVector<OpenGLTextureCache::ReferencePtr> held(in_flight);
+
+    for (int i=0;i<requests.size();i++) {
+      held[i % in_flight] = cache.Get(nullptr, params.at(requests.at(i)));
+    }
+
+    held.clear();
+
+    stats = cache.GetStats();
+  });
+
+  // From the last run, each run starts with an empty cache so they're all the same
+  benchmark_->SetCounter(QStringLiteral("micro.texture_cache"), QStringLiteral("hits"),
+                         static_cast<qint64>(stats.hits));
+  benchmark_->SetCounter(QStringLiteral("micro.texture_cache"), QStringLiteral("misses"),
+                         static_cast<qint64>(stats.misses));
+  benchmark_->SetCounter(QStringLiteral("micro.texture_cache"), QStringLiteral("evictions"),
+                         static_cast<qint64>(stats.evictions));
+  benchmark_->SetCounter(QStringLiteral("micro.texture_cache"), QStringLiteral("allocated_bytes"),
+                         stats.allocated_bytes);
+}
+
+void BenchmarkSuite::WaitForTickets(const QVector<RenderTicketPtr> &tickets)
+{
+  QEventLoop loop;
+  int remaining = 0;
+
+  foreach (RenderTicketPtr ticket, tickets) {
+    if (!ticket || ticket->IsFinished()) {
+      continue;
+    }
+
+    remaining++;
+
+    QObject::connect(ticket.get(), &RenderTicket::Finished, &loop, [&remaining, &loop]{
+      remaining--;
+
+      if (remaining == 0) {
+        loop.quit();
+      }
+    }, Qt::QueuedConnection);
+  }
+
+  // Jobs are only started from the event loop, so none can finish between the check above and exec()
+  if (remaining > 0) {
+    loop.exec();
+  }
+}
+
+OLIVE_NAMESPACE_EXIT
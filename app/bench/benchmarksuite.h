@@ -0,0 +1,97 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef BENCHMARKSUITE_H
+#define BENCHMARKSUITE_H
+
+#include "benchmark.h"
+#include "render/backend/renderticket.h"
+#include "syntheticproject.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief The stages olive-bench times
+ *
+ * Pipeline stages run on a SyntheticProject through the same code the editor uses (NodeTraverser, NodeHasher,
+ * decoders, PixelFormat, FrameHashCache, RenderBackend and ExportTask). Micro-benchmarks time individual hot
+ * functions that the pipeline stages would otherwise hide.
+ */
+class BenchmarkSuite
+{
+public:
+  BenchmarkSuite(SyntheticProject* project, Benchmark* benchmark, const QStringList& filter, const QString& working_dir);
+
+  void Run();
+
+private:
+  bool IsSelected(const QString& name) const
+  {
+    return Benchmark::IsSelected(name, filter_);
+  }
+
+  void RunTraversal();
+
+  void RunHash();
+
+  void RunDecode();
+
+  void RunPixelConversion();
+
+  void RunDiskCache();
+
+  void RunRender();
+
+  void RunExport();
+
+  void RunMemoryPool();
+
+  void RunBlur();
+
+  void RunTime();
+
+  void RunMix();
+
+  void RunTextureCache();
+
+  /**
+   * @brief Runs the event loop until every ticket has finished
+   *
+   * RenderBackend dispatches jobs from the event loop, so waiting on tickets directly would never return.
+   */
+  static void WaitForTickets(const QVector<RenderTicketPtr>& tickets);
+
+  SyntheticProject* project_;
+
+  Benchmark* benchmark_;
+
+  QStringList filter_;
+
+  QString working_dir_;
+
+  QVector<rational> times_;
+
+  QVector<QByteArray> hashes_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // BENCHMARKSUITE_H
@@ -18,36 +18,30 @@
 
 ***/
 
-#ifndef FUNCTIONTIMER_H
-#define FUNCTIONTIMER_H
+#ifndef CPUBACKEND_H
+#define CPUBACKEND_H
 
-#include <QDateTime>
-#include <QDebug>
+#include "render/backend/renderbackend.h"
 
-#define TIME_THIS_FUNCTION FunctionTimer __f(__FUNCTION__)
+OLIVE_NAMESPACE_ENTER
 
-class FunctionTimer {
+/**
+ * @brief RenderBackend that runs entirely on the CPU
+ *
+ * Used by olive-bench so it can run headless on machines without a GPU. See CPUWorker for what is and isn't rendered.
+ */
+class CPUBackend : public RenderBackend
+{
 public:
-  FunctionTimer(const char* s)
-  {
-    name_ = s;
-    time_ = QDateTime::currentMSecsSinceEpoch();
-  }
+  CPUBackend(QObject* parent = nullptr);
 
-  ~FunctionTimer()
-  {
-    qint64 elapsed = (QDateTime::currentMSecsSinceEpoch() - time_);
+  virtual ~CPUBackend() override;
 
-    if (elapsed > 1) {
-      qDebug() << name_ << "took" << elapsed;
-    }
-  }
-
-private:
-  const char* name_;
-
-  qint64 time_;
+protected:
+  virtual RenderWorker* CreateNewWorker() override;
 
 };
 
-#endif // FUNCTIONTIMER_H
+OLIVE_NAMESPACE_EXIT
+
+#endif // CPUBACKEND_H
@@ -0,0 +1,154 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "cpuworker.h"
+
+#include "node/filter/blur/blur.h"
+#include "render/pixelformat.h"
+
+OLIVE_NAMESPACE_ENTER
+
+CPUWorker::CPUWorker(RenderBackend *parent) :
+  RenderWorker(parent)
+{
+}
+
+void CPUWorker::TextureToFrame(const QVariant &texture, FramePtr frame, const QMatrix4x4 &mat) const
+{
+  Q_UNUSED(mat)
+
+  FramePtr src = texture.value<FramePtr>();
+
+  if (src->format() != frame->format()) {
+    src = PixelFormat::ConvertPixelFormat(src, frame->format());
+  }
+
+  // Frames aren't scaled, copy whatever overlaps
+  int rows = qMin(src->height(), frame->height());
+  int row_bytes = qMin(src->linesize_bytes(), frame->linesize_bytes());
+
+  for (int i=0;i<rows;i++) {
+    memcpy(frame->data() + i * frame->linesize_bytes(), src->const_data() + i * src->linesize_bytes(), row_bytes);
+  }
+}
+
+bool CPUWorker::TextureToSharedFrame(const QVariant &texture, FramePtr frame, const QMatrix4x4 &mat) const
+{
+  Q_UNUSED(texture)
+  Q_UNUSED(frame)
+  Q_UNUSED(mat)
+
+  return false;
+}
+
+QVariant CPUWorker::FootageFrameToTexture(StreamPtr stream, FramePtr frame) const
+{
+  Q_UNUSED(stream)
+
+  // Stands in for the upload, which converts footage to the render format
+  PixelFormat::Format dst = PixelFormat::GetFormatWithAlphaChannel(video_params().format());
+
+  if (frame->format() != dst) {
+    frame = PixelFormat::ConvertPixelFormat(frame, dst);
+  }
+
+  return QVariant::fromValue(frame);
+}
+
+QVariant CPUWorker::CachedFrameToTexture(FramePtr frame) const
+{
+  return QVariant::fromValue(frame);
+}
+
+QVariant CPUWorker::ProcessShader(const Node *node, const TimeRange &range, const ShaderJob &job)
+{
+  Q_UNUSED(range)
+
+  if (node->id() == QStringLiteral("org.olivevideoeditor.Olive.blur")) {
+    FramePtr src = job.GetValue(QStringLiteral("tex_in")).data().value<FramePtr>();
+
+    if (src) {
+      FramePtr blurred = BlurFilterNode::BlurFrame(src,
+                                                   static_cast<BlurFilterNode::Method>(job.GetValue(QStringLiteral("method_in")).data().toInt()),
+                                                   job.GetValue(QStringLiteral("radius_in")).data().toDouble(),
+                                                   job.GetValue(QStringLiteral("horiz_in")).data().toBool(),
+                                                   job.GetValue(QStringLiteral("vert_in")).data().toBool(),
+                                                   job.GetValue(QStringLiteral("repeat_edge_pixels_in")).data().toBool());
+
+      return QVariant::fromValue(blurred);
+    }
+  }
+
+  // Pass through the top-most texture
+  QStringList inputs = job.GetLayers();
+
+  if (inputs.isEmpty()) {
+    inputs = job.GetValues().keys();
+  }
+
+  for (int i=inputs.size()-1;i>=0;i--) {
+    const NodeValue& v = job.GetValue(inputs.at(i));
+
+    if (v.type() == NodeParam::kTexture && !v.data().isNull()) {
+      return v.data();
+    }
+  }
+
+  return QVariant::fromValue(CreateBlankFrame(job.GetAlphaChannelRequired()));
+}
+
+bool CPUWorker::TextureHasAlpha(const QVariant &v) const
+{
+  return PixelFormat::FormatHasAlphaChannel(v.value<FramePtr>()->format());
+}
+
+const void *CPUWorker::TextureIdentity(const QVariant &v) const
+{
+  return v.value<FramePtr>().get();
+}
+
+qint64 CPUWorker::TextureByteSize(const QVariant &v) const
+{
+  FramePtr frame = v.value<FramePtr>();
+
+  return frame ? frame->allocated_size() : 0;
+}
+
+FramePtr CPUWorker::CreateBlankFrame(bool alpha) const
+{
+  PixelFormat::Format format = alpha
+      ? PixelFormat::GetFormatWithAlphaChannel(video_params().format())
+      : PixelFormat::GetFormatWithoutAlphaChannel(video_params().format());
+
+  FramePtr frame = Frame::Create();
+
+  frame->set_video_params(VideoParams(video_params().width(),
+                                      video_params().height(),
+                                      video_params().time_base(),
+                                      format,
+                                      video_params().divider()));
+  frame->allocate();
+
+  memset(frame->data(), 0, frame->allocated_size());
+
+  return frame;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,65 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef CPUWORKER_H
+#define CPUWORKER_H
+
+#include "render/backend/renderworker.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief RenderWorker whose "textures" are frames in system memory
+ *
+ * Everything around the shaders runs as it would with OpenGLWorker (traversal, decoding, generators, audio, caching),
+ * but shader jobs themselves are not run: blurs are done with BlurFilterNode::BlurFrame() and every other job passes
+ * through its first texture (or a blank frame if it has none). This keeps the benchmarks about the CPU side of
+ * rendering, which is what olive-bench measures.
+ */
+class CPUWorker : public RenderWorker
+{
+public:
+  CPUWorker(RenderBackend* parent);
+
+protected:
+  virtual void TextureToFrame(const QVariant& texture, FramePtr frame, const QMatrix4x4 &mat) const override;
+
+  virtual bool TextureToSharedFrame(const QVariant& texture, FramePtr frame, const QMatrix4x4 &mat) const override;
+
+  virtual QVariant FootageFrameToTexture(StreamPtr stream, FramePtr frame) const override;
+
+  virtual QVariant CachedFrameToTexture(FramePtr frame) const override;
+
+  virtual QVariant ProcessShader(const Node *node, const TimeRange &range, const ShaderJob& job) override;
+
+  virtual bool TextureHasAlpha(const QVariant& v) const override;
+
+  virtual const void* TextureIdentity(const QVariant& v) const override;
+
+  virtual qint64 TextureByteSize(const QVariant& v) const override;
+
+private:
+  FramePtr CreateBlankFrame(bool alpha) const;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // CPUWORKER_H
@@ -0,0 +1,345 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "syntheticproject.h"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+}
+
+#include <QDir>
+#include <QFileInfo>
+#include <QtMath>
+
+#include "codec/decoder.h"
+#include "codec/ffmpeg/ffmpegencoder.h"
+#include "codec/waveoutput.h"
+#include "node/audio/volume/volume.h"
+#include "node/block/clip/clip.h"
+#include "node/filter/blur/blur.h"
+#include "node/generator/matrix/matrix.h"
+#include "node/generator/solid/solid.h"
+#include "node/input/media/audio/audio.h"
+#include "node/input/media/video/video.h"
+#include "node/math/math/math.h"
+
+OLIVE_NAMESPACE_ENTER
+
+SyntheticProject::SyntheticProject(const Settings &settings, const QString &working_dir) :
+  settings_(settings),
+  working_dir_(working_dir)
+{
+}
+
+bool SyntheticProject::Create()
+{
+  QDir dir(working_dir_);
+
+  QString video_fn = dir.filePath(QStringLiteral("testpattern.mp4"));
+  QString audio_fn = dir.filePath(QStringLiteral("testtone.wav"));
+
+  if (!CreateVideoMedia(video_fn) || !CreateAudioMedia(audio_fn)) {
+    return false;
+  }
+
+  project_ = std::make_shared<Project>();
+  project_->set_filename(dir.filePath(QStringLiteral("synthetic.ove")));
+
+  video_stream_ = ImportFootage(video_fn, Stream::kVideo);
+  audio_stream_ = ImportFootage(audio_fn, Stream::kAudio);
+
+  if (!video_stream_ || !audio_stream_) {
+    return false;
+  }
+
+  BuildSequence();
+
+  return true;
+}
+
+ViewerOutput *SyntheticProject::viewer() const
+{
+  return sequence_ ? sequence_->viewer_output() : nullptr;
+}
+
+QVector<rational> SyntheticProject::GetFrameTimes() const
+{
+  QVector<rational> times(settings_.frames);
+
+  for (int i=0;i<settings_.frames;i++) {
+    times[i] = rational(i) * settings_.timebase;
+  }
+
+  return times;
+}
+
+FramePtr SyntheticProject::CreateTestPattern(int width, int height, int index)
+{
+  // SMPTE-style color bars with a white stripe that moves every frame, so consecutive frames differ
+  static const uint8_t bars[][3] = {
+    {191, 191, 191},
+    {191, 191, 0},
+    {0, 191, 191},
+    {0, 191, 0},
+    {191, 0, 191},
+    {191, 0, 0},
+    {0, 0, 191}
+  };
+  static const int bar_count = sizeof(bars) / sizeof(bars[0]);
+
+  FramePtr frame = Frame::Create();
+  frame->set_video_params(VideoParams(width, height, PixelFormat::PIX_FMT_RGBA8));
+  frame->allocate();
+
+  int stripe_width = qMax(1, width / 64);
+  int stripe_x = (index * stripe_width) % width;
+
+  for (int y=0;y<height;y++) {
+    uint8_t* line = reinterpret_cast<uint8_t*>(frame->data() + y * frame->linesize_bytes());
+
+    for (int x=0;x<width;x++) {
+      uint8_t* px = line + x * 4;
+
+      if (x >= stripe_x && x < stripe_x + stripe_width) {
+        px[0] = px[1] = px[2] = 255;
+      } else {
+        const uint8_t* bar = bars[x * bar_count / width];
+        px[0] = bar[0];
+        px[1] = bar[1];
+        px[2] = bar[2];
+      }
+
+      px[3] = 255;
+    }
+  }
+
+  return frame;
+}
+
+bool SyntheticProject::CreateVideoMedia(const QString &filename)
+{
+  EncodingParams params;
+  params.SetFilename(filename);
+  params.EnableVideo(VideoParams(settings_.width,
+                                 settings_.height,
+                                 settings_.timebase,
+                                 PixelFormat::PIX_FMT_RGBA8),
+                     ExportCodec::kCodecH264);
+  params.set_video_pix_fmt(QStringLiteral("yuv420p"));
+
+  // Source media quality doesn't matter, only how long it takes to make
+  params.set_video_option(QStringLiteral("preset"), QStringLiteral("ultrafast"));
+
+  params.SetExportLength(rational(settings_.frames) * settings_.timebase);
+
+  FFmpegEncoder encoder(params);
+
+  if (!encoder.Open()) {
+    error_ = QStringLiteral("Failed to open \"%1\" for writing").arg(filename);
+    return false;
+  }
+
+  for (int i=0;i<settings_.frames;i++) {
+    if (!encoder.WriteFrame(CreateTestPattern(settings_.width, settings_.height, i),
+                            rational(i) * settings_.timebase)) {
+      error_ = QStringLiteral("Failed to encode test pattern frame %1").arg(i);
+      encoder.Close();
+      return false;
+    }
+  }
+
+  encoder.Close();
+
+  return true;
+}
+
+bool SyntheticProject::CreateAudioMedia(const QString &filename)
+{
+  const int channels = 2;
+  const double frequency = 440.0;
+
+  WaveOutput wave(filename, AudioParams(settings_.sample_rate, AV_CH_LAYOUT_STEREO, SampleFormat::SAMPLE_FMT_S16));
+
+  if (!wave.open()) {
+    error_ = QStringLiteral("Failed to open \"%1\" for writing").arg(filename);
+    return false;
+  }
+
+  qint64 sample_count = qCeil((rational(settings_.frames) * settings_.timebase).toDouble() * settings_.sample_rate);
+
+  QVector<qint16> buffer;
+
+  for (qint64 i=0;i<sample_count;i+=settings_.sample_rate) {
+    int count = static_cast<int>(qMin(static_cast<qint64>(settings_.sample_rate), sample_count - i));
+
+    buffer.resize(count * channels);
+
+    for (int j=0;j<count;j++) {
+      double t = static_cast<double>(i + j) / settings_.sample_rate;
+      qint16 v = static_cast<qint16>(qSin(2.0 * M_PI * frequency * t) * 8192.0);
+
+      for (int k=0;k<channels;k++) {
+        buffer[j * channels + k] = v;
+      }
+    }
+
+    wave.write(reinterpret_cast<const char*>(buffer.constData()), buffer.size() * static_cast<int>(sizeof(qint16)));
+  }
+
+  wave.close();
+
+  return true;
+}
+
+StreamPtr SyntheticProject::ImportFootage(const QString &filename, Stream::Type type)
+{
+  FootagePtr footage = std::make_shared<Footage>();
+  footage->set_filename(filename);
+  footage->set_name(QFileInfo(filename).fileName());
+
+  // Probing reads the project's color settings so the footage must be in it first
+  project_->root()->add_child(footage);
+
+  if (!Decoder::ProbeMedia(footage.get(), nullptr)) {
+    error_ = QStringLiteral("Failed to probe \"%1\"").arg(filename);
+    return nullptr;
+  }
+
+  foreach (StreamPtr stream, footage->streams()) {
+    if (stream->type() == type) {
+      return stream;
+    }
+  }
+
+  error_ = QStringLiteral("\"%1\" has no stream of the expected type").arg(filename);
+  return nullptr;
+}
+
+void SyntheticProject::BuildSequence()
+{
+  sequence_ = std::make_shared<Sequence>();
+  sequence_->set_name(QStringLiteral("Synthetic"));
+  sequence_->set_video_params(VideoParams(settings_.width,
+                                          settings_.height,
+                                          settings_.timebase,
+                                          PixelFormat::instance()->GetConfiguredFormatForMode(RenderMode::kOnline)));
+  sequence_->set_audio_params(AudioParams(settings_.sample_rate,
+                                          AV_CH_LAYOUT_STEREO,
+                                          SampleFormat::kInternalFormat));
+  sequence_->add_default_nodes();
+
+  project_->root()->add_child(sequence_);
+
+  TrackList* video_tracks = viewer()->track_list(Timeline::kTrackTypeVideo);
+  TrackList* audio_tracks = viewer()->track_list(Timeline::kTrackTypeAudio);
+
+  while (video_tracks->GetTrackCount() < settings_.video_tracks) {
+    video_tracks->AddTrack();
+  }
+
+  while (audio_tracks->GetTrackCount() < settings_.audio_tracks) {
+    audio_tracks->AddTrack();
+  }
+
+  // Cut every track into two clips so there are edits to cross
+  int first_half = settings_.frames / 2;
+  rational first_length = rational(first_half) * settings_.timebase;
+  rational second_length = rational(settings_.frames - first_half) * settings_.timebase;
+
+  for (int i=0;i<settings_.video_tracks;i++) {
+    TrackOutput* track = video_tracks->GetTrackAt(i);
+
+    AddVideoClip(track, i, 0, first_length);
+    AddVideoClip(track, i, 1, second_length);
+  }
+
+  for (int i=0;i<settings_.audio_tracks;i++) {
+    TrackOutput* track = audio_tracks->GetTrackAt(i);
+
+    AddAudioClip(track, first_length);
+    AddAudioClip(track, second_length);
+  }
+}
+
+void SyntheticProject::AddVideoClip(TrackOutput *track, int track_index, int clip_index, const rational &length)
+{
+  ClipBlock* clip = new ClipBlock();
+  clip->set_length_and_media_out(length);
+  sequence_->AddNode(clip);
+
+  Node* source;
+
+  if (track_index % 2 == 0) {
+    // Footage, moved by a transform matrix
+    VideoInput* video_input = new VideoInput();
+    video_input->SetFootage(video_stream_);
+    sequence_->AddNode(video_input);
+
+    MatrixGenerator* matrix = new MatrixGenerator();
+    matrix->GetInputWithID(QStringLiteral("rot_in"))->set_standard_value(5.0 * (track_index + clip_index));
+    sequence_->AddNode(matrix);
+
+    MathNode* multiply = new MathNode();
+    multiply->SetOperation(MathNode::kOpMultiply);
+    sequence_->AddNode(multiply);
+
+    NodeParam::ConnectEdge(video_input->output(), multiply->param_a_in());
+    NodeParam::ConnectEdge(matrix->output(), multiply->param_b_in());
+
+    source = multiply;
+  } else {
+    // Generator
+    SolidGenerator* solid = new SolidGenerator();
+    sequence_->AddNode(solid);
+
+    source = solid;
+  }
+
+  BlurFilterNode* blur = new BlurFilterNode();
+  blur->GetInputWithID(QStringLiteral("method_in"))->set_standard_value(clip_index % 2);
+  blur->GetInputWithID(QStringLiteral("radius_in"))->set_standard_value(5.0 + 10.0 * track_index);
+  sequence_->AddNode(blur);
+
+  NodeParam::ConnectEdge(source->output(), blur->GetInputWithID(QStringLiteral("tex_in")));
+  NodeParam::ConnectEdge(blur->output(), clip->texture_input());
+
+  track->AppendBlock(clip);
+}
+
+void SyntheticProject::AddAudioClip(TrackOutput *track, const rational &length)
+{
+  ClipBlock* clip = new ClipBlock();
+  clip->set_length_and_media_out(length);
+  sequence_->AddNode(clip);
+
+  AudioInput* audio_input = new AudioInput();
+  audio_input->SetFootage(audio_stream_);
+  sequence_->AddNode(audio_input);
+
+  VolumeNode* volume = new VolumeNode();
+  sequence_->AddNode(volume);
+
+  NodeParam::ConnectEdge(audio_input->output(), volume->samples_input());
+  NodeParam::ConnectEdge(volume->output(), clip->texture_input());
+
+  track->AppendBlock(clip);
+}
+
+OLIVE_NAMESPACE_EXIT
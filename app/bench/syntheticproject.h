@@ -0,0 +1,134 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SYNTHETICPROJECT_H
+#define SYNTHETICPROJECT_H
+
+#include "node/output/track/track.h"
+#include "project/item/footage/footage.h"
+#include "project/item/sequence/sequence.h"
+#include "project/project.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Generates a project with known, repeatable contents for benchmarking
+ *
+ * Test pattern media (moving color bars as H.264 video and a sine tone as WAV) is written to a working directory and
+ * imported, then a sequence is built from it with stacked video tracks, generators, blurs and transforms, and audio
+ * clips with volume nodes. The same settings always produce the same graph, so results are comparable across runs.
+ */
+class SyntheticProject
+{
+public:
+  struct Settings {
+    Settings() :
+      width(1920),
+      height(1080),
+      timebase(1001, 30000),
+      frames(120),
+      video_tracks(3),
+      audio_tracks(2),
+      sample_rate(48000)
+    {
+    }
+
+    int width;
+    int height;
+    rational timebase;
+    int frames;
+    int video_tracks;
+    int audio_tracks;
+    int sample_rate;
+  };
+
+  SyntheticProject(const Settings& settings, const QString& working_dir);
+
+  /**
+   * @brief Write the media and build the project
+   *
+   * Returns false on failure, in which case error() describes what went wrong.
+   */
+  bool Create();
+
+  const QString& error() const
+  {
+    return error_;
+  }
+
+  Project* project() const
+  {
+    return project_.get();
+  }
+
+  ViewerOutput* viewer() const;
+
+  StreamPtr video_stream() const
+  {
+    return video_stream_;
+  }
+
+  StreamPtr audio_stream() const
+  {
+    return audio_stream_;
+  }
+
+  /**
+   * @brief Every frame time in the sequence
+   */
+  QVector<rational> GetFrameTimes() const;
+
+  /**
+   * @brief Creates frame `index` of the test pattern
+   */
+  static FramePtr CreateTestPattern(int width, int height, int index);
+
+private:
+  bool CreateVideoMedia(const QString& filename);
+
+  bool CreateAudioMedia(const QString& filename);
+
+  StreamPtr ImportFootage(const QString& filename, Stream::Type type);
+
+  void BuildSequence();
+
+  void AddVideoClip(TrackOutput* track, int track_index, int clip_index, const rational& length);
+
+  void AddAudioClip(TrackOutput* track, const rational& length);
+
+  Settings settings_;
+
+  QString working_dir_;
+
+  QString error_;
+
+  ProjectPtr project_;
+
+  SequencePtr sequence_;
+
+  StreamPtr video_stream_;
+
+  StreamPtr audio_stream_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // SYNTHETICPROJECT_H
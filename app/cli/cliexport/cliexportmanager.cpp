@@ -20,11 +20,384 @@
 
 #include "cliexportmanager.h"
 
+#include <iostream>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QThread>
+
+#include "cli/clitask/clitaskdialog.h"
+#include "codec/ffmpeg/ffmpegencoder.h"
+#include "render/colormanager.h"
+#include "render/pixelformat.h"
+
 OLIVE_NAMESPACE_ENTER
 
-CLIExportManager::CLIExportManager()
+CLIExportManager::CLIExportManager(ViewerOutput *viewer, ColorManager *color_manager, const Options &options,
+                                   QObject *parent) :
+  QObject(parent),
+  viewer_(viewer),
+  color_manager_(color_manager),
+  options_(options),
+  timebase_(viewer->video_params().time_base()),
+  progress_dialog_(nullptr),
+  last_reported_progress_(-1),
+  next_segment_(0),
+  running_segments_(0)
+{
+}
+
+bool CLIExportManager::Run()
+{
+  // Include a trailing partial frame if the sequence doesn't end on a frame boundary
+  rational length = viewer_->GetLength();
+  TickRange range(0, timebase_.ToTicks(length) + (timebase_.IsExact(length) ? 0 : 1));
+
+  if (options_.segment_index >= 0 && !options_.has_range) {
+    if (options_.segment_count < 1 || options_.segment_index >= options_.segment_count) {
+      ReportFinished(false, tr("Segment index must be less than the number of segments"));
+      return false;
+    }
+
+    range = SegmentRange(range, options_.segment_count, options_.segment_index);
+  } else if (options_.has_range) {
+    range = TickRange(options_.range_in, options_.range_out);
+  }
+
+  if (range.length() <= 0) {
+    ReportFinished(false, tr("Nothing to export in this range"));
+    return false;
+  }
+
+  // Split the export across processes unless we are one of those processes
+  if (options_.segment_index < 0 && (options_.segment_count > 1 || options_.jobs > 1)) {
+    return RunSegments(range);
+  } else {
+    return RunLocal(range);
+  }
+}
+
+bool CLIExportManager::Concatenate(const Options &options)
+{
+  QString error;
+
+  bool success = FFmpegEncoder::ConcatenateFiles(options.concat_inputs, options.output, &error);
+
+  if (options.json_progress) {
+    QJsonObject event;
+
+    event.insert(QStringLiteral("event"), QStringLiteral("finished"));
+    event.insert(QStringLiteral("success"), success);
+    event.insert(QStringLiteral("output"), options.output);
+
+    if (!success) {
+      event.insert(QStringLiteral("error"), error);
+    }
+
+    WriteJSON(event);
+  } else if (success) {
+    qInfo().noquote() << tr("Concatenated %1 files into %2").arg(QString::number(options.concat_inputs.size()),
+                                                                 options.output);
+  } else {
+    qCritical().noquote() << tr("Concatenation failed: %1").arg(error);
+  }
+
+  return success;
+}
+
+bool CLIExportManager::ParseRange(const QString &s, int64_t *in, int64_t *out)
+{
+  QStringList parts = s.split(':');
+
+  if (parts.size() != 2) {
+    return false;
+  }
+
+  bool in_ok, out_ok;
+
+  *in = parts.at(0).toLongLong(&in_ok);
+  *out = parts.at(1).toLongLong(&out_ok);
+
+  return in_ok && out_ok && *in >= 0 && *out > *in;
+}
+
+TickRange CLIExportManager::SegmentRange(const TickRange &total, int count, int index)
+{
+  return TickRange(total.in() + total.length() * index / count,
+                   total.in() + total.length() * (index + 1) / count);
+}
+
+void CLIExportManager::WriteJSON(const QJsonObject &object)
+{
+  // std::endl flushes, so whatever is reading us sees each line as soon as it's written
+  std::cout << QJsonDocument(object).toJson(QJsonDocument::Compact).constData() << std::endl;
+}
+
+bool CLIExportManager::RunLocal(const TickRange &range)
+{
+  ExportParams params = CreateParams(options_.output);
+  params.set_custom_range(timebase_.ToTime(range));
+
+  ExportTask export_task(viewer_, color_manager_, params);
+
+  if (options_.json_progress) {
+    QJsonObject event = CreateEvent(QStringLiteral("start"));
+    event.insert(QStringLiteral("in"), static_cast<qint64>(range.in()));
+    event.insert(QStringLiteral("out"), static_cast<qint64>(range.out()));
+    event.insert(QStringLiteral("output"), options_.output);
+    WriteJSON(event);
+  } else {
+    progress_dialog_ = new CLIProgressDialog(export_task.GetTitle(), this);
+  }
+
+  connect(&export_task, &Task::ProgressChanged, this, &CLIExportManager::ReportProgress);
+
+  bool success = CLITaskDialog::RunInEventLoop(&export_task);
+
+  ReportFinished(success, export_task.GetError());
+
+  return success;
+}
+
+bool CLIExportManager::RunSegments(const TickRange &range)
+{
+  int count = (options_.segment_count > 0) ? options_.segment_count : options_.jobs;
+  count = static_cast<int>(qMin(static_cast<int64_t>(count), range.length()));
+
+  for (int i=0;i<count;i++) {
+    segments_.append(SegmentRange(range, count, i));
+  }
+
+  segment_progress_.fill(0, count);
+
+  if (!options_.json_progress) {
+    progress_dialog_ = new CLIProgressDialog(tr("Exporting \"%1\"").arg(viewer_->media_name()), this);
+  }
+
+  int jobs = (options_.jobs > 0) ? options_.jobs : QThread::idealThreadCount();
+  jobs = qMin(jobs, count);
+
+  QEventLoop loop;
+  connect(this, &CLIExportManager::AllSegmentsFinished, &loop, &QEventLoop::quit);
+
+  for (int i=0;i<jobs;i++) {
+    StartNextSegment();
+  }
+
+  loop.exec();
+
+  QStringList segment_files;
+
+  for (int i=0;i<count;i++) {
+    segment_files.append(SegmentFilename(i));
+  }
+
+  bool success = segment_error_.isEmpty();
+  QString error = segment_error_;
+
+  if (success) {
+    success = FFmpegEncoder::ConcatenateFiles(segment_files, options_.output, &error);
+  }
+
+  foreach (const QString& f, segment_files) {
+    QFile::remove(f);
+  }
+
+  if (success) {
+    ReportProgress(1.0);
+  }
+
+  ReportFinished(success, error);
+
+  return success;
+}
+
+ExportParams CLIExportManager::CreateParams(const QString &filename) const
+{
+  // Matches the sequence with the export dialog's default codecs. Every segment of a split export must be encoded
+  // with exactly the same parameters for them to be joined.
+  VideoParams video_params(viewer_->video_params().width(),
+                           viewer_->video_params().height(),
+                           viewer_->video_params().time_base(),
+                           PixelFormat::instance()->GetConfiguredFormatForMode(RenderMode::kOnline));
+
+  AudioParams audio_params(viewer_->audio_params().sample_rate(),
+                           viewer_->audio_params().channel_layout(),
+                           SampleFormat::kInternalFormat);
+
+  ExportParams params;
+  params.SetFilename(filename);
+  params.SetExportLength(viewer_->GetLength());
+
+  params.EnableVideo(video_params, ExportCodec::kCodecH264);
+  params.set_video_pix_fmt(ExportCodec::GetPixelFormatsForCodec(ExportCodec::kCodecH264).first());
+  params.set_color_transform(color_manager_->GetDefaultInputColorSpace());
+
+  params.EnableAudio(audio_params, ExportCodec::kCodecAAC);
+
+  return params;
+}
+
+QString CLIExportManager::SegmentFilename(int index) const
 {
+  QFileInfo info(options_.output);
+
+  // Keep the extension so the segments use the same container as the output
+  return info.dir().filePath(QStringLiteral("%1.segment%2.%3").arg(info.completeBaseName(),
+                                                                    QString::number(index),
+                                                                    info.suffix()));
+}
+
+void CLIExportManager::StartNextSegment()
+{
+  int index = next_segment_;
+  next_segment_++;
+
+  const TickRange& range = segments_.at(index);
+
+  QProcess* process = new QProcess(this);
+
+  // Let the segment's log through, stdout is its JSON progress which we read below
+  process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+  connect(process, &QProcess::readyReadStandardOutput, this, [this, process, index]{
+    ReadSegmentOutput(process, index);
+  });
+
+  connect(process,
+          static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
+          this,
+          [this, process, index](int exit_code, QProcess::ExitStatus status){
+    SegmentFinished(process, index, status == QProcess::NormalExit && exit_code == 0);
+  });
+
+  // finished() isn't emitted if the process never started
+  connect(process, &QProcess::errorOccurred, this, [this, process, index](QProcess::ProcessError error){
+    if (error == QProcess::FailedToStart) {
+      SegmentFinished(process, index, false);
+    }
+  });
+
+  running_segments_++;
+
+  process->start(QCoreApplication::applicationFilePath(),
+                 {options_.project,
+                  QStringLiteral("--export"),
+                  QStringLiteral("--sequence"), options_.sequence,
+                  QStringLiteral("--output"), SegmentFilename(index),
+                  QStringLiteral("--range"), QStringLiteral("%1:%2").arg(QString::number(range.in()),
+                                                                         QString::number(range.out())),
+                  QStringLiteral("--segment-index"), QString::number(index),
+                  QStringLiteral("--json-progress")});
+}
+
+void CLIExportManager::ReadSegmentOutput(QProcess *process, int index)
+{
+  while (process->canReadLine()) {
+    QJsonObject event = QJsonDocument::fromJson(process->readLine()).object();
+    QString type = event.value(QStringLiteral("event")).toString();
+
+    if (type == QLatin1String("progress")) {
+      segment_progress_[index] = event.value(QStringLiteral("progress")).toDouble();
+
+      // Weight each segment's progress by its length
+      double total = 0;
+      int64_t total_length = 0;
+
+      for (int i=0;i<segments_.size();i++) {
+        total += segment_progress_.at(i) * segments_.at(i).length();
+        total_length += segments_.at(i).length();
+      }
+
+      // Leave the last bit for joining the segments
+      ReportProgress(0.99 * total / total_length);
+    } else if (type == QLatin1String("finished")
+               && !event.value(QStringLiteral("success")).toBool()
+               && segment_error_.isEmpty()) {
+      segment_error_ = tr("Segment %1 failed: %2").arg(QString::number(index),
+                                                       event.value(QStringLiteral("error")).toString());
+    }
+  }
+}
+
+void CLIExportManager::SegmentFinished(QProcess *process, int index, bool success)
+{
+  running_segments_--;
+
+  if (!success && segment_error_.isEmpty()) {
+    segment_error_ = tr("Segment %1 failed: %2").arg(QString::number(index), process->errorString());
+  }
+
+  process->deleteLater();
+
+  if (!segment_error_.isEmpty()) {
+    // A segment is missing so there's no point rendering the rest
+    foreach (QProcess* p, findChildren<QProcess*>()) {
+      if (p != process) {
+        p->kill();
+      }
+    }
+  } else if (next_segment_ < segments_.size()) {
+    StartNextSegment();
+  }
+
+  if (running_segments_ == 0) {
+    emit AllSegmentsFinished();
+  }
+}
+
+QJsonObject CLIExportManager::CreateEvent(const QString &type) const
+{
+  QJsonObject event;
+
+  event.insert(QStringLiteral("event"), type);
+
+  if (options_.segment_index >= 0) {
+    event.insert(QStringLiteral("segment"), options_.segment_index);
+  }
+
+  return event;
+}
+
+void CLIExportManager::ReportProgress(double progress)
+{
+  if (options_.json_progress) {
+    // Only report every 0.1% so we don't flood whatever is reading us
+    int permille = qRound(progress * 1000.0);
+
+    if (permille != last_reported_progress_) {
+      last_reported_progress_ = permille;
+
+      QJsonObject event = CreateEvent(QStringLiteral("progress"));
+      event.insert(QStringLiteral("progress"), progress);
+      WriteJSON(event);
+    }
+  } else if (progress_dialog_) {
+    progress_dialog_->SetProgress(progress);
+  }
+}
+
+void CLIExportManager::ReportFinished(bool success, const QString &error)
+{
+  if (options_.json_progress) {
+    QJsonObject event = CreateEvent(QStringLiteral("finished"));
+    event.insert(QStringLiteral("success"), success);
+    event.insert(QStringLiteral("output"), options_.output);
+
+    if (!success) {
+      event.insert(QStringLiteral("error"), error);
+    }
 
+    WriteJSON(event);
+  } else if (success) {
+    qInfo().noquote() << tr("Export succeeded");
+  } else {
+    qCritical().noquote() << tr("Export failed: %1").arg(error);
+  }
 }
 
 OLIVE_NAMESPACE_EXIT
@@ -21,14 +21,136 @@
 #ifndef CLIEXPORTMANAGER_H
 #define CLIEXPORTMANAGER_H
 
+#include <QJsonObject>
+#include <QProcess>
+#include <QVector>
+
+#include "cli/cliprogress/cliprogressdialog.h"
+#include "common/ticktime.h"
 #include "task/export/export.h"
 
 OLIVE_NAMESPACE_ENTER
 
+/**
+ * @brief Runs an export from the command line
+ *
+ * An export can be split into segments that are each rendered by a separate Olive process (on this machine or on
+ * others) and then joined into the final file without re-encoding. With `jobs` set, the manager does all of this
+ * itself by launching a process per segment. Otherwise it renders the requested range or segment in this process.
+ *
+ * With `json_progress` set, progress is written to stdout as one JSON object per line so that it can be read by other
+ * programs (including a parent CLIExportManager).
+ */
 class CLIExportManager : public QObject
 {
+  Q_OBJECT
 public:
-  CLIExportManager();
+  struct Options {
+    Options() :
+      has_range(false),
+      range_in(0),
+      range_out(0),
+      segment_count(0),
+      segment_index(-1),
+      jobs(0),
+      json_progress(false)
+    {
+    }
+
+    QString project;
+    QString sequence;
+    QString output;
+
+    // Range to export in frames of the sequence's timebase, out is exclusive
+    bool has_range;
+    int64_t range_in;
+    int64_t range_out;
+
+    int segment_count;
+    int segment_index;
+
+    // Number of processes to render segments in
+    int jobs;
+
+    bool json_progress;
+
+    QStringList concat_inputs;
+  };
+
+  CLIExportManager(ViewerOutput* viewer, ColorManager* color_manager, const Options& options,
+                   QObject* parent = nullptr);
+
+  bool Run();
+
+  /**
+   * @brief Joins the segments in `options.concat_inputs` into `options.output`
+   */
+  static bool Concatenate(const Options& options);
+
+  /**
+   * @brief Parses a range given as "IN:OUT" in frames
+   */
+  static bool ParseRange(const QString& s, int64_t* in, int64_t* out);
+
+  /**
+   * @brief Returns the frames covered by segment `index` when `total` is split into `count` segments
+   *
+   * Segments are split on frame boundaries and are as close to equal in length as possible.
+   */
+  static TickRange SegmentRange(const TickRange& total, int count, int index);
+
+  /**
+   * @brief Writes one line of JSON progress to stdout
+   */
+  static void WriteJSON(const QJsonObject& object);
+
+signals:
+  void AllSegmentsFinished();
+
+private:
+  bool RunLocal(const TickRange& range);
+
+  bool RunSegments(const TickRange& range);
+
+  ExportParams CreateParams(const QString& filename) const;
+
+  QString SegmentFilename(int index) const;
+
+  void StartNextSegment();
+
+  void ReadSegmentOutput(QProcess* process, int index);
+
+  void SegmentFinished(QProcess* process, int index, bool success);
+
+  QJsonObject CreateEvent(const QString& type) const;
+
+  void ReportProgress(double progress);
+
+  void ReportFinished(bool success, const QString& error);
+
+  ViewerOutput* viewer_;
+
+  ColorManager* color_manager_;
+
+  Options options_;
+
+  TickTimebase timebase_;
+
+  CLIProgressDialog* progress_dialog_;
+
+  int last_reported_progress_;
+
+  // State for RunSegments()
+  QVector<TickRange> segments_;
+
+  QVector<double> segment_progress_;
+
+  int next_segment_;
+
+  int running_segments_;
+
+  QString segment_error_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -20,6 +20,10 @@
 
 #include "clitaskdialog.h"
 
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrent>
+
 OLIVE_NAMESPACE_ENTER
 
 CLITaskDialog::CLITaskDialog(Task *task, QObject* parent) :
@@ -31,7 +35,21 @@ CLITaskDialog::CLITaskDialog(Task *task, QObject* parent) :
 
 bool CLITaskDialog::Run()
 {
-  return task_->Start();
+  return RunInEventLoop(task_);
+}
+
+bool CLITaskDialog::RunInEventLoop(Task *task)
+{
+  QFutureWatcher<bool> watcher;
+  QEventLoop loop;
+
+  connect(&watcher, &QFutureWatcher<bool>::finished, &loop, &QEventLoop::quit);
+
+  watcher.setFuture(QtConcurrent::run(task, &Task::Start));
+
+  loop.exec();
+
+  return watcher.result();
 }
 
 OLIVE_NAMESPACE_EXIT
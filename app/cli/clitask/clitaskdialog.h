@@ -34,6 +34,14 @@ public:
 
   bool Run();
 
+  /**
+   * @brief Runs a task without any progress output
+   *
+   * Like TaskManager, the task runs on another thread while this one processes events, since some tasks (e.g.
+   * anything using a RenderBackend) rely on queued calls to the thread they were created on.
+   */
+  static bool RunInEventLoop(Task* task);
+
 private:
   Task* task_;
 
@@ -0,0 +1,177 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "conformprogress.h"
+
+#include <limits>
+
+OLIVE_NAMESPACE_ENTER
+
+const int ConformProgress::kChunkSeconds = 5;
+
+ConformProgress::ConformProgress(const AudioParams &params, qint64 estimated_samples) :
+  params_(params),
+  estimated_samples_(qMax(qint64(0), estimated_samples)),
+  chunk_samples_(static_cast<qint64>(params.sample_rate()) * kChunkSeconds),
+  priority_(-1),
+  claimed_(false),
+  finished_(false),
+  succeeded_(false)
+{
+  if (estimated_samples_ == 0) {
+    // Without an idea of the length, treat the whole conform as one chunk that's done when the conform is
+    chunk_samples_ = std::numeric_limits<qint64>::max();
+    done_.resize(1);
+  } else {
+    done_.resize(static_cast<int>((estimated_samples_ + chunk_samples_ - 1) / chunk_samples_));
+  }
+}
+
+int ConformProgress::ChunkAt(qint64 sample) const
+{
+  return static_cast<int>(qBound(qint64(0), sample / chunk_samples_, qint64(done_.size() - 1)));
+}
+
+bool ConformProgress::TryClaim()
+{
+  QMutexLocker locker(&lock_);
+
+  if (claimed_) {
+    return false;
+  }
+
+  claimed_ = true;
+  return true;
+}
+
+bool ConformProgress::IsClaimed()
+{
+  QMutexLocker locker(&lock_);
+
+  return claimed_;
+}
+
+void ConformProgress::MarkDone(int chunk)
+{
+  QMutexLocker locker(&lock_);
+
+  done_.setBit(chunk);
+
+  done_cond_.wakeAll();
+}
+
+int ConformProgress::NextChunk(int from)
+{
+  QMutexLocker locker(&lock_);
+
+  int priority = priority_;
+  priority_ = -1;
+
+  if (priority >= 0 && !done_.testBit(priority)) {
+    return priority;
+  }
+
+  for (int i=0;i<done_.size();i++) {
+    int chunk = (from + i) % done_.size();
+
+    if (!done_.testBit(chunk)) {
+      return chunk;
+    }
+  }
+
+  return -1;
+}
+
+void ConformProgress::Finish(bool success)
+{
+  QMutexLocker locker(&lock_);
+
+  finished_ = true;
+  succeeded_ = success;
+
+  if (success) {
+    // Chunks past the end of the audio have nothing in them, but they're as done as they'll ever be
+    done_.fill(true);
+  }
+
+  done_cond_.wakeAll();
+}
+
+bool ConformProgress::WaitForRange(qint64 start, qint64 count, const QAtomicInt *cancelled)
+{
+  int first = ChunkAt(start);
+  int last = ChunkAt(start + qMax(qint64(1), count) - 1);
+
+  QMutexLocker locker(&lock_);
+
+  while (!RangeIsDone(first, last)) {
+    if (finished_ || (cancelled && *cancelled)) {
+      return false;
+    }
+
+    // Have the conformer do this next
+    for (int i=first;i<=last;i++) {
+      if (!done_.testBit(i)) {
+        priority_ = i;
+        break;
+      }
+    }
+
+    // Wake periodically in case we're cancelled
+    done_cond_.wait(&lock_, 100);
+  }
+
+  return true;
+}
+
+bool ConformProgress::WaitForFinish(const QAtomicInt *cancelled)
+{
+  QMutexLocker locker(&lock_);
+
+  while (!finished_) {
+    if (cancelled && *cancelled) {
+      return false;
+    }
+
+    done_cond_.wait(&lock_, 100);
+  }
+
+  return succeeded_;
+}
+
+bool ConformProgress::IsFinished()
+{
+  QMutexLocker locker(&lock_);
+
+  return finished_;
+}
+
+bool ConformProgress::RangeIsDone(int first, int last) const
+{
+  for (int i=first;i<=last;i++) {
+    if (!done_.testBit(i)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+OLIVE_NAMESPACE_EXIT
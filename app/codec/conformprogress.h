@@ -0,0 +1,155 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef CONFORMPROGRESS_H
+#define CONFORMPROGRESS_H
+
+#include <memory>
+#include <QAtomicInt>
+#include <QBitArray>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "render/audioparams.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Tracks which parts of an audio conform have been written so far
+ *
+ * Conforms are written in fixed-size chunks, not necessarily in order. Readers can use any chunk that's done while
+ * the rest is still being conformed, and only block on the chunks they actually need. Waiting on a chunk also moves
+ * it to the front of the queue so whatever is near the playhead gets conformed first.
+ *
+ * One of these is shared by everything that wants a particular conform (see AudioStream::request_conform()). Only
+ * one thread gets to do the conforming, the one that TryClaim()s it first.
+ */
+class ConformProgress
+{
+public:
+  ConformProgress(const AudioParams& params, qint64 estimated_samples);
+
+  DISABLE_COPY_MOVE(ConformProgress)
+
+  const AudioParams& params() const
+  {
+    return params_;
+  }
+
+  /**
+   * @brief Length of the conform in samples as estimated from the stream's duration
+   *
+   * The real length is only known once the decoder reaches the end. If the estimate was unavailable, this is 0 and
+   * the whole conform is one chunk.
+   */
+  qint64 estimated_samples() const
+  {
+    return estimated_samples_;
+  }
+
+  int chunk_count() const
+  {
+    return done_.size();
+  }
+
+  qint64 chunk_samples() const
+  {
+    return chunk_samples_;
+  }
+
+  /**
+   * @brief The chunk a sample falls in, clamped to the chunks that exist
+   */
+  int ChunkAt(qint64 sample) const;
+
+  /**
+   * @brief Returns true for the first caller only, who is then responsible for conforming and calling Finish()
+   */
+  bool TryClaim();
+
+  bool IsClaimed();
+
+  /**
+   * @brief Conformer only: chunk `chunk` and everything in it has been written
+   */
+  void MarkDone(int chunk);
+
+  /**
+   * @brief Conformer only: the chunk to conform next
+   *
+   * Returns the chunk most recently waited on if it isn't done yet, otherwise the first chunk from `from` onwards
+   * that isn't done (wrapping around). Returns -1 once every chunk is done.
+   */
+  int NextChunk(int from);
+
+  /**
+   * @brief Conformer only: conforming is over, wake everyone waiting
+   */
+  void Finish(bool success);
+
+  /**
+   * @brief Block until every chunk covering `count` samples from `start` has been written
+   *
+   * Returns true if they have, or false if the conform failed or `cancelled` was set first.
+   */
+  bool WaitForRange(qint64 start, qint64 count, const QAtomicInt* cancelled);
+
+  /**
+   * @brief Block until the conform has finished, returning whether it succeeded
+   */
+  bool WaitForFinish(const QAtomicInt* cancelled);
+
+  bool IsFinished();
+
+  /**
+   * @brief Length of each chunk in seconds
+   */
+  static const int kChunkSeconds;
+
+private:
+  bool RangeIsDone(int first, int last) const;
+
+  AudioParams params_;
+
+  qint64 estimated_samples_;
+
+  qint64 chunk_samples_;
+
+  QMutex lock_;
+
+  QWaitCondition done_cond_;
+
+  QBitArray done_;
+
+  int priority_;
+
+  bool claimed_;
+
+  bool finished_;
+
+  bool succeeded_;
+
+};
+
+using ConformProgressPtr = std::shared_ptr<ConformProgress>;
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // CONFORMPROGRESS_H
@@ -175,7 +175,23 @@ QString Decoder::GetConformedFilename(const AudioParams &params)
   return index_fn;
 }
 
-bool Decoder::ConformAudio(const QAtomicInt *, const AudioParams& )
+bool Decoder::ConformAudio(const QAtomicInt *, const AudioParams& params)
+{
+  // Nobody else can conform this, so don't leave anyone waiting on it
+  if (stream()->type() == Stream::kAudio) {
+    AudioStreamPtr audio_stream = std::static_pointer_cast<AudioStream>(stream());
+    ConformProgressPtr progress = audio_stream->request_conform(params);
+
+    if (progress && progress->TryClaim()) {
+      audio_stream->remove_conform(params);
+      progress->Finish(false);
+    }
+  }
+
+  return false;
+}
+
+bool Decoder::GenerateProxy(const QAtomicInt *, int)
 {
   return false;
 }
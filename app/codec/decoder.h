@@ -221,11 +221,26 @@ public:
    * will return immediately. Otherwise it will block the calling thread until the conform is
    * complete. This function should therefore only be called from a background render thread.
    *
+   * The conform is written in chunks that other threads can read as soon as they're done (see
+   * AudioStream::request_conform() and ConformProgress), prioritizing whichever chunk was most
+   * recently waited on.
+   *
    * All audio decoders must override this. It's not pure since video decoders don't need to use
    * this, but default behavior will abort since it should never be called.
    */
   virtual bool ConformAudio(const QAtomicInt* cancelled, const AudioParams &params);
 
+  /**
+   * @brief VIDEO ONLY: Transcodes the stream to a reduced resolution proxy
+   *
+   * Once the proxy is complete, RetrieveVideo() reads from it instead of the original media
+   * whenever the requested divider is at least `divider`. Like ConformAudio(), this blocks until
+   * the proxy is done and should only be called from a background thread.
+   *
+   * Decoders that can't make proxies can leave this as-is, it does nothing and returns false.
+   */
+  virtual bool GenerateProxy(const QAtomicInt* cancelled, int divider);
+
   /**
    * @brief AUDIO ONLY: Returns whether a transcode of this audio matching the specified params
    * already exists
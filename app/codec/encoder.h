@@ -25,6 +25,7 @@
 #include <QString>
 #include <QXmlStreamWriter>
 
+#include "audio/mappedpcm.h"
 #include "codec/exportcodec.h"
 #include "codec/exportformat.h"
 #include "codec/frame.h"
@@ -116,7 +117,7 @@ public:
 
   virtual bool WriteFrame(OLIVE_NAMESPACE::FramePtr frame, OLIVE_NAMESPACE::rational time) = 0;
   virtual void WriteAudio(OLIVE_NAMESPACE::AudioParams pcm_info,
-                          const QString& pcm_filename) = 0;
+                          OLIVE_NAMESPACE::MappedPCMPtr pcm) = 0;
 
   virtual void Close() = 0;
 
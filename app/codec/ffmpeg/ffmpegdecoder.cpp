@@ -27,7 +27,9 @@ extern "C" {
 #include <libavutil/pixdesc.h>
 }
 
+#include <limits>
 #include <OpenImageIO/imagebuf.h>
+#include <QCryptographicHash>
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
@@ -39,8 +41,9 @@ extern "C" {
 #include "codec/waveinput.h"
 #include "common/define.h"
 #include "common/filefunctions.h"
-#include "common/functiontimer.h"
 #include "common/timecodefunctions.h"
+#include "common/trace.h"
+#include "core.h"
 #include "ffmpegcommon.h"
 #include "render/framehashcache.h"
 #include "render/diskmanager.h"
@@ -48,16 +51,22 @@ extern "C" {
 
 OLIVE_NAMESPACE_ENTER
 
-QHash< Stream*, QList<FFmpegDecoderInstance*> > FFmpegDecoder::instance_map_;
+QHash< FFmpegDecoder::InstanceKey, QList<FFmpegDecoderInstance*> > FFmpegDecoder::instance_map_;
 QMutex FFmpegDecoder::instance_map_lock_;
-QHash< Stream*, FFmpegFramePool* > FFmpegDecoder::frame_pool_map_;
+QHash< FFmpegDecoder::InstanceKey, FFmpegFramePool* > FFmpegDecoder::frame_pool_map_;
 
 // FIXME: Hardcoded, ideally this value is dynamically chosen based on memory restraints
 const int FFmpegDecoderInstance::kMaxFrameLife = 2000;
 
+// MJPEG quantizer for proxies (2-31, lower is better quality and larger files)
+const int FFmpegDecoder::kProxyQuality = 4;
+
 FFmpegDecoder::FFmpegDecoder() :
   scale_ctx_(nullptr),
-  scale_divider_(0)
+  scale_divider_(0),
+  scale_input_divider_(0),
+  proxy_divider_(0),
+  conformed_input_complete_(false)
 {
 }
 
@@ -91,24 +100,6 @@ bool FFmpegDecoder::Open()
     src_pix_fmt_ = static_cast<AVPixelFormat>(our_instance->stream()->codecpar->format);
     ideal_pix_fmt_ = FFmpegCommon::GetCompatiblePixelFormat(src_pix_fmt_);
 
-    if (stream()->type() == Stream::kVideo) {
-      QMutexLocker map_locker(&instance_map_lock_);
-
-      // FIXME: Test code, this should be changed later
-      FFmpegFramePool* frame_pool = frame_pool_map_.value(stream().get());
-
-      if (!frame_pool) {
-        frame_pool = new FFmpegFramePool(256,
-                                         our_instance->stream()->codecpar->width,
-                                         our_instance->stream()->codecpar->height,
-                                         static_cast<AVPixelFormat>(our_instance->stream()->codecpar->format));
-        frame_pool_map_.insert(stream().get(), frame_pool);
-      }
-
-      our_instance->SetFramePool(frame_pool);
-      // End test code
-    }
-
     // Determine which Olive native pixel format we retrieved
     // Note that FFmpeg doesn't support float formats
     native_pix_fmt_ = GetNativePixelFormat(ideal_pix_fmt_);
@@ -119,22 +110,26 @@ bool FFmpegDecoder::Open()
   time_base_ = our_instance->stream()->time_base;
   start_time_ = our_instance->stream()->start_time;
 
+  if (stream()->type() == Stream::kVideo) {
+    RemoveStaleProxies();
+
+    if (!std::static_pointer_cast<VideoStream>(stream())->proxy_divider()) {
+      FindExistingProxy();
+    }
+  }
+
   // All allocation succeeded so we set the state to open
   open_ = true;
 
-  {
-    QMutexLocker l(&instance_map_lock_);
-
-    QList<FFmpegDecoderInstance*> list = instance_map_.value(stream().get());
-    list.append(our_instance);
-    instance_map_.insert(stream().get(), list);
-  }
+  AddInstance(InstanceKey(stream().get(), 1), our_instance);
 
   return true;
 }
 
 FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divider)
 {
+  TRACE_SCOPE("decode", "RetrieveVideo");
+
   QMutexLocker locker(&mutex_);
 
   if (!open_) {
@@ -161,6 +156,7 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divid
 
     if (ret >= 0) {
       output_frame = BuffersToNativeFrame(divider,
+                                          1,
                                           is->width(),
                                           is->height(),
                                           0,
@@ -177,119 +173,22 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divid
 
   } else {
 
-    FFmpegFramePool::ElementPtr return_frame = nullptr;
-
-    int64_t target_ts = Timecode::time_to_timestamp(timecode, time_base_) + start_time_;
-
     VideoStreamPtr vs = std::static_pointer_cast<VideoStream>(stream());
 
-    FFmpegDecoderInstance* working_instance = nullptr;
-
-    // Find instance
-    do {
-      QMutexLocker list_locker(&instance_map_lock_);
-
-      QList<FFmpegDecoderInstance*> non_ideal_contenders;
-
-      QList<FFmpegDecoderInstance*> instances = instance_map_.value(stream().get());
-
-      foreach (FFmpegDecoderInstance* i, instances) {
-
-        i->cache_lock()->lock();
-
-        if (i->CacheContainsTime(target_ts)) {
-
-          // Found our instance, allow others to enter the list
-
-          list_locker.unlock();
-
-          // Get the frame from this cache
-          return_frame = i->GetFrameFromCache(target_ts);
-
-          // Got our frame, allow cache to continue
-          i->cache_lock()->unlock();
-          break;
-
-        } else if (i->CacheWillContainTime(target_ts) || i->CacheCouldContainTime(target_ts)) {
-
-          // Found our instance, allow others to enter the list
-          list_locker.unlock();
-
-          // If the instance is currently in use, enter into a loop of seeing from frames come up next in case one is ours
-          if (i->IsWorking()) {
-
-            do {
-              // Allow instance to continue to the next frame
-              i->cache_wait_cond()->wait(i->cache_lock());
-
-              // See if the cache now contains this frame, if so we'll exit this loop
-              if (i->CacheContainsTime(target_ts)) {
-
-                // Grab the frame
-                return_frame = i->GetFrameFromCache(target_ts);
-
-                // We can release this worker now since we don't need it anymore
-                i->cache_lock()->unlock();
-
-              } else if (!i->IsWorking()) {
-
-                // This instance finished and we didn't get our frame, we'll take it and continue it
-                working_instance = i;
-                break;
-
-              }
-            } while (!return_frame);
-
-          } else {
-            // Otherwise, we'll grab this instance and continue it ourselves
-            working_instance = i;
-          }
-
-          break;
-
-        } else if (i->IsWorking()) {
-
-          // Ignore currently working instances
-          i->cache_lock()->unlock();
-
-        } else if (i->CacheIsEmpty()) {
-
-          // Prioritize this cache over others (leaves this instance LOCKED in case we end up using it later)
-          non_ideal_contenders.prepend(i);
-
-        } else {
-
-          // De-prioritize this cache (leaves this instance LOCKED in case we end up using it later)
-          non_ideal_contenders.append(i);
-
-        }
-      }
+    // Read from a proxy instead if there's one at least as large as the frame we've been asked for
+    int proxy_divider = vs->proxy_divider();
 
-      // If we didn't find a suitable contender, grab the first non-suitable and roll with that
-      if (!return_frame && !working_instance && !non_ideal_contenders.isEmpty()) {
-        working_instance = non_ideal_contenders.takeFirst();
-      }
+    if (proxy_divider > 1 && proxy_divider <= divider) {
+      FramePtr proxy_frame = RetrieveProxyVideo(timecode, divider, proxy_divider);
 
-      // For all instances we left locked but didn't end up using, lock them now
-      foreach (FFmpegDecoderInstance* unsuitable_instance, non_ideal_contenders) {
-        unsuitable_instance->cache_lock()->unlock();
+      if (proxy_frame) {
+        return proxy_frame;
       }
-    } while (!return_frame && !working_instance);
-
-    if (!return_frame && working_instance) {
-
-      // This instance SHOULD remain locked from our earlier loop, making this operation safe
-      working_instance->SetWorking(true);
+    }
 
-      // Retrieve frame
-      return_frame = working_instance->RetrieveFrame(target_ts, true);
+    int64_t target_ts = Timecode::time_to_timestamp(timecode, time_base_) + start_time_;
 
-      // Set working to false and wake any threads waiting
-      working_instance->cache_lock()->lock();
-      working_instance->SetWorking(false);
-      working_instance->cache_wait_cond()->wakeAll();
-      working_instance->cache_lock()->unlock();
-    }
+    FFmpegFramePool::ElementPtr return_frame = RetrieveFrameFromInstances(InstanceKey(stream().get(), 1), target_ts);
 
     // We found the frame, we'll return a copy
     if (return_frame) {
@@ -306,6 +205,7 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divid
                            1);
 
       return BuffersToNativeFrame(divider,
+                                  1,
                                   vs->width(),
                                   vs->height(),
                                   target_ts,
@@ -320,6 +220,8 @@ FramePtr FFmpegDecoder::RetrieveVideo(const rational &timecode, const int &divid
 
 SampleBufferPtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rational &length, const AudioParams &params)
 {
+  TRACE_SCOPE("decode", "RetrieveAudio");
+
   QMutexLocker locker(&mutex_);
 
   if (!open_) {
@@ -332,82 +234,326 @@ SampleBufferPtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rat
   }
 
   QString wav_fn = GetConformedFilename(params);
-  WaveInput input(wav_fn);
 
-  if (input.open()) {
-    const AudioParams& input_params = input.params();
+  // The conform may still be being written, in which case reopen it once it's done to pick up its final length
+  bool conform_complete = std::static_pointer_cast<AudioStream>(stream())->has_conformed_version(params);
 
-    // Read bytes from wav
-    QByteArray packed_data = input.read(input_params.time_to_bytes(timecode), input_params.time_to_bytes(length));
-    input.close();
+  if (!conformed_input_
+      || conformed_input_->filename() != wav_fn
+      || (!conformed_input_complete_ && conform_complete)) {
+    conformed_input_ = std::unique_ptr<WaveInput>(new WaveInput(wav_fn));
+    conformed_input_complete_ = conform_complete;
 
-    // Create sample buffer
-    SampleBufferPtr sample_buffer = SampleBuffer::CreateFromPackedData(input_params, packed_data);
+    if (!conformed_input_->open()) {
+      conformed_input_ = nullptr;
+      qCritical() << "Failed to open cached file" << wav_fn;
+      return nullptr;
+    }
+  }
+
+  const AudioParams& input_params = conformed_input_->params();
+  const char* mapped = conformed_input_->map();
+
+  if (mapped) {
+    // Deinterleave straight out of the mapped conform
+    int sample_count = conformed_input_->sample_count();
+    int start = qBound(0, input_params.time_to_samples(timecode), sample_count);
+    int count = qBound(0, input_params.time_to_samples(length), sample_count - start);
 
-    return sample_buffer;
+    return SampleBuffer::CreateFromPackedData(input_params,
+                                              mapped + input_params.samples_to_bytes(start),
+                                              count);
   }
 
-  qCritical() << "Failed to open cached file" << wav_fn;
+  // Read bytes from wav
+  QByteArray packed_data = conformed_input_->read(input_params.time_to_bytes(timecode),
+                                                  input_params.time_to_bytes(length));
 
-  return nullptr;
+  // Create sample buffer
+  return SampleBuffer::CreateFromPackedData(input_params, packed_data);
 }
 
 void FFmpegDecoder::Close()
 {
   QMutexLocker locker(&mutex_);
 
-  {
-    // Clear whichever instance is not in use and is least useful (there are only ever as many instances as there are
-    // threads so if this thread is closing, an instance MUST be inactive)
-    QMutexLocker l(&instance_map_lock_);
+  RemoveInstance(InstanceKey(stream().get(), 1));
 
-    QList<FFmpegDecoderInstance*> list = instance_map_.value(stream().get());
+  if (proxy_divider_) {
+    RemoveInstance(InstanceKey(stream().get(), proxy_divider_));
+    proxy_divider_ = 0;
+    proxy_filename_.clear();
+  }
 
-    if (!list.isEmpty()) {
-      // Rank the instances by least useful (the top one should be one that isn't working and isn't in use)
-      QList<FFmpegDecoderInstance*> least_useful;
+  ClearResources();
+}
+
+FFmpegFramePool::ElementPtr FFmpegDecoder::RetrieveFrameFromInstances(const InstanceKey &key, const int64_t &target_ts)
+{
+  FFmpegFramePool::ElementPtr return_frame = nullptr;
+
+  FFmpegDecoderInstance* working_instance = nullptr;
+
+  // Find instance
+  do {
+    QMutexLocker list_locker(&instance_map_lock_);
+
+    QList<FFmpegDecoderInstance*> non_ideal_contenders;
+
+    QList<FFmpegDecoderInstance*> instances = instance_map_.value(key);
+
+    foreach (FFmpegDecoderInstance* i, instances) {
+
+      i->cache_lock()->lock();
 
-      foreach (FFmpegDecoderInstance* i, list) {
-        i->cache_lock()->lock();
+      if (i->CacheContainsTime(target_ts)) {
 
+        // Found our instance, allow others to enter the list
+
+        list_locker.unlock();
+
+        // Get the frame from this cache
+        return_frame = i->GetFrameFromCache(target_ts);
+
+        // Got our frame, allow cache to continue
+        i->cache_lock()->unlock();
+        break;
+
+      } else if (i->CacheWillContainTime(target_ts) || i->CacheCouldContainTime(target_ts)) {
+
+        // Found our instance, allow others to enter the list
+        list_locker.unlock();
+
+        // If the instance is currently in use, enter into a loop of seeing from frames come up next in case one is ours
         if (i->IsWorking()) {
-          // Don't bother any currently working instances
-          i->cache_lock()->unlock();
-          continue;
-        }
 
-        if (i->CacheIsEmpty()) {
-          least_useful.prepend(i);
+          do {
+            // Allow instance to continue to the next frame
+            i->cache_wait_cond()->wait(i->cache_lock());
+
+            // See if the cache now contains this frame, if so we'll exit this loop
+            if (i->CacheContainsTime(target_ts)) {
+
+              // Grab the frame
+              return_frame = i->GetFrameFromCache(target_ts);
+
+              // We can release this worker now since we don't need it anymore
+              i->cache_lock()->unlock();
+
+            } else if (!i->IsWorking()) {
+
+              // This instance finished and we didn't get our frame, we'll take it and continue it
+              working_instance = i;
+              break;
+
+            }
+          } while (!return_frame);
+
         } else {
-          least_useful.append(i);
+          // Otherwise, we'll grab this instance and continue it ourselves
+          working_instance = i;
         }
+
+        break;
+
+      } else if (i->IsWorking()) {
+
+        // Ignore currently working instances
+        i->cache_lock()->unlock();
+
+      } else if (i->CacheIsEmpty()) {
+
+        // Prioritize this cache over others (leaves this instance LOCKED in case we end up using it later)
+        non_ideal_contenders.prepend(i);
+
+      } else {
+
+        // De-prioritize this cache (leaves this instance LOCKED in case we end up using it later)
+        non_ideal_contenders.append(i);
+
       }
+    }
+
+    // If we didn't find a suitable contender, grab the first non-suitable and roll with that
+    if (!return_frame && !working_instance && !non_ideal_contenders.isEmpty()) {
+      working_instance = non_ideal_contenders.takeFirst();
+    }
+
+    // For all instances we left locked but didn't end up using, lock them now
+    foreach (FFmpegDecoderInstance* unsuitable_instance, non_ideal_contenders) {
+      unsuitable_instance->cache_lock()->unlock();
+    }
+  } while (!return_frame && !working_instance);
+
+  if (!return_frame && working_instance) {
 
-      // Remove the least useful from the list and re-insert it into the map
-      FFmpegDecoderInstance* least_useful_instance = least_useful.first();
-      list.removeOne(least_useful_instance);
-      instance_map_.insert(stream().get(), list);
+    // This instance SHOULD remain locked from our earlier loop, making this operation safe
+    working_instance->SetWorking(true);
 
-      // If there are no more instances, destroy frame pool
-      if (list.isEmpty()) {
-        FFmpegFramePool* frame_pool = frame_pool_map_.take(stream().get());
-        delete frame_pool;
+    // Retrieve frame
+    return_frame = working_instance->RetrieveFrame(target_ts, true);
+
+    // Set working to false and wake any threads waiting
+    working_instance->cache_lock()->lock();
+    working_instance->SetWorking(false);
+    working_instance->cache_wait_cond()->wakeAll();
+    working_instance->cache_lock()->unlock();
+  }
+
+  return return_frame;
+}
+
+FramePtr FFmpegDecoder::RetrieveProxyVideo(const rational &timecode, int divider, int proxy_divider)
+{
+  VideoStreamPtr vs = std::static_pointer_cast<VideoStream>(stream());
+
+  // The proxy's filename follows the source's identifier, so this also notices the source changing underneath an
+  // instance we already have open
+  QString proxy_fn = GetProxyFilename(proxy_divider);
+
+  if (proxy_divider != proxy_divider_ || proxy_fn != proxy_filename_) {
+    // A different proxy has been made since we last used one, or the one we have open is stale
+    if (proxy_divider_) {
+      RemoveInstance(InstanceKey(stream().get(), proxy_divider_));
+      proxy_divider_ = 0;
+      proxy_filename_.clear();
+    }
+
+    FFmpegDecoderInstance* instance = new FFmpegDecoderInstance(proxy_fn.toUtf8(), 0);
+
+    if (!instance->IsValid()) {
+      // Most likely the source has changed since the proxy was made so it's no longer at this filename. Stop trying
+      // to use it until another is made.
+      delete instance;
+
+      RemoveStaleProxies();
+
+      if (vs->proxy_divider() == proxy_divider) {
+        vs->set_proxy_divider(0);
       }
 
-      // We're done with the list now, we can unlock it and allow others to use it
-      l.unlock();
+      return nullptr;
+    }
+
+    AVStream* proxy_stream = instance->stream();
 
-      // Unlock all the instances we locked
-      foreach (FFmpegDecoderInstance* i, least_useful) {
+    proxy_time_base_ = proxy_stream->time_base;
+    proxy_start_time_ = (proxy_stream->start_time == AV_NOPTS_VALUE) ? 0 : proxy_stream->start_time;
+    proxy_width_ = proxy_stream->codecpar->width;
+    proxy_height_ = proxy_stream->codecpar->height;
+    proxy_pix_fmt_ = static_cast<AVPixelFormat>(proxy_stream->codecpar->format);
+
+    AddInstance(InstanceKey(stream().get(), proxy_divider), instance);
+
+    proxy_divider_ = proxy_divider;
+    proxy_filename_ = proxy_fn;
+  }
+
+  // Proxy timestamps start at zero from the source's start time (see GenerateProxy())
+  int64_t proxy_ts = Timecode::time_to_timestamp(timecode, proxy_time_base_) + proxy_start_time_;
+
+  FFmpegFramePool::ElementPtr proxy_frame = RetrieveFrameFromInstances(InstanceKey(stream().get(), proxy_divider_),
+                                                                       proxy_ts);
+
+  if (!proxy_frame) {
+    return nullptr;
+  }
+
+  uint8_t* input_data[4];
+  int input_linesize[4];
+
+  av_image_fill_arrays(input_data,
+                       input_linesize,
+                       reinterpret_cast<const uint8_t*>(proxy_frame->data()),
+                       proxy_pix_fmt_,
+                       proxy_width_,
+                       proxy_height_,
+                       1);
+
+  return BuffersToNativeFrame(divider,
+                              proxy_divider_,
+                              vs->width(),
+                              vs->height(),
+                              Timecode::time_to_timestamp(timecode, time_base_) + start_time_,
+                              input_data,
+                              input_linesize);
+}
+
+void FFmpegDecoder::AddInstance(const InstanceKey &key, FFmpegDecoderInstance *instance)
+{
+  QMutexLocker l(&instance_map_lock_);
+
+  if (stream()->type() == Stream::kVideo) {
+    // FIXME: Test code, this should be changed later
+    FFmpegFramePool* frame_pool = frame_pool_map_.value(key);
+
+    if (!frame_pool) {
+      frame_pool = new FFmpegFramePool(256,
+                                       instance->stream()->codecpar->width,
+                                       instance->stream()->codecpar->height,
+                                       static_cast<AVPixelFormat>(instance->stream()->codecpar->format));
+      frame_pool_map_.insert(key, frame_pool);
+    }
+
+    instance->SetFramePool(frame_pool);
+    // End test code
+  }
+
+  QList<FFmpegDecoderInstance*> list = instance_map_.value(key);
+  list.append(instance);
+  instance_map_.insert(key, list);
+}
+
+void FFmpegDecoder::RemoveInstance(const InstanceKey &key)
+{
+  // Clear whichever instance is not in use and is least useful (there are only ever as many instances as there are
+  // threads so if this thread is closing, an instance MUST be inactive)
+  QMutexLocker l(&instance_map_lock_);
+
+  QList<FFmpegDecoderInstance*> list = instance_map_.value(key);
+
+  if (!list.isEmpty()) {
+    // Rank the instances by least useful (the top one should be one that isn't working and isn't in use)
+    QList<FFmpegDecoderInstance*> least_useful;
+
+    foreach (FFmpegDecoderInstance* i, list) {
+      i->cache_lock()->lock();
+
+      if (i->IsWorking()) {
+        // Don't bother any currently working instances
         i->cache_lock()->unlock();
+        continue;
       }
 
-      // Delete this least useful instance now that we've definitely taken ownership of it
-      least_useful_instance->deleteLater();
+      if (i->CacheIsEmpty()) {
+        least_useful.prepend(i);
+      } else {
+        least_useful.append(i);
+      }
     }
-  }
 
-  ClearResources();
+    // Remove the least useful from the list and re-insert it into the map
+    FFmpegDecoderInstance* least_useful_instance = least_useful.first();
+    list.removeOne(least_useful_instance);
+    instance_map_.insert(key, list);
+
+    // If there are no more instances, destroy frame pool
+    if (list.isEmpty()) {
+      FFmpegFramePool* frame_pool = frame_pool_map_.take(key);
+      delete frame_pool;
+    }
+
+    // We're done with the list now, we can unlock it and allow others to use it
+    l.unlock();
+
+    // Unlock all the instances we locked
+    foreach (FFmpegDecoderInstance* i, least_useful) {
+      i->cache_lock()->unlock();
+    }
+
+    // Delete this least useful instance now that we've definitely taken ownership of it
+    least_useful_instance->deleteLater();
+  }
 }
 
 QString FFmpegDecoder::id()
@@ -647,21 +793,36 @@ void SaveCacheFrame(FFmpegDecoder* decoder,
 
 bool FFmpegDecoder::ConformAudio(const QAtomicInt *cancelled, const AudioParams &p)
 {
-  // Iterate through each audio frame and extract the PCM data
   AudioStreamPtr audio_stream = std::static_pointer_cast<AudioStream>(stream());
 
+  ConformProgressPtr progress = audio_stream->request_conform(p);
+
+  if (!progress) {
+    // Already conformed
+    return true;
+  }
+
+  if (!progress->TryClaim()) {
+    // Someone else is conforming this, wait for them to finish
+    return progress->WaitForFinish(cancelled);
+  }
+
   // Check if we already have a conform of this type
   QString conformed_fn = GetConformedFilename(p);
 
-  if (QFileInfo::exists(conformed_fn)) {
+  // Exists for as long as a conform is being written so one that was interrupted isn't mistaken for a complete one
+  QFile partial_marker(QStringLiteral("%1.partial").arg(conformed_fn));
+
+  if (QFileInfo::exists(conformed_fn) && !partial_marker.exists()) {
 
     // If we have one, and we can open it correctly, we can use it as-is
     WaveInput input(conformed_fn);
     if (input.open()) {
-      audio_stream->append_conformed_version(p);
-
       input.close();
 
+      audio_stream->append_conformed_version(p);
+      progress->Finish(true);
+
       return true;
     }
   }
@@ -674,6 +835,8 @@ bool FFmpegDecoder::ConformAudio(const QAtomicInt *cancelled, const AudioParams
   uint64_t channel_layout = ValidateChannelLayout(index_instance.stream());
   if (!channel_layout) {
     qCritical() << "Failed to determine channel layout of audio file, could not conform";
+    audio_stream->remove_conform(p);
+    progress->Finish(false);
     return false;
   }
 
@@ -698,74 +861,180 @@ bool FFmpegDecoder::ConformAudio(const QAtomicInt *cancelled, const AudioParams
 
   bool success = false;
 
-  if (wave_out.open()) {
-    while (true) {
-      // Check if we have a `cancelled` ptr and its value
+  if (partial_marker.open(QFile::WriteOnly) && wave_out.open()) {
+    partial_marker.close();
+
+    // Size the file up front so chunks can be written in any order and read while the rest are still being written
+    wave_out.reserve(p.samples_to_bytes(progress->estimated_samples()));
+
+    AVStream* avstream = index_instance.stream();
+    double stream_time_base = av_q2d(avstream->time_base);
+    int64_t stream_start = (avstream->start_time == AV_NOPTS_VALUE) ? 0 : avstream->start_time;
+
+    int bytes_per_sample = p.samples_to_bytes(1);
+
+    QByteArray resampled;
+
+    // Samples resampled past the end of a chunk, written at the start of the next one if we carry straight on
+    QByteArray carry;
+    qint64 carry_start = 0;
+
+    // Sample position the next resampled audio belongs at, or -1 if it'll be found from the next frame's timestamp
+    qint64 position = 0;
+
+    int chunk = progress->NextChunk(0);
+    bool need_seek = (chunk > 0);
+    bool failed = false;
+
+    while (chunk >= 0) {
       if (cancelled && *cancelled) {
         break;
       }
 
-      ret = index_instance.GetFrame(pkt, frame);
+      qint64 chunk_start = chunk * progress->chunk_samples();
 
-      if (ret < 0) {
+      // The last chunk takes whatever is left, however long the estimate was
+      qint64 chunk_end = (chunk == progress->chunk_count() - 1)
+          ? std::numeric_limits<qint64>::max()
+          : chunk_start + progress->chunk_samples();
 
-        if (ret == AVERROR_EOF) {
-          success = true;
-        } else {
+      if (need_seek) {
+        int64_t target = qRound64(static_cast<double>(chunk_start) / p.sample_rate() / stream_time_base);
+
+        index_instance.Seek(stream_start + target);
+
+        // Don't carry resampler state over from somewhere else in the stream
+        swr_init(resampler);
+
+        position = -1;
+        carry.clear();
+      } else if (!carry.isEmpty()) {
+        wave_out.write(p.samples_to_bytes(carry_start), carry.constData(), carry.size());
+        carry.clear();
+      }
+
+      bool eof = false;
+
+      while (position < chunk_end) {
+        if (cancelled && *cancelled) {
+          break;
+        }
+
+        ret = index_instance.GetFrame(pkt, frame);
+
+        if (ret < 0) {
+
+          if (ret == AVERROR_EOF) {
+            eof = true;
+          } else {
+            char err_str[50];
+            av_strerror(ret, err_str, 50);
+            qWarning() << "Failed to conform:" << ret << err_str;
+            failed = true;
+          }
+          break;
+
+        }
+
+        if (position < 0) {
+          // First frame after a seek, place it by its timestamp
+          if (frame->pts == AV_NOPTS_VALUE) {
+            position = chunk_start;
+          } else {
+            position = qRound64(static_cast<double>(frame->pts - stream_start) * stream_time_base * p.sample_rate());
+          }
+        }
+
+        int nb_samples = swr_get_out_samples(resampler, frame->nb_samples);
+        resampled.resize(p.samples_to_bytes(nb_samples));
+        uint8_t* resampled_data = reinterpret_cast<uint8_t*>(resampled.data());
+
+        // Resample audio to our destination parameters
+        nb_samples = swr_convert(resampler,
+                                 &resampled_data,
+                                 nb_samples,
+                                 const_cast<const uint8_t**>(frame->data),
+                                 frame->nb_samples);
+
+        if (nb_samples < 0) {
           char err_str[50];
-          av_strerror(ret, err_str, 50);
-          qWarning() << "Failed to conform:" << ret << err_str;
+          av_strerror(nb_samples, err_str, 50);
+          qWarning() << "libswresample failed with error:" << nb_samples << err_str;
+          failed = true;
+          break;
+        }
+
+        // Only write what falls in this chunk, seeking may have landed before it
+        qint64 frame_end = position + nb_samples;
+        qint64 write_start = qMax(position, chunk_start);
+        qint64 write_end = qMin(frame_end, chunk_end);
+
+        if (write_end > write_start) {
+          wave_out.write(p.samples_to_bytes(write_start),
+                         resampled.constData() + (write_start - position) * bytes_per_sample,
+                         p.samples_to_bytes(write_end - write_start));
+        }
+
+        if (frame_end > chunk_end) {
+          carry_start = qMax(chunk_end, position);
+          carry = resampled.mid(static_cast<int>(carry_start - position) * bytes_per_sample,
+                                p.samples_to_bytes(static_cast<int>(frame_end - carry_start)));
         }
-        break;
 
+        position = frame_end;
+
+        SignalProcessingProgress(frame->pts);
       }
 
-      // Allocate buffers
-      int nb_samples = swr_get_out_samples(resampler, frame->nb_samples);
-      char* data = new char[p.samples_to_bytes(nb_samples)];
-
-      // Resample audio to our destination parameters
-      nb_samples = swr_convert(resampler,
-                               reinterpret_cast<uint8_t**>(&data),
-                               nb_samples,
-                               const_cast<const uint8_t**>(frame->data),
-                               frame->nb_samples);
-
-      if (nb_samples < 0) {
-        char err_str[50];
-        av_strerror(nb_samples, err_str, 50);
-        qWarning() << "libswresample failed with error:" << nb_samples << err_str;
+      if (failed || (cancelled && *cancelled)) {
         break;
       }
 
-      // Write packed WAV data to the disk cache
-      wave_out.write(data, p.samples_to_bytes(nb_samples));
+      if (eof) {
+        // Nothing left from here to the end. If the estimate was long, the rest stays silent.
+        wave_out.set_data_length(qMax(wave_out.data_length(), p.samples_to_bytes(position)));
 
-      // If we allocated an output for the resampler, delete it here
-      if (data != reinterpret_cast<char*>(frame->data[0])) {
-        delete [] data;
-      }
+        for (int i=chunk;i<progress->chunk_count();i++) {
+          progress->MarkDone(i);
+        }
 
-      SignalProcessingProgress(frame->pts);
+        chunk = progress->NextChunk(0);
+        need_seek = true;
+      } else {
+        progress->MarkDone(chunk);
+
+        // Carry straight on unless something else has been asked for or is already done
+        int next = progress->NextChunk(chunk + 1);
+        need_seek = (next != chunk + 1);
+        chunk = next;
+      }
     }
 
     wave_out.close();
 
+    success = (chunk < 0 && !failed);
+
     if (success) {
 
       // If our conform succeeded, add it
+      partial_marker.remove();
       audio_stream->append_conformed_version(p);
 
     } else {
 
       // Audio index didn't complete, delete it
       QFile(conformed_fn).remove();
+      partial_marker.remove();
+      audio_stream->remove_conform(p);
 
     }
   } else {
     qWarning() << "Failed to open WAVE output for indexing";
+    audio_stream->remove_conform(p);
   }
 
+  progress->Finish(success);
+
   swr_free(&resampler);
 
   av_frame_free(&frame);
@@ -774,6 +1043,257 @@ bool FFmpegDecoder::ConformAudio(const QAtomicInt *cancelled, const AudioParams
   return success;
 }
 
+namespace {
+
+QString ProxyErrorString(const char* context, int error_code)
+{
+  char err[128];
+  av_strerror(error_code, err, 128);
+
+  return QStringLiteral("%1 - %2 %3").arg(context, QString::number(error_code), err);
+}
+
+/**
+ * @brief Send a frame (or nullptr to flush) to the proxy encoder and write out any packets it produces
+ */
+int WriteProxyPackets(AVCodecContext* encoder, AVFrame* frame, AVFormatContext* out_ctx, AVStream* out_stream, AVPacket* pkt)
+{
+  int error_code = avcodec_send_frame(encoder, frame);
+
+  while (error_code >= 0) {
+    error_code = avcodec_receive_packet(encoder, pkt);
+
+    if (error_code == AVERROR(EAGAIN) || error_code == AVERROR_EOF) {
+      return 0;
+    } else if (error_code < 0) {
+      break;
+    }
+
+    av_packet_rescale_ts(pkt, encoder->time_base, out_stream->time_base);
+    pkt->stream_index = out_stream->index;
+
+    error_code = av_interleaved_write_frame(out_ctx, pkt);
+  }
+
+  return error_code;
+}
+
+}
+
+bool FFmpegDecoder::GenerateProxy(const QAtomicInt *cancelled, int divider)
+{
+  if (stream()->type() != Stream::kVideo || divider < 2) {
+    return false;
+  }
+
+  QString proxy_fn = GetProxyFilename(divider);
+
+  // Written under another name and renamed once complete so a decoder never opens an unfinished proxy
+  QString partial_fn = QStringLiteral("%1.partial").arg(proxy_fn);
+  QByteArray partial_bytes = partial_fn.toUtf8();
+
+  FFmpegDecoderInstance source(stream()->footage()->filename().toUtf8(), stream()->index());
+
+  AVFormatContext* out_ctx = nullptr;
+  AVStream* out_stream;
+  AVCodecContext* encoder = nullptr;
+  AVCodec* codec;
+  SwsContext* scaler = nullptr;
+  AVPacket* in_pkt = av_packet_alloc();
+  AVPacket* out_pkt = av_packet_alloc();
+  AVFrame* frame = av_frame_alloc();
+  AVFrame* scaled = av_frame_alloc();
+  int64_t source_start;
+  int64_t last_pts = AV_NOPTS_VALUE;
+  QString error_string;
+  bool success = false;
+  int error_code;
+
+  if (!source.IsValid()) {
+    error_string = QStringLiteral("Failed to open source");
+    goto fail;
+  }
+
+  source_start = (source.stream()->start_time == AV_NOPTS_VALUE) ? 0 : source.stream()->start_time;
+
+  // Every MJPEG frame is a keyframe, so seeking in the proxy never decodes more than the frame it's after
+  codec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+  if (!codec) {
+    error_string = QStringLiteral("No MJPEG encoder available");
+    goto fail;
+  }
+
+  error_code = avformat_alloc_output_context2(&out_ctx, nullptr, "mov", partial_bytes.constData());
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to allocate output context", error_code);
+    goto fail;
+  }
+
+  encoder = avcodec_alloc_context3(codec);
+  encoder->width = GetScaledDimension(source.stream()->codecpar->width, divider);
+  encoder->height = GetScaledDimension(source.stream()->codecpar->height, divider);
+  encoder->pix_fmt = AV_PIX_FMT_YUVJ422P;
+  encoder->time_base = source.stream()->time_base;
+  encoder->flags |= AV_CODEC_FLAG_QSCALE;
+  encoder->global_quality = FF_QP2LAMBDA * kProxyQuality;
+
+  if (out_ctx->oformat->flags & AVFMT_GLOBALHEADER) {
+    encoder->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+
+  error_code = avcodec_open2(encoder, codec, nullptr);
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to open encoder", error_code);
+    goto fail;
+  }
+
+  out_stream = avformat_new_stream(out_ctx, nullptr);
+  if (!out_stream) {
+    error_string = QStringLiteral("Failed to create stream");
+    goto fail;
+  }
+
+  avcodec_parameters_from_context(out_stream->codecpar, encoder);
+  out_stream->time_base = encoder->time_base;
+
+  error_code = avio_open(&out_ctx->pb, partial_bytes.constData(), AVIO_FLAG_WRITE);
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to open IO context", error_code);
+    goto fail;
+  }
+
+  error_code = avformat_write_header(out_ctx, nullptr);
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to write format header", error_code);
+    goto fail;
+  }
+
+  scaler = sws_getContext(source.stream()->codecpar->width,
+                          source.stream()->codecpar->height,
+                          static_cast<AVPixelFormat>(source.stream()->codecpar->format),
+                          encoder->width,
+                          encoder->height,
+                          encoder->pix_fmt,
+                          SWS_BILINEAR,
+                          nullptr,
+                          nullptr,
+                          nullptr);
+  if (!scaler) {
+    error_string = QStringLiteral("Failed to create scaler");
+    goto fail;
+  }
+
+  scaled->width = encoder->width;
+  scaled->height = encoder->height;
+  scaled->format = encoder->pix_fmt;
+
+  error_code = av_frame_get_buffer(scaled, 0);
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to allocate frame", error_code);
+    goto fail;
+  }
+
+  while (true) {
+    if (cancelled && *cancelled) {
+      goto fail;
+    }
+
+    error_code = source.GetFrame(in_pkt, frame);
+
+    if (error_code == AVERROR_EOF) {
+      break;
+    } else if (error_code < 0) {
+      error_string = ProxyErrorString("Failed to decode source", error_code);
+      goto fail;
+    }
+
+    // The muxer needs increasing timestamps, and a frame we can't place is no use to a decoder seeking the proxy
+    if (frame->pts == AV_NOPTS_VALUE || (last_pts != AV_NOPTS_VALUE && frame->pts <= last_pts)) {
+      continue;
+    }
+
+    last_pts = frame->pts;
+
+    // The encoder may still be holding on to the last frame we gave it
+    error_code = av_frame_make_writable(scaled);
+    if (error_code < 0) {
+      error_string = ProxyErrorString("Failed to allocate frame", error_code);
+      goto fail;
+    }
+
+    sws_scale(scaler,
+              frame->data,
+              frame->linesize,
+              0,
+              frame->height,
+              scaled->data,
+              scaled->linesize);
+
+    // Proxy timestamps are the source's relative to its start time, RetrieveProxyVideo() relies on this
+    scaled->pts = frame->pts - source_start;
+
+    error_code = WriteProxyPackets(encoder, scaled, out_ctx, out_stream, out_pkt);
+    if (error_code < 0) {
+      error_string = ProxyErrorString("Failed to encode frame", error_code);
+      goto fail;
+    }
+
+    SignalProcessingProgress(frame->pts - source_start);
+  }
+
+  error_code = WriteProxyPackets(encoder, nullptr, out_ctx, out_stream, out_pkt);
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to flush encoder", error_code);
+    goto fail;
+  }
+
+  error_code = av_write_trailer(out_ctx);
+  if (error_code < 0) {
+    error_string = ProxyErrorString("Failed to write format trailer", error_code);
+    goto fail;
+  }
+
+  success = true;
+
+fail:
+  if (out_ctx) {
+    avio_closep(&out_ctx->pb);
+    avformat_free_context(out_ctx);
+  }
+
+  avcodec_free_context(&encoder);
+  sws_freeContext(scaler);
+
+  av_frame_free(&scaled);
+  av_frame_free(&frame);
+  av_packet_free(&out_pkt);
+  av_packet_free(&in_pkt);
+
+  if (success) {
+    QFile::remove(proxy_fn);
+    success = QFile::rename(partial_fn, proxy_fn);
+  } else {
+    QFile::remove(partial_fn);
+
+    if (!error_string.isEmpty()) {
+      qWarning().noquote() << "Failed to create proxy for" << stream()->footage()->filename() << "-" << error_string;
+    }
+  }
+
+  if (success) {
+    RemoveStaleProxies();
+
+    // A smaller proxy than one already in use would only lower quality, keep the existing one instead
+    VideoStreamPtr vs = std::static_pointer_cast<VideoStream>(stream());
+
+    if (!vs->proxy_divider() || divider < vs->proxy_divider()) {
+      vs->set_proxy_divider(divider);
+    }
+  }
+
+  return success;
+}
+
 QString FFmpegDecoder::GetIndexFilename() const
 {
   return FileFunctions::GetMediaIndexFilename(FileFunctions::GetUniqueFileIdentifier(stream()->footage()->filename()))
@@ -785,6 +1305,65 @@ QString FFmpegDecoder::GetProxyFilename(int divider) const
   return GetIndexFilename().append('d').append(QString::number(divider));
 }
 
+QString FFmpegDecoder::GetProxyRecordFilename() const
+{
+  // Keyed on the path alone so it stays put when the file's contents change
+  QByteArray path = QFileInfo(stream()->footage()->filename()).absoluteFilePath().toUtf8();
+  QByteArray path_hash = QCryptographicHash::hash(path, QCryptographicHash::Sha1).toHex();
+
+  return FileFunctions::GetMediaIndexFilename(QString::fromLatin1(path_hash))
+      .append(QString::number(stream()->index()))
+      .append(QStringLiteral("proxy"));
+}
+
+void FFmpegDecoder::RemoveStaleProxies()
+{
+  QString identifier = FileFunctions::GetUniqueFileIdentifier(stream()->footage()->filename());
+
+  if (identifier.isEmpty()) {
+    return;
+  }
+
+  QFile record(GetProxyRecordFilename());
+
+  if (record.open(QFile::ReadOnly)) {
+    QString recorded = QString::fromUtf8(record.readAll()).trimmed();
+
+    record.close();
+
+    if (recorded == identifier) {
+      return;
+    }
+
+    if (!recorded.isEmpty()) {
+      // The source has changed since these proxies were made, nothing will ever look for them again
+      QString stale_index = FileFunctions::GetMediaIndexFilename(recorded).append(QString::number(stream()->index()));
+
+      foreach (int divider, Core::SupportedDividers()) {
+        if (divider > 1) {
+          QFile::remove(QStringLiteral("%1d%2").arg(stale_index, QString::number(divider)));
+        }
+      }
+    }
+  }
+
+  if (record.open(QFile::WriteOnly | QFile::Truncate)) {
+    record.write(identifier.toUtf8());
+    record.close();
+  }
+}
+
+void FFmpegDecoder::FindExistingProxy()
+{
+  // Prefer the largest proxy since it can stand in for the most dividers
+  foreach (int divider, Core::SupportedDividers()) {
+    if (divider > 1 && QFileInfo::exists(GetProxyFilename(divider))) {
+      std::static_pointer_cast<VideoStream>(stream())->set_proxy_divider(divider);
+      break;
+    }
+  }
+}
+
 int FFmpegDecoder::GetScaledDimension(int dim, int divider)
 {
   return dim / divider;
@@ -815,11 +1394,11 @@ uint64_t FFmpegDecoder::ValidateChannelLayout(AVStream* stream)
   return av_get_default_channel_layout(stream->codecpar->channels);
 }
 
-FramePtr FFmpegDecoder::BuffersToNativeFrame(int divider, int width, int height, int64_t ts, uint8_t** input_data, int* input_linesize)
+FramePtr FFmpegDecoder::BuffersToNativeFrame(int divider, int input_divider, int width, int height, int64_t ts, uint8_t** input_data, int* input_linesize)
 {
-  if (divider != scale_divider_) {
+  if (divider != scale_divider_ || input_divider != scale_input_divider_) {
     FreeScaler();
-    InitScaler(divider);
+    InitScaler(divider, input_divider);
   }
 
   // Create frame to return
@@ -840,7 +1419,7 @@ FramePtr FFmpegDecoder::BuffersToNativeFrame(int divider, int width, int height,
             input_data,
             input_linesize,
             0,
-            height,
+            (input_divider > 1) ? proxy_height_ : height,
             &output_data,
             &output_linesize);
 
@@ -849,6 +1428,8 @@ FramePtr FFmpegDecoder::BuffersToNativeFrame(int divider, int width, int height,
 
 int FFmpegDecoderInstance::GetFrame(AVPacket *pkt, AVFrame *frame)
 {
+  TRACE_SCOPE("decode", "DecodeFrame");
+
   bool eof = false;
 
   int ret;
@@ -914,6 +1495,8 @@ void FFmpegDecoderInstance::SetWorking(bool working)
 
 void FFmpegDecoderInstance::Seek(int64_t timestamp)
 {
+  TRACE_SCOPE_ARG("decode", "Seek", timestamp);
+
   avcodec_flush_buffers(codec_ctx_);
   av_seek_frame(fmt_ctx_, avstream_->index, timestamp, AVSEEK_FLAG_BACKWARD);
 }
@@ -1131,16 +1714,21 @@ void FFmpegDecoder::ClearResources()
 {
   FreeScaler();
 
+  conformed_input_ = nullptr;
+
   open_ = false;
 }
 
-void FFmpegDecoder::InitScaler(int divider)
+void FFmpegDecoder::InitScaler(int divider, int input_divider)
 {
   VideoStream* vs = static_cast<VideoStream*>(stream().get());
 
-  scale_ctx_ = sws_getContext(vs->width(),
-                              vs->height(),
-                              src_pix_fmt_,
+  // Input is either the source or the proxy we're reading from
+  bool from_proxy = (input_divider > 1);
+
+  scale_ctx_ = sws_getContext(from_proxy ? proxy_width_ : vs->width(),
+                              from_proxy ? proxy_height_ : vs->height(),
+                              from_proxy ? proxy_pix_fmt_ : src_pix_fmt_,
                               GetScaledDimension(vs->width(), divider),
                               GetScaledDimension(vs->height(), divider),
                               ideal_pix_fmt_,
@@ -1151,8 +1739,10 @@ void FFmpegDecoder::InitScaler(int divider)
 
   if (scale_ctx_) {
     scale_divider_ = divider;
+    scale_input_divider_ = input_divider;
   } else {
     scale_divider_ = 0;
+    scale_input_divider_ = 0;
   }
 }
 
@@ -1163,6 +1753,7 @@ void FFmpegDecoder::FreeScaler()
     scale_ctx_ = nullptr;
 
     scale_divider_ = 0;
+    scale_input_divider_ = 0;
   }
 }
 
@@ -1410,7 +2001,7 @@ void FFmpegDecoderInstance::ClearResources()
 void FFmpegDecoderInstance::ClearTimerEvent()
 {
   cache_lock()->lock();
-  RemoveFramesBefore(QDateTime::currentMSecsSinceEpoch() - kMaxFrameLife);
+  RemoveFramesBefore(FFmpegFramePool::Element::CurrentTime() - kMaxFrameLife);
   cache_lock()->unlock();
 }
 
@@ -28,6 +28,7 @@ extern "C" {
 }
 
 #include <QAtomicInt>
+#include <QPair>
 #include <QTimer>
 #include <QVector>
 #include <QWaitCondition>
@@ -35,6 +36,7 @@ extern "C" {
 #include "audio/sampleformat.h"
 #include "avframeptr.h"
 #include "codec/decoder.h"
+#include "codec/waveinput.h"
 #include "codec/waveoutput.h"
 #include "ffmpegframepool.h"
 #include "project/item/footage/videostream.h"
@@ -93,11 +95,11 @@ public:
   bool IsWorking() const;
   void SetWorking(bool working);
 
+  void Seek(int64_t timestamp);
+
 private:
   void ClearResources();
 
-  void Seek(int64_t timestamp);
-
   AVFormatContext* fmt_ctx_;
   AVCodecContext* codec_ctx_;
   AVStream* avstream_;
@@ -152,7 +154,16 @@ public:
 
   virtual bool ConformAudio(const QAtomicInt* cancelled, const AudioParams& p) override;
 
+  virtual bool GenerateProxy(const QAtomicInt* cancelled, int divider) override;
+
 private:
+  /**
+   * @brief Identifies a set of shared instances: the stream they decode and the proxy divider they read from
+   *
+   * A divider of 1 means the original media.
+   */
+  using InstanceKey = QPair<Stream*, int>;
+
   /**
    * @brief Handle an error
    *
@@ -174,11 +185,53 @@ private:
 
   virtual QString GetIndexFilename() const override;
 
+  /**
+   * @brief Add an instance to the shared list for `key`, creating its frame pool if needed
+   */
+  void AddInstance(const InstanceKey& key, FFmpegDecoderInstance* instance);
+
+  /**
+   * @brief Remove and delete the least useful instance that isn't working from the shared list for `key`
+   */
+  void RemoveInstance(const InstanceKey& key);
+
+  /**
+   * @brief Find or decode the frame at `target_ts` using the shared instances for `key`
+   *
+   * There must be at least one instance for `key`.
+   */
+  FFmpegFramePool::ElementPtr RetrieveFrameFromInstances(const InstanceKey& key, const int64_t& target_ts);
+
+  /**
+   * @brief Retrieve video from the proxy with divider `proxy_divider`, opening it if necessary
+   *
+   * Returns nullptr if the proxy couldn't be read, in which case the original media should be used instead.
+   */
+  FramePtr RetrieveProxyVideo(const rational& timecode, int divider, int proxy_divider);
+
+  /**
+   * @brief Look on disk for a proxy of the open stream made by an earlier GenerateProxy()
+   */
+  void FindExistingProxy();
+
   QString GetProxyFilename(int divider) const;
 
+  /**
+   * @brief File recording which version of the source this stream's proxies were made from
+   */
+  QString GetProxyRecordFilename() const;
+
+  /**
+   * @brief Delete proxies made from an earlier version of the source file
+   *
+   * Proxy filenames are derived from the source's unique identifier, so once the source changes its old proxies are
+   * never looked up again and would otherwise stay on disk forever.
+   */
+  void RemoveStaleProxies();
+
   void ClearResources();
 
-  void InitScaler(int divider);
+  void InitScaler(int divider, int input_divider);
   void FreeScaler();
 
   QString GetProxyFrameFilename(const int64_t& timestamp, const int &divider) const;
@@ -189,10 +242,11 @@ private:
 
   static uint64_t ValidateChannelLayout(AVStream *stream);
 
-  FramePtr BuffersToNativeFrame(int divider, int width, int height, int64_t ts, uint8_t **input_data, int* input_linesize);
+  FramePtr BuffersToNativeFrame(int divider, int input_divider, int width, int height, int64_t ts, uint8_t **input_data, int* input_linesize);
 
   SwsContext* scale_ctx_;
   int scale_divider_;
+  int scale_input_divider_;
   AVPixelFormat src_pix_fmt_;
   AVPixelFormat ideal_pix_fmt_;
   PixelFormat::Format native_pix_fmt_;
@@ -200,8 +254,23 @@ private:
   rational time_base_;
   int64_t start_time_;
 
-  static QHash< Stream*, QList<FFmpegDecoderInstance*> > instance_map_;
-  static QHash< Stream*, FFmpegFramePool* > frame_pool_map_;
+  // Proxy this decoder has an instance open for, or 0 if none
+  int proxy_divider_;
+  QString proxy_filename_;
+  rational proxy_time_base_;
+  int64_t proxy_start_time_;
+  int proxy_width_;
+  int proxy_height_;
+  AVPixelFormat proxy_pix_fmt_;
+
+  // Most recently read conform, kept open and mapped between audio retrievals
+  std::unique_ptr<WaveInput> conformed_input_;
+  bool conformed_input_complete_;
+
+  static const int kProxyQuality;
+
+  static QHash< InstanceKey, QList<FFmpegDecoderInstance*> > instance_map_;
+  static QHash< InstanceKey, FFmpegFramePool* > frame_pool_map_;
   static QMutex instance_map_lock_;
 
 };
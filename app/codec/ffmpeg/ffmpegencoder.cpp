@@ -24,7 +24,6 @@ extern "C" {
 #include <libavutil/pixdesc.h>
 }
 
-#include <QFile>
 
 #include "ffmpegcommon.h"
 #include "render/pixelformat.h"
@@ -174,10 +173,9 @@ fail:
   return success;
 }
 
-void FFmpegEncoder::WriteAudio(AudioParams pcm_info, const QString &pcm_filename)
+void FFmpegEncoder::WriteAudio(AudioParams pcm_info, MappedPCMPtr pcm)
 {
-  QFile pcm(pcm_filename);
-  if (pcm.open(QFile::ReadOnly)) {
+  if (pcm) {
     // Divide PCM stream into AVFrames
 
     // See if the codec defines a number of samples per frame
@@ -217,6 +215,11 @@ void FFmpegEncoder::WriteAudio(AudioParams pcm_info, const QString &pcm_filename
     // Keep track of sample count to use as each frame's timebase
     int sample_counter = 0;
 
+    // Position in the PCM and a buffer we reuse for every read
+    qint64 pcm_position = 0;
+    qint64 pcm_length = pcm->length();
+    QByteArray input_data;
+
     while (true) {
       // Calculate how many samples should input this frame
       int64_t samples_needed = av_rescale_rnd(maximum_frame_samples + swr_get_delay(swr_ctx, pcm_info.sample_rate()),
@@ -224,11 +227,11 @@ void FFmpegEncoder::WriteAudio(AudioParams pcm_info, const QString &pcm_filename
                                               pcm_info.sample_rate(),
                                               AV_ROUND_UP);
 
-      // Calculate how many bytes this is
-      int max_read = pcm_info.samples_to_bytes(samples_needed);
-
-      // Read bytes from PCM
-      QByteArray input_data = pcm.read(max_read);
+      // Read samples from PCM
+      qint64 samples_read = qMin(static_cast<qint64>(samples_needed), pcm_length - pcm_position);
+      input_data.resize(pcm_info.samples_to_bytes(samples_read));
+      pcm->ReadPacked(pcm_position, input_data.data(), samples_read);
+      pcm_position += samples_read;
 
       // Use swresample to convert the data into the correct format
       const char* input_data_array = input_data.constData();
@@ -244,7 +247,7 @@ void FFmpegEncoder::WriteAudio(AudioParams pcm_info, const QString &pcm_filename
                                   reinterpret_cast<const uint8_t**>(&input_data_array),
 
                                   // input sample count (maximum amount of samples we read from pcm file)
-                                  pcm_info.bytes_to_samples(input_data.size()));
+                                  static_cast<int>(samples_read));
 
       // Update the frame's number of samples to the amount we actually received
       frame->nb_samples = converted;
@@ -262,7 +265,7 @@ void FFmpegEncoder::WriteAudio(AudioParams pcm_info, const QString &pcm_filename
       }
 
       // Break if we've reached the end point
-      if (pcm.atEnd()) {
+      if (pcm_position == pcm_length) {
         break;
       }
     }
@@ -270,8 +273,6 @@ void FFmpegEncoder::WriteAudio(AudioParams pcm_info, const QString &pcm_filename
     av_frame_free(&frame);
 
     swr_free(&swr_ctx);
-
-    pcm.close();
   }
 }
 
@@ -310,15 +311,221 @@ void FFmpegEncoder::Close()
   }
 }
 
+bool FFmpegEncoder::ConcatenateFiles(const QStringList &inputs, const QString &output, QString *error)
+{
+  AVFormatContext* in_ctx = nullptr;
+  AVFormatContext* out_ctx = nullptr;
+  QByteArray input_bytes;
+  QByteArray output_bytes = output.toUtf8();
+  QVector<int64_t> last_dts;
+  int64_t start = 0;
+  QString error_string;
+  bool success = false;
+  int error_code;
+
+  if (inputs.isEmpty()) {
+    error_string = tr("No files to concatenate");
+    goto fail;
+  }
+
+  // The first file decides the output's streams
+  input_bytes = inputs.first().toUtf8();
+
+  error_code = avformat_open_input(&in_ctx, input_bytes.constData(), nullptr, nullptr);
+  if (error_code < 0) {
+    error_string = FFmpegErrorString("Failed to open input", inputs.first(), error_code);
+    goto fail;
+  }
+
+  error_code = avformat_find_stream_info(in_ctx, nullptr);
+  if (error_code < 0) {
+    error_string = FFmpegErrorString("Failed to find stream info", inputs.first(), error_code);
+    goto fail;
+  }
+
+  error_code = avformat_alloc_output_context2(&out_ctx, nullptr, nullptr, output_bytes.constData());
+  if (error_code < 0) {
+    error_string = FFmpegErrorString("Failed to allocate output context", output, error_code);
+    goto fail;
+  }
+
+  for (unsigned int i=0;i<in_ctx->nb_streams;i++) {
+    AVStream* out_stream = avformat_new_stream(out_ctx, nullptr);
+
+    if (!out_stream) {
+      error_string = tr("Failed to create stream for %1").arg(output);
+      goto fail;
+    }
+
+    error_code = avcodec_parameters_copy(out_stream->codecpar, in_ctx->streams[i]->codecpar);
+    if (error_code < 0) {
+      error_string = FFmpegErrorString("Failed to copy codec parameters", output, error_code);
+      goto fail;
+    }
+
+    // Let the muxer pick a tag that suits the output container
+    out_stream->codecpar->codec_tag = 0;
+    out_stream->time_base = in_ctx->streams[i]->time_base;
+  }
+
+  avformat_close_input(&in_ctx);
+
+  error_code = avio_open(&out_ctx->pb, output_bytes.constData(), AVIO_FLAG_WRITE);
+  if (error_code < 0) {
+    error_string = FFmpegErrorString("Failed to open IO context", output, error_code);
+    goto fail;
+  }
+
+  error_code = avformat_write_header(out_ctx, nullptr);
+  if (error_code < 0) {
+    error_string = FFmpegErrorString("Failed to write format header", output, error_code);
+    goto fail;
+  }
+
+  last_dts.fill(AV_NOPTS_VALUE, static_cast<int>(out_ctx->nb_streams));
+
+  foreach (const QString& input, inputs) {
+    if (!AppendFile(out_ctx, input, &start, &last_dts, &error_string)) {
+      goto fail;
+    }
+  }
+
+  error_code = av_write_trailer(out_ctx);
+  if (error_code < 0) {
+    error_string = FFmpegErrorString("Failed to write format trailer", output, error_code);
+    goto fail;
+  }
+
+  success = true;
+
+fail:
+  avformat_close_input(&in_ctx);
+
+  if (out_ctx) {
+    avio_closep(&out_ctx->pb);
+    avformat_free_context(out_ctx);
+  }
+
+  if (!success) {
+    qWarning() << error_string;
+
+    if (error) {
+      *error = error_string;
+    }
+  }
+
+  return success;
+}
+
 void FFmpegEncoder::FFmpegError(const char* context, int error_code)
+{
+  Error(FFmpegErrorString(context, params().filename(), error_code));
+}
+
+QString FFmpegEncoder::FFmpegErrorString(const char *context, const QString &filename, int error_code)
 {
   char err[128];
   av_strerror(error_code, err, 128);
 
-  Error(QStringLiteral("%1 for %2 - %3 %4").arg(context,
-                                                params().filename(),
-                                                QString::number(error_code),
-                                                err));
+  return QStringLiteral("%1 for %2 - %3 %4").arg(context,
+                                                 filename,
+                                                 QString::number(error_code),
+                                                 err);
+}
+
+bool FFmpegEncoder::AppendFile(AVFormatContext *out_ctx, const QString &input, int64_t *start,
+                               QVector<int64_t> *last_dts, QString *error)
+{
+  AVFormatContext* in_ctx = nullptr;
+  AVPacket* pkt = nullptr;
+  QByteArray input_bytes = input.toUtf8();
+  int64_t end = *start;
+  int length_stream;
+  bool success = false;
+  int error_code;
+
+  error_code = avformat_open_input(&in_ctx, input_bytes.constData(), nullptr, nullptr);
+  if (error_code < 0) {
+    *error = FFmpegErrorString("Failed to open input", input, error_code);
+    goto fail;
+  }
+
+  error_code = avformat_find_stream_info(in_ctx, nullptr);
+  if (error_code < 0) {
+    *error = FFmpegErrorString("Failed to find stream info", input, error_code);
+    goto fail;
+  }
+
+  if (in_ctx->nb_streams != out_ctx->nb_streams) {
+    *error = tr("%1 does not have the same streams as the other files").arg(input);
+    goto fail;
+  }
+
+  for (unsigned int i=0;i<in_ctx->nb_streams;i++) {
+    if (in_ctx->streams[i]->codecpar->codec_id != out_ctx->streams[i]->codecpar->codec_id) {
+      *error = tr("%1 does not use the same codecs as the other files").arg(input);
+      goto fail;
+    }
+  }
+
+  // The video decides where the next file starts. Audio encoders pad out their last frame, so going by the longest
+  // stream would slowly push the video out of sync with the audio.
+  length_stream = av_find_best_stream(in_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+
+  pkt = av_packet_alloc();
+
+  while ((error_code = av_read_frame(in_ctx, pkt)) >= 0) {
+    AVStream* in_stream = in_ctx->streams[pkt->stream_index];
+    AVStream* out_stream = out_ctx->streams[pkt->stream_index];
+    int64_t offset = av_rescale_q(*start, AV_TIME_BASE_Q, out_stream->time_base);
+    int64_t& stream_last_dts = (*last_dts)[pkt->stream_index];
+
+    av_packet_rescale_ts(pkt, in_stream->time_base, out_stream->time_base);
+
+    if (pkt->pts != AV_NOPTS_VALUE) {
+      pkt->pts += offset;
+
+      if (length_stream < 0 || pkt->stream_index == length_stream) {
+        end = qMax(end, av_rescale_q(pkt->pts + pkt->duration, out_stream->time_base, AV_TIME_BASE_Q));
+      }
+    }
+
+    if (pkt->dts != AV_NOPTS_VALUE) {
+      pkt->dts += offset;
+
+      // Drop any padding that overlaps the end of the previous file, the muxer won't accept timestamps going backwards
+      if (stream_last_dts != AV_NOPTS_VALUE && pkt->dts <= stream_last_dts) {
+        av_packet_unref(pkt);
+        continue;
+      }
+
+      stream_last_dts = pkt->dts;
+    }
+
+    pkt->pos = -1;
+
+    // NOTE: This takes ownership of the packet's data and resets it
+    error_code = av_interleaved_write_frame(out_ctx, pkt);
+    if (error_code < 0) {
+      *error = FFmpegErrorString("Failed to write packet", input, error_code);
+      goto fail;
+    }
+  }
+
+  if (error_code != AVERROR_EOF) {
+    *error = FFmpegErrorString("Failed to read packet", input, error_code);
+    goto fail;
+  }
+
+  *start = end;
+
+  success = true;
+
+fail:
+  av_packet_free(&pkt);
+  avformat_close_input(&in_ctx);
+
+  return success;
 }
 
 bool FFmpegEncoder::WriteAVFrame(AVFrame *frame, AVCodecContext* codec_ctx, AVStream* stream)
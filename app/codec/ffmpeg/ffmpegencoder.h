@@ -28,6 +28,9 @@ extern "C" {
 #include <libavutil/opt.h>
 }
 
+#include <QStringList>
+#include <QVector>
+
 #include "codec/encoder.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -43,10 +46,20 @@ public:
   virtual bool WriteFrame(OLIVE_NAMESPACE::FramePtr frame, OLIVE_NAMESPACE::rational time) override;
 
   virtual void WriteAudio(OLIVE_NAMESPACE::AudioParams pcm_info,
-                          const QString& pcm_filename) override;
+                          OLIVE_NAMESPACE::MappedPCMPtr pcm) override;
 
   virtual void Close() override;
 
+  /**
+   * @brief Join files encoded with identical parameters into one file without re-encoding
+   *
+   * Used to stitch together the segments of a split export. Every input must have the same streams as the first one.
+   * Packets are copied as-is with their timestamps offset so each file starts where the previous one ended.
+   *
+   * @return True on success. On failure, `error` (if not null) is set to a description of what went wrong.
+   */
+  static bool ConcatenateFiles(const QStringList& inputs, const QString& output, QString* error = nullptr);
+
 private:
   /**
    * @brief Handle an error
@@ -67,6 +80,17 @@ private:
    */
   void FFmpegError(const char *context, int error_code);
 
+  static QString FFmpegErrorString(const char *context, const QString& filename, int error_code);
+
+  /**
+   * @brief Copies every packet of `input` into `out_ctx`, offset by `start`
+   *
+   * `start` is in AV_TIME_BASE units and is moved to the end of this file on success. `last_dts` holds the last DTS
+   * written for each output stream.
+   */
+  static bool AppendFile(AVFormatContext* out_ctx, const QString& input, int64_t* start, QVector<int64_t>* last_dts,
+                         QString* error);
+
   bool WriteAVFrame(AVFrame* frame, AVCodecContext *codec_ctx, AVStream *stream);
 
   bool InitializeStream(enum AVMediaType type, AVStream** stream, AVCodecContext** codec_ctx, const ExportCodec::Codec &codec);
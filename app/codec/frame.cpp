@@ -27,6 +27,7 @@
 OLIVE_NAMESPACE_ENTER
 
 Frame::Frame() :
+  download_failed_(false),
   timestamp_(0),
   sample_aspect_ratio_(1)
 {
@@ -85,6 +86,8 @@ Color Frame::get_pixel(int x, int y) const
 
   int byte_offset = PixelFormat::GetBufferSize(video_params().format(), pixel_index, 1);
 
+  EnsureDownloaded();
+
   return Color(data_.data() + byte_offset, video_params().format());
 }
 
@@ -103,6 +106,8 @@ void Frame::set_pixel(int x, int y, const Color &c)
 
   int byte_offset = PixelFormat::GetBufferSize(video_params().format(), pixel_index, 1);
 
+  EnsureDownloaded();
+
   c.toData(data_.data() + byte_offset, video_params().format());
 }
 
@@ -142,11 +147,15 @@ void Frame::set_native_timestamp(const int64_t &timestamp)
 
 char *Frame::data()
 {
+  EnsureDownloaded();
+
   return data_.data();
 }
 
 const char *Frame::const_data() const
 {
+  EnsureDownloaded();
+
   return data_.constData();
 }
 
@@ -158,22 +167,86 @@ void Frame::allocate()
     return;
   }
 
+  QMutexLocker locker(&download_lock_);
+
+  // Any texture we held is about to be replaced by whatever's written into memory
+  texture_.clear();
+  download_ = nullptr;
+  download_failed_ = false;
+
   data_.resize(PixelFormat::GetBufferSize(params_.format(), linesize_, params_.height()));
 }
 
 bool Frame::is_allocated() const
 {
-  return !data_.isEmpty();
+  QMutexLocker locker(&download_lock_);
+
+  return !data_.isEmpty() || download_;
 }
 
 void Frame::destroy()
 {
+  QMutexLocker locker(&download_lock_);
+
   data_.clear();
+  texture_.clear();
+  download_ = nullptr;
+  download_failed_ = false;
 }
 
 int Frame::allocated_size() const
 {
+  EnsureDownloaded();
+
   return data_.size();
 }
 
+void Frame::set_texture(const QVariant &texture, std::function<bool (FramePtr)> download)
+{
+  QMutexLocker locker(&download_lock_);
+
+  data_.clear();
+  texture_ = texture;
+  download_ = download;
+  download_failed_ = false;
+}
+
+bool Frame::has_valid_data() const
+{
+  EnsureDownloaded();
+
+  QMutexLocker locker(&download_lock_);
+
+  return !download_failed_;
+}
+
+const QVariant &Frame::texture() const
+{
+  return texture_;
+}
+
+void Frame::EnsureDownloaded() const
+{
+  QMutexLocker locker(&download_lock_);
+
+  if (!download_) {
+    return;
+  }
+
+  // Downloaded into a separate frame so the download function never needs to access (and lock) this one
+  FramePtr destination = Frame::Create();
+  destination->set_video_params(params_);
+  destination->allocate();
+
+  if (!download_(destination)) {
+    // Blank rather than whatever was in the buffer, and flagged so it's never mistaken for the real image
+    destination->data_.fill(0);
+    download_failed_ = true;
+  }
+
+  download_ = nullptr;
+
+  data_.swap(destination->data_);
+}
+
 OLIVE_NAMESPACE_EXIT
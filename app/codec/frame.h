@@ -21,7 +21,10 @@
 #ifndef FRAME_H
 #define FRAME_H
 
+#include <functional>
 #include <memory>
+#include <QMutex>
+#include <QVariant>
 #include <QVector>
 
 #include "common/rational.h"
@@ -107,10 +110,45 @@ public:
    */
   int allocated_size() const;
 
+  /**
+   * @brief Keep this frame's image in a GPU texture rather than in memory
+   *
+   * `download` is called to read the image back into a newly allocated frame with the same parameters the first
+   * time this frame's data is accessed, so a frame that's only ever displayed never leaves the GPU. Frames are shared
+   * between threads, so any other thread accessing the data waits for the download to finish.
+   *
+   * `download` returns false if the image couldn't be read back, in which case this frame's data is left blank and
+   * has_valid_data() returns false.
+   */
+  void set_texture(const QVariant& texture, std::function<bool(FramePtr)> download);
+
+  /**
+   * @brief Returns false if this frame's image couldn't be read back from its texture
+   *
+   * Reads the image back first if that hasn't happened yet. Frames without valid data shouldn't be stored anywhere
+   * (e.g. the disk cache) since their contents are blank rather than the image they were rendered with.
+   */
+  bool has_valid_data() const;
+
+  /**
+   * @brief Returns the texture set in set_texture() or a null QVariant if this frame only exists in memory
+   */
+  const QVariant& texture() const;
+
 private:
+  void EnsureDownloaded() const;
+
   VideoParams params_;
 
-  QByteArray data_;
+  mutable QByteArray data_;
+
+  QVariant texture_;
+
+  mutable std::function<bool(FramePtr)> download_;
+
+  mutable bool download_failed_;
+
+  mutable QMutex download_lock_;
 
   rational timestamp_;
 
@@ -56,12 +56,21 @@ SampleBufferPtr SampleBuffer::CreateFromPackedData(const AudioParams &audio_para
     return nullptr;
   }
 
-  int samples_per_channel = audio_params.bytes_to_samples(bytes.size());
+  return CreateFromPackedData(audio_params, bytes.constData(), audio_params.bytes_to_samples(bytes.size()));
+}
+
+SampleBufferPtr SampleBuffer::CreateFromPackedData(const AudioParams &audio_params, const char *data, int samples_per_channel)
+{
+  if (!audio_params.is_valid()) {
+    qWarning() << "Tried to create from packed data with invalid parameters";
+    return nullptr;
+  }
+
   SampleBufferPtr buffer = CreateAllocated(audio_params, samples_per_channel);
 
   int total_samples = samples_per_channel * audio_params.channel_count();
 
-  const float* packed_data = reinterpret_cast<const float*>(bytes.constData());
+  const float* packed_data = reinterpret_cast<const float*>(data);
 
   for (int i=0;i<total_samples;i++) {
     int channel = i % audio_params.channel_count();
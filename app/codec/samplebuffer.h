@@ -48,6 +48,7 @@ public:
   static SampleBufferPtr Create();
   static SampleBufferPtr CreateAllocated(const AudioParams& audio_params, int samples_per_channel);
   static SampleBufferPtr CreateFromPackedData(const AudioParams& audio_params, const QByteArray& bytes);
+  static SampleBufferPtr CreateFromPackedData(const AudioParams& audio_params, const char* data, int samples_per_channel);
 
   DISABLE_COPY_MOVE(SampleBuffer)
 
@@ -30,7 +30,8 @@ extern "C" {
 OLIVE_NAMESPACE_ENTER
 
 WaveInput::WaveInput(const QString &f) :
-  file_(f)
+  file_(f),
+  mapped_data_(nullptr)
 {
 }
 
@@ -187,6 +188,19 @@ qint64 WaveInput::read(int offset, char *buffer, int length)
   return file_.read(buffer, qMin(calculate_max_read(), static_cast<qint64>(length)));
 }
 
+const char *WaveInput::map()
+{
+  if (!is_open()) {
+    return nullptr;
+  }
+
+  if (!mapped_data_ && data_size_ > 0) {
+    mapped_data_ = file_.map(data_position_, data_size_);
+  }
+
+  return reinterpret_cast<const char*>(mapped_data_);
+}
+
 bool WaveInput::seek(qint64 pos)
 {
   return file_.seek(data_position_ + qMin(pos, static_cast<qint64>(data_size_)));
@@ -205,8 +219,11 @@ const AudioParams &WaveInput::params() const
 void WaveInput::close()
 {
   if (file_.isOpen()) {
+    // Closing the file also unmaps it
     file_.close();
   }
+
+  mapped_data_ = nullptr;
 }
 
 const quint32 &WaveInput::data_length() const
@@ -40,6 +40,19 @@ public:
 
   bool is_open() const;
 
+  QString filename() const
+  {
+    return file_.fileName();
+  }
+
+  /**
+   * @brief Map the WAV's sample data into memory
+   *
+   * Returns a pointer to the first byte of sample data, valid until close(), or nullptr if the file couldn't be
+   * mapped. Mapping several times returns the same memory.
+   */
+  const char* map();
+
   QByteArray read(int length);
   QByteArray read(int offset, int length);
   qint64 read(int offset, char *buffer, int length);
@@ -68,6 +81,8 @@ private:
   qint64 data_position_;
 
   quint32 data_size_;
+
+  uchar* mapped_data_;
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -24,6 +24,7 @@ OLIVE_NAMESPACE_ENTER
 
 const int16_t kWAVIntegerFormat = 1;
 const int16_t kWAVFloatFormat = 3;
+const int kHeaderSize = 44;
 
 WaveOutput::WaveOutput(const QString &f,
                        const AudioParams& params) :
@@ -122,21 +123,55 @@ void WaveOutput::write(const char *bytes, int length)
   }
 }
 
-void WaveOutput::close()
+void WaveOutput::write(int offset, const char *bytes, int length)
 {
   if (file_.isOpen()) {
+    file_.seek(kHeaderSize + offset);
+    file_.write(bytes, length);
+
+    data_length_ = qMax(data_length_, offset + length);
+  }
+}
+
+void WaveOutput::reserve(int length)
+{
+  if (file_.isOpen() && length > data_length_) {
+    file_.resize(kHeaderSize + length);
+
+    data_length_ = length;
+
+    write_sizes();
+  }
+}
 
-    // Write file sizes
-    file_.seek(4);
-    write_int<int32_t>(&file_, data_length_ + 36);
+void WaveOutput::set_data_length(int length)
+{
+  data_length_ = length;
+}
 
-    file_.seek(40);
-    write_int<int32_t>(&file_, data_length_);
+void WaveOutput::close()
+{
+  if (file_.isOpen()) {
+    write_sizes();
 
     file_.close();
   }
 }
 
+void WaveOutput::write_sizes()
+{
+  qint64 pos = file_.pos();
+
+  // Write file sizes
+  file_.seek(4);
+  write_int<int32_t>(&file_, data_length_ + 36);
+
+  file_.seek(40);
+  write_int<int32_t>(&file_, data_length_);
+
+  file_.seek(pos);
+}
+
 const int& WaveOutput::data_length() const
 {
   return data_length_;
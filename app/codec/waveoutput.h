@@ -44,6 +44,25 @@ public:
   void write(const QByteArray& bytes);
   void write(const char* bytes, int length);
 
+  /**
+   * @brief Write sample data at `offset` bytes into the data chunk rather than appending it
+   */
+  void write(int offset, const char* bytes, int length);
+
+  /**
+   * @brief Grow the data chunk to `length` bytes of silence and write the header for it now
+   *
+   * Lets the file be opened and read by WaveInput while it's still being written into with write(offset, ...).
+   */
+  void reserve(int length);
+
+  /**
+   * @brief Set the data length the header will report on close()
+   *
+   * Never shrinks the file itself, so anything that has the file mapped stays valid.
+   */
+  void set_data_length(int length);
+
   void close();
 
   const int& data_length() const;
@@ -56,6 +75,8 @@ private:
 
   void switch_endianness(QByteArray &array);
 
+  void write_sizes();
+
   QFile file_;
 
   AudioParams params_;
@@ -0,0 +1,179 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "fasthash.h"
+
+#include <cstring>
+
+OLIVE_NAMESPACE_ENTER
+
+namespace {
+
+const quint64 kC1 = Q_UINT64_C(0x87c37b91114253d5);
+const quint64 kC2 = Q_UINT64_C(0x4cf5ad432745937f);
+
+inline quint64 RotateLeft(quint64 x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 FinalMix(quint64 k)
+{
+  k ^= k >> 33;
+  k *= Q_UINT64_C(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+  k ^= k >> 33;
+
+  return k;
+}
+
+inline quint64 MixK1(quint64 k1)
+{
+  k1 *= kC1;
+  k1 = RotateLeft(k1, 31);
+  k1 *= kC2;
+  return k1;
+}
+
+inline quint64 MixK2(quint64 k2)
+{
+  k2 *= kC2;
+  k2 = RotateLeft(k2, 33);
+  k2 *= kC1;
+  return k2;
+}
+
+}
+
+FastHasher::FastHasher(quint64 seed) :
+  h1_(seed),
+  h2_(seed),
+  length_(0),
+  tail_size_(0)
+{
+}
+
+void FastHasher::addData(const char *data, int length)
+{
+  if (length <= 0) {
+    return;
+  }
+
+  length_ += length;
+
+  // Complete a block left over from the last call first
+  if (tail_size_) {
+    int copy = qMin(length, 16 - tail_size_);
+
+    memcpy(tail_ + tail_size_, data, copy);
+    tail_size_ += copy;
+    data += copy;
+    length -= copy;
+
+    if (tail_size_ < 16) {
+      return;
+    }
+
+    ProcessBlock(tail_);
+    tail_size_ = 0;
+  }
+
+  while (length >= 16) {
+    ProcessBlock(data);
+    data += 16;
+    length -= 16;
+  }
+
+  if (length) {
+    memcpy(tail_, data, length);
+    tail_size_ = length;
+  }
+}
+
+QByteArray FastHasher::result() const
+{
+  quint64 h1 = h1_;
+  quint64 h2 = h2_;
+
+  if (tail_size_) {
+    quint64 k1 = 0;
+    quint64 k2 = 0;
+
+    // Tail bytes are read little endian, same as the reference implementation
+    for (int i=tail_size_-1;i>=8;i--) {
+      k2 = (k2 << 8) | static_cast<uchar>(tail_[i]);
+    }
+
+    for (int i=qMin(tail_size_, 8)-1;i>=0;i--) {
+      k1 = (k1 << 8) | static_cast<uchar>(tail_[i]);
+    }
+
+    if (tail_size_ > 8) {
+      h2 ^= MixK2(k2);
+    }
+
+    h1 ^= MixK1(k1);
+  }
+
+  h1 ^= static_cast<quint64>(length_);
+  h2 ^= static_cast<quint64>(length_);
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = FinalMix(h1);
+  h2 = FinalMix(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  QByteArray digest(kDigestSize, Qt::Uninitialized);
+  memcpy(digest.data(), &h1, sizeof(quint64));
+  memcpy(digest.data() + sizeof(quint64), &h2, sizeof(quint64));
+  return digest;
+}
+
+QByteArray FastHasher::hash(const QByteArray &data)
+{
+  FastHasher h;
+  h.addData(data);
+  return h.result();
+}
+
+void FastHasher::ProcessBlock(const char *block)
+{
+  quint64 k1, k2;
+
+  memcpy(&k1, block, sizeof(quint64));
+  memcpy(&k2, block + sizeof(quint64), sizeof(quint64));
+
+  h1_ ^= MixK1(k1);
+  h1_ = RotateLeft(h1_, 27);
+  h1_ += h2_;
+  h1_ = h1_ * 5 + 0x52dce729;
+
+  h2_ ^= MixK2(k2);
+  h2_ = RotateLeft(h2_, 31);
+  h2_ += h1_;
+  h2_ = h2_ * 5 + 0x38495ab5;
+}
+
+OLIVE_NAMESPACE_EXIT
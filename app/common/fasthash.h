@@ -0,0 +1,93 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FASTHASH_H
+#define FASTHASH_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Incremental 128-bit non-cryptographic hash
+ *
+ * A drop-in replacement for QCryptographicHash where the result only needs to identify data rather than protect it
+ * (e.g. frame cache keys). Implements MurmurHash3 x64 128 over a stream of data, so feeding the same bytes in
+ * different sized pieces produces the same result.
+ */
+class FastHasher
+{
+public:
+  FastHasher(quint64 seed = 0);
+
+  void addData(const char* data, int length);
+
+  void addData(const QByteArray& data)
+  {
+    addData(data.constData(), data.size());
+  }
+
+  /**
+   * @brief Add a string's UTF-16 data without converting it first
+   */
+  void addString(const QString& s)
+  {
+    addData(reinterpret_cast<const char*>(s.constData()), s.size() * static_cast<int>(sizeof(QChar)));
+  }
+
+  /**
+   * @brief Add the raw bytes of a trivially copyable value
+   */
+  template <typename T>
+  void add(const T& value)
+  {
+    addData(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  /**
+   * @brief Returns the 16-byte digest of everything added so far
+   *
+   * Does not reset the hasher, more data can still be added afterwards.
+   */
+  QByteArray result() const;
+
+  static QByteArray hash(const QByteArray& data);
+
+  static const int kDigestSize = 16;
+
+private:
+  void ProcessBlock(const char* block);
+
+  quint64 h1_;
+  quint64 h2_;
+
+  qint64 length_;
+
+  char tail_[16];
+  int tail_size_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // FASTHASH_H
@@ -45,6 +45,9 @@ QString FileFunctions::GetUniqueFileIdentifier(const QString &filename)
 
   hash.addData(info.lastModified().toString().toUtf8());
 
+  // Modification times only have a resolution of a second here, so the size catches changes within the same second
+  hash.addData(QByteArray::number(info.size()));
+
   QByteArray result = hash.result();
 
   return QString(result.toHex());
@@ -79,6 +82,13 @@ QString FileFunctions::GetMediaCacheLocation()
   return media_cache_dir.absolutePath();
 }
 
+QString FileFunctions::GetShaderCacheLocation()
+{
+  QDir local_appdata_dir(Config::Current()["DiskCachePath"].toString());
+
+  return local_appdata_dir.filePath("shadercache");
+}
+
 QString FileFunctions::GetConfigurationLocation()
 {
   if (IsPortable()) {
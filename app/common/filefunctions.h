@@ -48,6 +48,8 @@ public:
 
   static QString GetMediaCacheLocation();
 
+  static QString GetShaderCacheLocation();
+
   static QString GetConfigurationLocation();
 
   static QString GetApplicationPath();
@@ -21,12 +21,15 @@
 #ifndef MEMORYPOOL_H
 #define MEMORYPOOL_H
 
+#include <atomic>
+#include <chrono>
+#include <list>
 #include <memory>
-#include <QDateTime>
+#include <new>
 #include <QDebug>
-#include <QLinkedList>
 #include <QMutex>
 #include <stdint.h>
+#include <vector>
 
 #include "common/define.h"
 
@@ -45,6 +48,10 @@ template <typename T>
  *
  * `Get()` will return an ElementPtr. The original desired data can be accessed through ElementPtr::data(). This data
  * will belong to the caller until ElementPtr goes out of scope and the memory is freed back into the pool.
+ *
+ * Each arena keeps its free elements in a lock-free stack, so getting and releasing an element is O(1) and doesn't
+ * take any mutex. The pool's mutex is only taken when the current arena runs dry (growth) or when an arena becomes
+ * completely unused (shrink). Growth and shrink can be tuned with SetMaximumArenaCount() and SetMaximumIdleArenas().
  */
 class MemoryPool
 {
@@ -55,9 +62,13 @@ public:
    *
    * Number of elements per arena
    */
-  MemoryPool(int element_count) {
-    element_count_ = element_count;
-    ignore_arena_empty_signal_ = false;
+  MemoryPool(int element_count) :
+    element_count_(element_count),
+    max_arena_count_(0),
+    max_idle_arenas_(1),
+    current_(nullptr),
+    destroying_(false)
+  {
   }
 
   /**
@@ -66,7 +77,7 @@ public:
    * Deletes all arenas.
    */
   virtual ~MemoryPool() {
-    ignore_arena_empty_signal_ = true;
+    destroying_ = true;
     qDeleteAll(arenas_);
   }
 
@@ -76,14 +87,45 @@ public:
    * @brief Returns whether any arenas are successfully allocated
    */
   inline bool IsAllocated() const {
-    return !arenas_.isEmpty();
+    return GetArenaCount() > 0;
   }
 
   /**
    * @brief Returns current number of allocated arenas
    */
-  inline int GetArenaCount() const {
-    return arenas_.size();
+  int GetArenaCount() const {
+    QMutexLocker locker(&lock_);
+
+    int count = 0;
+
+    foreach (Arena* a, arenas_) {
+      if (a->IsAllocated()) {
+        count++;
+      }
+    }
+
+    return count;
+  }
+
+  /**
+   * @brief Set the maximum number of arenas this pool will allocate at once
+   *
+   * Once this limit is reached, Get() returns nullptr rather than growing further. 0 (the default) means unlimited.
+   */
+  void SetMaximumArenaCount(int count) {
+    QMutexLocker locker(&lock_);
+    max_arena_count_ = count;
+  }
+
+  /**
+   * @brief Set how many completely unused arenas are kept allocated
+   *
+   * Keeping at least one idle arena around prevents the pool from freeing and reallocating an arena every time usage
+   * oscillates around an arena boundary. Defaults to 1.
+   */
+  void SetMaximumIdleArenas(int count) {
+    QMutexLocker locker(&lock_);
+    max_idle_arenas_ = count;
   }
 
   class Arena;
@@ -102,10 +144,12 @@ public:
      *
      * There is no need to use this outside of the memory pool's internal functions.
      */
-    Element(Arena* parent, T* data) {
+    Element(Arena* parent, T* data, int index) {
       parent_ = parent;
       data_ = data;
-      accessed_ = QDateTime::currentMSecsSinceEpoch();
+      index_ = index;
+      timestamp_ = 0;
+      accessed_ = CurrentTime();
     }
 
     /**
@@ -140,7 +184,7 @@ public:
      * \see last_accessed()
      */
     inline void access() {
-      accessed_ = QDateTime::currentMSecsSinceEpoch();
+      accessed_ = CurrentTime();
     }
 
     /**
@@ -148,11 +192,24 @@ public:
      *
      * Useful for determining the relative age of an element (i.e. if it hasn't been accessed for a certain amount of
      * time, it can probably be freed back into the pool). This requires all usages to call `access()`.
+     *
+     * The value is in milliseconds on the same clock as CurrentTime().
      */
     inline const int64_t& last_accessed() const {
       return accessed_;
     }
 
+    /**
+     * @brief Monotonic millisecond clock used for access times
+     *
+     * Cheaper than a wall clock and unaffected by system time changes. Compare last_accessed() against this rather
+     * than QDateTime.
+     */
+    static inline int64_t CurrentTime() {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
     void release() {
       if (data_) {
         parent_->Release(this);
@@ -161,10 +218,21 @@ public:
     }
 
   private:
+    friend class Arena;
+
+    /**
+     * @brief Called by an arena that is being destroyed while this element is still lent out
+     */
+    inline void detach() {
+      data_ = nullptr;
+    }
+
     Arena* parent_;
 
     T* data_;
 
+    int index_;
+
     int64_t timestamp_;
 
     int64_t accessed_;
@@ -179,18 +247,28 @@ public:
    * The pool itself does not store memory, it stores "arenas". This is so that the pool can handle the situation of
    * an arena becoming full with no more memory to lend. A pool can automatically allocate another arena and continue
    * providing memory (and freeing arenas when they're no longer in use).
+   *
+   * Free elements are linked through `next_` into a Treiber stack. The stack head packs the top index, the number of
+   * free elements and an ABA tag into one 64-bit word so that Get() and Release() are a single CAS each. An arena
+   * whose memory has been freed is "closed" by swapping in a sentinel head, which makes any concurrent Get() fail
+   * cleanly instead of touching freed memory. Closed arenas are kept and reused by the pool rather than deleted.
    */
   class Arena {
   public:
     Arena(MemoryPool* parent) {
       parent_ = parent;
       data_ = nullptr;
+      element_sz_ = 0;
+      element_count_ = 0;
+      head_ = PackHead(kClosedIndex, 0, 0);
     }
 
     ~Arena() {
-      std::list<Element*> copy = lent_elements_;
-      foreach (Element* e, copy) {
-        e->release();
+      // Any elements still lent out must not write back into memory we're about to free
+      for (size_t i=0;i<lent_elements_.size();i++) {
+        if (lent_elements_.at(i)) {
+          lent_elements_.at(i)->detach();
+        }
       }
 
       delete [] data_;
@@ -202,86 +280,177 @@ public:
      * @brief Returns an element if there is free memory to do so
      */
     ElementPtr Get() {
-      QMutexLocker locker(&lock_);
+      uint64_t head = head_.load(std::memory_order_acquire);
+
+      forever {
+        uint32_t index = HeadIndex(head);
+
+        if (index == kEmptyIndex || index == kClosedIndex) {
+          return nullptr;
+        }
 
-      for (int i=0;i<available_.size();i++) {
-        if (available_.at(i)) {
-          // This buffer is available
-          available_.replace(i, false);
+        uint64_t new_head = PackHead(next_[index].load(std::memory_order_relaxed),
+                                     HeadCount(head) - 1,
+                                     HeadTag(head) + 1);
 
+        if (head_.compare_exchange_weak(head, new_head, std::memory_order_acquire, std::memory_order_acquire)) {
           ElementPtr e = std::make_shared<Element>(this,
-                                                   reinterpret_cast<T*>(data_ + i * element_sz_));
-          lent_elements_.push_back(e.get());
+                                                   reinterpret_cast<T*>(data_ + index * element_sz_),
+                                                   static_cast<int>(index));
+
+          // This index belongs exclusively to us until it's released so this doesn't need synchronizing
+          lent_elements_[index] = e.get();
+
           return e;
         }
       }
-
-      return nullptr;
     }
 
     /**
      * @brief Releases an element back into the pool for use elsewhere
      */
     void Release(Element* e) {
-      QMutexLocker locker(&lock_);
-      quintptr diff = reinterpret_cast<quintptr>(e->data()) - reinterpret_cast<quintptr>(data_);
+      uint32_t index = static_cast<uint32_t>(e->index_);
 
-      int index = diff / element_sz_;
+      lent_elements_[index] = nullptr;
 
-      available_.replace(index, true);
+      uint64_t head = head_.load(std::memory_order_relaxed);
+      uint64_t new_head;
 
-      lent_elements_.remove(e);
+      do {
+        next_[index].store(HeadIndex(head), std::memory_order_relaxed);
+        new_head = PackHead(index, HeadCount(head) + 1, HeadTag(head) + 1);
+      } while (!head_.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
 
-      if (lent_elements_.empty()) {
-        locker.unlock();
+      if (HeadCount(new_head) == element_count_) {
         parent_->ArenaIsEmpty(this);
       }
     }
 
-    int GetUsageCount() {
-      QMutexLocker locker(&lock_);
-      return lent_elements_.size();
+    int GetUsageCount() const {
+      uint64_t head = head_.load(std::memory_order_acquire);
+
+      if (HeadIndex(head) == kClosedIndex) {
+        return 0;
+      }
+
+      return static_cast<int>(element_count_ - HeadCount(head));
     }
 
+    /**
+     * @brief Allocate memory for this arena and mark every element as free
+     *
+     * Must only be called on an arena that isn't allocated, with the pool's lock held.
+     */
     bool Allocate(size_t ele_sz, size_t nb_elements) {
       if (IsAllocated()) {
         return true;
       }
 
+      if (element_count_ != nb_elements) {
+        // Index tables persist for the arena's lifetime (concurrent Get() calls may still read them after closing),
+        // so they are only created once
+        Q_ASSERT(element_count_ == 0);
+
+        element_count_ = static_cast<uint32_t>(nb_elements);
+        next_.reset(new std::atomic<uint32_t>[nb_elements]);
+        lent_elements_.resize(nb_elements, nullptr);
+      }
+
       element_sz_ = ele_sz;
 
-      if ((data_ = new char[element_sz_ * nb_elements])) {
-        available_.resize(nb_elements);
-        available_.fill(true);
+      if (!(data_ = new (std::nothrow) char[element_sz_ * nb_elements])) {
+        return false;
+      }
 
-        return true;
-      } else {
-        available_.clear();
+      for (uint32_t i=0;i<element_count_;i++) {
+        next_[i].store((i == element_count_ - 1) ? kEmptyIndex : i + 1, std::memory_order_relaxed);
+      }
+
+      uint64_t old_head = head_.load(std::memory_order_relaxed);
+      head_.store(PackHead(0, element_count_, HeadTag(old_head) + 1), std::memory_order_release);
 
+      return true;
+    }
+
+    /**
+     * @brief Free this arena's memory if none of its elements are lent out
+     *
+     * Must be called with the pool's lock held. Returns true if the memory was freed.
+     */
+    bool Free() {
+      uint64_t head = head_.load(std::memory_order_acquire);
+
+      if (HeadIndex(head) == kClosedIndex || HeadCount(head) != element_count_) {
         return false;
       }
+
+      // If anyone grabs an element between the load and here, the tag will differ and this will fail
+      if (!head_.compare_exchange_strong(head, PackHead(kClosedIndex, 0, HeadTag(head) + 1),
+                                         std::memory_order_acq_rel)) {
+        return false;
+      }
+
+      delete [] data_;
+      data_ = nullptr;
+
+      return true;
     }
 
     inline int GetElementCount() const {
-      return available_.size();
+      return static_cast<int>(element_count_);
     }
 
     inline bool IsAllocated() const {
-      return data_;
+      return HeadIndex(head_.load(std::memory_order_acquire)) != kClosedIndex;
     }
 
+    inline bool IsIdle() const {
+      uint64_t head = head_.load(std::memory_order_acquire);
+      return HeadIndex(head) != kClosedIndex && HeadCount(head) == element_count_;
+    }
+
+    /**
+     * @brief Maximum number of elements a single arena can hold
+     */
+    static const uint32_t kMaximumElementCount = 0xFFFFD;
+
   private:
+    static const uint32_t kEmptyIndex = 0xFFFFF;
+
+    static const uint32_t kClosedIndex = 0xFFFFE;
+
+    static inline uint64_t PackHead(uint32_t index, uint32_t count, uint32_t tag) {
+      return (static_cast<uint64_t>(tag & 0x7FFFFF) << 41)
+          | (static_cast<uint64_t>(count & 0x1FFFFF) << 20)
+          | static_cast<uint64_t>(index & 0xFFFFF);
+    }
+
+    static inline uint32_t HeadIndex(uint64_t head) {
+      return static_cast<uint32_t>(head & 0xFFFFF);
+    }
+
+    static inline uint32_t HeadCount(uint64_t head) {
+      return static_cast<uint32_t>((head >> 20) & 0x1FFFFF);
+    }
+
+    static inline uint32_t HeadTag(uint64_t head) {
+      return static_cast<uint32_t>(head >> 41);
+    }
+
     MemoryPool* parent_;
 
     char* data_;
 
-    QVector<bool> available_;
+    size_t element_sz_;
 
-    QMutex lock_;
+    uint32_t element_count_;
 
-    size_t element_sz_;
+    std::atomic<uint64_t> head_;
+
+    std::unique_ptr< std::atomic<uint32_t>[] > next_;
 
-    std::list<Element*> lent_elements_;
+    std::vector<Element*> lent_elements_;
 
   };
 
@@ -289,24 +458,89 @@ public:
    * @brief Retrieves an element from an available arena
    */
   ElementPtr Get() {
-    QMutexLocker locker(&lock_);
+    // Fast path: try the arena that last had free elements without taking any lock. Arenas are never deleted while
+    // the pool is alive (only freed and reused), so this pointer is always safe to use.
+    Arena* current = current_.load(std::memory_order_acquire);
 
-    // Attempt to get an element from an arena
-    foreach (Arena* a, arenas_) {
-      ElementPtr e = a->Get();
+    if (current) {
+      ElementPtr e = current->Get();
 
       if (e) {
         return e;
       }
     }
 
-    // All arenas were empty, we'll need to create a new one
-    if (arenas_.empty()) {
-      qDebug() << "No arenas, creating new...";
-    } else {
-      qDebug() << "All arenas are full, creating new...";
+    return GetSlow();
+  }
+
+  void ArenaIsEmpty(Arena* a) {
+    if (destroying_) {
+      return;
+    }
+
+    QMutexLocker locker(&lock_);
+
+    int idle_count = 0;
+
+    foreach (Arena* arena, arenas_) {
+      if (arena->IsIdle()) {
+        idle_count++;
+      }
+    }
+
+    if (idle_count > max_idle_arenas_ && a->Free()) {
+      qDebug() << "Freed an empty arena";
+
+      if (current_.load(std::memory_order_relaxed) == a) {
+        current_.store(FindAllocatedArena(), std::memory_order_release);
+      }
+    }
+  }
+
+protected:
+  /**
+   * @brief The size of each element
+   *
+   * Override this to use a custom size (e.g. a char array where T = char but the element size is > 1)
+   */
+  virtual size_t GetElementSize() {
+    return sizeof(T);
+  }
+
+private:
+  ElementPtr GetSlow() {
+    QMutexLocker locker(&lock_);
+
+    forever {
+      // Attempt to get an element from any arena
+      foreach (Arena* a, arenas_) {
+        ElementPtr e = a->Get();
+
+        if (e) {
+          current_.store(a, std::memory_order_release);
+          return e;
+        }
+      }
+
+      Arena* a = Grow();
+
+      if (!a) {
+        return nullptr;
+      }
+
+      current_.store(a, std::memory_order_release);
+
+      // Another thread may have drained the new arena already, in which case we loop around
+      ElementPtr e = a->Get();
+
+      if (e) {
+        return e;
+      }
     }
+  }
 
+  Arena* Grow() {
+    // All arenas were empty, we'll need to allocate another one
     size_t ele_sz = GetElementSize();
 
     if (!ele_sz) {
@@ -314,55 +548,71 @@ public:
       return nullptr;
     }
 
-    if (element_count_ <= 0) {
+    if (element_count_ <= 0 || static_cast<uint32_t>(element_count_) > Arena::kMaximumElementCount) {
       qCritical() << "Failed to create arena, element count was invalid:" << element_count_;
       return nullptr;
     }
 
-    Arena* a = new Arena(this);
-    if (!a->Allocate(ele_sz, element_count_)) {
-      qCritical() << "Failed to create arena, allocation failed. Out of memory?";
-      delete a;
+    Arena* a = nullptr;
+    int allocated_count = 0;
+
+    foreach (Arena* arena, arenas_) {
+      if (arena->IsAllocated()) {
+        allocated_count++;
+      } else if (!a) {
+        a = arena;
+      }
+    }
+
+    if (max_arena_count_ > 0 && allocated_count >= max_arena_count_) {
+      qWarning() << "Memory pool reached its maximum arena count:" << max_arena_count_;
       return nullptr;
     }
 
-    arenas_.push_back(a);
-    return a->Get();
-  }
+    if (a) {
+      qDebug() << "All arenas are full, reusing freed arena...";
+    } else {
+      if (arenas_.empty()) {
+        qDebug() << "No arenas, creating new...";
+      } else {
+        qDebug() << "All arenas are full, creating new...";
+      }
 
-  void ArenaIsEmpty(Arena* a) {
-    // FIXME: Does this need to be mutexed?
-    if (ignore_arena_empty_signal_) {
-      return;
+      a = new Arena(this);
+      arenas_.push_back(a);
     }
 
-    QMutexLocker locker(&lock_);
-
-    if (!a->GetUsageCount()) {
-      qDebug() << "Removing an empty arena";
-      arenas_.remove(a);
-      delete a;
+    if (!a->Allocate(ele_sz, element_count_)) {
+      qCritical() << "Failed to create arena, allocation failed. Out of memory?";
+      return nullptr;
     }
+
+    return a;
   }
 
-protected:
-  /**
-   * @brief The size of each element
-   *
-   * Override this to use a custom size (e.g. a char array where T = char but the element size is > 1)
-   */
-  virtual size_t GetElementSize() {
-    return sizeof(T);
+  Arena* FindAllocatedArena() const {
+    foreach (Arena* a, arenas_) {
+      if (a->IsAllocated()) {
+        return a;
+      }
+    }
+
+    return nullptr;
   }
 
-private:
   int element_count_;
 
+  int max_arena_count_;
+
+  int max_idle_arenas_;
+
   std::list<Arena*> arenas_;
 
-  QMutex lock_;
+  std::atomic<Arena*> current_;
+
+  mutable QMutex lock_;
 
-  bool ignore_arena_empty_signal_;
+  std::atomic_bool destroying_;
 
 };
 
@@ -74,11 +74,16 @@ void rational::reduce()
 
 intType rational::gcd(const intType &x, const intType &y)
 {
-  if (y == 0) {
-    return x;
-  } else {
-    return gcd(y, x % y);
+  intType a = x;
+  intType b = y;
+
+  while (b != 0) {
+    intType t = a % b;
+    a = b;
+    b = t;
   }
+
+  return a;
 }
 
 //Function: convert to double
@@ -146,8 +151,13 @@ const rational& rational::operator+=(const rational &rhs)
       numer_ = rhs.numer_;
       denom_ = rhs.denom_;
     } else {
-      numer_ = (numer_ * rhs.denom_) + (rhs.numer_ * denom_);
-      denom_ = denom_ * rhs.denom_;
+      if (denom_ == rhs.denom_) {
+        // Common case of both times sharing a timebase, no need to cross-multiply
+        numer_ += rhs.numer_;
+      } else {
+        numer_ = (numer_ * rhs.denom_) + (rhs.numer_ * denom_);
+        denom_ = denom_ * rhs.denom_;
+      }
       fix_signs();
       reduce();
     }
@@ -163,8 +173,12 @@ const rational& rational::operator-=(const rational &rhs)
       numer_ = -rhs.numer_;
       denom_ = rhs.denom_;
     } else {
-      numer_ = (numer_ * rhs.denom_) - (rhs.numer_ * denom_);
-      denom_ = denom_ * rhs.denom_;
+      if (denom_ == rhs.denom_) {
+        numer_ -= rhs.numer_;
+      } else {
+        numer_ = (numer_ * rhs.denom_) - (rhs.numer_ * denom_);
+        denom_ = denom_ * rhs.denom_;
+      }
       fix_signs();
       reduce();
     }
@@ -249,6 +263,10 @@ bool rational::operator<(const rational &rhs) const
     return !(rhs.numer_ * rhs.denom_ < intType(0));
   }
 
+  if (denom_ == rhs.denom_) {
+    return numer_ < rhs.numer_;
+  }
+
   return ((numer_ * rhs.denom_) < (denom_ * rhs.numer_));
 }
 
@@ -278,6 +296,10 @@ bool rational::operator<=(const rational &rhs) const
     return !(rhs.numer_ * rhs.denom_ < intType(0));
   }
 
+  if (denom_ == rhs.denom_) {
+    return numer_ <= rhs.numer_;
+  }
+
   return ((numer_ * rhs.denom_) <= (denom_ * rhs.numer_));
 }
 
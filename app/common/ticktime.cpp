@@ -0,0 +1,94 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ticktime.h"
+
+OLIVE_NAMESPACE_ENTER
+
+namespace {
+
+inline int64_t FloorDivide(int64_t num, int64_t den)
+{
+  // Integer division truncates toward zero, we always want to round down (den is always positive)
+  int64_t q = num / den;
+
+  if (num % den != 0 && num < 0) {
+    q--;
+  }
+
+  return q;
+}
+
+}
+
+TickTimebase::TickTimebase(const rational &timebase) :
+  timebase_(timebase),
+  seconds_per_tick_(timebase.toDouble())
+{
+}
+
+bool TickTimebase::IsExact(const rational &time) const
+{
+  if (time.isNull() || !is_valid()) {
+    return true;
+  }
+
+  // time / timebase = (n * tb_d) / (d * tb_n)
+  return (time.numerator() * timebase_.denominator()) % (time.denominator() * timebase_.numerator()) == 0;
+}
+
+int64_t TickTimebase::ToTicks(const rational &time) const
+{
+  if (time.isNull() || !is_valid()) {
+    return 0;
+  }
+
+  if (time == RATIONAL_MAX) {
+    return INT64_MAX;
+  } else if (time == RATIONAL_MIN) {
+    return INT64_MIN;
+  }
+
+  int64_t num = time.numerator() * timebase_.denominator();
+  int64_t den = time.denominator() * timebase_.numerator();
+
+  return FloorDivide(num, den);
+}
+
+int64_t TickTimebase::ToNearestTicks(const rational &time) const
+{
+  if (time.isNull() || !is_valid()) {
+    return 0;
+  }
+
+  if (time == RATIONAL_MAX) {
+    return INT64_MAX;
+  } else if (time == RATIONAL_MIN) {
+    return INT64_MIN;
+  }
+
+  int64_t num = time.numerator() * timebase_.denominator();
+  int64_t den = time.denominator() * timebase_.numerator();
+
+  // Halves round up, matching qRound64()
+  return FloorDivide(num * 2 + den, den * 2);
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,188 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef TICKTIME_H
+#define TICKTIME_H
+
+#include "common/timerange.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief A range of integer ticks, the tick equivalent of TimeRange
+ *
+ * `in` is inclusive and `out` is exclusive. All operations are plain integer math.
+ */
+class TickRange
+{
+public:
+  TickRange() :
+    in_(0),
+    out_(0)
+  {
+  }
+
+  TickRange(int64_t in, int64_t out) :
+    in_(qMin(in, out)),
+    out_(qMax(in, out))
+  {
+  }
+
+  int64_t in() const
+  {
+    return in_;
+  }
+
+  int64_t out() const
+  {
+    return out_;
+  }
+
+  int64_t length() const
+  {
+    return out_ - in_;
+  }
+
+  bool operator==(const TickRange& r) const
+  {
+    return in_ == r.in_ && out_ == r.out_;
+  }
+
+  bool operator!=(const TickRange& r) const
+  {
+    return !(*this == r);
+  }
+
+  bool OverlapsWith(const TickRange& a) const
+  {
+    return a.in_ < out_ && a.out_ > in_;
+  }
+
+  bool Contains(const TickRange& a) const
+  {
+    return a.in_ >= in_ && a.out_ <= out_;
+  }
+
+  bool Contains(int64_t t) const
+  {
+    return t >= in_ && t < out_;
+  }
+
+  TickRange Intersected(const TickRange& a) const
+  {
+    return TickRange(qMax(in_, a.in_), qMax(qMax(in_, a.in_), qMin(out_, a.out_)));
+  }
+
+  TickRange Combined(const TickRange& a) const
+  {
+    return TickRange(qMin(in_, a.in_), qMax(out_, a.out_));
+  }
+
+  TickRange operator+(int64_t t) const
+  {
+    return TickRange(in_ + t, out_ + t);
+  }
+
+  TickRange operator-(int64_t t) const
+  {
+    return TickRange(in_ - t, out_ - t);
+  }
+
+private:
+  int64_t in_;
+  int64_t out_;
+
+};
+
+/**
+ * @brief Converts between rational times and integer ticks of one fixed timebase
+ *
+ * rational reduces itself with a gcd after every operation, which adds up in loops that step through time one frame
+ * or sample at a time. Code working within a single timebase (e.g. a sequence's frame rate or an audio sample rate)
+ * can instead do its math on int64 ticks and only convert at API boundaries, where conversion of any time that lies
+ * on the timebase is exact.
+ *
+ * A tick `t` represents the time `t * timebase`, the same as the timestamps used by Timecode.
+ */
+class TickTimebase
+{
+public:
+  TickTimebase() :
+    seconds_per_tick_(0)
+  {
+  }
+
+  TickTimebase(const rational& timebase);
+
+  const rational& timebase() const
+  {
+    return timebase_;
+  }
+
+  bool is_valid() const
+  {
+    return !timebase_.isNull();
+  }
+
+  /**
+   * @brief Returns whether `time` lies exactly on a tick
+   */
+  bool IsExact(const rational& time) const;
+
+  /**
+   * @brief Convert a time to ticks, rounding down if it doesn't lie exactly on a tick
+   */
+  int64_t ToTicks(const rational& time) const;
+
+  /**
+   * @brief Convert a time to the nearest tick
+   */
+  int64_t ToNearestTicks(const rational& time) const;
+
+  TickRange ToTicks(const TimeRange& range) const
+  {
+    return TickRange(ToTicks(range.in()), ToTicks(range.out()));
+  }
+
+  rational ToTime(int64_t ticks) const
+  {
+    return rational(ticks * timebase_.numerator(), timebase_.denominator());
+  }
+
+  TimeRange ToTime(const TickRange& range) const
+  {
+    return TimeRange(ToTime(range.in()), ToTime(range.out()));
+  }
+
+  double ToSeconds(int64_t ticks) const
+  {
+    return static_cast<double>(ticks) * seconds_per_tick_;
+  }
+
+private:
+  rational timebase_;
+
+  double seconds_per_tick_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // TICKTIME_H
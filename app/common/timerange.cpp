@@ -41,9 +41,9 @@ const rational &TimeRange::out() const
   return out_;
 }
 
-const rational &TimeRange::length() const
+rational TimeRange::length() const
 {
-  return length_;
+  return out_ - in_;
 }
 
 void TimeRange::set_in(const rational &in)
@@ -155,9 +155,6 @@ void TimeRange::normalize()
   {
     std::swap(out_, in_);
   }
-
-  // Calculate length
-  length_ = out_ - in_;
 }
 
 void TimeRangeList::InsertTimeRange(const TimeRange &range)
@@ -32,7 +32,7 @@ public:
 
   const rational& in() const;
   const rational& out() const;
-  const rational& length() const;
+  rational length() const;
 
   void set_in(const rational& in);
   void set_out(const rational& out);
@@ -61,7 +61,6 @@ private:
 
   rational in_;
   rational out_;
-  rational length_;
 
 };
 
@@ -0,0 +1,367 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QThread>
+
+OLIVE_NAMESPACE_ENTER
+
+const qint64 Trace::kNoArg;
+const int Trace::kEventsPerThread = 65536;
+const int Trace::kMaxExitedBuffers = 8;
+
+std::atomic<bool> Trace::enabled_(false);
+QMutex Trace::buffers_lock_;
+QVector<TraceThreadBuffer*> Trace::buffers_;
+int Trace::next_thread_id_ = 1;
+
+/**
+ * @brief One thread's ring of events
+ *
+ * Only its own thread writes to it. The lock is only ever contended while a trace is being written out.
+ */
+class TraceThreadBuffer
+{
+public:
+  struct Event {
+    const char* category;
+    const char* name;
+    qint64 start;
+    qint64 duration;
+    qint64 arg;
+  };
+
+  TraceThreadBuffer(int id, const QString& name) :
+    id_(id),
+    name_(name),
+    events_(Trace::kEventsPerThread),
+    count_(0),
+    exited_(false)
+  {
+  }
+
+  void Append(const Event& e)
+  {
+    QMutexLocker locker(&lock_);
+
+    events_[static_cast<int>(count_ % static_cast<quint64>(events_.size()))] = e;
+    count_++;
+  }
+
+  void Clear()
+  {
+    QMutexLocker locker(&lock_);
+
+    count_ = 0;
+  }
+
+  /**
+   * @brief Hand an exited thread's buffer to a new thread, discarding its events
+   *
+   * Must be called with Trace::buffers_lock_ held.
+   */
+  void Reuse(int id, const QString& name)
+  {
+    QMutexLocker locker(&lock_);
+
+    id_ = id;
+    name_ = name;
+    count_ = 0;
+    exited_ = false;
+  }
+
+  /**
+   * @brief Returns recorded events from oldest to newest
+   */
+  QVector<Event> Events()
+  {
+    QMutexLocker locker(&lock_);
+
+    int size = events_.size();
+
+    if (count_ <= static_cast<quint64>(size)) {
+      return events_.mid(0, static_cast<int>(count_));
+    }
+
+    int oldest = static_cast<int>(count_ % static_cast<quint64>(size));
+    return events_.mid(oldest) + events_.mid(0, oldest);
+  }
+
+  int id() const
+  {
+    return id_;
+  }
+
+  const QString& name() const
+  {
+    return name_;
+  }
+
+  bool exited() const
+  {
+    return exited_;
+  }
+
+  static void MarkExited(TraceThreadBuffer* b)
+  {
+    QMutexLocker locker(&Trace::buffers_lock_);
+
+    b->exited_ = true;
+  }
+
+private:
+  int id_;
+
+  QString name_;
+
+  QMutex lock_;
+
+  QVector<Event> events_;
+
+  quint64 count_;
+
+  // Written under Trace::buffers_lock_
+  bool exited_;
+
+};
+
+namespace {
+
+/**
+ * @brief Marks a thread's buffer as exited when the thread ends
+ *
+ * The buffer itself is kept so a thread's events aren't lost just because it finished before the trace was written,
+ * until the trace is cleared or a new thread needs it (see Trace::kMaxExitedBuffers).
+ */
+class ThreadBufferRef
+{
+public:
+  ThreadBufferRef() :
+    buffer(nullptr)
+  {
+  }
+
+  ~ThreadBufferRef();
+
+  TraceThreadBuffer* buffer;
+};
+
+thread_local ThreadBufferRef current_thread_buffer;
+
+}
+
+ThreadBufferRef::~ThreadBufferRef()
+{
+  if (buffer) {
+    TraceThreadBuffer::MarkExited(buffer);
+  }
+}
+
+void Trace::SetEnabled(bool e)
+{
+  enabled_.store(e, std::memory_order_relaxed);
+}
+
+void Trace::Clear()
+{
+  QMutexLocker locker(&buffers_lock_);
+
+  for (int i=0;i<buffers_.size();i++) {
+    TraceThreadBuffer* b = buffers_.at(i);
+
+    if (b->exited()) {
+      delete b;
+      buffers_.removeAt(i);
+      i--;
+    } else {
+      b->Clear();
+    }
+  }
+}
+
+void Trace::Record(const char *category, const char *name, qint64 start, qint64 arg)
+{
+  qint64 end = Now();
+
+  CurrentBuffer()->Append({category, name, start, end - start, arg});
+}
+
+TraceThreadBuffer *Trace::CurrentBuffer()
+{
+  TraceThreadBuffer* b = current_thread_buffer.buffer;
+
+  if (!b) {
+    QString name = QThread::currentThread()->objectName();
+
+    QMutexLocker locker(&buffers_lock_);
+
+    int id = next_thread_id_++;
+
+    if (name.isEmpty()) {
+      if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        name = QStringLiteral("Main");
+      } else {
+        name = QStringLiteral("Thread %1").arg(id);
+      }
+    }
+
+    // Thread pools end and recreate threads all the time, so only the most recently exited threads' buffers are
+    // kept and the oldest is reused once there are too many
+    TraceThreadBuffer* oldest_exited = nullptr;
+    int exited_count = 0;
+
+    foreach (TraceThreadBuffer* existing, buffers_) {
+      if (existing->exited()) {
+        if (!oldest_exited) {
+          oldest_exited = existing;
+        }
+
+        exited_count++;
+      }
+    }
+
+    if (exited_count >= kMaxExitedBuffers) {
+      b = oldest_exited;
+      b->Reuse(id, name);
+
+      // Keep the list in order of when each buffer's thread started, so the oldest exited one is found first
+      buffers_.removeOne(b);
+    } else {
+      b = new TraceThreadBuffer(id, name);
+    }
+
+    buffers_.append(b);
+
+    current_thread_buffer.buffer = b;
+  }
+
+  return b;
+}
+
+namespace {
+
+void AppendJSONString(QByteArray& out, const char* s)
+{
+  out.append('"');
+
+  for (;*s;s++) {
+    if (*s == '"' || *s == '\\') {
+      out.append('\\');
+    }
+
+    out.append(*s);
+  }
+
+  out.append('"');
+}
+
+}
+
+bool Trace::WriteChromeJSON(const QString &filename)
+{
+  struct ThreadEvents {
+    int id;
+    QString name;
+    QVector<TraceThreadBuffer::Event> events;
+  };
+
+  QVector<ThreadEvents> threads;
+
+  {
+    QMutexLocker locker(&buffers_lock_);
+
+    foreach (TraceThreadBuffer* b, buffers_) {
+      ThreadEvents t = {b->id(), b->name(), b->Events()};
+
+      if (!t.events.isEmpty()) {
+        threads.append(t);
+      }
+    }
+  }
+
+  // Chrome's timestamps are in microseconds, make them relative to the earliest event so they're easy to read
+  qint64 origin = INT64_MAX;
+  foreach (const ThreadEvents& t, threads) {
+    foreach (const TraceThreadBuffer::Event& e, t.events) {
+      origin = qMin(origin, e.start);
+    }
+  }
+
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  QByteArray out;
+  out.append("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+  for (int i=0;i<threads.size();i++) {
+    const ThreadEvents& t = threads.at(i);
+    QByteArray tid = QByteArray::number(t.id);
+
+    if (i > 0) {
+      out.append(',');
+    }
+
+    out.append("\n{\"ph\":\"M\",\"pid\":1,\"tid\":");
+    out.append(tid);
+    out.append(",\"name\":\"thread_name\",\"args\":{\"name\":");
+    AppendJSONString(out, t.name.toUtf8().constData());
+    out.append("}}");
+
+    foreach (const TraceThreadBuffer::Event& e, t.events) {
+      out.append(",\n{\"ph\":\"X\",\"pid\":1,\"tid\":");
+      out.append(tid);
+      out.append(",\"cat\":");
+      AppendJSONString(out, e.category);
+      out.append(",\"name\":");
+      AppendJSONString(out, e.name);
+      out.append(",\"ts\":");
+      out.append(QByteArray::number((e.start - origin) * 0.001, 'f', 3));
+      out.append(",\"dur\":");
+      out.append(QByteArray::number(e.duration * 0.001, 'f', 3));
+
+      if (e.arg != kNoArg) {
+        out.append(",\"args\":{\"value\":");
+        out.append(QByteArray::number(e.arg));
+        out.append('}');
+      }
+
+      out.append('}');
+
+      // Write as we go so large traces aren't held in memory twice
+      if (out.size() > 1048576) {
+        file.write(out);
+        out.clear();
+      }
+    }
+  }
+
+  out.append("\n]}\n");
+  file.write(out);
+
+  return file.error() == QFile::NoError;
+}
+
+OLIVE_NAMESPACE_EXIT
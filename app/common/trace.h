@@ -0,0 +1,175 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+class TraceThreadBuffer;
+
+/**
+ * @brief Low-overhead tracing of where time goes in rendering
+ *
+ * Each thread records events into its own fixed-size ring buffer, so a trace always holds the most recent activity
+ * (e.g. the seconds leading up to a stutter) without growing. Events have nanosecond timestamps and can be written out
+ * in the Chrome trace event format, which can be opened in chrome://tracing or https://ui.perfetto.dev.
+ *
+ * Tracing is off by default. While it's off, TraceScope costs one relaxed atomic load and nothing is allocated.
+ *
+ * Use the TRACE_SCOPE macros rather than calling Record() directly. Categories and names must be string literals (or
+ * otherwise live for the rest of the program) since only their pointers are stored.
+ */
+class Trace
+{
+public:
+  static bool IsEnabled()
+  {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  static void SetEnabled(bool e);
+
+  /**
+   * @brief Discard everything recorded so far
+   */
+  static void Clear();
+
+  /**
+   * @brief Write every thread's events to `filename` as Chrome trace JSON
+   */
+  static bool WriteChromeJSON(const QString& filename);
+
+  /**
+   * @brief Current time in nanoseconds on the clock that events are stamped with
+   */
+  static qint64 Now()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * @brief Record a complete event that started at `start` and ended now
+   *
+   * `arg` is shown with the event if it isn't kNoArg, e.g. a frame number or byte count.
+   */
+  static void Record(const char* category, const char* name, qint64 start, qint64 arg = kNoArg);
+
+  static const qint64 kNoArg = INT64_MIN;
+
+  /**
+   * @brief Number of events kept per thread before the oldest are overwritten
+   */
+  static const int kEventsPerThread;
+
+  /**
+   * @brief Number of finished threads whose events are kept before their buffers are reused by new threads
+   */
+  static const int kMaxExitedBuffers;
+
+private:
+  static TraceThreadBuffer* CurrentBuffer();
+
+  static std::atomic<bool> enabled_;
+
+  static QMutex buffers_lock_;
+
+  static QVector<TraceThreadBuffer*> buffers_;
+
+  static int next_thread_id_;
+
+  friend class TraceThreadBuffer;
+
+};
+
+/**
+ * @brief Records the time between its construction and destruction as one trace event
+ */
+class TraceScope
+{
+public:
+  TraceScope(const char* category, const char* name) :
+    category_(category),
+    name_(name),
+    arg_(Trace::kNoArg),
+    start_(Trace::IsEnabled() ? Trace::Now() : 0)
+  {
+  }
+
+  ~TraceScope()
+  {
+    // Don't record if tracing was off when this started, so every event has a valid start
+    if (start_ && Trace::IsEnabled()) {
+      Trace::Record(category_, name_, start_, arg_);
+    }
+  }
+
+  DISABLE_COPY_MOVE(TraceScope)
+
+  bool active() const
+  {
+    return start_ != 0;
+  }
+
+  void set_arg(qint64 arg)
+  {
+    arg_ = arg;
+  }
+
+private:
+  const char* category_;
+
+  const char* name_;
+
+  qint64 arg_;
+
+  qint64 start_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+/// Trace the rest of the enclosing scope
+#define TRACE_SCOPE(category, name) \
+  OLIVE_NAMESPACE::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+
+/// Trace the rest of the enclosing scope with a numeric argument (e.g. a frame number), only evaluated when tracing
+#define TRACE_SCOPE_ARG(category, name, arg) \
+  TRACE_SCOPE(category, name); \
+  if (TRACE_CONCAT(trace_scope_, __LINE__).active()) \
+    TRACE_CONCAT(trace_scope_, __LINE__).set_arg(static_cast<qint64>(arg))
+
+/// Trace the rest of the enclosing function under its own name
+#define TRACE_FUNCTION(category) TRACE_SCOPE(category, __FUNCTION__)
+
+#endif // TRACE_H
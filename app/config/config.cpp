@@ -103,6 +103,9 @@ void Config::SetDefaults()
   config_map_["DiskCacheAhead"] = QVariant::fromValue(rational(5));
   config_map_["ClearDiskCacheOnClose"] = false;
 
+  // Textures kept on the GPU between renders, in gigabytes
+  config_map_["TextureCacheSize"] = 1.0;
+
   config_map_["DefaultSequenceWidth"] = 1920;
   config_map_["DefaultSequenceHeight"] = 1080;
   config_map_["DefaultSequenceFrameRate"] = QVariant::fromValue(rational(1001, 30000));
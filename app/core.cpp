@@ -34,6 +34,7 @@
 #include "audio/audiomanager.h"
 #include "cli/clitask/clitaskdialog.h"
 #include "common/filefunctions.h"
+#include "common/trace.h"
 #include "common/xmlutils.h"
 #include "config/config.h"
 #include "dialog/about/about.h"
@@ -105,13 +106,52 @@ int Core::execute(QCoreApplication* a)
   QCommandLineOption fullscreen_option({"f", "fullscreen"}, tr("Start in full screen mode"));
   parser.addOption(fullscreen_option);
 
-  // Create headless export option
+  // Create headless export options
   QCommandLineOption headless_export_option({"x", "export"}, tr("Export project from command line"));
   parser.addOption(headless_export_option);
 
+  QCommandLineOption export_output_option({"o", "output"}, tr("File to export to"), tr("file"));
+  parser.addOption(export_output_option);
+
+  QCommandLineOption export_sequence_option("sequence", tr("Name or index of the sequence to export"), tr("sequence"));
+  parser.addOption(export_sequence_option);
+
+  QCommandLineOption export_range_option("range", tr("Only export frames IN up to (not including) OUT"), tr("in:out"));
+  parser.addOption(export_range_option);
+
+  QCommandLineOption export_segments_option("segments", tr("Split the export into this many segments"), tr("count"));
+  parser.addOption(export_segments_option);
+
+  QCommandLineOption export_segment_index_option("segment-index",
+                                                 tr("Only export this segment (use with --segments or --range)"),
+                                                 tr("index"));
+  parser.addOption(export_segment_index_option);
+
+  QCommandLineOption export_jobs_option({"j", "jobs"}, tr("Export segments in this many processes at once"), tr("count"));
+  parser.addOption(export_jobs_option);
+
+  QCommandLineOption export_concat_option("concat",
+                                          tr("Join exported segments into the output file without re-encoding "
+                                             "(give once per segment, in order)"),
+                                          tr("file"));
+  parser.addOption(export_concat_option);
+
+  QCommandLineOption export_json_option("json-progress", tr("Report export progress as lines of JSON"));
+  parser.addOption(export_json_option);
+
+  // Tracing
+  QCommandLineOption trace_option("trace", tr("Record a performance trace and write it to this file on exit"), tr("file"));
+  parser.addOption(trace_option);
+
   // Parse options
   parser.process(*a);
 
+  QString trace_filename = parser.value(trace_option);
+
+  if (!trace_filename.isEmpty()) {
+    Trace::SetEnabled(true);
+  }
+
   QStringList args = parser.positionalArguments();
 
   // Detect project to load on startup
@@ -135,15 +175,44 @@ int Core::execute(QCoreApplication* a)
   } else {
 
     if (parser.isSet(headless_export_option)) {
+      CLIExportManager::Options export_options;
+
+      export_options.project = startup_project_;
+      export_options.sequence = parser.value(export_sequence_option);
+      export_options.output = parser.value(export_output_option);
+      export_options.segment_count = parser.value(export_segments_option).toInt();
+      export_options.jobs = parser.value(export_jobs_option).toInt();
+      export_options.json_progress = parser.isSet(export_json_option);
+      export_options.concat_inputs = parser.values(export_concat_option);
+
+      if (parser.isSet(export_segment_index_option)) {
+        export_options.segment_index = parser.value(export_segment_index_option).toInt();
+      }
+
+      bool valid_options = true;
+
+      if (parser.isSet(export_range_option)) {
+        export_options.has_range = true;
+
+        if (!CLIExportManager::ParseRange(parser.value(export_range_option),
+                                          &export_options.range_in,
+                                          &export_options.range_out)) {
+          qCritical().noquote() << tr("Invalid range, expected IN:OUT in frames");
+          valid_options = false;
+        }
+      }
+
       // Start a headless export
-      if (StartHeadlessExport()) {
+      if (valid_options && StartHeadlessExport(export_options)) {
         exit_code = 0;
       }
     }
 
   }
 
-
+  if (!trace_filename.isEmpty() && !Trace::WriteChromeJSON(trace_filename)) {
+    qCritical().noquote() << tr("Failed to write trace to \"%1\"").arg(trace_filename);
+  }
 
   // Clear core memory
   OLIVE_NAMESPACE::Core::instance()->Stop();
@@ -173,6 +242,8 @@ void Core::DeclareTypesForQt()
   qRegisterMetaType<OLIVE_NAMESPACE::GenerateJob>();
   qRegisterMetaType<OLIVE_NAMESPACE::VideoParams>();
   qRegisterMetaType<OLIVE_NAMESPACE::MainWindowLayoutInfo>();
+  qRegisterMetaType<OLIVE_NAMESPACE::MappedPCMPtr>();
+  qRegisterMetaType<OLIVE_NAMESPACE::StreamPtr>();
 }
 
 void Core::Start()
@@ -199,6 +270,12 @@ void Core::Start()
   // Initialize OpenGL service
   OpenGLProxy::CreateInstance();
 
+  // Initialize disk service
+  DiskManager::CreateInstance();
+
+  // Initialize pixel service
+  PixelFormat::CreateInstance();
+
   //
   // Start application
   //
@@ -569,8 +646,18 @@ void Core::ProjectWasModified(bool e)
   }
 }
 
-bool Core::StartHeadlessExport()
+bool Core::StartHeadlessExport(const CLIExportManager::Options& options)
 {
+  if (options.output.isEmpty()) {
+    qCritical().noquote() << tr("You must specify a file to export to with --output");
+    return false;
+  }
+
+  // Joining segments doesn't need the project
+  if (!options.concat_inputs.isEmpty()) {
+    return CLIExportManager::Concatenate(options);
+  }
+
   if (startup_project_.isEmpty()) {
     qCritical().noquote() << tr("You must specify a project file to export");
     return false;
@@ -583,9 +670,17 @@ bool Core::StartHeadlessExport()
 
   // Start a load task and try running it
   ProjectLoadTask plm(startup_project_);
-  CLITaskDialog task_dialog(&plm);
+  bool loaded;
+
+  if (options.json_progress) {
+    // Keep stdout clear for JSON
+    loaded = CLITaskDialog::RunInEventLoop(&plm);
+  } else {
+    CLITaskDialog task_dialog(&plm);
+    loaded = task_dialog.Run();
+  }
 
-  if (task_dialog.Run()) {
+  if (loaded) {
     ProjectPtr p = plm.GetLoadedProjects().first();
     QList<ItemPtr> items = p->get_items_of_type(Item::kSequence);
 
@@ -595,10 +690,35 @@ bool Core::StartHeadlessExport()
       return false;
     }
 
-    SequencePtr sequence = nullptr;
+    int sequence_index = -1;
+
+    if (!options.sequence.isEmpty()) {
+      // Accept either an index or a name
+      bool ok;
+      sequence_index = options.sequence.toInt(&ok);
+
+      if (!ok || sequence_index < 0 || sequence_index >= items.size()) {
+        sequence_index = -1;
+
+        for (int i=0;i<items.size();i++) {
+          if (items.at(i)->name() == options.sequence) {
+            sequence_index = i;
+            break;
+          }
+        }
+      }
+
+      if (sequence_index == -1) {
+        qCritical().noquote() << tr("Project has no sequence \"%1\"").arg(options.sequence);
+        return false;
+      }
+    } else if (items.size() > 1) {
+      // Check if this project contains multiple sequences
+      if (options.json_progress) {
+        qCritical().noquote() << tr("This project has multiple sequences, specify one with --sequence");
+        return false;
+      }
 
-    // Check if this project contains multiple sequences
-    if (items.size() > 1) {
       qInfo().noquote() << tr("This project has multiple sequences. Which do you wish to export?");
       for (int i=0;i<items.size();i++) {
         std::cout << "[" << i << "] " << items.at(i)->name().toStdString();
@@ -606,7 +726,6 @@ bool Core::StartHeadlessExport()
 
       QTextStream stream(stdin);
       QString sequence_read;
-      int sequence_index = -1;
       QString quit_code = QStringLiteral("q");
       std::string prompt = tr("Enter number (or %1 to cancel): ").arg(quit_code).toStdString();
       forever {
@@ -627,22 +746,18 @@ bool Core::StartHeadlessExport()
           qCritical().noquote() << tr("Invalid sequence number");
         }
       }
-
-      sequence = std::static_pointer_cast<Sequence>(items.at(sequence_index));
     } else {
-      sequence = std::static_pointer_cast<Sequence>(items.first());
+      sequence_index = 0;
     }
 
-    ExportParams params;
-    ExportTask export_task(sequence->viewer_output(), p->color_manager(), params);
-    CLITaskDialog export_dialog(&export_task);
-    if (export_dialog.Run()) {
-      qInfo().noquote() << tr("Export succeeded");
-      return true;
-    } else {
-      qInfo().noquote() << tr("Export failed: %1").arg(export_task.GetError());
-      return false;
-    }
+    SequencePtr sequence = std::static_pointer_cast<Sequence>(items.at(sequence_index));
+
+    // Any segment processes need to export the same sequence
+    CLIExportManager::Options export_options = options;
+    export_options.sequence = QString::number(sequence_index);
+
+    CLIExportManager export_manager(sequence->viewer_output(), p->color_manager(), export_options);
+    return export_manager.Run();
   } else {
     qCritical().noquote() << tr("Project failed to load: %1").arg(plm.GetError());
     return false;
@@ -684,12 +799,6 @@ void Core::StartGUI(bool full_screen)
   // Initialize audio service
   AudioManager::CreateInstance();
 
-  // Initialize disk service
-  DiskManager::CreateInstance();
-
-  // Initialize pixel service
-  PixelFormat::CreateInstance();
-
   // Connect the PanelFocusManager to the application's focus change signal
   connect(qApp,
           &QApplication::focusChanged,
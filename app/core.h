@@ -25,6 +25,7 @@
 #include <QList>
 #include <QTimer>
 
+#include "cli/cliexport/cliexportmanager.h"
 #include "common/rational.h"
 #include "common/timecodefunctions.h"
 #include "project/item/footage/footage.h"
@@ -66,6 +67,14 @@ public:
    */
   static Core* instance();
 
+  /**
+   * @brief Declare custom types/classes for Qt's signal/slot system
+   *
+   * Qt's signal/slot system requires types to be declared. In the interest of doing this only at startup, we contain
+   * them all in a function here. Public so other entry points (e.g. olive-bench) can use it.
+   */
+  static void DeclareTypesForQt();
+
   int execute(QCoreApplication *a);
 
   /**
@@ -417,14 +426,6 @@ private:
    */
   void PushRecentlyOpenedProject(const QString &s);
 
-  /**
-   * @brief Declare custom types/classes for Qt's signal/slot system
-   *
-   * Qt's signal/slot system requires types to be declared. In the interest of doing this only at startup, we contain
-   * them all in a function here.
-   */
-  void DeclareTypesForQt();
-
   /**
    * @brief Start GUI portion of Olive
    *
@@ -519,7 +520,7 @@ private slots:
 
   void ProjectWasModified(bool e);
 
-  bool StartHeadlessExport();
+  bool StartHeadlessExport(const CLIExportManager::Options& options);
 
   void OpenStartupProject();
 
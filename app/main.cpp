@@ -53,6 +53,9 @@ int main(int argc, char *argv[]) {
   //QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
   QCoreApplication::setAttribute(Qt::AA_UseHighDpiPixmaps);
 
+  // Allows viewers to draw textures rendered by the OpenGL proxy directly
+  QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
   // Create application instance
   QApplication a(argc, argv);
 
@@ -0,0 +1,241 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "mix.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OLIVE_MIX_HAS_SSE
+#endif
+
+OLIVE_NAMESPACE_ENTER
+
+namespace {
+
+/**
+ * @brief Flushes denormals to zero on this thread while in scope
+ *
+ * Long decaying tails multiplied by small gains easily produce denormals, which are drastically slower to process on
+ * x86. They're inaudible anyway, so we let the CPU treat them as zero while mixing.
+ */
+class DenormalGuard
+{
+public:
+  DenormalGuard()
+  {
+#ifdef OLIVE_MIX_HAS_SSE
+    old_csr_ = _mm_getcsr();
+
+    // Flush-to-zero (0x8000) and denormals-are-zero (0x0040)
+    _mm_setcsr(old_csr_ | 0x8040);
+#endif
+  }
+
+  ~DenormalGuard()
+  {
+#ifdef OLIVE_MIX_HAS_SSE
+    _mm_setcsr(old_csr_);
+#endif
+  }
+
+private:
+#ifdef OLIVE_MIX_HAS_SSE
+  unsigned int old_csr_;
+#endif
+
+};
+
+}
+
+MixNode::MixNode()
+{
+  samples_input_ = new NodeInputArray("samples_in", NodeParam::kSamples);
+  AddInput(samples_input_);
+
+  gain_input_ = new NodeInputArray("gain_in", NodeParam::kFloat, 1.0);
+  AddInput(gain_input_);
+
+  pan_input_ = new NodeInputArray("pan_in", NodeParam::kFloat, 0.0);
+  AddInput(pan_input_);
+}
+
+Node *MixNode::copy() const
+{
+  return new MixNode();
+}
+
+QString MixNode::Name() const
+{
+  return tr("Mix");
+}
+
+QString MixNode::id() const
+{
+  return QStringLiteral("org.olivevideoeditor.Olive.mix");
+}
+
+QList<Node::CategoryID> MixNode::Category() const
+{
+  return {kCategoryChannels};
+}
+
+QString MixNode::Description() const
+{
+  return tr("Mix any number of audio sources together.");
+}
+
+void MixNode::Retranslate()
+{
+  samples_input_->set_name(tr("Samples"));
+  gain_input_->set_name(tr("Gain"));
+  pan_input_->set_name(tr("Pan"));
+}
+
+NodeValueTable MixNode::Value(NodeValueDatabase &value) const
+{
+  struct Source {
+    SampleBufferPtr samples;
+    float gain;
+    float pan;
+  };
+
+  QVector<Source> sources;
+  int max_samples = 0;
+
+  for (int i=0; i<samples_input_->GetSize(); i++) {
+    SampleBufferPtr samples = value[samples_input_->At(i)].Take(NodeParam::kSamples).value<SampleBufferPtr>();
+
+    // Gain and pan are sampled once per buffer
+    float gain = (i < gain_input_->GetSize()) ? value[gain_input_->At(i)].Take(NodeParam::kFloat).toFloat() : 1.0f;
+    float pan = (i < pan_input_->GetSize()) ? value[pan_input_->At(i)].Take(NodeParam::kFloat).toFloat() : 0.0f;
+
+    if (!samples || !samples->is_allocated() || qIsNull(gain) || IsSilent(samples)) {
+      continue;
+    }
+
+    sources.append({samples, gain, pan});
+    max_samples = qMax(max_samples, samples->sample_count());
+  }
+
+  NodeValueTable table = value.Merge();
+
+  if (sources.isEmpty()) {
+    return table;
+  }
+
+  const Source& first = sources.first();
+
+  if (sources.size() == 1
+      && first.samples->sample_count() == max_samples
+      && qFuzzyCompare(first.gain, 1.0f)
+      && qIsNull(first.pan)) {
+    // Nothing to mix, pass the only audible source straight through
+    table.Push(NodeParam::kSamples, QVariant::fromValue(first.samples), this);
+    return table;
+  }
+
+  // Sum everything into one buffer
+  const AudioParams& params = first.samples->audio_params();
+  SampleBufferPtr mixed = SampleBuffer::CreateAllocated(params, max_samples);
+  mixed->fill(0.0f);
+
+  DenormalGuard denormal_guard;
+
+  foreach (const Source& s, sources) {
+    int channels = qMin(params.channel_count(), s.samples->audio_params().channel_count());
+
+    for (int i=0; i<channels; i++) {
+      float channel_gain = s.gain;
+
+      // Same linear balance as PanNode, which currently only handles stereo
+      if (channels == 2) {
+        if (i == 0 && s.pan > 0) {
+          channel_gain *= 1.0f - s.pan;
+        } else if (i == 1 && s.pan < 0) {
+          channel_gain *= 1.0f + s.pan;
+        }
+      }
+
+      Accumulate(mixed->channel_data(i), s.samples->channel_data(i), s.samples->sample_count(), channel_gain);
+    }
+  }
+
+  table.Push(NodeParam::kSamples, QVariant::fromValue(mixed), this);
+
+  return table;
+}
+
+NodeInputArray *MixNode::samples_in() const
+{
+  return samples_input_;
+}
+
+NodeInputArray *MixNode::gain_in() const
+{
+  return gain_input_;
+}
+
+NodeInputArray *MixNode::pan_in() const
+{
+  return pan_input_;
+}
+
+NodeInput *MixNode::AppendSource()
+{
+  samples_input_->Append();
+
+  gain_input_->SetSize(samples_input_->GetSize());
+  pan_input_->SetSize(samples_input_->GetSize());
+
+  return samples_input_->Last();
+}
+
+void MixNode::Accumulate(float *dst, const float *src, int count, float gain)
+{
+  float* __restrict d = dst;
+  const float* __restrict s = src;
+
+  if (gain == 1.0f) {
+    for (int i=0; i<count; i++) {
+      d[i] += s[i];
+    }
+  } else {
+    for (int i=0; i<count; i++) {
+      d[i] += s[i] * gain;
+    }
+  }
+}
+
+bool MixNode::IsSilent(SampleBufferPtr samples)
+{
+  for (int i=0; i<samples->audio_params().channel_count(); i++) {
+    const float* data = samples->channel_data(i);
+
+    for (int j=0; j<samples->sample_count(); j++) {
+      if (data[j] != 0.0f) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,86 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MIXNODE_H
+#define MIXNODE_H
+
+#include "node/inputarray.h"
+#include "node/node.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Audio bus that sums any number of sample buffers into one
+ *
+ * Replaces adding tracks together pairwise with a MathNode, which allocates a new buffer and makes a full pass for
+ * every pair. Each source has its own gain and pan that are applied while accumulating. Sources that are missing or
+ * silent (e.g. muted tracks or gaps) are skipped entirely.
+ */
+class MixNode : public Node
+{
+public:
+  MixNode();
+
+  virtual Node* copy() const override;
+
+  virtual QString Name() const override;
+  virtual QString id() const override;
+  virtual QList<CategoryID> Category() const override;
+  virtual QString Description() const override;
+
+  virtual void Retranslate() override;
+
+  virtual NodeValueTable Value(NodeValueDatabase &value) const override;
+
+  NodeInputArray* samples_in() const;
+  NodeInputArray* gain_in() const;
+  NodeInputArray* pan_in() const;
+
+  /**
+   * @brief Add a source to the bus, returning the input to connect it to
+   */
+  NodeInput* AppendSource();
+
+  /**
+   * @brief Adds `src * gain` to `dst`
+   *
+   * Written so the compiler can vectorize it.
+   */
+  static void Accumulate(float* dst, const float* src, int count, float gain);
+
+  /**
+   * @brief Returns true if every sample of this buffer is zero
+   *
+   * Stops at the first audible sample, so this is only a full pass over buffers that actually are silent.
+   */
+  static bool IsSilent(SampleBufferPtr samples);
+
+private:
+  NodeInputArray* samples_input_;
+
+  NodeInputArray* gain_input_;
+
+  NodeInputArray* pan_input_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // MIXNODE_H
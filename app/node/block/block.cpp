@@ -355,7 +355,7 @@ NodeInput *Block::speed_input() const
   return speed_input_;
 }
 
-void Block::Hash(QCryptographicHash &, const rational &) const
+void Block::Hash(NodeHasher &, const rational &) const
 {
   // A block does nothing by default, so we hash nothing
 }
@@ -88,7 +88,7 @@ public:
   NodeInput* media_in_input() const;
   NodeInput* speed_input() const;
 
-  virtual void Hash(QCryptographicHash &hash, const rational &time) const override;
+  virtual void Hash(NodeHasher &hash, const rational &time) const override;
 
 public slots:
 
@@ -111,12 +111,12 @@ void ClipBlock::Retranslate()
   texture_input_->set_name(tr("Buffer"));
 }
 
-void ClipBlock::Hash(QCryptographicHash &hash, const rational &time) const
+void ClipBlock::Hash(NodeHasher &hash, const rational &time) const
 {
   if (texture_input_->is_connected()) {
     rational t = InputTimeAdjustment(texture_input_, TimeRange(time, time)).in();
 
-    texture_input_->get_connected_node()->Hash(hash, t);
+    hash.AddNode(texture_input_->get_connected_node(), t);
   }
 }
 
@@ -54,7 +54,7 @@ public:
 
   virtual void Retranslate() override;
 
-  virtual void Hash(QCryptographicHash &hash, const rational &time) const override;
+  virtual void Hash(NodeHasher &hash, const rational &time) const override;
 
 private:
   NodeInput* texture_input_;
@@ -138,7 +138,7 @@ double TransitionBlock::GetInProgress(const double &time) const
   return clamp((GetInternalTransitionTime(time) - out_offset().toDouble()) / in_offset().toDouble(), 0.0, 1.0);
 }
 
-void TransitionBlock::Hash(QCryptographicHash &hash, const rational &time) const
+void TransitionBlock::Hash(NodeHasher &hash, const rational &time) const
 {
   Node::Hash(hash, time);
 
@@ -147,9 +147,9 @@ void TransitionBlock::Hash(QCryptographicHash &hash, const rational &time) const
   double in_prog = GetInProgress(time_dbl);
   double out_prog = GetOutProgress(time_dbl);
 
-  hash.addData(reinterpret_cast<const char*>(&all_prog), sizeof(double));
-  hash.addData(reinterpret_cast<const char*>(&in_prog), sizeof(double));
-  hash.addData(reinterpret_cast<const char*>(&out_prog), sizeof(double));
+  hash.add(all_prog);
+  hash.add(in_prog);
+  hash.add(out_prog);
 }
 
 double TransitionBlock::GetInternalTransitionTime(const double &time) const
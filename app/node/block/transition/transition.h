@@ -47,7 +47,13 @@ public:
   double GetOutProgress(const double &time) const;
   double GetInProgress(const double &time) const;
 
-  virtual void Hash(QCryptographicHash& hash, const rational &time) const override;
+  virtual void Hash(NodeHasher& hash, const rational &time) const override;
+
+  virtual bool HashDependsOnTime() const override
+  {
+    // Progress through the transition is hashed
+    return true;
+  }
 
   virtual NodeValueTable Value(NodeValueDatabase &value) const override;
 
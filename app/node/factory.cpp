@@ -20,6 +20,7 @@
 
 #include "factory.h"
 
+#include "audio/mix/mix.h"
 #include "audio/pan/pan.h"
 #include "audio/volume/volume.h"
 #include "block/clip/clip.h"
@@ -35,6 +36,7 @@
 #include "input/media/video/video.h"
 #include "input/media/audio/audio.h"
 #include "input/time/timeinput.h"
+#include "math/composite/composite.h"
 #include "math/math/math.h"
 #include "math/merge/merge.h"
 #include "math/trigonometry/trigonometry.h"
@@ -215,6 +217,10 @@ Node *NodeFactory::CreateFromFactoryIndex(const NodeFactory::InternalID &id)
     return new CrossDissolveTransition();
   case kDipToColorTransition:
     return new DipToColorTransition();
+  case kComposite:
+    return new CompositeNode();
+  case kMix:
+    return new MixNode();
 
   case kInternalNodeCount:
     break;
@@ -52,6 +52,8 @@ public:
     kTextGenerator,
     kCrossDissolveTransition,
     kDipToColorTransition,
+    kComposite,
+    kMix,
 
     // Count value
     kInternalNodeCount
@@ -20,8 +20,14 @@
 
 #include "blur.h"
 
+#include <QtMath>
+
+#include "render/pixelformat.h"
+
 OLIVE_NAMESPACE_ENTER
 
+const int BlurFilterNode::kMaxTapRadius = 32;
+
 BlurFilterNode::BlurFilterNode()
 {
   texture_input_ = new NodeInput("tex_in", NodeParam::kTexture);
@@ -116,6 +122,17 @@ NodeValueTable BlurFilterNode::Value(NodeValueDatabase &value) const
         job.SetAlphaChannelRequired(true);
       }
 
+      // Calculate weights here once rather than per-pixel in the shader
+      Kernel kernel = CreateKernel(static_cast<Method>(job.GetValue(method_input_).data().toInt()),
+                                   job.GetValue(radius_input_).data().toDouble());
+
+      job.InsertValue(QStringLiteral("kernel_offsets"),
+                      NodeValue(NodeParam::kFloat, QVariant::fromValue(kernel.offsets), this));
+      job.InsertValue(QStringLiteral("kernel_weights"),
+                      NodeValue(NodeParam::kFloat, QVariant::fromValue(kernel.weights), this));
+      job.InsertValue(QStringLiteral("kernel_step"),
+                      NodeValue(NodeParam::kFloat, kernel.step, this));
+
       table.Push(NodeParam::kShaderJob, QVariant::fromValue(job), this);
 
     } else {
@@ -128,4 +145,203 @@ NodeValueTable BlurFilterNode::Value(NodeValueDatabase &value) const
   return table;
 }
 
+BlurFilterNode::Kernel BlurFilterNode::CreateKernel(Method method, double radius)
+{
+  Kernel kernel;
+
+  radius = qMax(0.0, radius);
+
+  // Determine how far the kernel reaches
+  int reach;
+
+  if (method == kGaussian) {
+    // Using (radius = 3 * sigma) because 3 standard deviations covers 97% of the blur according to this document:
+    // http://chemaguerra.com/gaussian-filter-radius/
+    reach = qCeil(radius * 3.0);
+  } else {
+    reach = qCeil(radius) + 1;
+  }
+
+  // If the kernel is too wide, sample from a smaller mipmap instead of taking more samples
+  int step = 1;
+  while (reach > kMaxTapRadius * step) {
+    step *= 2;
+  }
+
+  kernel.step = step;
+
+  int tap_radius = qMin(kMaxTapRadius, reach / step + 1);
+
+  // Calculate full kernel from the center outwards
+  QVector<double> taps(tap_radius + 1);
+
+  for (int i=0; i<taps.size(); i++) {
+    double x = i * step;
+
+    if (method == kGaussian) {
+      taps[i] = qExp(-0.5 * (x * x) / (radius * radius));
+    } else {
+      // Coverage of this sample's footprint by the box [-radius - 0.5, radius + 0.5]
+      double box_edge = radius + 0.5;
+      double lower = qMax(x - 0.5 * step, -box_edge);
+      double upper = qMin(x + 0.5 * step, box_edge);
+
+      taps[i] = qMax(0.0, upper - lower) / step;
+    }
+  }
+
+  // Normalize so the whole (two-sided) kernel sums to 1
+  double sum = taps.at(0);
+  for (int i=1; i<taps.size(); i++) {
+    sum += 2.0 * taps.at(i);
+  }
+
+  for (int i=0; i<taps.size(); i++) {
+    taps[i] /= sum;
+  }
+
+  // Merge adjacent taps into one sample positioned between them, the linear filter does the weighting for us
+  kernel.offsets.append(0.0f);
+  kernel.weights.append(static_cast<float>(taps.at(0)));
+
+  for (int i=1; i<taps.size(); i+=2) {
+    double w1 = taps.at(i);
+    double w2 = (i + 1 < taps.size()) ? taps.at(i + 1) : 0.0;
+    double w = w1 + w2;
+
+    if (qFuzzyIsNull(w)) {
+      break;
+    }
+
+    kernel.offsets.append(static_cast<float>((i * w1 + (i + 1) * w2) / w));
+    kernel.weights.append(static_cast<float>(w));
+  }
+
+  return kernel;
+}
+
+FramePtr BlurFilterNode::BlurFrame(FramePtr frame, Method method, double radius, bool horiz, bool vert, bool repeat_edge_pixels)
+{
+  if (radius <= 0.0 || (!horiz && !vert)) {
+    return frame;
+  }
+
+  // Work in 32-bit float
+  PixelFormat::Format original_format = frame->format();
+  PixelFormat::Format float_format = PixelFormat::FormatHasAlphaChannel(original_format)
+      ? PixelFormat::PIX_FMT_RGBA32F
+      : PixelFormat::PIX_FMT_RGB32F;
+
+  FramePtr working = PixelFormat::ConvertPixelFormat(frame, float_format);
+
+  if (!working) {
+    return nullptr;
+  }
+
+  QVector<double> radii;
+
+  if (method == kGaussian) {
+    radii = GaussianBoxRadii(radius);
+  } else {
+    radii.append(radius);
+  }
+
+  int channels = PixelFormat::ChannelCount(float_format);
+  int line_stride = working->linesize_pixels() * channels;
+  float* data = reinterpret_cast<float*>(working->data());
+  QVector<float> scratch;
+
+  foreach (double r, radii) {
+    if (horiz) {
+      for (int y=0; y<working->height(); y++) {
+        BoxBlurLine(data + y * line_stride, working->width(), channels, channels, r, repeat_edge_pixels, scratch);
+      }
+    }
+
+    if (vert) {
+      for (int x=0; x<working->width(); x++) {
+        BoxBlurLine(data + x * channels, working->height(), line_stride, channels, r, repeat_edge_pixels, scratch);
+      }
+    }
+  }
+
+  return working;
+}
+
+void BlurFilterNode::BoxBlurLine(float *data, int count, int stride, int channels, double radius, bool repeat_edge_pixels, QVector<float> &scratch)
+{
+  int whole = qFloor(radius);
+  float partial = static_cast<float>(radius - whole);
+  float norm = static_cast<float>(1.0 / (2.0 * radius + 1.0));
+
+  // Copy line into a contiguous buffer with zeroed or repeated padding on either side
+  int padding = whole + 1;
+  int padded_count = count + 2 * padding;
+
+  scratch.resize(padded_count * channels);
+
+  for (int i=0; i<padded_count; i++) {
+    int src = i - padding;
+
+    if (src < 0 || src >= count) {
+      if (repeat_edge_pixels) {
+        src = qBound(0, src, count - 1);
+      } else {
+        memset(scratch.data() + i * channels, 0, sizeof(float) * static_cast<size_t>(channels));
+        continue;
+      }
+    }
+
+    memcpy(scratch.data() + i * channels, data + src * stride, sizeof(float) * static_cast<size_t>(channels));
+  }
+
+  const float* padded = scratch.constData() + padding * channels;
+
+  for (int c=0; c<channels; c++) {
+    // Sum of the whole pixels in the window around pixel 0
+    float sum = 0;
+    for (int i=-whole; i<=whole; i++) {
+      sum += padded[i * channels + c];
+    }
+
+    for (int i=0; i<count; i++) {
+      float edges = padded[(i - whole - 1) * channels + c] + padded[(i + whole + 1) * channels + c];
+
+      data[i * stride + c] = (sum + partial * edges) * norm;
+
+      if (i + 1 < count) {
+        sum += padded[(i + whole + 1) * channels + c] - padded[(i - whole) * channels + c];
+      }
+    }
+  }
+}
+
+QVector<double> BlurFilterNode::GaussianBoxRadii(double sigma)
+{
+  // Three box blurs whose combined variance matches the gaussian, from "Fast Almost-Gaussian Filtering" (Kovesi)
+  const int passes = 3;
+
+  double ideal_width = qSqrt((12.0 * sigma * sigma / passes) + 1.0);
+
+  int lower_width = qFloor(ideal_width);
+  if (lower_width % 2 == 0) {
+    lower_width--;
+  }
+  int upper_width = lower_width + 2;
+
+  double ideal_lower_count = (12.0 * sigma * sigma
+                              - passes * lower_width * lower_width
+                              - 4.0 * passes * lower_width
+                              - 3.0 * passes) / (-4.0 * lower_width - 4.0);
+  int lower_count = qRound(ideal_lower_count);
+
+  QVector<double> radii(passes);
+  for (int i=0; i<passes; i++) {
+    int width = (i < lower_count) ? lower_width : upper_width;
+    radii[i] = (width - 1) / 2;
+  }
+
+  return radii;
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -30,6 +30,38 @@ class BlurFilterNode : public Node
 public:
   BlurFilterNode();
 
+  enum Method {
+    kBox,
+    kGaussian
+  };
+
+  /**
+   * @brief Precomputed one-dimensional kernel used by the GPU blur
+   *
+   * Taps are symmetrical around the center and adjacent pairs are merged into a single linearly filtered sample, so
+   * `offsets` and `weights` hold the center tap followed by one entry per pair on each side. Offsets are in units of
+   * `step` pixels. Kernels wider than kMaxTapRadius are sampled from a downscaled mipmap level (step > 1) so the
+   * number of texture fetches per pixel never depends on the radius.
+   */
+  struct Kernel {
+    QVector<float> offsets;
+    QVector<float> weights;
+    float step;
+  };
+
+  static const int kMaxTapRadius;
+
+  static Kernel CreateKernel(Method method, double radius);
+
+  /**
+   * @brief Blurs a frame on the CPU
+   *
+   * Uses running sums so each pass costs the same regardless of radius. Gaussian blurs are approximated with three
+   * successive box blurs of matching variance. Returns the blurred frame, which may be in a floating point format if
+   * the source wasn't.
+   */
+  static FramePtr BlurFrame(FramePtr frame, Method method, double radius, bool horiz, bool vert, bool repeat_edge_pixels);
+
   virtual Node* copy() const override;
 
   virtual QString Name() const override;
@@ -43,6 +75,11 @@ public:
   virtual NodeValueTable Value(NodeValueDatabase &value) const override;
 
 private:
+  static void BoxBlurLine(float* data, int count, int stride, int channels, double radius, bool repeat_edge_pixels,
+                          QVector<float>& scratch);
+
+  static QVector<double> GaussianBoxRadii(double sigma);
+
   NodeInput* texture_input_;
 
   NodeInput* method_input_;
@@ -20,6 +20,8 @@
 
 #include "stroke.h"
 
+#include <QtMath>
+
 #include "render/color.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -97,6 +99,19 @@ NodeValueTable StrokeFilterNode::Value(NodeValueDatabase &value) const
   if (!job.GetValue(tex_input_).data().isNull()) {
     if (job.GetValue(radius_input_).data().toDouble() > 0.0
         && job.GetValue(opacity_input_).data().toDouble() > 0.0) {
+      // Rather than searching the surrounding area of every pixel (which gets quadratically slower with the radius),
+      // the shader builds a distance field using jump flooding: one seed iteration, one flood iteration for every
+      // power of two up to the radius, and a final iteration that derives the stroke from the field
+      int flood_passes = qMax(1, qCeil(std::log2(job.GetValue(radius_input_).data().toDouble())) + 1);
+
+      job.InsertValue(QStringLiteral("flood_passes"), NodeValue(NodeParam::kInt, flood_passes, this));
+
+      // The iterations replace the texture input with the field, so the shader gets the original separately too
+      job.InsertValue(QStringLiteral("src_in"), job.GetValue(tex_input_));
+
+      job.SetIterations(flood_passes + 2, tex_input_);
+      job.SetAlphaChannelRequired(true);
+
       table.Push(NodeParam::kShaderJob, QVariant::fromValue(job), this);
     } else {
       table.Push(job.GetValue(tex_input_));
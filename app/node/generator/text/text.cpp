@@ -164,14 +164,27 @@ void TextGenerator::GenerateFrame(FramePtr frame, const GenerateJob& job) const
 
   text_doc.drawContents(&p);
 
-  // Transplant alpha channel to frame
+  // Transplant alpha channel to frame. Since the source alpha only has 256 possible values, we convert each of them
+  // to a pixel in the frame's format once and then copy whole pixels per row instead of converting every pixel.
   Color rgb = job.GetValue(color_input_).data().value<Color>();
-  for (int x=0; x<frame->width(); x++) {
-    for (int y=0; y<frame->height(); y++) {
-      uchar src_alpha = img.bits()[img.bytesPerLine() * y + x];
-      float alpha = float(src_alpha) / 255.0f;
+  int bpp = PixelFormat::BytesPerPixel(frame->format());
 
-      frame->set_pixel(x, y, Color(rgb.red() * alpha, rgb.green() * alpha, rgb.blue() * alpha, alpha));
+  QByteArray lut(256 * bpp, Qt::Uninitialized);
+  for (int i=0; i<256; i++) {
+    float alpha = float(i) / 255.0f;
+
+    Color(rgb.red() * alpha, rgb.green() * alpha, rgb.blue() * alpha, alpha).toData(lut.data() + i * bpp,
+                                                                                   frame->format());
+  }
+
+  const char* lut_data = lut.constData();
+
+  for (int y=0; y<frame->height(); y++) {
+    const uchar* src_line = img.constScanLine(y);
+    char* dst_line = frame->data() + y * frame->linesize_bytes();
+
+    for (int x=0; x<frame->width(); x++) {
+      memcpy(dst_line + x * bpp, lut_data + src_line[x] * bpp, static_cast<size_t>(bpp));
     }
   }
 }
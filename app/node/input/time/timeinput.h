@@ -40,7 +40,12 @@ public:
 
   virtual NodeValueTable Value(NodeValueDatabase& value) const override;
 
-  virtual void Hash(QCryptographicHash& hash, const rational& time) const override;
+  virtual void Hash(NodeHasher& hash, const rational& time) const override;
+
+  virtual bool HashDependsOnTime() const override
+  {
+    return true;
+  }
 
 };
 
@@ -0,0 +1,134 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "composite.h"
+
+#include <QDebug>
+
+OLIVE_NAMESPACE_ENTER
+
+const int CompositeNode::kMaxLayers = 15;
+
+CompositeNode::CompositeNode()
+{
+  layers_input_ = new NodeInputArray("layers_in", NodeParam::kTexture);
+  AddInput(layers_input_);
+}
+
+Node *CompositeNode::copy() const
+{
+  return new CompositeNode();
+}
+
+QString CompositeNode::Name() const
+{
+  return tr("Composite");
+}
+
+QString CompositeNode::id() const
+{
+  return QStringLiteral("org.olivevideoeditor.Olive.composite");
+}
+
+QList<Node::CategoryID> CompositeNode::Category() const
+{
+  return {kCategoryMath};
+}
+
+QString CompositeNode::Description() const
+{
+  return tr("Composite several textures over each other.");
+}
+
+void CompositeNode::Retranslate()
+{
+  layers_input_->set_name(tr("Layers"));
+}
+
+ShaderCode CompositeNode::GetShaderCode(const QString &shader_id) const
+{
+  Q_UNUSED(shader_id)
+
+  return ShaderCode(ReadFileAsString(":/shaders/composite.frag"), QString());
+}
+
+NodeValueTable CompositeNode::Value(NodeValueDatabase &value) const
+{
+  ShaderJob job;
+  QStringList layers;
+
+  for (int i=0; i<layers_input_->GetSize(); i++) {
+    NodeInput* layer_input = layers_input_->At(i);
+    NodeValue layer = value[layer_input].TakeWithMeta(NodeParam::kTexture);
+
+    // Empty layers (e.g. gaps in a track) don't cost anything
+    if (layer.data().isNull()) {
+      continue;
+    }
+
+    if (layers.size() == kMaxLayers) {
+      qWarning() << "Composite node has more than" << kMaxLayers << "active layers, ignoring the rest";
+      break;
+    }
+
+    QString layer_id = QStringLiteral("layer_%1").arg(layers.size());
+    job.InsertValue(layer_id, layer);
+    layers.append(layer_id);
+  }
+
+  NodeValueTable table = value.Merge();
+
+  if (layers.size() == 1) {
+    // Only one layer, no need to composite
+    table.Push(job.GetValue(layers.first()));
+  } else if (layers.size() > 1) {
+    // Set unused layers too so the shader doesn't use bindings left over from a previous job
+    for (int i=layers.size(); i<kMaxLayers; i++) {
+      job.InsertValue(QStringLiteral("layer_%1").arg(i), NodeValue(NodeParam::kTexture, QVariant(), this));
+    }
+
+    job.SetLayers(layers);
+
+    table.Push(NodeParam::kShaderJob, QVariant::fromValue(job), this);
+  }
+
+  return table;
+}
+
+NodeInputArray *CompositeNode::layers_in() const
+{
+  return layers_input_;
+}
+
+void CompositeNode::Hash(NodeHasher &hash, const rational &time) const
+{
+  for (int i=0; i<layers_input_->GetSize(); i++) {
+    NodeInput* layer = layers_input_->At(i);
+
+    if (layer->is_connected()) {
+      // Include the layer's position since the order matters
+      hash.add(i);
+
+      hash.AddNode(layer->get_connected_node(), time);
+    }
+  }
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,69 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef COMPOSITENODE_H
+#define COMPOSITENODE_H
+
+#include "node/inputarray.h"
+#include "node/node.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Composites any number of textures over each other in a single pass
+ *
+ * Replaces stacking a MergeNode per layer, which costs a full-frame pass and an intermediate texture for every layer.
+ * Layers are ordered bottom to top. Empty layers are skipped here and the renderer skips layers covered by an opaque
+ * layer above them.
+ */
+class CompositeNode : public Node
+{
+public:
+  CompositeNode();
+
+  virtual Node* copy() const override;
+
+  virtual QString Name() const override;
+  virtual QString id() const override;
+  virtual QList<CategoryID> Category() const override;
+  virtual QString Description() const override;
+
+  virtual void Retranslate() override;
+
+  virtual ShaderCode GetShaderCode(const QString &shader_id) const override;
+  virtual NodeValueTable Value(NodeValueDatabase &value) const override;
+
+  NodeInputArray* layers_in() const;
+
+  virtual void Hash(NodeHasher &hash, const rational &time) const override;
+
+  /**
+   * @brief Maximum amount of layers composited by one node (limited by texture units available to one shader)
+   */
+  static const int kMaxLayers;
+
+private:
+  NodeInputArray* layers_input_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // COMPOSITENODE_H
@@ -105,14 +105,14 @@ NodeInput *MergeNode::blend_in() const
   return blend_in_;
 }
 
-void MergeNode::Hash(QCryptographicHash &hash, const rational &time) const
+void MergeNode::Hash(NodeHasher &hash, const rational &time) const
 {
   if (base_in_->is_connected()) {
-    base_in_->get_connected_node()->Hash(hash, time);
+    hash.AddNode(base_in_->get_connected_node(), time);
   }
 
   if (blend_in_->is_connected()) {
-    blend_in_->get_connected_node()->Hash(hash, time);
+    hash.AddNode(blend_in_->get_connected_node(), time);
   }
 }
 
@@ -174,6 +174,8 @@ void Node::InvalidateCache(const TimeRange &range, NodeInput *from, NodeInput *s
 {
   Q_UNUSED(from)
 
+  emit CacheInvalidated(range);
+
   SendInvalidateCache(range, source);
 }
 
@@ -290,6 +292,20 @@ QList<NodeOutput *> Node::GetOutputs() const
   return {output_};
 }
 
+QList<NodeInput *> Node::GetGizmoInputs() const
+{
+  QList<NodeInput*> inputs = GetInputsIncludingArrays();
+
+  for (int i=0;i<inputs.size();i++) {
+    if (inputs.at(i)->data_type() & NodeParam::kBuffer) {
+      inputs.removeAt(i);
+      i--;
+    }
+  }
+
+  return inputs;
+}
+
 bool Node::HasGizmos() const
 {
   return false;
@@ -326,10 +342,10 @@ void Node::SetLabel(const QString &s)
   }
 }
 
-void Node::Hash(QCryptographicHash &hash, const rational& time) const
+void Node::Hash(NodeHasher &hash, const rational& time) const
 {
   // Add this Node's ID
-  hash.addData(id().toUtf8());
+  hash.addString(id());
 
   QList<NodeInput*> inputs = GetInputsToHash();
 
@@ -342,7 +358,7 @@ void Node::Hash(QCryptographicHash &hash, const rational& time) const
 
     if (input->is_connected()) {
       // Traverse down this edge
-      input->get_connected_node()->Hash(hash, input_time);
+      hash.AddNode(input->get_connected_node(), input_time);
     } else {
       // Grab the value at this time
       QVariant value = input->get_value_at_time(input_time);
@@ -355,38 +371,35 @@ void Node::Hash(QCryptographicHash &hash, const rational& time) const
 
       if (stream) {
         // Add footage details to hash
-
-        // Footage filename
-        hash.addData(stream->footage()->filename().toUtf8());
-
-        // Footage last modified date
-        hash.addData(stream->footage()->timestamp().toString().toUtf8());
-
-        // Footage stream
-        hash.addData(QString::number(stream->index()).toUtf8());
-
-        if (stream->type() == Stream::kImage || stream->type() == Stream::kVideo) {
-          ImageStreamPtr image_stream = std::static_pointer_cast<ImageStream>(stream);
-
-          // Current color config and space
-          hash.addData(image_stream->footage()->project()->color_manager()->GetConfigFilename().toUtf8());
-          hash.addData(image_stream->colorspace().toUtf8());
-
-          // Alpha associated setting
-          hash.addData(QString::number(image_stream->premultiplied_alpha()).toUtf8());
-        }
+        hash.AddStream(stream);
 
         // Footage timestamp
         if (stream->type() == Stream::kVideo) {
-          hash.addData(QStringLiteral("%1/%2").arg(QString::number(input_time.numerator()),
-                                                   QString::number(input_time.denominator())).toUtf8());
+          hash.AddTime(input_time);
+          hash.add(static_cast<VideoStream*>(stream.get())->start_time());
+        }
+      }
+    }
+  }
+}
+
+bool Node::HashDependsOnTime() const
+{
+  foreach (NodeInput* input, GetInputsToHash()) {
+    if (!input->is_connected() && input->is_keyframing()) {
+      return true;
+    }
 
-          hash.addData(QString::number(static_cast<VideoStream*>(stream.get())->start_time()).toUtf8());
+    if (input->data_type() == NodeParam::kFootage) {
+      StreamPtr stream = input->get_standard_value().value<StreamPtr>();
 
-        }
+      if (stream && stream->type() == Stream::kVideo) {
+        return true;
       }
     }
   }
+
+  return false;
 }
 
 void Node::CopyInputs(Node *source, Node *destination, bool include_connections)
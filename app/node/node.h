@@ -21,7 +21,6 @@
 #ifndef NODE_H
 #define NODE_H
 
-#include <QCryptographicHash>
 #include <QObject>
 #include <QPainter>
 #include <QPointF>
@@ -33,6 +32,7 @@
 #include "common/xmlutils.h"
 #include "node/input.h"
 #include "node/inputarray.h"
+#include "node/nodehasher.h"
 #include "node/output.h"
 #include "node/value.h"
 #include "render/audioparams.h"
@@ -189,6 +189,9 @@ public:
    * @param frame
    *
    * The destination buffer. It will already be allocated and ready for writing to.
+   *
+   * The renderer caches the result against the job's values and the current video parameters, so every input that
+   * affects the image must be inserted into the job and the output must not depend on anything else (e.g. time).
    */
   virtual void GenerateFrame(FramePtr frame, const GenerateJob &job) const;
 
@@ -397,6 +400,14 @@ public:
 
   virtual bool HasGizmos() const;
 
+  /**
+   * @brief Returns the inputs that DrawGizmos() and GizmoPress() read from the database
+   *
+   * Only these inputs are evaluated when drawing gizmos. By default this is every input that isn't a texture or
+   * sample buffer, so the graph producing the image is never traversed just to draw some handles.
+   */
+  virtual QList<NodeInput*> GetGizmoInputs() const;
+
   virtual void DrawGizmos(NodeValueDatabase& db, QPainter* p, const QVector2D &scale, const QSize& viewport) const;
 
   virtual bool GizmoPress(NodeValueDatabase& db, const QPointF& p, const QVector2D &scale, const QSize& viewport);
@@ -406,7 +417,21 @@ public:
   const QString& GetLabel() const;
   void SetLabel(const QString& s);
 
-  virtual void Hash(QCryptographicHash& hash, const rational &time) const;
+  /**
+   * @brief Add everything that determines this node's output at `time` to a hash
+   *
+   * Upstream nodes should be added with NodeHasher::AddNode() rather than by calling their Hash() directly so their
+   * digests can be reused where possible.
+   */
+  virtual void Hash(NodeHasher& hash, const rational &time) const;
+
+  /**
+   * @brief Returns whether this node's own contribution to Hash() can change over time
+   *
+   * Upstream nodes are not considered. By default this is true if any input that gets hashed is keyframed or is video
+   * footage. Nodes that hash the time itself or anything derived from it should override this and return true.
+   */
+  virtual bool HashDependsOnTime() const;
 
 protected:
   void AddInput(NodeInput* input);
@@ -445,6 +470,11 @@ signals:
    */
   void EdgeRemoved(NodeEdgePtr edge);
 
+  /**
+   * @brief Signal emitted whenever InvalidateCache() is called on this node
+   */
+  void CacheInvalidated(const OLIVE_NAMESPACE::TimeRange& range);
+
   /**
    * @brief Signal emitted whenever the position is set through SetPosition()
    */
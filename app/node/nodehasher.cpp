@@ -0,0 +1,158 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "nodehasher.h"
+
+#include "node/node.h"
+#include "project/item/footage/footage.h"
+#include "project/item/footage/imagestream.h"
+#include "project/project.h"
+
+OLIVE_NAMESPACE_ENTER
+
+NodeHasher::NodeHasher(Memo *memo) :
+  memo_(memo)
+{
+  if (!memo_) {
+    own_memo_.reset(new Memo());
+    memo_ = own_memo_.get();
+  }
+}
+
+void NodeHasher::AddNode(const Node *node, const rational &time)
+{
+  if (!IsTimeInvariant(node)) {
+    node->Hash(*this, time);
+    return;
+  }
+
+  QByteArray digest = memo_->node_digests.value(node);
+
+  if (digest.isEmpty()) {
+    // Any time will do since this subtree hashes the same at all of them
+    NodeHasher subtree(memo_);
+    node->Hash(subtree, time);
+    digest = subtree.result();
+
+    memo_->node_digests.insert(node, digest);
+  }
+
+  addData(digest);
+}
+
+void NodeHasher::AddStream(const StreamPtr &stream)
+{
+  QByteArray digest = memo_->stream_digests.value(stream.get());
+
+  if (digest.isEmpty()) {
+    FastHasher h;
+
+    // Footage filename and last modified date
+    h.addString(stream->footage()->filename());
+    h.add(stream->footage()->timestamp().toMSecsSinceEpoch());
+
+    // Footage stream
+    h.add(stream->index());
+
+    if (stream->type() == Stream::kImage || stream->type() == Stream::kVideo) {
+      ImageStream* image_stream = static_cast<ImageStream*>(stream.get());
+
+      // Current color config and space
+      h.addString(image_stream->footage()->project()->color_manager()->GetConfigFilename());
+      h.addString(image_stream->colorspace());
+
+      // Alpha associated setting
+      h.add(image_stream->premultiplied_alpha());
+    }
+
+    digest = h.result();
+
+    memo_->stream_digests.insert(stream.get(), digest);
+  }
+
+  addData(digest);
+}
+
+QVector<QByteArray> NodeHasher::HashFrames(const Node *n, const VideoParams &params, const QVector<rational> &times)
+{
+  QVector<QByteArray> hashes(times.size());
+
+  Memo memo;
+
+  for (int i=0;i<times.size();i++) {
+    hashes[i] = HashFrameInternal(n, params, times.at(i), &memo);
+  }
+
+  return hashes;
+}
+
+QByteArray NodeHasher::HashFrame(const Node *n, const VideoParams &params, const rational &time)
+{
+  // Hashed exactly like HashFrames() so frames cached by one are found by the other
+  return HashFrameInternal(n, params, time, nullptr);
+}
+
+QByteArray NodeHasher::HashFrameInternal(const Node *n, const VideoParams &params, const rational &time, Memo *memo)
+{
+  NodeHasher hasher(memo);
+
+  hasher.AddVideoParams(params);
+
+  if (n) {
+    hasher.AddNode(n, time);
+  }
+
+  return hasher.result();
+}
+
+bool NodeHasher::IsTimeInvariant(const Node *n)
+{
+  QHash<const Node*, bool>::const_iterator it = memo_->time_invariant.constFind(n);
+
+  if (it != memo_->time_invariant.constEnd()) {
+    return it.value();
+  }
+
+  bool invariant = !n->HashDependsOnTime();
+
+  if (invariant) {
+    // A node's hash can only stay the same if everything upstream of it does too
+    foreach (Node* dep, n->GetImmediateDependencies()) {
+      if (!IsTimeInvariant(dep)) {
+        invariant = false;
+        break;
+      }
+    }
+  }
+
+  memo_->time_invariant.insert(n, invariant);
+
+  return invariant;
+}
+
+void NodeHasher::AddVideoParams(const VideoParams &params)
+{
+  // Embed video parameters into this hash
+  add(params.effective_width());
+  add(params.effective_height());
+  add(params.format());
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,112 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef NODEHASHER_H
+#define NODEHASHER_H
+
+#include <memory>
+#include <QHash>
+#include <QVector>
+
+#include "common/fasthash.h"
+#include "common/rational.h"
+#include "project/item/footage/stream.h"
+#include "render/videoparams.h"
+
+OLIVE_NAMESPACE_ENTER
+
+class Node;
+
+/**
+ * @brief Hasher used to identify what a node graph will produce at a given time
+ *
+ * Nodes add themselves with Node::Hash() and add upstream nodes with AddNode() rather than calling their Hash()
+ * directly. The digests of upstream subtrees that don't change over time and of footage identities are added in place
+ * of their contents, and are only calculated once and then reused for every frame hashed with the same Memo. A hasher
+ * created without a Memo uses one of its own, so a frame hashes identically with or without a shared Memo.
+ */
+class NodeHasher : public FastHasher
+{
+public:
+  /**
+   * @brief Digests shared between hashes of the same graph
+   *
+   * Only valid while the graph is unchanged, e.g. for the duration of one batch of hashes.
+   */
+  class Memo
+  {
+  public:
+    Memo() = default;
+
+  private:
+    friend class NodeHasher;
+
+    QHash<const Node*, bool> time_invariant;
+
+    QHash<const Node*, QByteArray> node_digests;
+
+    QHash<const Stream*, QByteArray> stream_digests;
+
+  };
+
+  NodeHasher(Memo* memo = nullptr);
+
+  /**
+   * @brief Add a node and everything upstream of it at a given time
+   */
+  void AddNode(const Node* node, const rational& time);
+
+  /**
+   * @brief Add everything that identifies a footage stream (its file, modified date, color settings, etc.)
+   */
+  void AddStream(const StreamPtr& stream);
+
+  void AddTime(const rational& time)
+  {
+    add(time.numerator());
+    add(time.denominator());
+  }
+
+  /**
+   * @brief Hash the frame a node produces with the given parameters at each of `times`
+   *
+   * All times are hashed in one pass with a shared Memo, so static parts of the graph are only traversed once.
+   */
+  static QVector<QByteArray> HashFrames(const Node* n, const VideoParams& params, const QVector<rational>& times);
+
+  static QByteArray HashFrame(const Node* n, const VideoParams& params, const rational& time);
+
+private:
+  static QByteArray HashFrameInternal(const Node* n, const VideoParams& params, const rational& time, Memo* memo);
+
+  bool IsTimeInvariant(const Node* n);
+
+  void AddVideoParams(const VideoParams& params);
+
+  Memo* memo_;
+
+  // Used when no Memo was provided
+  std::unique_ptr<Memo> own_memo_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // NODEHASHER_H
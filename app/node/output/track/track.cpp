@@ -20,17 +20,20 @@
 
 #include "track.h"
 
+#include <algorithm>
 #include <QApplication>
 #include <QDebug>
 #include <QFontMetrics>
 
 #include "node/block/gap/gap.h"
 #include "node/graph.h"
+#include "node/output/track/tracklist.h"
 
 OLIVE_NAMESPACE_ENTER
 
 TrackOutput::TrackOutput() :
   track_type_(Timeline::kTrackTypeNone),
+  track_list_(nullptr),
   index_(-1),
   locked_(false)
 {
@@ -61,6 +64,16 @@ const Timeline::TrackType& TrackOutput::track_type() const
   return track_type_;
 }
 
+TrackList *TrackOutput::track_list() const
+{
+  return track_list_;
+}
+
+void TrackOutput::set_track_list(TrackList *list)
+{
+  track_list_ = list;
+}
+
 Node *TrackOutput::copy() const
 {
   return new TrackOutput();
@@ -143,12 +156,12 @@ void TrackOutput::SetIndex(const int &index)
 
 Block *TrackOutput::BlockContainingTime(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    if (block->in() < time && block->out() > time) {
-      return block;
-    } else if (block->out() == time) {
-      break;
-    }
+  // Last block starting before this time
+  int index = std::lower_bound(block_in_points_.constBegin(), block_in_points_.constEnd(), time)
+      - block_in_points_.constBegin() - 1;
+
+  if (index >= 0 && block_cache_.at(index)->out() > time) {
+    return block_cache_.at(index);
   }
 
   return nullptr;
@@ -156,50 +169,32 @@ Block *TrackOutput::BlockContainingTime(const rational &time) const
 
 Block *TrackOutput::NearestBlockBefore(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    // Blocks are sorted by time, so the first Block who's out point is at/after this time is the correct Block
-    if (block->out() >= time) {
-      return block;
-    }
-  }
+  int index = IndexOfFirstBlockEndingAfter(time, true);
 
-  return nullptr;
+  return (index >= 0) ? block_cache_.at(index) : nullptr;
 }
 
 Block *TrackOutput::NearestBlockBeforeOrAt(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    // Blocks are sorted by time, so the first Block who's out point is at/after this time is the correct Block
-    if (block->out() > time) {
-      return block;
-    }
-  }
+  int index = IndexOfFirstBlockEndingAfter(time, false);
 
-  return nullptr;
+  return (index >= 0) ? block_cache_.at(index) : nullptr;
 }
 
 Block *TrackOutput::NearestBlockAfterOrAt(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    // Blocks are sorted by time, so the first Block after this time is the correct Block
-    if (block->in() >= time) {
-      return block;
-    }
-  }
+  int index = std::lower_bound(block_in_points_.constBegin(), block_in_points_.constEnd(), time)
+      - block_in_points_.constBegin();
 
-  return nullptr;
+  return (index < block_cache_.size()) ? block_cache_.at(index) : nullptr;
 }
 
 Block *TrackOutput::NearestBlockAfter(const rational &time) const
 {
-  foreach (Block* block, block_cache_) {
-    // Blocks are sorted by time, so the first Block after this time is the correct Block
-    if (block->in() > time) {
-      return block;
-    }
-  }
+  int index = std::upper_bound(block_in_points_.constBegin(), block_in_points_.constEnd(), time)
+      - block_in_points_.constBegin();
 
-  return nullptr;
+  return (index < block_cache_.size()) ? block_cache_.at(index) : nullptr;
 }
 
 Block *TrackOutput::BlockAtTime(const rational &time) const
@@ -208,15 +203,13 @@ Block *TrackOutput::BlockAtTime(const rational &time) const
     return nullptr;
   }
 
-  foreach (Block* block, block_cache_) {
-    if (block
-        && block->in() <= time
-        && block->out() > time) {
-      if (block->is_enabled()) {
-        return block;
-      } else {
-        break;
-      }
+  int index = IndexOfFirstBlockEndingAfter(time, false);
+
+  if (index >= 0) {
+    Block* block = block_cache_.at(index);
+
+    if (block->in() <= time && block->is_enabled()) {
+      return block;
     }
   }
 
@@ -231,18 +224,42 @@ QList<Block *> TrackOutput::BlocksAtTimeRange(const TimeRange &range) const
     return list;
   }
 
-  foreach (Block* block, block_cache_) {
-    if (block
-        && block->is_enabled()
-        && block->out() > range.in()
-        && block->in() < range.out()) {
-      list.append(block);
+  int index = IndexOfFirstBlockEndingAfter(range.in(), false);
+
+  if (index >= 0) {
+    for (int i=index; i<block_cache_.size() && block_in_points_.at(i) < range.out(); i++) {
+      Block* block = block_cache_.at(i);
+
+      if (block->is_enabled()) {
+        list.append(block);
+      }
     }
   }
 
   return list;
 }
 
+QVector<rational> TrackOutput::EditPointsInRange(const rational &in, const rational &out) const
+{
+  QVector<rational> points;
+
+  QVector<rational>::const_iterator begin = std::lower_bound(block_in_points_.constBegin(),
+                                                             block_in_points_.constEnd(),
+                                                             in);
+  QVector<rational>::const_iterator end = std::upper_bound(begin, block_in_points_.constEnd(), out);
+
+  for (QVector<rational>::const_iterator i=begin; i!=end; i++) {
+    points.append(*i);
+  }
+
+  // The last block's out point is the only one that isn't also an in point
+  if (!block_cache_.isEmpty() && track_length_ >= in && track_length_ <= out) {
+    points.append(track_length_);
+  }
+
+  return points;
+}
+
 const QList<Block *> &TrackOutput::Blocks() const
 {
   return block_cache_;
@@ -272,12 +289,12 @@ void TrackOutput::InvalidateCache(const TimeRange &range, NodeInput *from, NodeI
 
 void TrackOutput::InsertBlockBefore(Block* block, Block* after)
 {
-  InsertBlockAtIndex(block, block_cache_.indexOf(after));
+  InsertBlockAtIndex(block, IndexOfBlock(after));
 }
 
 void TrackOutput::InsertBlockAfter(Block *block, Block *before)
 {
-  int before_index = block_cache_.indexOf(before);
+  int before_index = IndexOfBlock(before);
 
   Q_ASSERT(before_index >= 0);
 
@@ -297,8 +314,8 @@ void TrackOutput::PrependBlock(Block *block)
 
   EndOperation();
 
-  // Everything has shifted at this point
-  InvalidateCache(TimeRange(0, track_length()), block_input_, block_input_);
+  // Everything has shifted forward by the length of the new block
+  InvalidateRipple(0, block->length(), TimeRange(block->in(), block->out()));
 }
 
 void TrackOutput::InsertBlockAtIndex(Block *block, int index)
@@ -312,7 +329,7 @@ void TrackOutput::InsertBlockAtIndex(Block *block, int index)
 
   EndOperation();
 
-  InvalidateCache(TimeRange(block->in(), track_length()), block_input_, block_input_);
+  InvalidateRipple(block->in(), block->out(), TimeRange(block->in(), block->out()));
 }
 
 void TrackOutput::AppendBlock(Block *block)
@@ -324,8 +341,8 @@ void TrackOutput::AppendBlock(Block *block)
 
   EndOperation();
 
-  // Invalidate area that block was added to
-  InvalidateCache(TimeRange(block->in(), track_length()), block_input_, block_input_);
+  // Invalidate area that block was added to (nothing after it has moved)
+  InvalidateCache(TimeRange(block->in(), block->out()), block_input_, block_input_);
 }
 
 void TrackOutput::RippleRemoveBlock(Block *block)
@@ -333,18 +350,22 @@ void TrackOutput::RippleRemoveBlock(Block *block)
   BeginOperation();
 
   rational remove_in = block->in();
+  rational remove_out = block->out();
 
   block_input_->RemoveAt(GetInputIndexFromCacheIndex(block));
 
   EndOperation();
 
-  InvalidateCache(TimeRange(remove_in, track_length()), block_input_, block_input_);
+  // Everything after the block has moved back to where it started, nothing new has appeared
+  InvalidateRipple(remove_out, remove_in, TimeRange(remove_in, remove_in));
 }
 
 void TrackOutput::ReplaceBlock(Block *old, Block *replace)
 {
   BeginOperation();
 
+  rational old_out = old->out();
+
   int index_of_old_block = GetInputIndexFromCacheIndex(old);
 
   NodeParam::DisconnectEdge(old->output(),
@@ -358,7 +379,8 @@ void TrackOutput::ReplaceBlock(Block *old, Block *replace)
   if (old->length() == replace->length()) {
     InvalidateCache(TimeRange(replace->in(), replace->out()), block_input_, block_input_);
   } else {
-    InvalidateCache(TimeRange(replace->in(), RATIONAL_MAX), block_input_, block_input_);
+    // Everything after the old block has moved to wherever the new one ends
+    InvalidateRipple(old_out, replace->out(), TimeRange(replace->in(), replace->out()));
   }
 }
 
@@ -434,13 +456,13 @@ NodeInputArray *TrackOutput::block_input() const
   return block_input_;
 }
 
-void TrackOutput::Hash(QCryptographicHash &hash, const rational &time) const
+void TrackOutput::Hash(NodeHasher &hash, const rational &time) const
 {
   Block* b = BlockAtTime(time);
 
   // Defer to block at this time, don't add any of our own information to the hash
   if (b) {
-    b->Hash(hash, time);
+    hash.AddNode(b, time);
   }
 }
 
@@ -465,11 +487,14 @@ void TrackOutput::UpdateInOutFrom(int index)
   // Find block just before this one to find the last out point
   rational last_out = (index == 0) ? 0 : block_cache_.at(index - 1)->out();
 
+  block_in_points_.resize(block_cache_.size());
+
   // Iterate through all blocks updating their in/outs
   for (int i=index; i<block_cache_.size(); i++) {
     Block* b = block_cache_.at(i);
 
     b->set_in(last_out);
+    block_in_points_[i] = last_out;
 
     last_out += b->length();
 
@@ -482,6 +507,42 @@ void TrackOutput::UpdateInOutFrom(int index)
   SetLengthInternal(last_out);
 }
 
+int TrackOutput::IndexOfFirstBlockEndingAfter(const rational &time, bool or_at) const
+{
+  // Block `i` ends where block `i+1` starts, so the block before the first in point past `time` is the first to end
+  // past it
+  QVector<rational>::const_iterator next_in = or_at
+      ? std::lower_bound(block_in_points_.constBegin(), block_in_points_.constEnd(), time)
+      : std::upper_bound(block_in_points_.constBegin(), block_in_points_.constEnd(), time);
+
+  int index = qMax(0, static_cast<int>(next_in - block_in_points_.constBegin()) - 1);
+
+  if (index < block_cache_.size()) {
+    const rational& out = block_cache_.at(index)->out();
+
+    if (or_at ? out >= time : out > time) {
+      return index;
+    }
+  }
+
+  return -1;
+}
+
+int TrackOutput::IndexOfBlock(Block *block) const
+{
+  int index = std::lower_bound(block_in_points_.constBegin(), block_in_points_.constEnd(), block->in())
+      - block_in_points_.constBegin();
+
+  // Zero-length blocks share their in point with the next block
+  for (; index<block_cache_.size() && block_in_points_.at(index) == block->in(); index++) {
+    if (block_cache_.at(index) == block) {
+      return index;
+    }
+  }
+
+  return block_cache_.indexOf(block);
+}
+
 int TrackOutput::GetInputIndexFromCacheIndex(int cache_index)
 {
   return GetInputIndexFromCacheIndex(block_cache_.at(cache_index));
@@ -514,6 +575,16 @@ void TrackOutput::SetLengthInternal(const rational &r, bool invalidate)
   }
 }
 
+void TrackOutput::InvalidateRipple(const rational &from, const rational &to, const TimeRange &changed)
+{
+  if (track_list_ && track_list_->ShiftCacheForTrack(this, from, to)) {
+    // Caches have been translated, so only the span that genuinely changed needs re-rendering
+    InvalidateCache(changed, block_input_, block_input_);
+  } else {
+    InvalidateCache(TimeRange(qMin(from, to), track_length()), block_input_, block_input_);
+  }
+}
+
 void TrackOutput::BlockConnected(NodeEdgePtr edge)
 {
   QList<Block*> new_block_list;
@@ -628,8 +699,11 @@ void TrackOutput::BlockDisconnected(NodeEdgePtr edge)
 {
   Block* b = static_cast<Block*>(edge->output()->parentNode());
 
-  if (block_cache_.contains(b)) {
-    block_cache_.removeOne(b);
+  int index = IndexOfBlock(b);
+
+  if (index >= 0) {
+    block_cache_.removeAt(index);
+    block_in_points_.remove(index);
 
     Block* previous = b->previous();
     Block* next = b->next();
@@ -646,7 +720,7 @@ void TrackOutput::BlockDisconnected(NodeEdgePtr edge)
     b->set_next(nullptr);
 
     if (next) {
-      UpdateInOutFrom(block_cache_.indexOf(next));
+      UpdateInOutFrom(IndexOfBlock(next));
     } else if (block_cache_.isEmpty()) {
       SetLengthInternal(rational());
     } else {
@@ -698,7 +772,7 @@ void TrackOutput::BlockLengthChanged()
 
   rational old_out = b->out();
 
-  UpdateInOutFrom(block_cache_.indexOf(b));
+  UpdateInOutFrom(IndexOfBlock(b));
 
   rational new_out = b->out();
 
@@ -27,6 +27,8 @@
 
 OLIVE_NAMESPACE_ENTER
 
+class TrackList;
+
 /**
  * @brief A time traversal Node for sorting through one channel/track of Blocks
  */
@@ -39,6 +41,9 @@ public:
   const Timeline::TrackType& track_type() const;
   void set_track_type(const Timeline::TrackType& track_type);
 
+  TrackList* track_list() const;
+  void set_track_list(TrackList* list);
+
   virtual Node* copy() const override;
 
   virtual QString Name() const override;
@@ -120,6 +125,13 @@ public:
    */
   QList<Block*> BlocksAtTimeRange(const TimeRange& range) const;
 
+  /**
+   * @brief Returns every edit point (block in or out point) between `in` and `out` inclusive, in order
+   *
+   * Used for snapping. Includes disabled blocks and gaps, and ignores IsMuted().
+   */
+  QVector<rational> EditPointsInRange(const rational& in, const rational& out) const;
+
   const QList<Block *> &Blocks() const;
 
   virtual void InvalidateCache(const TimeRange& range, NodeInput* from, NodeInput *source) override;
@@ -186,7 +198,13 @@ public:
 
   NodeInputArray* block_input() const;
 
-  virtual void Hash(QCryptographicHash& hash, const rational &time) const override;
+  virtual void Hash(NodeHasher& hash, const rational &time) const override;
+
+  virtual bool HashDependsOnTime() const override
+  {
+    // Which block gets hashed depends on the time
+    return true;
+  }
 
   AudioVisualWaveform& waveform()
   {
@@ -249,19 +267,49 @@ protected:
 private:
   void UpdateInOutFrom(int index);
 
+  /**
+   * @brief Index of the first block that ends after `time`, or at `time` too if `or_at` is true
+   *
+   * Returns -1 if no block does (i.e. `time` is past the end of the track).
+   */
+  int IndexOfFirstBlockEndingAfter(const rational& time, bool or_at) const;
+
+  /**
+   * @brief Index of `block` in block_cache_ or -1, found by its in point rather than a linear search
+   */
+  int IndexOfBlock(Block* block) const;
+
   int GetInputIndexFromCacheIndex(int cache_index);
   int GetInputIndexFromCacheIndex(Block* block);
 
   void SetLengthInternal(const rational& r, bool invalidate = true);
 
+  /**
+   * @brief Invalidate after an edit that moved everything from `from` onwards to `to`
+   *
+   * If the TrackList can shift the downstream caches to match, only `changed` is invalidated. Otherwise everything
+   * from the edit point to the end of the track is invalidated.
+   */
+  void InvalidateRipple(const rational& from, const rational& to, const TimeRange& changed);
+
   QList<Block*> block_cache_;
 
+  /**
+   * @brief In point of each block in block_cache_
+   *
+   * Blocks are contiguous, so this is sorted and block `i` ends where block `i+1` starts. Lookups by time binary search
+   * this rather than walking the blocks. UpdateInOutFrom() keeps it up to date from the first block that changed.
+   */
+  QVector<rational> block_in_points_;
+
   NodeInputArray* block_input_;
 
   NodeInput* muted_input_;
 
   Timeline::TrackType track_type_;
 
+  TrackList* track_list_;
+
   rational track_length_;
 
   int track_height_;
@@ -20,9 +20,9 @@
 
 #include "tracklist.h"
 
+#include "node/audio/mix/mix.h"
 #include "node/factory.h"
-#include "node/math/math/math.h"
-#include "node/math/merge/merge.h"
+#include "node/math/composite/composite.h"
 #include "node/output/viewer/viewer.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -105,22 +105,57 @@ TrackOutput* TrackList::AddTrack()
           switch (type_) {
           case Timeline::kTrackTypeVideo:
           {
-            MergeNode* blend = new MergeNode();
-            GetParentGraph()->AddNode(blend);
-
-            NodeParam::ConnectEdge(track->output(), blend->blend_in());
-            NodeParam::ConnectEdge(last_track->output(), blend->base_in());
-            NodeParam::ConnectEdge(blend->output(), edge->input());
+            // Add as a layer to the compositor the last track is on if there's space
+            CompositeNode* composite = dynamic_cast<CompositeNode*>(edge->input()->parentNode());
+            int last_layer = composite ? composite->layers_in()->IndexOfSubParameter(edge->input()) : -1;
+
+            if (last_layer >= 0) {
+              NodeInputArray* layers = composite->layers_in();
+
+              if (last_layer + 1 < layers->GetSize() && !layers->At(last_layer + 1)->is_connected()) {
+                NodeParam::ConnectEdge(track->output(), layers->At(last_layer + 1));
+                break;
+              } else if (last_layer + 1 == layers->GetSize() && layers->GetSize() < CompositeNode::kMaxLayers) {
+                layers->Append();
+                NodeParam::ConnectEdge(track->output(), layers->Last());
+                break;
+              }
+            }
+
+            // Otherwise start a new compositor in place of the last track
+            composite = new CompositeNode();
+            GetParentGraph()->AddNode(composite);
+
+            composite->layers_in()->SetSize(2);
+            NodeParam::ConnectEdge(last_track->output(), composite->layers_in()->At(0));
+            NodeParam::ConnectEdge(track->output(), composite->layers_in()->At(1));
+            NodeParam::ConnectEdge(composite->output(), edge->input());
             break;
           }
           case Timeline::kTrackTypeAudio:
           {
-            MathNode* add = new MathNode();
-            GetParentGraph()->AddNode(add);
-
-            NodeParam::ConnectEdge(track->output(), add->param_a_in());
-            NodeParam::ConnectEdge(last_track->output(), add->param_b_in());
-            NodeParam::ConnectEdge(add->output(), edge->input());
+            // Add as a source to the bus the last track is on
+            MixNode* mix = dynamic_cast<MixNode*>(edge->input()->parentNode());
+            int last_source = mix ? mix->samples_in()->IndexOfSubParameter(edge->input()) : -1;
+
+            if (last_source >= 0) {
+              NodeInputArray* sources = mix->samples_in();
+
+              if (last_source + 1 < sources->GetSize() && !sources->At(last_source + 1)->is_connected()) {
+                NodeParam::ConnectEdge(track->output(), sources->At(last_source + 1));
+              } else {
+                NodeParam::ConnectEdge(track->output(), mix->AppendSource());
+              }
+              break;
+            }
+
+            // Otherwise create a bus in place of the last track
+            mix = new MixNode();
+            GetParentGraph()->AddNode(mix);
+
+            NodeParam::ConnectEdge(last_track->output(), mix->AppendSource());
+            NodeParam::ConnectEdge(track->output(), mix->AppendSource());
+            NodeParam::ConnectEdge(mix->output(), edge->input());
             break;
           }
           default:
@@ -193,6 +228,7 @@ void TrackList::TrackConnected(NodeEdgePtr edge)
     connect(connected_track, &TrackOutput::TrackHeightChanged, this, &TrackList::TrackHeightChangedSlot);
 
     connected_track->set_track_type(type_);
+    connected_track->set_track_list(this);
 
     emit TrackListChanged();
 
@@ -229,6 +265,7 @@ void TrackList::TrackDisconnected(NodeEdgePtr edge)
 
     track->SetIndex(-1);
     track->set_track_type(Timeline::kTrackTypeNone);
+    track->set_track_list(nullptr);
 
     disconnect(track, &TrackOutput::BlockAdded, this, &TrackList::TrackAddedBlock);
     disconnect(track, &TrackOutput::BlockRemoved, this, &TrackList::TrackRemovedBlock);
@@ -246,6 +283,57 @@ NodeGraph *TrackList::GetParentGraph() const
   return static_cast<NodeGraph*>(parent()->parent());
 }
 
+bool TrackList::ShiftCacheForTrack(TrackOutput *track, const rational &from, const rational &to)
+{
+  if (from == to) {
+    return true;
+  }
+
+  if (type_ != Timeline::kTrackTypeVideo && type_ != Timeline::kTrackTypeAudio) {
+    return false;
+  }
+
+  ViewerOutput* viewer = static_cast<ViewerOutput*>(parent());
+
+  // A wider operation (e.g. a ripple across the whole track list) is in progress and handles shifting itself
+  if (viewer->IsInOperation()) {
+    return false;
+  }
+
+  rational edit_point = qMin(from, to);
+
+  QVector<TrackOutput*> skipped_tracks;
+
+  foreach (TrackOutput* other, track_cache_) {
+    if (other
+        && other != track
+        && other->track_length() > edit_point) {
+      if (other->IsMuted()) {
+        // Doesn't affect the composite, but has content that didn't move with the edited track
+        skipped_tracks.append(other);
+      } else {
+        // This track has content that didn't move, so the composite after the edit point has changed
+        return false;
+      }
+    }
+  }
+
+  if (type_ == Timeline::kTrackTypeVideo) {
+    viewer->ShiftVideoCache(from, to);
+  } else {
+    viewer->ShiftAudioCache(from, to, track);
+
+    // Regenerate the waveforms of tracks that stayed where they were after the edit point
+    foreach (TrackOutput* other, skipped_tracks) {
+      other->InvalidateCache(TimeRange(edit_point, other->track_length()),
+                             other->block_input(),
+                             other->block_input());
+    }
+  }
+
+  return true;
+}
+
 void TrackList::UpdateTotalLength()
 {
   total_length_ = 0;
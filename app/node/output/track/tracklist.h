@@ -52,6 +52,18 @@ public:
 
   NodeGraph* GetParentGraph() const;
 
+  /**
+   * @brief Shift the parent viewer's caches for a ripple edit on a single track
+   *
+   * Called by a track when everything on it from `from` onwards has moved to `to`. The composited result only moved
+   * with it if no other track in this list has visible content after the edit point, so the caches are only shifted
+   * in that case. Muted tracks don't prevent the shift, but their waveforms after the edit point are regenerated
+   * since only the edited track's waveform moves.
+   *
+   * @return True if the caches were shifted and only the genuinely changed span needs invalidating.
+   */
+  bool ShiftCacheForTrack(TrackOutput* track, const rational& from, const rational& to);
+
 signals:
   void BlockAdded(Block* block, int index);
 
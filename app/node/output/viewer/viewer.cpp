@@ -92,11 +92,15 @@ void ViewerOutput::ShiftVideoCache(const rational &from, const rational &to)
   video_frame_cache_.Shift(from, to);
 }
 
-void ViewerOutput::ShiftAudioCache(const rational &from, const rational &to)
+void ViewerOutput::ShiftAudioCache(const rational &from, const rational &to, TrackOutput *only_track)
 {
   audio_playback_cache_.Shift(from, to);
 
   foreach (TrackOutput* track, track_lists_.at(Timeline::kTrackTypeAudio)->GetTracks()) {
+    if (only_track && track != only_track) {
+      continue;
+    }
+
     QMutexLocker locker(track->waveform_lock());
     track->waveform().Shift(from, to);
   }
@@ -55,7 +55,12 @@ public:
   virtual QString Description() const override;
 
   void ShiftVideoCache(const rational& from, const rational& to);
-  void ShiftAudioCache(const rational& from, const rational& to);
+  /**
+   * @brief Shift the audio cache and track waveforms
+   *
+   * If `only_track` is set, only that track's waveform is shifted since the other tracks' content didn't move.
+   */
+  void ShiftAudioCache(const rational& from, const rational& to, TrackOutput* only_track = nullptr);
   void ShiftCache(const rational& from, const rational& to);
 
   NodeInput* texture_input() const {
@@ -122,6 +127,13 @@ public:
 
   virtual void EndOperation() override;
 
+  /**
+   * @brief Returns true while BeginOperation() has been called more times than EndOperation()
+   */
+  bool IsInOperation() const {
+    return operation_stack_ > 0;
+  }
+
 signals:
   void TimebaseChanged(const rational&);
 
@@ -20,6 +20,7 @@
 
 #include "traverser.h"
 
+#include "common/trace.h"
 #include "node.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -65,6 +66,8 @@ NodeValueTable NodeTraverser::ProcessInput(NodeInput* input, const TimeRange& ra
 
 NodeValueTable NodeTraverser::GenerateTable(const Node *n, const TimeRange& range)
 {
+  TRACE_SCOPE("node", "GenerateTable");
+
   if (n->IsTrack()) {
     // If the range is not wholly contained in this Block, we'll need to do some extra processing
     return GenerateBlockTable(static_cast<const TrackOutput*>(n), range);
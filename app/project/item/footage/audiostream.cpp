@@ -64,17 +64,37 @@ void AudioStream::set_sample_rate(const int &sample_rate)
   sample_rate_ = sample_rate;
 }
 
-bool AudioStream::try_start_conforming(const AudioParams &params)
+ConformProgressPtr AudioStream::request_conform(const AudioParams &params, bool *created)
 {
   QMutexLocker locker(proxy_access_lock());
 
-  if (!currently_conforming_.contains(params)
-      && !conformed_.contains(params)) {
-    currently_conforming_.append(params);
-    return true;
+  if (created) {
+    *created = false;
   }
 
-  return false;
+  if (conformed_.contains(params)) {
+    return nullptr;
+  }
+
+  foreach (ConformProgressPtr p, conforming_) {
+    if (p->params() == params) {
+      return p;
+    }
+  }
+
+  qint64 estimated_samples = 0;
+  if (duration() > 0 && !timebase().isNull()) {
+    estimated_samples = qRound64(static_cast<double>(duration()) * timebase().toDouble() * params.sample_rate());
+  }
+
+  ConformProgressPtr p = std::make_shared<ConformProgress>(params, estimated_samples);
+  conforming_.append(p);
+
+  if (created) {
+    *created = true;
+  }
+
+  return p;
 }
 
 bool AudioStream::has_conformed_version(const AudioParams &params)
@@ -89,11 +109,29 @@ void AudioStream::append_conformed_version(const AudioParams &params)
   {
     QMutexLocker locker(proxy_access_lock());
 
-    currently_conforming_.removeOne(params);
+    for (int i=0;i<conforming_.size();i++) {
+      if (conforming_.at(i)->params() == params) {
+        conforming_.removeAt(i);
+        break;
+      }
+    }
+
     conformed_.append(params);
   }
 
   emit ConformAppended(params);
 }
 
+void AudioStream::remove_conform(const AudioParams &params)
+{
+  QMutexLocker locker(proxy_access_lock());
+
+  for (int i=0;i<conforming_.size();i++) {
+    if (conforming_.at(i)->params() == params) {
+      conforming_.removeAt(i);
+      break;
+    }
+  }
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -23,6 +23,7 @@
 
 #include <QVector>
 
+#include "codec/conformprogress.h"
 #include "common/rational.h"
 #include "render/audioparams.h"
 #include "stream.h"
@@ -49,10 +50,22 @@ public:
   const int& sample_rate() const;
   void set_sample_rate(const int& sample_rate);
 
-  bool try_start_conforming(const AudioParams& params);
+  /**
+   * @brief Returns the progress of a conform to `params`, starting a new one if nobody has asked for it yet
+   *
+   * Returns nullptr if the conform already exists in full. If `created` is non-null, it's set to whether this call
+   * started it.
+   */
+  ConformProgressPtr request_conform(const AudioParams& params, bool* created = nullptr);
+
   bool has_conformed_version(const AudioParams& params);
   void append_conformed_version(const AudioParams& params);
 
+  /**
+   * @brief Forget a conform that failed so that it can be tried again
+   */
+  void remove_conform(const AudioParams& params);
+
 signals:
   void ConformAppended(OLIVE_NAMESPACE::AudioParams params);
 
@@ -63,7 +76,7 @@ private:
 
   QList<AudioParams> conformed_;
 
-  QList<AudioParams> currently_conforming_;
+  QList<ConformProgressPtr> conforming_;
 
 };
 
@@ -28,7 +28,8 @@ OLIVE_NAMESPACE_ENTER
 
 VideoStream::VideoStream() :
   start_time_(0),
-  is_image_sequence_(false)
+  is_image_sequence_(false),
+  proxy_divider_(0)
 {
   set_type(kVideo);
 }
@@ -71,6 +72,20 @@ void VideoStream::set_image_sequence(bool e)
   is_image_sequence_ = e;
 }
 
+int VideoStream::proxy_divider()
+{
+  QMutexLocker locker(proxy_access_lock());
+
+  return proxy_divider_;
+}
+
+void VideoStream::set_proxy_divider(int divider)
+{
+  QMutexLocker locker(proxy_access_lock());
+
+  proxy_divider_ = divider;
+}
+
 /*
 int64_t VideoStream::get_closest_timestamp_in_frame_index(const rational &time)
 {
@@ -47,6 +47,14 @@ public:
   bool is_image_sequence() const;
   void set_image_sequence(bool e);
 
+  /**
+   * @brief Divider of the proxy decoders can use in place of this stream, or 0 if there isn't one
+   *
+   * Not saved with the project, decoders find existing proxies on disk when they open.
+   */
+  int proxy_divider();
+  void set_proxy_divider(int divider);
+
   /*
   int64_t get_closest_timestamp_in_frame_index(const rational& time);
   int64_t get_closest_timestamp_in_frame_index(int64_t timestamp);
@@ -69,6 +77,8 @@ private:
 
   bool is_image_sequence_;
 
+  int proxy_divider_;
+
 };
 
 using VideoStreamPtr = std::shared_ptr<VideoStream>;
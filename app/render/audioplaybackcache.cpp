@@ -21,7 +21,6 @@
 #include "audioplaybackcache.h"
 
 #include <QDir>
-#include <QFile>
 #include <QUuid>
 
 #include "common/filefunctions.h"
@@ -31,8 +30,7 @@ OLIVE_NAMESPACE_ENTER
 AudioPlaybackCache::AudioPlaybackCache(QObject* parent) :
   PlaybackCache(parent)
 {
-  quint32 r = std::rand();
-  UpdateFilename(QString::number(r));
+  pcm_ = CreateStorage(params_);
 }
 
 void AudioPlaybackCache::SetParameters(const AudioParams &params)
@@ -45,13 +43,10 @@ void AudioPlaybackCache::SetParameters(const AudioParams &params)
 
   params_ = params;
 
-  // Restart empty file so there's always "something" to play
-  QFile f(filename_);
-  if (f.open(QFile::WriteOnly)) {
-    f.close();
-  }
+  // Our current audio cache is unusable, so we start new (empty) storage. Anything still reading the old one keeps it
+  // alive until it's done.
+  pcm_ = CreateStorage(params_);
 
-  // Our current audio cache is unusable, so we truncate it automatically
   TimeRange invalidate_range(0, NoLockGetLength());
   if (invalidate_range.in() != invalidate_range.out()) {
     NoLockInvalidate(invalidate_range);
@@ -72,152 +67,55 @@ void AudioPlaybackCache::WritePCM(const TimeRange &range, SampleBufferPtr sample
     return;
   }
 
-  QFile f(filename_);
-  if (f.open(QFile::ReadWrite)) {
-    QByteArray a = samples->toPackedData();
-
-    foreach (const TimeRange& r, valid_ranges) {
-      // Calculate destination offsets
-      qint64 start_offset = params_.time_to_bytes(r.in());
-      qint64 max_len = params_.time_to_bytes(r.out());
-
-      if (f.size() < max_len) {
-        f.resize(max_len);
-      }
+  foreach (const TimeRange& r, valid_ranges) {
+    // Calculate destination offsets
+    qint64 dest_start = params_.time_to_samples(r.in());
+    qint64 dest_len = params_.time_to_samples(r.out()) - dest_start;
 
-      // Calculate source offsets
-      qint64 sample_start = params_.time_to_bytes(r.in() - range.in());
-      qint64 sample_len = params_.time_to_bytes(r.length());
-      qint64 actual_write = qMin(sample_len, a.size() - sample_start);
+    // Calculate source offsets
+    qint64 src_start = params_.time_to_samples(r.in() - range.in());
+    qint64 actual_write = qBound(qint64(0), samples->sample_count() - src_start, dest_len);
 
-      f.seek(start_offset);
-      f.write(a.data() + sample_start, actual_write);
+    // Samples are interleaved straight into the mapped storage
+    pcm_->Write(dest_start, samples, src_start, actual_write);
 
-      if (actual_write < sample_len) {
-        // Fill remaining space with silence
-        QByteArray s(sample_len - actual_write, 0x00);
-        f.write(s);
-      }
+    if (actual_write < dest_len) {
+      // Fill remaining space with silence
+      pcm_->WriteSilence(dest_start + actual_write, dest_len - actual_write);
     }
+  }
 
-    f.close();
-
-    NoLockValidate(range);
+  NoLockValidate(range);
 
-    locker.unlock();
+  locker.unlock();
 
-    emit Validated(range);
-  } else {
-    qWarning() << "Failed to write PCM data to" << filename_;
-  }
+  emit Validated(range);
 }
 
 void AudioPlaybackCache::WriteSilence(const TimeRange &range)
 {
   QMutexLocker locker(lock());
 
-  QFile f(filename_);
-  if (f.open(QFile::ReadWrite)) {
-    qint64 start_offset = params_.time_to_bytes(range.in());
-    qint64 max_len = params_.time_to_bytes(range.out());
-    qint64 write_len = max_len - start_offset;
-
-    if (f.size() < max_len) {
-      f.resize(max_len);
-    }
-
-    f.seek(start_offset);
+  qint64 start = params_.time_to_samples(range.in());
 
-    QByteArray a(write_len, 0x00);
-    f.write(a);
-
-    f.close();
-  } else {
-    qWarning() << "Failed to write PCM data to" << filename_;
-  }
-}
-
-/*
-void AudioPlaybackCache::SetUuid(const QUuid &id)
-{
-  UpdateFilename(id.toByteArray());
+  pcm_->WriteSilence(start, params_.time_to_samples(range.out()) - start);
 }
-*/
 
 void AudioPlaybackCache::ShiftEvent(const rational &from, const rational &to)
 {
-  qint64 from_offset = params_.time_to_bytes(from);
-  qint64 to_offset = params_.time_to_bytes(to);
+  qint64 from_sample = params_.time_to_samples(from);
+  qint64 to_sample = params_.time_to_samples(to);
 
-  if (from_offset == to_offset) {
+  if (from_sample == to_sample || from_sample >= pcm_->length()) {
+    // Nothing to move
     return;
   }
 
-  QFile f(filename_);
-  if (f.open(QFile::ReadWrite)) {
-    if (!f.size()) {
-      return;
-    }
-
-    qint64 chunk = qAbs(to_offset - from_offset);
-
-    QByteArray buf(chunk, Qt::Uninitialized);
-
-    if (to > from) {
-      // Shifting forwards, we must insert a new region and shift all the bytes there
-
-      // For shifting forwards, we copy bytes starting at the back so that bytes we need don't
-      // get overwritten.
-      qint64 read_offset = f.size();
-
-      f.resize(f.size() + chunk);
-
-      qint64 write_offset = f.size();
-
-      while (read_offset != from_offset) {
-
-        // Calculate how much will be read this time
-        qint64 chunk_sz = qMin(chunk, read_offset - from_offset);
-        read_offset -= chunk_sz;
-
-        // Read that chunk
-        f.seek(read_offset);
-        f.read(buf.data(), chunk_sz);
-
-        // Write it at the destination
-        write_offset -= chunk_sz;
-        f.seek(write_offset);
-        f.write(buf.data(), chunk_sz);
-
-      }
-
-      // Replace remainder with silence
-      f.seek(from_offset);
-      buf.fill(0);
-      f.write(buf);
-
-    } else {
-      // Shifting backwards, we will shift bytes and truncate
-
-      while (from_offset != f.size()) {
-        // Read region to be shifted
-        f.seek(from_offset);
-        qint64 read_sz = f.read(buf.data(), buf.size());
-        from_offset += read_sz;
-
-        // Write it at the destination
-        f.seek(to_offset);
-        to_offset += f.write(buf, read_sz);
-      }
-
-      // Truncate
-      f.resize(f.size() - chunk);
-
-    }
-
-    f.close();
+  // This only edits the storage's segment table, no audio is actually moved
+  if (to_sample > from_sample) {
+    pcm_->Insert(from_sample, to_sample - from_sample);
   } else {
-    qWarning() << "Failed to write PCM data to" << filename_;
+    pcm_->Remove(to_sample, from_sample - to_sample);
   }
 }
 
@@ -228,7 +126,11 @@ void AudioPlaybackCache::LengthChangedEvent(const rational& old, const rational&
   }
 
   if (newlen < old) {
-    QFile(filename_).resize(params_.time_to_bytes(newlen));
+    qint64 new_sample_length = params_.time_to_samples(newlen);
+
+    if (new_sample_length < pcm_->length()) {
+      pcm_->Resize(new_sample_length);
+    }
   }
 }
 
@@ -247,15 +149,13 @@ QList<TimeRange> AudioPlaybackCache::NoLockGetValidRanges(const TimeRange& range
   return valid_ranges;
 }
 
-void AudioPlaybackCache::UpdateFilename(const QString &s)
+MappedPCMPtr AudioPlaybackCache::CreateStorage(const AudioParams &params)
 {
-  filename_ = QDir(FileFunctions::GetMediaCacheLocation()).filePath(s);
-  filename_.append(QStringLiteral(".pcm"));
-}
+  // Stored interleaved since that's what the audio output reads
+  QString filename = QDir(FileFunctions::GetMediaCacheLocation()).filePath(QUuid::createUuid().toRfc4122().toHex());
+  filename.append(QStringLiteral(".pcm"));
 
-const QString &AudioPlaybackCache::GetCacheFilename() const
-{
-  return filename_;
+  return std::make_shared<MappedPCM>(filename, params, MappedPCM::kInterleaved);
 }
 
 OLIVE_NAMESPACE_EXIT
@@ -21,6 +21,7 @@
 #ifndef AUDIOPLAYBACKCACHE_H
 #define AUDIOPLAYBACKCACHE_H
 
+#include "audio/mappedpcm.h"
 #include "common/timerange.h"
 #include "codec/samplebuffer.h"
 #include "render/playbackcache.h"
@@ -44,9 +45,17 @@ public:
 
   void WriteSilence(const TimeRange &range);
 
-  //void SetUuid(const QUuid& id);
-
-  const QString& GetCacheFilename() const;
+  /**
+   * @brief Returns the storage holding this cache's audio
+   *
+   * Readers should hold on to the returned pointer while reading. If the parameters change, the cache starts new
+   * storage rather than changing this one underneath them.
+   */
+  MappedPCMPtr GetPCM()
+  {
+    QMutexLocker locker(lock());
+    return pcm_;
+  }
 
   QList<TimeRange> GetValidRanges(const TimeRange &range, const qint64 &job_time)
   {
@@ -66,9 +75,9 @@ protected:
 private:
   QList<TimeRange> NoLockGetValidRanges(const TimeRange &range, const qint64 &job_time);
 
-  void UpdateFilename(const QString& s);
+  static MappedPCMPtr CreateStorage(const AudioParams& params);
 
-  QString filename_;
+  MappedPCMPtr pcm_;
 
   AudioParams params_;
 
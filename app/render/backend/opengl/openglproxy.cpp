@@ -20,14 +20,19 @@
 
 #include "openglproxy.h"
 
+#include <QOpenGLExtraFunctions>
 #include <QThread>
 
 #include "common/clamp.h"
+#include "common/filefunctions.h"
+#include "common/trace.h"
+#include "config/config.h"
 #include "core.h"
 #include "node/block/transition/transition.h"
 #include "node/node.h"
 #include "openglcolorprocessor.h"
 #include "openglrenderfunctions.h"
+#include "openglsharedtexture.h"
 #include "render/colormanager.h"
 #include "render/pixelformat.h"
 
@@ -55,6 +60,7 @@ void OpenGLProxy::CreateInstance()
   instance_ = new OpenGLProxy();
 
   QThread* proxy_thread = new QThread();
+  proxy_thread->setObjectName(QStringLiteral("OpenGLProxy"));
   proxy_thread->start(QThread::IdlePriority);
   instance_->moveToThread(proxy_thread);
 
@@ -79,6 +85,9 @@ bool OpenGLProxy::Init()
   // Create context object
   ctx_ = new QOpenGLContext();
 
+  // Share with the viewers so they can draw what we render without downloading it first
+  ctx_->setShareContext(QOpenGLContext::globalShareContext());
+
   // Create OpenGL context (automatically destroys any existing if there is one)
   if (!ctx_->create()) {
     qWarning() << "Failed to create OpenGL context in thread" << thread();
@@ -95,6 +104,8 @@ bool OpenGLProxy::Init()
 
 QVariant OpenGLProxy::FrameToValue(FramePtr frame, StreamPtr stream, const VideoParams& params, const RenderMode::Mode& mode)
 {
+  TRACE_SCOPE("gl", "Upload");
+
   ImageStreamPtr video_stream = std::static_pointer_cast<ImageStream>(stream);
 
   // Set up OCIO context
@@ -205,6 +216,8 @@ QVariant OpenGLProxy::FrameToValue(FramePtr frame, StreamPtr stream, const Video
 
 QVariant OpenGLProxy::PreCachedFrameToValue(FramePtr frame)
 {
+  TRACE_SCOPE("gl", "UploadCached");
+
   return QVariant::fromValue(texture_cache_.Get(ctx_, frame));
 }
 
@@ -234,10 +247,7 @@ OpenGLShaderPtr OpenGLProxy::ResolveShaderFromCache(const Node *node, const QStr
 
     shader = OpenGLShader::Create();
     if (shader
-        && shader->create()
-        && shader->addShaderFromSourceCode(QOpenGLShader::Fragment, frag_code)
-        && shader->addShaderFromSourceCode(QOpenGLShader::Vertex, vert_code)
-        && shader->link()) {
+        && shader->LinkFromSource(vert_code, frag_code, shader_binary_cache_.get())) {
       shader_cache_.insert(full_shader_id, shader);
     } else {
       qWarning() << "Failed to compile shader for" << node->id();
@@ -250,7 +260,12 @@ OpenGLShaderPtr OpenGLProxy::ResolveShaderFromCache(const Node *node, const QStr
 
 void OpenGLProxy::Close()
 {
+  fence_lock_.lock();
+  released_fences_.clear();
+  fence_lock_.unlock();
+
   shader_cache_.clear();
+  shader_binary_cache_ = nullptr;
   buffer_.Destroy();
   copy_pipeline_ = nullptr;
   functions_ = nullptr;
@@ -263,10 +278,7 @@ QVariant OpenGLProxy::RunNodeAccelerated(const Node *node,
                                          const ShaderJob &job,
                                          const VideoParams& params)
 {
-  // If this node is iterative, we'll pick up which input here
-  GLuint iterative_input = 0;
-  QList<GLuint> textures_to_bind;
-  bool input_textures_have_alpha = false;
+  Q_UNUSED(range)
 
   OpenGLShaderPtr shader = ResolveShaderFromCache(node, job.GetShaderID());
 
@@ -274,6 +286,47 @@ QVariant OpenGLProxy::RunNodeAccelerated(const Node *node,
     return QVariant();
   }
 
+  return RunShaderJob(shader, node, job, params);
+}
+
+QVariant OpenGLProxy::RunFusedAccelerated(const QString &signature,
+                                          const QString &frag_code,
+                                          const ShaderJob &job,
+                                          const VideoParams &params)
+{
+  QString full_shader_id = QStringLiteral("fused:%1").arg(signature);
+  OpenGLShaderPtr shader;
+
+  if (shader_cache_.contains(full_shader_id)) {
+    shader = shader_cache_.value(full_shader_id);
+  } else {
+    shader = OpenGLShader::Create();
+    if (!shader
+        || !shader->LinkFromSource(OpenGLShader::CodeDefaultVertex(), frag_code, shader_binary_cache_.get())) {
+      qWarning() << "Failed to compile fused shader" << signature;
+      shader = nullptr;
+    }
+
+    // Cache failures too so we don't try compiling them again
+    shader_cache_.insert(full_shader_id, shader);
+  }
+
+  if (!shader) {
+    return QVariant();
+  }
+
+  return RunShaderJob(shader, nullptr, job, params);
+}
+
+QVariant OpenGLProxy::RunShaderJob(OpenGLShaderPtr shader, const Node *node, const ShaderJob &job, const VideoParams &params)
+{
+  TRACE_SCOPE("gl", "RunShaderJob");
+
+  // If this node is iterative, we'll pick up which input here
+  GLuint iterative_input = 0;
+  QList<GLuint> textures_to_bind;
+  bool input_textures_have_alpha = false;
+
   shader->bind();
 
   NodeValueMap::const_iterator it;
@@ -286,21 +339,39 @@ QVariant OpenGLProxy::RunNodeAccelerated(const Node *node,
     }
 
     // See if this value corresponds to an input (NOTE: it may not and this may be null)
-    NodeInput* corresponding_input = node->GetInputWithID(it.key());
+    NodeInput* corresponding_input = node ? node->GetInputWithID(it.key()) : nullptr;
 
     // This variable is used in the shader, let's set it
     const QVariant& value = it.value().data();
 
-    NodeParam::DataType data_type = (it.value().type() != NodeParam::kNone)
-        ? it.value().type()
-        : corresponding_input->data_type();
+    NodeParam::DataType data_type;
+
+    if (it.value().type() != NodeParam::kNone) {
+      data_type = it.value().type();
+    } else if (corresponding_input) {
+      data_type = corresponding_input->data_type();
+    } else {
+      continue;
+    }
 
     switch (data_type) {
     case NodeInput::kInt:
       shader->setUniformValue(variable_location, value.toInt());
       break;
     case NodeInput::kFloat:
-      shader->setUniformValue(variable_location, value.toFloat());
+      if (value.userType() == qMetaTypeId< QVector<float> >()) {
+        // Nodes may pass precalculated tables (e.g. kernel weights) as float arrays
+        QVector<float> a = value.value< QVector<float> >();
+
+        shader->setUniformValueArray(variable_location, a.constData(), a.size(), 1);
+
+        int count_location = shader->uniformLocation(QStringLiteral("%1_count").arg(it.key()));
+        if (count_location > -1) {
+          shader->setUniformValue(count_location, a.size());
+        }
+      } else {
+        shader->setUniformValue(variable_location, value.toFloat());
+      }
       break;
     case NodeInput::kVec2:
       if (corresponding_input && corresponding_input->IsArray()) {
@@ -488,6 +559,8 @@ void OpenGLProxy::TextureToBuffer(const QVariant& tex_in,
                                   FramePtr frame,
                                   const QMatrix4x4& matrix)
 {
+  TRACE_SCOPE("gl", "Readback");
+
   OpenGLTextureCache::ReferencePtr texture = tex_in.value<OpenGLTextureCache::ReferencePtr>();
 
   if (!texture) {
@@ -544,6 +617,67 @@ void OpenGLProxy::TextureToBuffer(const QVariant& tex_in,
   buffer_.Detach();
 }
 
+QVariant OpenGLProxy::TextureToShared(const QVariant &tex_in, const VideoParams &params, const QMatrix4x4 &matrix)
+{
+  TRACE_SCOPE("gl", "CopyToShared");
+
+  OpenGLTextureCache::ReferencePtr texture = tex_in.value<OpenGLTextureCache::ReferencePtr>();
+
+  if (!texture) {
+    return QVariant();
+  }
+
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  // Clean up fences of shared textures that have been released since last time
+  fence_lock_.lock();
+  foreach (GLsync fence, released_fences_) {
+    xf->glDeleteSync(fence);
+  }
+  released_fences_.clear();
+  fence_lock_.unlock();
+
+  // Always copy into a texture of our own. The input may be a cached result that we'll keep sampling (and changing
+  // the filtering of) while it's displayed.
+  OpenGLTextureCache::ReferencePtr shared = texture_cache_.Get(ctx_, VideoParams(params.width(),
+                                                                                 params.height(),
+                                                                                 params.time_base(),
+                                                                                 texture->texture()->format(),
+                                                                                 params.divider()));
+
+  functions_->glViewport(0, 0, shared->texture()->width(), shared->texture()->height());
+
+  buffer_.Attach(shared->texture(), true);
+  buffer_.Bind();
+
+  texture->texture()->Bind();
+
+  OpenGLRenderFunctions::Blit(copy_pipeline_, false, matrix);
+
+  texture->texture()->Release();
+
+  buffer_.Release();
+  buffer_.Detach();
+
+  // Displays sample this without mipmaps
+  shared->texture()->Bind();
+  functions_->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  shared->texture()->Release();
+
+  // Other contexts will wait for this before drawing, flushing guarantees it'll actually be signalled
+  GLsync fence = xf->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  functions_->glFlush();
+
+  return QVariant::fromValue(std::make_shared<OpenGLSharedTexture>(shared, fence));
+}
+
+void OpenGLProxy::ReleaseFence(GLsync fence)
+{
+  QMutexLocker locker(&fence_lock_);
+
+  released_fences_.append(fence);
+}
+
 void OpenGLProxy::FinishInit()
 {
   // Make context current on that surface
@@ -558,7 +692,18 @@ void OpenGLProxy::FinishInit()
 
   buffer_.Create(ctx_);
 
-  copy_pipeline_ = OpenGLShader::CreateDefault();
+  // Keep linked shaders between runs so effects don't stall the first time they're used in a session
+  if (OpenGLRenderFunctions::SupportsProgramBinaries(ctx_)) {
+    shader_binary_cache_ = std::unique_ptr<OpenGLShaderBinaryCache>(
+          new OpenGLShaderBinaryCache(FileFunctions::GetShaderCacheLocation(),
+                                      OpenGLRenderFunctions::GetDriverIdentifier(ctx_)));
+  }
+
+  copy_pipeline_ = OpenGLShader::CreateDefault(QString(), QString(), shader_binary_cache_.get());
+
+  // Convert gigabytes to bytes
+  double texture_cache_gigabytes = Config::Current()["TextureCacheSize"].toDouble();
+  texture_cache_.SetBudget(qRound64(texture_cache_gigabytes * 1073741824));
 }
 
 OLIVE_NAMESPACE_EXIT
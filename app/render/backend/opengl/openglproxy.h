@@ -21,6 +21,7 @@
 #ifndef OPENGLPROXY_H
 #define OPENGLPROXY_H
 
+#include <QMutex>
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
 
@@ -28,6 +29,7 @@
 #include "node/value.h"
 #include "openglcolorprocessor.h"
 #include "openglframebuffer.h"
+#include "openglshaderbinarycache.h"
 #include "opengltexturecache.h"
 #include "render/shaderinfo.h"
 
@@ -75,16 +77,44 @@ public:
 
   void Close();
 
+  /**
+   * @brief Queue a fence for deletion
+   *
+   * Fences are deleted the next time the proxy renders a shared texture, so this can be called from any thread.
+   */
+  void ReleaseFence(GLsync fence);
+
 public slots:
   QVariant RunNodeAccelerated(const OLIVE_NAMESPACE::Node *node,
                               const OLIVE_NAMESPACE::TimeRange &range,
                               const OLIVE_NAMESPACE::ShaderJob &job,
                               const OLIVE_NAMESPACE::VideoParams &params);
 
+  /**
+   * @brief Run a job with generated shader code (e.g. several nodes fused into one pass)
+   *
+   * The compiled program is cached by `signature`, which must uniquely identify `frag_code`. Returns a null value if
+   * the code doesn't compile, in which case the caller should fall back to running the nodes individually.
+   */
+  QVariant RunFusedAccelerated(const QString& signature,
+                               const QString& frag_code,
+                               const OLIVE_NAMESPACE::ShaderJob &job,
+                               const OLIVE_NAMESPACE::VideoParams &params);
+
   void TextureToBuffer(const QVariant& texture,
                        OLIVE_NAMESPACE::FramePtr frame,
                        const QMatrix4x4& matrix);
 
+  /**
+   * @brief Render a texture for drawing directly in another context, avoiding a round trip through system memory
+   *
+   * Returns an OpenGLSharedTexturePtr the size of `params` in its own texture (so nothing else in the proxy writes to
+   * it while it's being displayed) or a null value if there's nothing to render.
+   */
+  QVariant TextureToShared(const QVariant& texture,
+                           const OLIVE_NAMESPACE::VideoParams& params,
+                           const QMatrix4x4& matrix);
+
   QVariant FrameToValue(OLIVE_NAMESPACE::FramePtr frame,
                         OLIVE_NAMESPACE::StreamPtr stream,
                         const OLIVE_NAMESPACE::VideoParams &params,
@@ -95,6 +125,8 @@ public slots:
 private:
   OpenGLShaderPtr ResolveShaderFromCache(const Node* node, const QString &shader_id);
 
+  QVariant RunShaderJob(OpenGLShaderPtr shader, const Node* node, const ShaderJob& job, const VideoParams& params);
+
   QOpenGLContext* ctx_;
   QOffscreenSurface surface_;
 
@@ -108,8 +140,14 @@ private:
 
   QHash<QString, OpenGLShaderPtr> shader_cache_;
 
+  std::unique_ptr<OpenGLShaderBinaryCache> shader_binary_cache_;
+
   OpenGLTextureCache texture_cache_;
 
+  QMutex fence_lock_;
+
+  QVector<GLsync> released_fences_;
+
   static OpenGLProxy* instance_;
 
 private slots:
@@ -23,6 +23,7 @@
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLVertexArrayObject>
 #include <QOpenGLBuffer>
+#include <QStringList>
 
 OLIVE_NAMESPACE_ENTER
 
@@ -229,4 +230,42 @@ void OpenGLRenderFunctions::OCIOBlit(OpenGLShader *pipeline,
   xf->glActiveTexture(GL_TEXTURE0);
 }
 
+QString OpenGLRenderFunctions::GetDriverIdentifier(QOpenGLContext *ctx)
+{
+  QOpenGLFunctions* f = ctx->functions();
+
+  QStringList parts;
+
+  parts.append(QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_VENDOR))));
+  parts.append(QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_RENDERER))));
+  parts.append(QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_VERSION))));
+  parts.append(QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_SHADING_LANGUAGE_VERSION))));
+
+  return parts.join('\n');
+}
+
+bool OpenGLRenderFunctions::SupportsProgramBinaries(QOpenGLContext *ctx)
+{
+  // Core since OpenGL 4.1 and OpenGL ES 3.0, otherwise provided by an extension
+  QPair<int, int> version = ctx->format().version();
+
+  bool has_functions;
+
+  if (ctx->isOpenGLES()) {
+    has_functions = (version >= qMakePair(3, 0));
+  } else {
+    has_functions = (version >= qMakePair(4, 1) || ctx->hasExtension("GL_ARB_get_program_binary"));
+  }
+
+  if (!has_functions) {
+    return false;
+  }
+
+  // Some drivers provide the functions but no formats to use with them
+  GLint format_count = 0;
+  ctx->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+
+  return format_count > 0;
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -63,6 +63,16 @@ public:
 
   static GLenum GetPixelType(const PixelFormat::Format& format);
 
+  /**
+   * @brief Describes the driver behind `ctx`, anything it compiles is only guaranteed to work with the same one
+   */
+  static QString GetDriverIdentifier(QOpenGLContext* ctx);
+
+  /**
+   * @brief Returns whether `ctx` can retrieve and load linked program binaries
+   */
+  static bool SupportsProgramBinaries(QOpenGLContext* ctx);
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -20,7 +20,9 @@
 
 #include "openglshader.h"
 
+#include <QDebug>
 #include <QOpenGLExtraFunctions>
+
 OLIVE_NAMESPACE_ENTER
 
 OpenGLShaderPtr OpenGLShader::Create()
@@ -28,18 +30,73 @@ OpenGLShaderPtr OpenGLShader::Create()
   return std::make_shared<OpenGLShader>();
 }
 
-OpenGLShaderPtr OpenGLShader::CreateDefault(const QString &function_name, const QString &shader_code)
+OpenGLShaderPtr OpenGLShader::CreateDefault(const QString &function_name, const QString &shader_code, OpenGLShaderBinaryCache *binary_cache)
 {
   OpenGLShaderPtr program = Create();
 
-  // Add shaders to program
-  program->addShaderFromSourceCode(QOpenGLShader::Vertex, CodeDefaultVertex());
-  program->addShaderFromSourceCode(QOpenGLShader::Fragment, CodeDefaultFragment(function_name, shader_code));
-  program->link();
+  program->LinkFromSource(CodeDefaultVertex(), CodeDefaultFragment(function_name, shader_code), binary_cache);
 
   return program;
 }
 
+bool OpenGLShader::LinkFromSource(const QString &vert_code, const QString &frag_code, OpenGLShaderBinaryCache *binary_cache)
+{
+  if (!create()) {
+    return false;
+  }
+
+  QOpenGLExtraFunctions* xf = QOpenGLContext::currentContext()->extraFunctions();
+
+  QString key;
+
+  if (binary_cache) {
+    key = binary_cache->GetKey(vert_code, frag_code);
+
+    quint32 format;
+    QByteArray binary;
+
+    if (binary_cache->Load(key, &format, &binary)) {
+      xf->glProgramBinary(programId(), format, binary.constData(), binary.size());
+
+      // With no shaders added, link() just checks whether the binary loaded
+      if (link()) {
+        return true;
+      }
+
+      // Usually means the driver was updated in a way our identifier didn't catch
+      qWarning() << "Driver rejected cached shader binary, compiling from source";
+      binary_cache->Remove(key);
+    }
+
+    xf->glProgramParameteri(programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
+  if (!addShaderFromSourceCode(QOpenGLShader::Vertex, vert_code)
+      || !addShaderFromSourceCode(QOpenGLShader::Fragment, frag_code)
+      || !link()) {
+    return false;
+  }
+
+  if (binary_cache) {
+    GLint length = 0;
+    xf->glGetProgramiv(programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+
+    if (length > 0) {
+      QByteArray binary(length, Qt::Uninitialized);
+      GLenum format;
+
+      xf->glGetProgramBinary(programId(), length, &length, &format, binary.data());
+      binary.resize(length);
+
+      if (!binary.isEmpty() && !binary_cache->Save(key, format, binary)) {
+        qWarning() << "Failed to store shader binary in" << binary_cache->directory();
+      }
+    }
+  }
+
+  return true;
+}
+
 // copied from source code to OCIODisplay
 const int OCIO_LUT3D_EDGE_SIZE = 64;
 
@@ -28,6 +28,7 @@
 namespace OCIO = OCIO_NAMESPACE::v1;
 
 #include "common/define.h"
+#include "openglshaderbinarycache.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -44,13 +45,23 @@ public:
   static OpenGLShaderPtr Create();
 
   static OpenGLShaderPtr CreateDefault(const QString &function_name = QString(),
-                                       const QString &shader_code = QString());
+                                       const QString &shader_code = QString(),
+                                       OpenGLShaderBinaryCache* binary_cache = nullptr);
 
   static OpenGLShaderPtr CreateOCIO(QOpenGLContext* ctx,
                                     GLuint& lut_texture,
                                     OCIO::ConstProcessorRcPtr processor,
                                     bool alpha_is_associated);
 
+  /**
+   * @brief Create and link this program from source, or from a binary in `binary_cache` if it has one
+   *
+   * After compiling from source, the linked binary is stored in `binary_cache` for next time. If the driver won't load
+   * a stored binary, it's deleted and the source is compiled instead. `binary_cache` may be nullptr, and must be if
+   * the current context doesn't support program binaries (see OpenGLRenderFunctions::SupportsProgramBinaries()).
+   */
+  bool LinkFromSource(const QString& vert_code, const QString& frag_code, OpenGLShaderBinaryCache* binary_cache);
+
   static QString CodeDefaultFragment(const QString &function_name = QString(),
                                      const QString &shader_code = QString());
   static QString CodeDefaultVertex();
@@ -0,0 +1,116 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "openglshaderbinarycache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+OLIVE_NAMESPACE_ENTER
+
+// "OSBC"
+const quint32 OpenGLShaderBinaryCache::kMagic = 0x4F534243;
+const quint32 OpenGLShaderBinaryCache::kVersion = 1;
+
+OpenGLShaderBinaryCache::OpenGLShaderBinaryCache(const QString &directory, const QString &driver_id) :
+  directory_(directory),
+  driver_id_(driver_id)
+{
+}
+
+QString OpenGLShaderBinaryCache::GetKey(const QString &vert_code, const QString &frag_code) const
+{
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+
+  hash.addData(driver_id_.toUtf8());
+
+  // Separate each part so moving text from one to the next can't produce the same key
+  hash.addData("\0", 1);
+  hash.addData(vert_code.toUtf8());
+  hash.addData("\0", 1);
+  hash.addData(frag_code.toUtf8());
+
+  return QString(hash.result().toHex());
+}
+
+bool OpenGLShaderBinaryCache::Load(const QString &key, quint32 *format, QByteArray *binary) const
+{
+  QFile file(GetFilename(key));
+
+  if (!file.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream ds(&file);
+
+  quint32 magic, version;
+  QString file_key, file_driver;
+  QByteArray checksum;
+
+  ds >> magic >> version;
+
+  if (ds.status() != QDataStream::Ok || magic != kMagic || version != kVersion) {
+    return false;
+  }
+
+  ds >> file_key >> file_driver >> *format >> *binary >> checksum;
+
+  return ds.status() == QDataStream::Ok
+      && file_key == key
+      && file_driver == driver_id_
+      && !binary->isEmpty()
+      && checksum == QCryptographicHash::hash(*binary, QCryptographicHash::Sha1);
+}
+
+bool OpenGLShaderBinaryCache::Save(const QString &key, quint32 format, const QByteArray &binary) const
+{
+  if (!QDir(directory_).mkpath(QStringLiteral("."))) {
+    return false;
+  }
+
+  // Written to a temporary file first so another process never sees half of it
+  QSaveFile file(GetFilename(key));
+
+  if (!file.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream ds(&file);
+
+  ds << kMagic << kVersion << key << driver_id_ << format << binary
+     << QCryptographicHash::hash(binary, QCryptographicHash::Sha1);
+
+  return ds.status() == QDataStream::Ok && file.commit();
+}
+
+void OpenGLShaderBinaryCache::Remove(const QString &key) const
+{
+  QFile::remove(GetFilename(key));
+}
+
+QString OpenGLShaderBinaryCache::GetFilename(const QString &key) const
+{
+  return QDir(directory_).filePath(key);
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,90 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OPENGLSHADERBINARYCACHE_H
+#define OPENGLSHADERBINARYCACHE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "common/define.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief Stores linked shader program binaries on disk so later runs can skip compiling them
+ *
+ * Binaries are only valid for the driver that produced them, so each is stored under a key made from both the
+ * program's source and an identifier for the driver (see OpenGLRenderFunctions::GetDriverIdentifier()). Files also
+ * record the driver and a checksum so anything that doesn't match exactly is treated as missing.
+ *
+ * This class only deals with files and makes no OpenGL calls, see OpenGLShader::LinkFromSource() for how binaries are
+ * retrieved and loaded.
+ */
+class OpenGLShaderBinaryCache
+{
+public:
+  OpenGLShaderBinaryCache(const QString& directory, const QString& driver_id);
+
+  /**
+   * @brief Key identifying a program with this source built by this cache's driver
+   */
+  QString GetKey(const QString& vert_code, const QString& frag_code) const;
+
+  /**
+   * @brief Load a binary stored under `key`
+   *
+   * Returns false if there isn't one or it's unreadable, corrupt or from a different driver.
+   */
+  bool Load(const QString& key, quint32* format, QByteArray* binary) const;
+
+  bool Save(const QString& key, quint32 format, const QByteArray& binary) const;
+
+  /**
+   * @brief Delete a binary, e.g. one the driver refused to load
+   */
+  void Remove(const QString& key) const;
+
+  const QString& directory() const
+  {
+    return directory_;
+  }
+
+  const QString& driver_id() const
+  {
+    return driver_id_;
+  }
+
+private:
+  QString GetFilename(const QString& key) const;
+
+  static const quint32 kMagic;
+
+  static const quint32 kVersion;
+
+  QString directory_;
+
+  QString driver_id_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+#endif // OPENGLSHADERBINARYCACHE_H
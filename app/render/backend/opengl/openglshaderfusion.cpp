@@ -0,0 +1,254 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "openglshaderfusion.h"
+
+#include <QMutex>
+#include <QRegularExpression>
+
+OLIVE_NAMESPACE_ENTER
+
+namespace {
+
+// Provided by the renderer to every shader, so they're shared between stages rather than namespaced
+const QStringList kSharedUniforms = {QStringLiteral("ove_resolution"), QStringLiteral("ove_iteration")};
+
+QHash<QString, ShaderCode> code_cache;
+QMutex code_cache_lock;
+
+}
+
+int OpenGLShaderFusion::Build(OpenGLFusedStagePtr root)
+{
+  stages_.clear();
+  stage_code_.clear();
+  signature_.clear();
+  job_ = ShaderJob();
+
+  if (BuildStage(root) < 0) {
+    return 0;
+  }
+
+  return stages_.size();
+}
+
+QString OpenGLShaderFusion::frag_code() const
+{
+  QString code = QStringLiteral("#version 150\n"
+                                "\n"
+                                "uniform vec2 ove_resolution;\n"
+                                "uniform int ove_iteration;\n"
+                                "\n"
+                                "in vec2 ove_texcoord;\n"
+                                "\n"
+                                "out vec4 fragColor;\n"
+                                "\n");
+
+  foreach (const QString& stage, stage_code_) {
+    code.append(stage);
+    code.append('\n');
+  }
+
+  code.append(QStringLiteral("void main(void) {\n"));
+
+  for (int i=0; i<stage_code_.size(); i++) {
+    code.append(QStringLiteral("    s%1_main();\n").arg(i));
+  }
+
+  code.append(QStringLiteral("    fragColor = s%1_fragColor;\n"
+                             "}\n").arg(stage_code_.size() - 1));
+
+  return code;
+}
+
+bool OpenGLShaderFusion::IsFusable(const ShaderJob &job, const ShaderCode &code)
+{
+  // Multi-pass jobs and jobs that move geometry around can't be evaluated per pixel
+  if (job.GetIterationCount() > 1 || !code.vert_code().isEmpty() || code.frag_code().isEmpty()) {
+    return false;
+  }
+
+  // Array uniforms are resolved through their node input, which a fused job doesn't have
+  foreach (const NodeValue& v, job.GetValues()) {
+    if (v.data().userType() == qMetaTypeId< QVector<NodeValue> >()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool OpenGLShaderFusion::IsUnrenderedStage(const QVariant &v)
+{
+  return v.userType() == qMetaTypeId<OpenGLFusedStagePtr>()
+      && v.value<OpenGLFusedStagePtr>()->result.isNull();
+}
+
+int OpenGLShaderFusion::BuildStage(OpenGLFusedStagePtr stage)
+{
+  int existing = stages_.indexOf(stage);
+  if (existing >= 0) {
+    return existing;
+  }
+
+  ShaderCode code = GetCode(stage->node, stage->job.GetShaderID());
+
+  if (!IsFusable(stage->job, code)) {
+    return -1;
+  }
+
+  // Inline any input that was produced by another stage and is only sampled at this pixel
+  QHash<QString, int> inlined;
+  QStringList inlined_signature;
+
+  NodeValueMap::const_iterator it;
+  for (it=stage->job.GetValues().constBegin(); it!=stage->job.GetValues().constEnd(); it++) {
+    if (IsUnrenderedStage(it.value().data()) && SamplesOnlyAtOwnCoordinate(code.frag_code(), it.key())) {
+      int input_index = BuildStage(it.value().data().value<OpenGLFusedStagePtr>());
+
+      if (input_index >= 0) {
+        inlined.insert(it.key(), input_index);
+        inlined_signature.append(QStringLiteral("%1=%2").arg(it.key(), QString::number(input_index)));
+      }
+    }
+  }
+
+  int index = stages_.size();
+  QString prefix = QStringLiteral("s%1_").arg(index);
+
+  stages_.append(stage);
+  stage_code_.append(TransformStage(code.frag_code(), prefix, inlined));
+
+  // Everything that affects the generated code goes into the signature
+  inlined_signature.sort();
+  signature_.append(QStringLiteral("%1:%2(%3);").arg(stage->node->id(),
+                                                     stage->job.GetShaderID(),
+                                                     inlined_signature.join(',')));
+
+  for (it=stage->job.GetValues().constBegin(); it!=stage->job.GetValues().constEnd(); it++) {
+    if (!inlined.contains(it.key())) {
+      job_.InsertValue(prefix + it.key(), it.value());
+    }
+  }
+
+  if (stage->job.GetAlphaChannelRequired()) {
+    job_.SetAlphaChannelRequired(true);
+  }
+
+  return index;
+}
+
+ShaderCode OpenGLShaderFusion::GetCode(const Node *node, const QString &shader_id)
+{
+  // Some nodes read their code from disk, so keep it around rather than loading it every frame
+  QString key = QStringLiteral("%1:%2").arg(node->id(), shader_id);
+
+  QMutexLocker locker(&code_cache_lock);
+
+  QHash<QString, ShaderCode>::const_iterator cached = code_cache.constFind(key);
+  if (cached != code_cache.constEnd()) {
+    return *cached;
+  }
+
+  ShaderCode code = node->GetShaderCode(shader_id);
+  code_cache.insert(key, code);
+
+  return code;
+}
+
+bool OpenGLShaderFusion::SamplesOnlyAtOwnCoordinate(const QString &code, const QString &input)
+{
+  QString escaped = QRegularExpression::escape(input);
+
+  QString stripped = code;
+  stripped.remove(QRegularExpression(QStringLiteral("uniform\\s+\\w+\\s+%1(_enabled)?\\s*;").arg(escaped)));
+  stripped.remove(QRegularExpression(QStringLiteral("texture\\s*\\(\\s*%1\\s*,\\s*ove_texcoord\\s*\\)").arg(escaped)));
+  stripped.remove(QRegularExpression(QStringLiteral("\\b%1_enabled\\b").arg(escaped)));
+
+  // If the input is still referenced, it's sampled somewhere else or used in some other way
+  return !stripped.contains(QRegularExpression(QStringLiteral("\\b%1(_resolution)?\\b").arg(escaped)));
+}
+
+QString OpenGLShaderFusion::TransformStage(QString code, const QString &prefix, const QHash<QString, int> &inlined)
+{
+  // Declarations provided once by the fused program
+  code.remove(QRegularExpression(QStringLiteral("^\\s*#version[^\\n]*"), QRegularExpression::MultilineOption));
+  code.remove(QRegularExpression(QStringLiteral("^\\s*(in|out)\\s+\\w+\\s+\\w+\\s*;"), QRegularExpression::MultilineOption));
+  foreach (const QString& shared, kSharedUniforms) {
+    code.remove(QRegularExpression(QStringLiteral("uniform\\s+\\w+\\s+%1\\s*;").arg(shared)));
+  }
+
+  // Replace inlined inputs with a placeholder for the output of the stage that produces them
+  QHash<QString, int>::const_iterator i;
+  for (i=inlined.constBegin(); i!=inlined.constEnd(); i++) {
+    QString escaped = QRegularExpression::escape(i.key());
+    QString placeholder = QStringLiteral("OVE_FUSED_INPUT_%1").arg(i.value());
+
+    code.remove(QRegularExpression(QStringLiteral("uniform\\s+\\w+\\s+%1(_enabled)?\\s*;").arg(escaped)));
+    code.replace(QRegularExpression(QStringLiteral("texture\\s*\\(\\s*%1\\s*,\\s*ove_texcoord\\s*\\)").arg(escaped)),
+                 placeholder);
+    code.replace(QRegularExpression(QStringLiteral("\\b%1_enabled\\b").arg(escaped)), QStringLiteral("true"));
+  }
+
+  // Collect every global name this stage declares
+  QStringList names = {QStringLiteral("fragColor")};
+
+  QList<QRegularExpression> declarations = {
+    // Uniforms, including arrays declared either way (`vec2[4] a` or `vec2 a[4]`)
+    QRegularExpression(QStringLiteral("uniform\\s+\\w+(\\s*\\[[^\\]]*\\])?\\s+(?<name>\\w+)")),
+
+    // Global variables and constants
+    QRegularExpression(QStringLiteral("^(const\\s+)?\\w+\\s+(?<name>\\w+)\\s*(=|;|\\[)"), QRegularExpression::MultilineOption),
+
+    // Functions
+    QRegularExpression(QStringLiteral("^\\w+\\s+(?<name>\\w+)\\s*\\("), QRegularExpression::MultilineOption),
+
+    // Macros
+    QRegularExpression(QStringLiteral("^\\s*#define\\s+(?<name>\\w+)"), QRegularExpression::MultilineOption)
+  };
+
+  foreach (const QRegularExpression& r, declarations) {
+    QRegularExpressionMatchIterator matches = r.globalMatch(code);
+
+    while (matches.hasNext()) {
+      QString name = matches.next().captured(QStringLiteral("name"));
+
+      if (!names.contains(name)) {
+        names.append(name);
+      }
+    }
+  }
+
+  // Our output is a global rather than the shader output
+  code.prepend(QStringLiteral("vec4 fragColor;\n"));
+
+  // Namespace all of them
+  QRegularExpression name_regex(QStringLiteral("\\b(%1)\\b").arg(names.join('|')));
+  code.replace(name_regex, QStringLiteral("%1\\1").arg(prefix));
+
+  // Connect inlined inputs
+  for (i=inlined.constBegin(); i!=inlined.constEnd(); i++) {
+    code.replace(QStringLiteral("OVE_FUSED_INPUT_%1").arg(i.value()), QStringLiteral("s%1_fragColor").arg(i.value()));
+  }
+
+  return code;
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,133 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OPENGLSHADERFUSION_H
+#define OPENGLSHADERFUSION_H
+
+#include <memory>
+#include <QHash>
+
+#include "common/timerange.h"
+#include "node/node.h"
+#include "render/shaderinfo.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief A shader job that hasn't been run yet
+ *
+ * OpenGLWorker returns these instead of textures for single pass jobs so that a consumer sampling them only at its
+ * own coordinate can compute them inline rather than reading back a full-frame intermediate texture.
+ */
+struct OpenGLFusedStage {
+  const Node* node;
+  TimeRange range;
+  ShaderJob job;
+
+  // Set once this stage has been rendered so it never runs twice
+  QVariant result;
+};
+
+using OpenGLFusedStagePtr = std::shared_ptr<OpenGLFusedStage>;
+
+/**
+ * @brief Generates one fragment shader from a tree of OpenGLFusedStages
+ *
+ * Each stage's code is namespaced with a stage prefix (uniforms, functions, macros and its output), its main()
+ * becomes a function called in dependency order and every `texture(input, ove_texcoord)` of an input produced by
+ * another stage is replaced by that stage's output. Inputs sampled any other way (i.e. anything that reads
+ * neighboring pixels) are left as real textures.
+ *
+ * Fusing only gives the same result as rendering each stage on its own if nothing is lost between stages. The worker
+ * therefore only defers stages whose output texture would keep its alpha channel, since a texture without one
+ * discards the alpha the stage computed. Intermediate values also skip rounding to the working pixel format, so
+ * fused results can differ from unfused ones within that format's precision.
+ */
+class OpenGLShaderFusion
+{
+public:
+  OpenGLShaderFusion() = default;
+
+  /**
+   * @brief Build a program for the tree with this root, returns the number of stages fused into it
+   *
+   * Values of the resulting job that still hold unrendered stages must be rendered before running it.
+   */
+  int Build(OpenGLFusedStagePtr root);
+
+  const QString& signature() const
+  {
+    return signature_;
+  }
+
+  QString frag_code() const;
+
+  const ShaderJob& job() const
+  {
+    return job_;
+  }
+
+  ShaderJob& job()
+  {
+    return job_;
+  }
+
+  /**
+   * @brief Returns the stages that were fused, in the order they're evaluated
+   */
+  const QVector<OpenGLFusedStagePtr>& stages() const
+  {
+    return stages_;
+  }
+
+  /**
+   * @brief Returns whether this job could ever be fused with another
+   */
+  static bool IsFusable(const ShaderJob& job, const ShaderCode& code);
+
+  static bool IsUnrenderedStage(const QVariant& v);
+
+  /**
+   * @brief Cached equivalent of Node::GetShaderCode()
+   */
+  static ShaderCode GetCode(const Node* node, const QString& shader_id);
+
+private:
+  int BuildStage(OpenGLFusedStagePtr stage);
+
+  static bool SamplesOnlyAtOwnCoordinate(const QString& code, const QString& input);
+
+  static QString TransformStage(QString code, const QString &prefix, const QHash<QString, int> &inlined);
+
+  QVector<OpenGLFusedStagePtr> stages_;
+
+  QStringList stage_code_;
+
+  QString signature_;
+
+  ShaderJob job_;
+
+};
+
+OLIVE_NAMESPACE_EXIT
+
+Q_DECLARE_METATYPE(OLIVE_NAMESPACE::OpenGLFusedStagePtr)
+
+#endif // OPENGLSHADERFUSION_H
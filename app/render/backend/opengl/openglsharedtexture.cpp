@@ -0,0 +1,46 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "openglsharedtexture.h"
+
+#include "openglproxy.h"
+
+OLIVE_NAMESPACE_ENTER
+
+OpenGLSharedTexture::OpenGLSharedTexture(OpenGLTextureCache::ReferencePtr texture, GLsync fence) :
+  texture_(texture),
+  fence_(fence)
+{
+}
+
+OpenGLSharedTexture::~OpenGLSharedTexture()
+{
+  // We may not have a context here, so the proxy deletes the fence the next time it can
+  if (OpenGLProxy::instance()) {
+    OpenGLProxy::instance()->ReleaseFence(fence_);
+  }
+}
+
+void OpenGLSharedTexture::WaitForRender(QOpenGLContext *ctx) const
+{
+  ctx->extraFunctions()->glWaitSync(fence_, 0, GL_TIMEOUT_IGNORED);
+}
+
+OLIVE_NAMESPACE_EXIT
@@ -0,0 +1,75 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OPENGLSHAREDTEXTURE_H
+#define OPENGLSHAREDTEXTURE_H
+
+#include <QOpenGLExtraFunctions>
+
+#include "opengltexturecache.h"
+
+OLIVE_NAMESPACE_ENTER
+
+/**
+ * @brief A texture rendered by OpenGLProxy that can be drawn directly by any other context in its share group
+ *
+ * The proxy renders asynchronously, so the texture is accompanied by a fence that consumers must wait on (see
+ * WaitForRender()) before drawing it. The texture is held until this object is destroyed.
+ */
+class OpenGLSharedTexture
+{
+public:
+  OpenGLSharedTexture(OpenGLTextureCache::ReferencePtr texture, GLsync fence);
+
+  ~OpenGLSharedTexture();
+
+  DISABLE_COPY_MOVE(OpenGLSharedTexture)
+
+  OpenGLTexturePtr texture() const
+  {
+    return texture_->texture();
+  }
+
+  const OpenGLTextureCache::ReferencePtr& reference() const
+  {
+    return texture_;
+  }
+
+  /**
+   * @brief Make the context current in this thread wait until the texture has finished rendering
+   *
+   * This waits on the GPU rather than blocking the calling thread.
+   */
+  void WaitForRender(QOpenGLContext* ctx) const;
+
+private:
+  OpenGLTextureCache::ReferencePtr texture_;
+
+  GLsync fence_;
+
+};
+
+using OpenGLSharedTexturePtr = std::shared_ptr<OpenGLSharedTexture>;
+
+OLIVE_NAMESPACE_EXIT
+
+Q_DECLARE_METATYPE(OLIVE_NAMESPACE::OpenGLSharedTexturePtr)
+
+#endif // OPENGLSHAREDTEXTURE_H
@@ -20,8 +20,32 @@
 
 #include "opengltexturecache.h"
 
+#include <iterator>
+
 OLIVE_NAMESPACE_ENTER
 
+const qint64 OpenGLTextureCache::kDefaultBudget = Q_INT64_C(1073741824);
+
+OpenGLTexturePtr OpenGLTextureAllocator::Allocate(QOpenGLContext *ctx, const VideoParams &params)
+{
+  OpenGLTexturePtr texture = std::make_shared<OpenGLTexture>();
+  texture->Create(ctx, params);
+  return texture;
+}
+
+namespace {
+
+OpenGLTextureAllocator default_allocator;
+
+}
+
+OpenGLTextureCache::OpenGLTextureCache(OpenGLTextureAllocator *allocator) :
+  allocator_(allocator ? allocator : &default_allocator),
+  budget_(kDefaultBudget),
+  stats_()
+{
+}
+
 OpenGLTextureCache::~OpenGLTextureCache()
 {
   foreach (Reference* ref, existing_references_) {
@@ -43,29 +67,38 @@ OpenGLTextureCache::ReferencePtr OpenGLTextureCache::Get(QOpenGLContext* ctx, co
 {
   OpenGLTexturePtr texture = nullptr;
 
+  Key key = {params.effective_width(), params.effective_height(), params.format()};
+
   lock_.lock();
 
-  // Iterate through textures and see if we have one that matches these parameters
-  for (int i=0;i<available_textures_.size();i++) {
-    OpenGLTexturePtr test = available_textures_.at(i);
+  auto bucket = idle_by_key_.find(key);
 
-    if (test->width() == params.effective_width()
-        && test->height() == params.effective_height()
-        && test->format() == params.format()) {
-      texture = test;
-      available_textures_.removeAt(i);
-      break;
+  if (bucket != idle_by_key_.end()) {
+    // Take the most recently used, it's the least likely to have been paged out of VRAM
+    std::list<IdleTexture>::iterator idle = bucket->takeLast();
+
+    if (bucket->isEmpty()) {
+      idle_by_key_.erase(bucket);
     }
-  }
 
-  // If we didn't find a texture, we'll need to create one
-  if (!texture) {
-    texture = std::make_shared<OpenGLTexture>();
-    texture->Create(ctx, params);
+    texture = idle->texture;
+    idle_textures_.erase(idle);
+
+    stats_.hits++;
+  } else {
+    qint64 size = GetTextureSize(key);
+
+    // Make room first so the total stays within budget wherever idle textures allow it
+    EvictIdle(budget_ - size);
+
+    texture = allocator_->Allocate(ctx, params);
+    stats_.allocated_bytes += size;
+
+    stats_.misses++;
   }
 
-  ReferencePtr ref = std::make_shared<Reference>(this, texture);
-  existing_references_.append(ref.get());
+  ReferencePtr ref = std::make_shared<Reference>(this, texture, key);
+  existing_references_.insert(ref.get());
 
   lock_.unlock();
 
@@ -81,21 +114,65 @@ OpenGLTextureCache::ReferencePtr OpenGLTextureCache::Get(QOpenGLContext *ctx, co
   return Get(ctx, params, nullptr, 0);
 }
 
+void OpenGLTextureCache::SetBudget(qint64 bytes)
+{
+  QMutexLocker locker(&lock_);
+
+  budget_ = bytes;
+}
+
+OpenGLTextureCache::Stats OpenGLTextureCache::GetStats()
+{
+  QMutexLocker locker(&lock_);
+
+  return stats_;
+}
+
+qint64 OpenGLTextureCache::GetTextureSize(const Key &key)
+{
+  return PixelFormat::GetBufferSize(key.format, key.width, key.height);
+}
+
+void OpenGLTextureCache::EvictIdle(qint64 target)
+{
+  while (stats_.allocated_bytes > target && !idle_textures_.empty()) {
+    const IdleTexture& oldest = idle_textures_.front();
+
+    // Textures go idle in the same order in both lists, so this is also the oldest of its key
+    auto bucket = idle_by_key_.find(oldest.key);
+    bucket->removeFirst();
+
+    if (bucket->isEmpty()) {
+      idle_by_key_.erase(bucket);
+    }
+
+    stats_.allocated_bytes -= GetTextureSize(oldest.key);
+    stats_.evictions++;
+
+    // Destroys the texture, unless something outside the cache is still holding on to it
+    idle_textures_.pop_front();
+  }
+}
+
 void OpenGLTextureCache::Relinquish(OpenGLTextureCache::Reference *ref)
 {
   OpenGLTexturePtr tex = ref->texture();
 
   lock_.lock();
 
-  existing_references_.removeOne(ref);
-  available_textures_.append(tex);
+  existing_references_.remove(ref);
+
+  // Only put aside here, this may be called from a thread without the context current so eviction waits for Get()
+  idle_textures_.push_back({tex, ref->key()});
+  idle_by_key_[ref->key()].append(std::prev(idle_textures_.end()));
 
   lock_.unlock();
 }
 
-OpenGLTextureCache::Reference::Reference(OpenGLTextureCache *parent, OpenGLTexturePtr texture) :
+OpenGLTextureCache::Reference::Reference(OpenGLTextureCache *parent, OpenGLTexturePtr texture, const Key& key) :
   parent_(parent),
-  texture_(texture)
+  texture_(texture),
+  key_(key)
 {
 }
 
@@ -21,7 +21,10 @@
 #ifndef OPENGLTEXTURECACHE_H
 #define OPENGLTEXTURECACHE_H
 
+#include <list>
+#include <QHash>
 #include <QMutex>
+#include <QSet>
 
 #include "openglframebuffer.h"
 #include "opengltexture.h"
@@ -29,29 +32,84 @@
 
 OLIVE_NAMESPACE_ENTER
 
+/**
+ * @brief Creates the textures an OpenGLTextureCache hands out
+ *
+ * The default creates real OpenGL textures. A subclass can be substituted to exercise the cache without a GPU, e.g.
+ * by returning textures that were never created.
+ */
+class OpenGLTextureAllocator
+{
+public:
+  virtual ~OpenGLTextureAllocator() = default;
+
+  virtual OpenGLTexturePtr Allocate(QOpenGLContext* ctx, const VideoParams& params);
+
+};
+
+/**
+ * @brief Recycles textures between renders
+ *
+ * Textures no longer referenced are kept idle, bucketed by size and format so a matching one is found in constant
+ * time. Idle textures are destroyed least recently used first whenever the total size of all textures the cache has
+ * created would otherwise go over its budget. Textures in use are never destroyed, so the budget can be exceeded if
+ * enough are referenced at once.
+ */
 class OpenGLTextureCache
 {
 public:
+  struct Key {
+    int width;
+    int height;
+    PixelFormat::Format format;
+
+    bool operator==(const Key& rhs) const
+    {
+      return width == rhs.width && height == rhs.height && format == rhs.format;
+    }
+  };
+
   class Reference {
   public:
-    Reference(OpenGLTextureCache* parent, OpenGLTexturePtr texture);
+    Reference(OpenGLTextureCache* parent, OpenGLTexturePtr texture, const Key& key);
     ~Reference();
 
     DISABLE_COPY_MOVE(Reference)
 
     OpenGLTexturePtr texture();
 
+    const Key& key() const
+    {
+      return key_;
+    }
+
     void ParentKilled();
 
   private:
     OpenGLTextureCache* parent_;
 
     OpenGLTexturePtr texture_;
+
+    Key key_;
   };
 
   using ReferencePtr = std::shared_ptr<Reference>;
 
-  OpenGLTextureCache() = default;
+  struct Stats {
+    quint64 hits;
+    quint64 misses;
+    quint64 evictions;
+
+    /// Total size of every texture the cache currently owns, in use or idle
+    qint64 allocated_bytes;
+  };
+
+  /**
+   * @brief Create a cache that allocates textures with `allocator`, or real OpenGL textures if it's nullptr
+   *
+   * The cache does not take ownership of the allocator.
+   */
+  OpenGLTextureCache(OpenGLTextureAllocator* allocator = nullptr);
 
   ~OpenGLTextureCache();
 
@@ -62,17 +120,61 @@ public:
   ReferencePtr Get(QOpenGLContext *ctx, const VideoParams& params, const void *data, int linesize);
   ReferencePtr Get(QOpenGLContext *ctx, const VideoParams& params);
 
+  /**
+   * @brief Set the maximum size in bytes of all textures the cache owns
+   *
+   * Idle textures over the budget are destroyed on the next Get() rather than immediately, since destroying them
+   * needs the context current on the calling thread.
+   */
+  void SetBudget(qint64 bytes);
+
+  Stats GetStats();
+
+  /**
+   * @brief Returns the amount of memory in bytes a texture with this key uses
+   */
+  static qint64 GetTextureSize(const Key& key);
+
+  static const qint64 kDefaultBudget;
+
 private:
+  struct IdleTexture {
+    OpenGLTexturePtr texture;
+    Key key;
+  };
+
+  /**
+   * @brief Destroy idle textures, least recently used first, until the cache owns no more than `target` bytes
+   *
+   * Must be called with `lock_` held.
+   */
+  void EvictIdle(qint64 target);
+
   void Relinquish(Reference* ref);
 
   QMutex lock_;
 
-  QList<OpenGLTexturePtr> available_textures_;
+  OpenGLTextureAllocator* allocator_;
 
-  QList<Reference*> existing_references_;
+  // Least recently used at the front
+  std::list<IdleTexture> idle_textures_;
+
+  // Positions in `idle_textures_` of each key's textures, oldest first
+  QHash< Key, QList<std::list<IdleTexture>::iterator> > idle_by_key_;
+
+  QSet<Reference*> existing_references_;
+
+  qint64 budget_;
+
+  Stats stats_;
 
 };
 
+inline uint qHash(const OpenGLTextureCache::Key& key, uint seed = 0)
+{
+  return qHash(key.width, seed) ^ qHash(key.height, seed) * 31 ^ qHash(static_cast<int>(key.format), seed) * 131;
+}
+
 OLIVE_NAMESPACE_EXIT
 
 Q_DECLARE_METATYPE(OLIVE_NAMESPACE::OpenGLTextureCache::ReferencePtr)
@@ -20,27 +20,102 @@
 
 #include "openglworker.h"
 
+#include "common/trace.h"
+#include "openglsharedtexture.h"
+
 OLIVE_NAMESPACE_ENTER
 
 OpenGLWorker::OpenGLWorker(RenderBackend *parent) :
-  RenderWorker(parent)
+  RenderWorker(parent),
+  frame_stats_({0, 0, 0, 0})
 {
 }
 
 void OpenGLWorker::TextureToFrame(const QVariant &texture, FramePtr frame, const QMatrix4x4& mat) const
 {
+  QVariant real_texture = Materialize(texture);
+
+  TRACE_SCOPE("proxy-wait", "TextureToBuffer");
+
   QMetaObject::invokeMethod(OpenGLProxy::instance(),
                             "TextureToBuffer",
                             Qt::BlockingQueuedConnection,
-                            Q_ARG(const QVariant&, texture),
+                            Q_ARG(const QVariant&, real_texture),
                             OLIVE_NS_ARG(FramePtr, frame),
                             Q_ARG(const QMatrix4x4&, mat));
+
+  ReportFrameStatistics();
+}
+
+bool OpenGLWorker::TextureToSharedFrame(const QVariant &texture, FramePtr frame, const QMatrix4x4 &mat) const
+{
+  QVariant real_texture = Materialize(texture);
+  QVariant shared;
+
+  TRACE_SCOPE("proxy-wait", "TextureToShared");
+
+  QMetaObject::invokeMethod(OpenGLProxy::instance(),
+                            "TextureToShared",
+                            Qt::BlockingQueuedConnection,
+                            Q_RETURN_ARG(QVariant, shared),
+                            Q_ARG(const QVariant&, real_texture),
+                            OLIVE_NS_CONST_ARG(VideoParams&, frame->video_params()),
+                            Q_ARG(const QMatrix4x4&, mat));
+
+  ReportFrameStatistics();
+
+  if (shared.isNull()) {
+    return false;
+  }
+
+  // The shared texture is already transformed and sized for this frame, so it can be read back as-is if something
+  // (e.g. the disk cache) needs the pixels
+  QVariant reference = QVariant::fromValue(shared.value<OpenGLSharedTexturePtr>()->reference());
+
+  frame->set_texture(shared, [reference](FramePtr destination) -> bool {
+    // The proxy may have been shut down by the time something asks for this frame's pixels
+    OpenGLProxy* proxy = OpenGLProxy::instance();
+
+    if (!proxy) {
+      return false;
+    }
+
+    TRACE_SCOPE("proxy-wait", "TextureToBuffer");
+
+    QMetaObject::invokeMethod(proxy,
+                              "TextureToBuffer",
+                              Qt::BlockingQueuedConnection,
+                              Q_ARG(const QVariant&, reference),
+                              OLIVE_NS_ARG(FramePtr, destination),
+                              Q_ARG(const QMatrix4x4&, QMatrix4x4()));
+
+    return true;
+  });
+
+  return true;
+}
+
+//#define PRINT_FUSION_INFO
+void OpenGLWorker::ReportFrameStatistics() const
+{
+#ifdef PRINT_FUSION_INFO
+  if (frame_stats_.passes < frame_stats_.unfused_passes) {
+    qDebug() << "Frame rendered in" << frame_stats_.passes << "passes with"
+             << (frame_stats_.bytes / 1048576) << "MiB of texture traffic, would have been"
+             << frame_stats_.unfused_passes << "passes with"
+             << (frame_stats_.unfused_bytes / 1048576) << "MiB without fusion";
+  }
+#endif
+
+  frame_stats_ = {0, 0, 0, 0};
 }
 
 QVariant OpenGLWorker::FootageFrameToTexture(StreamPtr stream, FramePtr frame) const
 {
   QVariant value;
 
+  TRACE_SCOPE("proxy-wait", "FrameToValue");
+
   QMetaObject::invokeMethod(OpenGLProxy::instance(),
                             "FrameToValue",
                             Qt::BlockingQueuedConnection,
@@ -57,6 +132,8 @@ QVariant OpenGLWorker::CachedFrameToTexture(FramePtr frame) const
 {
   QVariant value;
 
+  TRACE_SCOPE("proxy-wait", "PreCachedFrameToValue");
+
   QMetaObject::invokeMethod(OpenGLProxy::instance(),
                             "PreCachedFrameToValue",
                             Qt::BlockingQueuedConnection,
@@ -66,25 +143,222 @@ QVariant OpenGLWorker::CachedFrameToTexture(FramePtr frame) const
   return value;
 }
 
-QVariant OpenGLWorker::ProcessShader(const Node *node, const TimeRange &range, const ShaderJob &job)
+QVariant OpenGLWorker::ProcessShader(const Node *node, const TimeRange &range, const ShaderJob &original_job)
 {
+  ShaderJob job = original_job;
+
+  // Don't composite layers nobody will see
+  if (!job.GetLayers().isEmpty()) {
+    QVariant top_layer;
+
+    if (CullOccludedLayers(&job, &top_layer) == 1) {
+      return top_layer;
+    }
+  }
+
+  // Shader jobs without texture inputs (solids, polygons, etc.) are pure generators and can be reused
+  QVariantList inputs;
+  QByteArray key = HashGeneratorJob(node, job, QStringLiteral("%1:%2").arg(job.GetShaderID(),
+                                                                           QString::number(job.GetIterationCount())).toUtf8(),
+                                    &inputs);
   QVariant value;
 
+  if (GetCachedGeneration(node, key, &value)) {
+    return value;
+  }
+
+  OpenGLFusedStagePtr stage = std::make_shared<OpenGLFusedStage>();
+  stage->node = node;
+  stage->range = range;
+  stage->job = job;
+
+  // A stage rendered to a texture without an alpha channel loses its alpha, which computing it inline wouldn't do,
+  // so only stages that keep their alpha can be deferred
+  if (key.isEmpty()
+      && OpenGLShaderFusion::IsFusable(job, OpenGLShaderFusion::GetCode(node, job.GetShaderID()))
+      && TextureHasAlpha(QVariant::fromValue(stage))) {
+    // Defer this job so whatever consumes it has a chance to compute it inline
+    return QVariant::fromValue(stage);
+  }
+
+  value = RenderStage(stage);
+
+  SetCachedGeneration(node, key, value, inputs);
+
+  return value;
+}
+
+bool OpenGLWorker::TextureHasAlpha(const QVariant &v) const
+{
+  if (v.canConvert<OpenGLFusedStagePtr>()) {
+    OpenGLFusedStagePtr stage = v.value<OpenGLFusedStagePtr>();
+
+    if (!stage->result.isNull()) {
+      return TextureHasAlpha(stage->result);
+    }
+
+    // Determine the format the proxy would choose without rendering anything
+    if (stage->job.GetAlphaChannelRequired()) {
+      return true;
+    }
+
+    foreach (const NodeValue& value, stage->job.GetValues()) {
+      if (value.type() == NodeParam::kTexture
+          && !value.data().isNull()
+          && TextureHasAlpha(value.data())) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  return PixelFormat::FormatHasAlphaChannel(v.value<OpenGLTextureCache::ReferencePtr>()->texture()->format());
+}
+
+const void *OpenGLWorker::TextureIdentity(const QVariant &v) const
+{
+  if (v.canConvert<OpenGLFusedStagePtr>()) {
+    return v.value<OpenGLFusedStagePtr>().get();
+  }
+
+  return v.value<OpenGLTextureCache::ReferencePtr>().get();
+}
+
+qint64 OpenGLWorker::TextureByteSize(const QVariant &v) const
+{
+  if (v.canConvert<OpenGLFusedStagePtr>()) {
+    OpenGLFusedStagePtr stage = v.value<OpenGLFusedStagePtr>();
+
+    // Nothing has been allocated for a stage that hasn't been rendered yet
+    return stage->result.isNull() ? 0 : TextureByteSize(stage->result);
+  }
+
+  OpenGLTextureCache::ReferencePtr ref = v.value<OpenGLTextureCache::ReferencePtr>();
+
+  if (!ref) {
+    return 0;
+  }
+
+  return OpenGLTextureCache::GetTextureSize(ref->key());
+}
+
+QVariant OpenGLWorker::Materialize(const QVariant &v) const
+{
+  if (v.canConvert<OpenGLFusedStagePtr>()) {
+    return RenderStage(v.value<OpenGLFusedStagePtr>());
+  }
+
+  return v;
+}
+
+QVariant OpenGLWorker::RenderStage(OpenGLFusedStagePtr stage) const
+{
+  if (!stage->result.isNull()) {
+    return stage->result;
+  }
+
+  QVariant value;
+
+  OpenGLShaderFusion fusion;
+
+  if (fusion.Build(stage) > 1) {
+    ShaderJob fused_job = fusion.job();
+
+    MaterializeValues(&fused_job);
+
+    int texture_count = 0;
+
+    foreach (const NodeValue& v, fused_job.GetValues()) {
+      if (v.type() == NodeParam::kTexture && !v.data().isNull()) {
+        texture_count++;
+      }
+    }
+
+    if (texture_count <= kMaxFusedTextures) {
+      TRACE_SCOPE("proxy-wait", "RunFusedAccelerated");
+
+      QMetaObject::invokeMethod(OpenGLProxy::instance(),
+                                "RunFusedAccelerated",
+                                Qt::BlockingQueuedConnection,
+                                Q_RETURN_ARG(QVariant, value),
+                                Q_ARG(const QString&, fusion.signature()),
+                                Q_ARG(const QString&, fusion.frag_code()),
+                                OLIVE_NS_CONST_ARG(ShaderJob&, fused_job),
+                                OLIVE_NS_CONST_ARG(VideoParams&, video_params()));
+    }
+
+    if (!value.isNull()) {
+      frame_stats_.passes++;
+      frame_stats_.bytes += PassBandwidth(fused_job);
+
+      foreach (OpenGLFusedStagePtr s, fusion.stages()) {
+        frame_stats_.unfused_passes++;
+        frame_stats_.unfused_bytes += PassBandwidth(s->job);
+      }
+
+      stage->result = value;
+      return value;
+    }
+
+    // Fall through and render this stage on its own, its inputs will be fused where possible
+  }
+
+  ShaderJob job = stage->job;
+
+  MaterializeValues(&job);
+
+  TRACE_SCOPE("proxy-wait", "RunNodeAccelerated");
+
   QMetaObject::invokeMethod(OpenGLProxy::instance(),
                             "RunNodeAccelerated",
                             Qt::BlockingQueuedConnection,
                             Q_RETURN_ARG(QVariant, value),
-                            OLIVE_NS_CONST_ARG(Node*, node),
-                            OLIVE_NS_CONST_ARG(TimeRange&, range),
+                            OLIVE_NS_CONST_ARG(Node*, stage->node),
+                            OLIVE_NS_CONST_ARG(TimeRange&, stage->range),
                             OLIVE_NS_CONST_ARG(ShaderJob&, job),
                             OLIVE_NS_CONST_ARG(VideoParams&, video_params()));
 
+  qint64 bandwidth = PassBandwidth(job) * qMax(1, job.GetIterationCount());
+  frame_stats_.passes++;
+  frame_stats_.unfused_passes++;
+  frame_stats_.bytes += bandwidth;
+  frame_stats_.unfused_bytes += bandwidth;
+
+  stage->result = value;
+
   return value;
 }
 
-bool OpenGLWorker::TextureHasAlpha(const QVariant &v) const
+void OpenGLWorker::MaterializeValues(ShaderJob *job) const
 {
-  return PixelFormat::FormatHasAlphaChannel(v.value<OpenGLTextureCache::ReferencePtr>()->texture()->format());
+  NodeValueMap values = job->GetValues();
+
+  for (auto it=values.cbegin(); it!=values.cend(); it++) {
+    if (it.value().data().canConvert<OpenGLFusedStagePtr>()) {
+      job->InsertValue(it.key(), NodeValue(it.value().type(),
+                                           Materialize(it.value().data()),
+                                           it.value().source(),
+                                           it.value().tag()));
+    }
+  }
+}
+
+qint64 OpenGLWorker::PassBandwidth(const ShaderJob &job) const
+{
+  // Every bound texture is read once and the destination is written once per pass
+  int textures = 1;
+
+  foreach (const NodeValue& v, job.GetValues()) {
+    if (v.type() == NodeParam::kTexture && !v.data().isNull()) {
+      textures++;
+    }
+  }
+
+  return qint64(video_params().effective_width())
+      * qint64(video_params().effective_height())
+      * PixelFormat::BytesPerPixel(video_params().format())
+      * textures;
 }
 
 OLIVE_NAMESPACE_EXIT
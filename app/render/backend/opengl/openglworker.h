@@ -22,6 +22,7 @@
 #define OPENGLWORKER_H
 
 #include "openglproxy.h"
+#include "openglshaderfusion.h"
 #include "render/backend/renderworker.h"
 
 OLIVE_NAMESPACE_ENTER
@@ -34,6 +35,8 @@ public:
 protected:
   virtual void TextureToFrame(const QVariant& texture, FramePtr frame, const QMatrix4x4 &mat) const override;
 
+  virtual bool TextureToSharedFrame(const QVariant& texture, FramePtr frame, const QMatrix4x4 &mat) const override;
+
   virtual QVariant FootageFrameToTexture(StreamPtr stream, FramePtr frame) const override;
 
   virtual QVariant CachedFrameToTexture(FramePtr frame) const override;
@@ -42,6 +45,39 @@ protected:
 
   virtual bool TextureHasAlpha(const QVariant& v) const override;
 
+  virtual const void* TextureIdentity(const QVariant& v) const override;
+
+  virtual qint64 TextureByteSize(const QVariant& v) const override;
+
+private:
+  /**
+   * @brief Returns a real texture for this value, rendering it (fused with as many of its inputs as possible) if it's
+   * a deferred shader job
+   */
+  QVariant Materialize(const QVariant& v) const;
+
+  QVariant RenderStage(OpenGLFusedStagePtr stage) const;
+
+  /**
+   * @brief Replaces all deferred values in a job with real textures
+   */
+  void MaterializeValues(ShaderJob* job) const;
+
+  qint64 PassBandwidth(const ShaderJob& job) const;
+
+  void ReportFrameStatistics() const;
+
+  static const int kMaxFusedTextures = 16;
+
+  struct FusionStatistics {
+    int passes;
+    int unfused_passes;
+    qint64 bytes;
+    qint64 unfused_bytes;
+  };
+
+  mutable FusionStatistics frame_stats_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -34,9 +34,13 @@ OLIVE_NAMESPACE_ENTER
 RenderBackend::RenderBackend(QObject *parent) :
   QObject(parent),
   viewer_node_(nullptr),
+  copied_viewer_node_(nullptr),
+  copied_connections_changed_(false),
+  update_stats_(),
   update_with_graph_(false),
   preview_job_time_(0),
-  render_mode_(RenderMode::kOnline)
+  render_mode_(RenderMode::kOnline),
+  gpu_resident_frames_(false)
 {
 }
 
@@ -75,6 +79,7 @@ void RenderBackend::SetViewerNode(ViewerOutput *viewer_node)
     copy_map_.clear();
     copied_viewer_node_ = nullptr;
     graph_update_queue_.clear();
+    graph_update_set_.clear();
 
     disconnect(old_viewer,
                &ViewerOutput::GraphChangedFrom,
@@ -196,53 +201,27 @@ std::list<TimeRange> RenderBackend::SplitRangeIntoChunks(const TimeRange &r)
 
 void RenderBackend::NodeGraphChanged(NodeInput *source)
 {
-  // We need to determine:
-  // - If we don't have this input, assume that it's coming soon and ignore it
-  // - If we do, is this input a child of another input we're already copying?
-  // - Or are any of the queued inputs children of this one?
-
-  // First we need to find our copy of the input being queued
-  Node* our_copy_node = copy_map_.value(source->parentNode());
+  // This is called for every change to the graph (e.g. every tick of a slider drag), so all we do here is record
+  // which inputs changed. The actual copying is deferred to ProcessUpdateQueue(), which runs once before the next
+  // job and where changes to the same input collapse into one update.
+  update_stats_.changes_received++;
 
   // If we don't have this node yet, assume it's coming in a later copy in which case it'll be
   // copied then
-  if (!our_copy_node) {
+  if (!copy_map_.contains(source->parentNode())) {
     // Assert that there are updates coming
     Q_ASSERT(!graph_update_queue_.isEmpty());
     return;
   }
 
-  // If we're here, we must have this node. Determine if we're already copying a "parent" of this
-  for (int i=0; i<graph_update_queue_.size(); i++) {
-    NodeInput* queued_input = graph_update_queue_.at(i);
-
-    // If this input is already queued, nothing to be done
-    if (source == queued_input) {
-      return;
-    }
-
-    // Check if this dependency graph is already queued
-    if (source->parentNode()->OutputsTo(queued_input, true, true)) {
-      // In which case, no further copy is necessary
-      return;
-    }
-
-    // Check if the source is a member of this array, in which case it'll be copied eventually anyway
-    if (queued_input->IsArray()
-        && static_cast<NodeInputArray*>(queued_input)->sub_params().contains(source)) {
-      return;
-    }
-
-    // Check if this input supersedes an already queued input
-    if (queued_input->parentNode()->OutputsTo(source, true, true)
-        || (source->IsArray() && static_cast<NodeInputArray*>(source)->sub_params().contains(queued_input))) {
-      // In which case, we don't need to queue it and can queue our own
-      graph_update_queue_.removeAt(i);
-      i--;
-    }
+  // If this input is already queued, nothing to be done
+  if (graph_update_set_.contains(source)) {
+    update_stats_.changes_coalesced++;
+    return;
   }
 
   graph_update_queue_.append(source);
+  graph_update_set_.insert(source);
 }
 
 void RenderBackend::Close()
@@ -297,6 +276,7 @@ void RenderBackend::RunNextJob()
       RenderWorker* worker = CreateNewWorker();
 
       connect(worker, &RenderWorker::FinishedJob, this, &RenderBackend::WorkerFinished);
+      connect(worker, &RenderWorker::AudioConformUnavailable, this, &RenderBackend::StartConform);
 
       workers_.replace(i, {worker, false});
     }
@@ -315,6 +295,7 @@ void RenderBackend::RunNextJob()
       worker->SetAudioParams(audio_params_);
       worker->SetVideoDownloadMatrix(video_download_matrix_);
       worker->SetRenderMode(render_mode_);
+      worker->SetGPUResidentFrames(gpu_resident_frames_);
       if (preview_job_time_) {
         worker->EnablePreviewGeneration(viewer_node_->audio_playback_cache(), preview_job_time_);
       }
@@ -366,6 +347,8 @@ void RenderBackend::ProcessUpdateQueue()
   qDebug() << "Processing update queue of" << graph_update_queue_.size() << "elements:";
 #endif
 
+  copied_connections_changed_ = false;
+
   while (!graph_update_queue_.isEmpty()) {
     NodeInput* i = graph_update_queue_.takeFirst();
 #ifdef PRINT_UPDATE_QUEUE_INFO
@@ -374,8 +357,21 @@ void RenderBackend::ProcessUpdateQueue()
     CopyNodeInputValue(i);
   }
 
+  graph_update_set_.clear();
+  synced_nodes_.clear();
+
+  // Only connections can leave copies orphaned, so we only need to look for them if any were changed
+  if (copied_connections_changed_) {
+    RemoveDisconnectedCopies();
+  }
+
 #ifdef PRINT_UPDATE_QUEUE_INFO
   qDebug() << "Update queue took:" << (QDateTime::currentMSecsSinceEpoch() - t);
+  qDebug() << "  Changes received:" << update_stats_.changes_received
+           << "coalesced:" << update_stats_.changes_coalesced
+           << "nodes copied:" << update_stats_.nodes_copied
+           << "copies avoided:" << update_stats_.copies_avoided
+           << "removed:" << update_stats_.nodes_removed;
 #endif
 }
 
@@ -396,11 +392,34 @@ void RenderBackend::WorkerFinished()
   }
 }
 
+void RenderBackend::StartConform(StreamPtr stream, TimeRange range, rational stream_time, AudioParams params)
+{
+  Q_UNUSED(range)
+  Q_UNUSED(stream_time)
+
+  ConformTask* task = new ConformTask(std::static_pointer_cast<AudioStream>(stream), params);
+
+  if (TaskManager::instance()) {
+    TaskManager::instance()->AddTask(task);
+  } else {
+    // Headless, there's nowhere to show the task but workers are still waiting on it
+    QtConcurrent::run([task]{
+      task->Start();
+      delete task;
+    });
+  }
+}
+
 void RenderBackend::CopyNodeInputValue(NodeInput *input)
 {
   // Find our copy of this parameter
   Node* our_copy_node = copy_map_.value(input->parentNode());
-  Q_ASSERT(our_copy_node);
+
+  if (!our_copy_node) {
+    // This node was never part of our copy, or a previous update in this batch removed it
+    return;
+  }
+
   NodeInput* our_copy = our_copy_node->GetInputWithID(input->id());
 
   // Copy the standard/keyframe values between these two inputs
@@ -411,22 +430,23 @@ void RenderBackend::CopyNodeInputValue(NodeInput *input)
 
   // Handle connections
   if (input->is_connected() || our_copy->is_connected()) {
-    // If one of the inputs is connected, it's likely this change came from connecting or
-    // disconnecting whatever was connected to it
+    if (CopiedConnectionMatches(input, our_copy)) {
+      // Nothing was connected or disconnected here. Upstream nodes report their own changes, so there's no need to
+      // re-copy the dependency graph.
+      update_stats_.copies_avoided++;
+    } else {
+      // It's likely this change came from connecting or disconnecting whatever was connected to it, so clear the old
+      // edges. Old dependencies are left in the map since they may just be reconnected elsewhere in this batch,
+      // RemoveDisconnectedCopies() deletes any that aren't.
+      while (!our_copy->edges().isEmpty()) {
+        NodeParam::DisconnectEdge(our_copy->edges().first());
+      }
 
-    // We start by removing all old dependencies from the map
-    QList<Node*> old_deps = our_copy->GetExclusiveDependencies();
-    foreach (Node* i, old_deps) {
-      copy_map_.take(copy_map_.key(i))->deleteLater();
-    }
+      copied_connections_changed_ = true;
 
-    // And clear any other edges
-    while (!our_copy->edges().isEmpty()) {
-      NodeParam::DisconnectEdge(our_copy->edges().first());
+      // Then we copy all node dependencies and connections (if there are any)
+      CopyNodeMakeConnection(input, our_copy);
     }
-
-    // Then we copy all node dependencies and connections (if there are any)
-    CopyNodeMakeConnection(input, our_copy);
   }
 
   // Call on sub-elements too
@@ -442,8 +462,16 @@ Node* RenderBackend::CopyNodeConnections(Node* src_node)
   // Check if this node is already in the map
   Node* dst_node = copy_map_.value(src_node);
 
-  // If not, create it now
-  if (!dst_node) {
+  if (dst_node) {
+    if (synced_nodes_.contains(src_node)) {
+      // Already brought up to date during this update, no need to traverse it again
+      update_stats_.copies_avoided++;
+      return dst_node;
+    }
+
+    update_stats_.copies_avoided++;
+  } else {
+    // If not, create it now
     dst_node = src_node->copy();
 
     if (dst_node->IsTrack()) {
@@ -452,8 +480,12 @@ Node* RenderBackend::CopyNodeConnections(Node* src_node)
     }
 
     copy_map_.insert(src_node, dst_node);
+
+    update_stats_.nodes_copied++;
   }
 
+  synced_nodes_.insert(src_node);
+
   // Make sure its values are copied
   Node::CopyInputs(src_node, dst_node, false);
 
@@ -477,8 +509,81 @@ void RenderBackend::CopyNodeMakeConnection(NodeInput* src_input, NodeInput* dst_
 
     NodeOutput* corresponding_output = dst_node->GetOutputWithID(src_input->get_connected_output()->id());
 
-    NodeParam::ConnectEdge(corresponding_output,
-                           dst_input);
+    // Reused copies may already have this edge, in which case we leave it alone
+    if (dst_input->get_connected_output() != corresponding_output) {
+      NodeParam::ConnectEdge(corresponding_output,
+                             dst_input);
+
+      copied_connections_changed_ = true;
+    }
+  } else if (dst_input->is_connected()) {
+    // A reused copy may have an edge its source no longer has
+    while (!dst_input->edges().isEmpty()) {
+      NodeParam::DisconnectEdge(dst_input->edges().first());
+    }
+
+    copied_connections_changed_ = true;
+  }
+}
+
+bool RenderBackend::CopiedConnectionMatches(NodeInput *src_input, NodeInput *dst_input) const
+{
+  if (!src_input->is_connected()) {
+    return !dst_input->is_connected();
+  }
+
+  Node* copied_src = copy_map_.value(src_input->get_connected_node());
+
+  return copied_src
+      && dst_input->get_connected_output() == copied_src->GetOutputWithID(src_input->get_connected_output()->id());
+}
+
+void RenderBackend::RemoveDisconnectedCopies()
+{
+  // Walk upstream from our viewer once to find every copy that's still in use
+  QSet<Node*> reachable;
+  QList<Node*> stack;
+
+  stack.append(copied_viewer_node_);
+  reachable.insert(copied_viewer_node_);
+
+  while (!stack.isEmpty()) {
+    Node* n = stack.takeLast();
+
+    foreach (Node* dep, n->GetImmediateDependencies()) {
+      if (!reachable.contains(dep)) {
+        reachable.insert(dep);
+        stack.append(dep);
+      }
+    }
+  }
+
+  QHash<Node*, Node*>::iterator i = copy_map_.begin();
+
+  while (i != copy_map_.end()) {
+    Node* copy = i.value();
+
+    if (reachable.contains(copy)) {
+      i++;
+    } else {
+      // Make sure nothing that's still in use holds an edge to this node before it's deleted
+      foreach (NodeOutput* output, copy->GetOutputs()) {
+        while (!output->edges().isEmpty()) {
+          NodeParam::DisconnectEdge(output->edges().first());
+        }
+      }
+
+      foreach (NodeInput* input, copy->GetInputsIncludingArrays()) {
+        while (!input->edges().isEmpty()) {
+          NodeParam::DisconnectEdge(input->edges().first());
+        }
+      }
+
+      copy->deleteLater();
+      i = copy_map_.erase(i);
+
+      update_stats_.nodes_removed++;
+    }
   }
 }
 
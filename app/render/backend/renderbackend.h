@@ -60,6 +60,14 @@ public:
     render_mode_ = e;
   }
 
+  /**
+   * @brief Leave rendered frames on the GPU so they can be displayed without a round trip through system memory
+   */
+  void SetGPUResidentFrames(bool e)
+  {
+    gpu_resident_frames_ = e;
+  }
+
   void EnablePreviewGeneration(qint64 job_time)
   {
     preview_job_time_ = job_time;
@@ -102,6 +110,31 @@ public:
 
   static std::list<TimeRange> SplitRangeIntoChunks(const TimeRange& r);
 
+  /**
+   * @brief Counters describing how much work keeping the copied graph up to date has taken
+   */
+  struct UpdateStatistics {
+    /// Number of graph changes received through NodeGraphChanged()
+    qint64 changes_received;
+
+    /// Number of those changes that were dropped because that input was already queued
+    qint64 changes_coalesced;
+
+    /// Number of nodes newly copied into our graph
+    qint64 nodes_copied;
+
+    /// Number of node copies avoided, either by reusing an existing copy or leaving an unchanged edge alone
+    qint64 copies_avoided;
+
+    /// Number of copied nodes deleted because they were no longer connected to our viewer
+    qint64 nodes_removed;
+  };
+
+  const UpdateStatistics& GetUpdateStatistics() const
+  {
+    return update_stats_;
+  }
+
 public slots:
   void NodeGraphChanged(NodeInput *source);
 
@@ -112,6 +145,8 @@ private:
   void CopyNodeInputValue(NodeInput* input);
   Node *CopyNodeConnections(Node *src_node);
   void CopyNodeMakeConnection(NodeInput *src_input, NodeInput *dst_input);
+  bool CopiedConnectionMatches(NodeInput *src_input, NodeInput *dst_input) const;
+  void RemoveDisconnectedCopies();
 
   ViewerOutput* viewer_node_;
 
@@ -123,9 +158,15 @@ private:
   AudioParams audio_params_;
 
   QList<NodeInput*> graph_update_queue_;
+  QSet<NodeInput*> graph_update_set_;
   QHash<Node*, Node*> copy_map_;
   ViewerOutput* copied_viewer_node_;
 
+  // Source nodes whose copies have been fully synced during the current ProcessUpdateQueue()
+  QSet<Node*> synced_nodes_;
+  bool copied_connections_changed_;
+  UpdateStatistics update_stats_;
+
   QThreadPool pool_;
 
   std::list<RenderTicketPtr> render_queue_;
@@ -143,9 +184,18 @@ private:
 
   RenderMode::Mode render_mode_;
 
+  bool gpu_resident_frames_;
+
 private slots:
   void WorkerFinished();
 
+  /**
+   * @brief Conform audio a worker found missing in the background
+   *
+   * Workers wait on the parts they need (see ConformProgress) rather than the whole conform.
+   */
+  void StartConform(StreamPtr stream, TimeRange range, rational stream_time, AudioParams params);
+
   void RunNextJob();
 
 };
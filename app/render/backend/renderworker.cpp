@@ -21,34 +21,49 @@
 #include "renderworker.h"
 
 #include <QDir>
-#include <QThread>
 
 #include "audio/audiovisualwaveform.h"
-#include "common/functiontimer.h"
+#include "common/ticktime.h"
+#include "common/timecodefunctions.h"
+#include "common/trace.h"
 #include "config/config.h"
 #include "node/block/clip/clip.h"
+#include "render/diskmanager.h"
 #include "task/conform/conform.h"
 
 OLIVE_NAMESPACE_ENTER
 
+const int RenderWorker::kMaxCachedGenerations = 64;
+const double RenderWorker::kGenerationCacheShare = 0.5;
+std::atomic<qint64> RenderWorker::generation_cache_total_bytes_(0);
+
 RenderWorker::RenderWorker(RenderBackend* parent) :
   parent_(parent),
+  generation_cache_bytes_(0),
+  generation_cache_budget_(qRound64(Config::Current()["TextureCacheSize"].toDouble() * 1073741824 * kGenerationCacheShare)),
+  generation_cache_counter_(0),
   available_(true),
   audio_mode_is_preview_(false),
   preview_cache_(nullptr),
-  render_mode_(RenderMode::kOnline)
+  render_mode_(RenderMode::kOnline),
+  gpu_resident_frames_(false)
+{
+}
+
+RenderWorker::~RenderWorker()
 {
+  // The textures are released along with this worker
+  generation_cache_total_bytes_ -= generation_cache_bytes_;
 }
 
 void RenderWorker::Hash(RenderTicketPtr ticket, ViewerOutput *viewer, const QVector<rational> &times)
 {
-  QVector<QByteArray> hashes(times.size());
+  TRACE_SCOPE_ARG("render", "Hash", times.size());
 
-  for (int i=0;i<hashes.size();i++) {
-    hashes[i] = HashNode(viewer->texture_input()->get_connected_node(),
-                         video_params_,
-                         times.at(i));
-  }
+  // Hashed as one batch so static parts of the graph are only traversed once
+  QVector<QByteArray> hashes = NodeHasher::HashFrames(viewer->texture_input()->get_connected_node(),
+                                                      video_params_,
+                                                      times);
 
   ticket->Finish(QVariant::fromValue(hashes));
 
@@ -57,22 +72,13 @@ void RenderWorker::Hash(RenderTicketPtr ticket, ViewerOutput *viewer, const QVec
 
 QByteArray RenderWorker::HashNode(const Node *n, const VideoParams &params, const rational &time)
 {
-  QCryptographicHash hasher(QCryptographicHash::Sha1);
-
-  // Embed video parameters into this hash
-  hasher.addData(reinterpret_cast<const char*>(&params.effective_width()), sizeof(int));
-  hasher.addData(reinterpret_cast<const char*>(&params.effective_height()), sizeof(int));
-  hasher.addData(reinterpret_cast<const char*>(&params.format()), sizeof(PixelFormat::Format));
-
-  if (n) {
-    n->Hash(hasher, time);
-  }
-
-  return hasher.result();
+  return NodeHasher::HashFrame(n, params, time);
 }
 
 void RenderWorker::RenderFrame(RenderTicketPtr ticket, ViewerOutput* viewer, const rational &time)
 {
+  TRACE_SCOPE_ARG("render", "RenderFrame", Timecode::time_to_timestamp(time, video_params_.time_base()));
+
   NodeValueTable table = ProcessInput(viewer->texture_input(),
                                       TimeRange(time, time + video_params_.time_base()));
 
@@ -92,13 +98,14 @@ void RenderWorker::RenderFrame(RenderTicketPtr ticket, ViewerOutput* viewer, con
                                       output_format,
                                       video_params_.divider()));
   frame->set_timestamp(time);
-  frame->allocate();
 
   if (texture.isNull()) {
     // Blank frame out
+    frame->allocate();
     memset(frame->data(), 0, frame->allocated_size());
-  } else {
+  } else if (!gpu_resident_frames_ || !TextureToSharedFrame(texture, frame, video_download_matrix_)) {
     // Dump texture contents to frame
+    frame->allocate();
     TextureToFrame(texture, frame, video_download_matrix_);
   }
 
@@ -109,6 +116,8 @@ void RenderWorker::RenderFrame(RenderTicketPtr ticket, ViewerOutput* viewer, con
 
 void RenderWorker::RenderAudio(RenderTicketPtr ticket, ViewerOutput* viewer, const TimeRange &range)
 {
+  TRACE_SCOPE("render", "RenderAudio");
+
   NodeValueTable table = ProcessInput(viewer->samples_input(), range);
 
   QVariant samples = table.Get(NodeParam::kSamples);
@@ -221,11 +230,20 @@ QVariant RenderWorker::ProcessSamples(const Node *node, const TimeRange &range,
   SampleBufferPtr output_buffer = SampleBuffer::CreateAllocated(job.samples()->audio_params(), job.samples()->sample_count());
   NodeValueDatabase value_db;
 
+  // Step through samples as integer ticks of the sample rate
+  TickTimebase sample_timebase(rational(1, audio_params_.sample_rate()));
+  bool in_is_exact = sample_timebase.IsExact(range.in());
+  int64_t in_ticks = sample_timebase.ToTicks(range.in());
+
   for (int i=0;i<job.samples()->sample_count();i++) {
     // Calculate the exact rational time at this sample
-    double sample_to_second = static_cast<double>(i) / static_cast<double>(audio_params_.sample_rate());
+    rational this_sample_time;
 
-    rational this_sample_time = rational::fromDouble(range.in().toDouble() + sample_to_second);
+    if (in_is_exact) {
+      this_sample_time = sample_timebase.ToTime(in_ticks + i);
+    } else {
+      this_sample_time = range.in() + sample_timebase.ToTime(i);
+    }
 
     // Update all non-sample and non-footage inputs
     NodeValueMap::const_iterator j;
@@ -255,8 +273,6 @@ QVariant RenderWorker::ProcessSamples(const Node *node, const TimeRange &range,
 
 QVariant RenderWorker::ProcessFrameGeneration(const Node* node, const GenerateJob &job)
 {
-  FramePtr frame = Frame::Create();
-
   PixelFormat::Format output_fmt;
   if (job.GetAlphaChannelRequired()) {
     output_fmt = PixelFormat::GetFormatWithAlphaChannel(video_params_.format());
@@ -264,6 +280,16 @@ QVariant RenderWorker::ProcessFrameGeneration(const Node* node, const GenerateJo
     output_fmt = PixelFormat::GetFormatWithoutAlphaChannel(video_params_.format());
   }
 
+  // If nothing this node's raster depends on has changed (e.g. static text), we can skip generating it entirely
+  QByteArray key = HashGeneratorJob(node, job);
+  QVariant value;
+
+  if (GetCachedGeneration(node, key, &value)) {
+    return value;
+  }
+
+  FramePtr frame = Frame::Create();
+
   frame->set_video_params(VideoParams(video_params_.width(),
                                       video_params_.height(),
                                       video_params_.time_base(),
@@ -273,7 +299,230 @@ QVariant RenderWorker::ProcessFrameGeneration(const Node* node, const GenerateJo
 
   node->GenerateFrame(frame, job);
 
-  return CachedFrameToTexture(frame);
+  value = CachedFrameToTexture(frame);
+
+  SetCachedGeneration(node, key, value);
+
+  return value;
+}
+
+QByteArray RenderWorker::HashGeneratorJob(const Node *node, const GenerateJob &job, const QByteArray& extra, QVariantList *textures) const
+{
+  FastHasher hasher;
+
+  hasher.addString(node->id());
+  hasher.addData(extra);
+
+  // Embed video parameters into this hash
+  hasher.add(video_params_.width());
+  hasher.add(video_params_.height());
+  hasher.add(video_params_.divider());
+  hasher.add(video_params_.format());
+
+  hasher.add(job.GetAlphaChannelRequired());
+
+  // Sort keys so the hash doesn't depend on QHash's iteration order
+  QStringList keys = job.GetValues().keys();
+  keys.sort();
+
+  foreach (const QString& k, keys) {
+    const NodeValue& v = job.GetValues()[k];
+
+    QList<NodeValue> values_to_hash;
+
+    if (v.data().userType() == qMetaTypeId< QVector<NodeValue> >()) {
+      // Array inputs are stored as a vector of values
+      foreach (const NodeValue& sub, v.data().value< QVector<NodeValue> >()) {
+        values_to_hash.append(sub);
+      }
+    } else {
+      values_to_hash.append(v);
+    }
+
+    hasher.addString(k);
+
+    foreach (const NodeValue& hash_me, values_to_hash) {
+      if (hash_me.data().isNull()) {
+        // Nothing connected/set, which is still a valid and deterministic state
+        continue;
+      }
+
+      QByteArray bytes;
+
+      if (hash_me.type() == NodeParam::kTexture) {
+        // Textures can only be hashed if they were cached results, otherwise we can't know what they contain
+        const void* identity = TextureIdentity(hash_me.data());
+        bool is_cached_result = false;
+
+        if (textures) {
+          foreach (const CachedGeneration& g, generation_cache_) {
+            if (TextureIdentity(g.texture) == identity) {
+              is_cached_result = true;
+              break;
+            }
+          }
+        }
+
+        if (!is_cached_result) {
+          return QByteArray();
+        }
+
+        textures->append(hash_me.data());
+        bytes = QByteArray(reinterpret_cast<const char*>(&identity), sizeof(identity));
+      } else if (hash_me.data().userType() == qMetaTypeId< QVector<float> >()) {
+        // Precalculated tables
+        QVector<float> table = hash_me.data().value< QVector<float> >();
+        bytes = QByteArray(reinterpret_cast<const char*>(table.constData()), table.size() * int(sizeof(float)));
+      } else {
+        bytes = NodeParam::ValueToBytes(hash_me.type(), hash_me.data());
+      }
+
+      if (bytes.isEmpty()) {
+        switch (hash_me.type()) {
+        case NodeParam::kFloat:
+        case NodeParam::kInt:
+        case NodeParam::kRational:
+        case NodeParam::kText:
+        case NodeParam::kFile:
+          // An empty string is as valid a value as any other
+          bytes = hash_me.data().toString().toUtf8();
+          break;
+        default:
+          // Textures, samples, etc. can't be hashed here so this job can't be cached
+          return QByteArray();
+        }
+      }
+
+      // Length first so adjacent values can't run into each other
+      hasher.add(bytes.size());
+      hasher.addData(bytes);
+    }
+  }
+
+  return hasher.result();
+}
+
+int RenderWorker::CullOccludedLayers(ShaderJob *job, QVariant *top_layer) const
+{
+  int visible = 0;
+  bool occluded = false;
+
+  for (int i=job->GetLayers().size()-1; i>=0; i--) {
+    const QString& layer = job->GetLayers().at(i);
+    NodeValue v = job->GetValue(layer);
+
+    if (v.data().isNull()) {
+      continue;
+    }
+
+    if (occluded) {
+      // Keep the value but with no texture so the shader sees it as disabled
+      job->InsertValue(layer, NodeValue(NodeParam::kTexture, QVariant(), v.source()));
+      continue;
+    }
+
+    if (visible == 0) {
+      *top_layer = v.data();
+    }
+
+    visible++;
+
+    if (!TextureHasAlpha(v.data())) {
+      occluded = true;
+    }
+  }
+
+  return visible;
+}
+
+bool RenderWorker::GetCachedGeneration(const Node *node, const QByteArray &key, QVariant *texture)
+{
+  if (key.isEmpty()) {
+    return false;
+  }
+
+  QHash<const Node*, CachedGeneration>::iterator it = generation_cache_.find(node);
+
+  if (it != generation_cache_.end() && it->key == key) {
+    it->last_used = ++generation_cache_counter_;
+    *texture = it->texture;
+    return true;
+  }
+
+  return false;
+}
+
+void RenderWorker::SetCachedGeneration(const Node *node, const QByteArray &key, const QVariant &texture, const QVariantList &inputs)
+{
+  if (key.isEmpty() || texture.isNull()) {
+    return;
+  }
+
+  RemoveCachedGeneration(node);
+
+  qint64 bytes = TextureByteSize(texture);
+
+  if (bytes > generation_cache_budget_) {
+    return;
+  }
+
+  // Nodes that have since been deleted can't be detected from this thread, so release the least recently used
+  // textures to stay within both limits
+  while (!generation_cache_.isEmpty()
+         && (generation_cache_.size() >= kMaxCachedGenerations
+             || generation_cache_total_bytes_ + bytes > generation_cache_budget_)) {
+    QHash<const Node*, CachedGeneration>::const_iterator oldest = generation_cache_.constBegin();
+
+    for (QHash<const Node*, CachedGeneration>::const_iterator it=generation_cache_.constBegin();
+         it!=generation_cache_.constEnd();
+         it++) {
+      if (it->last_used < oldest->last_used) {
+        oldest = it;
+      }
+    }
+
+    RemoveCachedGeneration(oldest.key());
+  }
+
+  // Other workers may have filled the budget in the meantime
+  if (generation_cache_total_bytes_.fetch_add(bytes) + bytes > generation_cache_budget_) {
+    generation_cache_total_bytes_ -= bytes;
+    return;
+  }
+
+  generation_cache_.insert(node, {key, texture, inputs, bytes, ++generation_cache_counter_});
+  generation_cache_bytes_ += bytes;
+}
+
+void RenderWorker::RemoveCachedGeneration(const Node *node)
+{
+  QHash<const Node*, CachedGeneration>::iterator it = generation_cache_.find(node);
+
+  if (it == generation_cache_.end()) {
+    return;
+  }
+
+  const void* identity = TextureIdentity(it->texture);
+
+  generation_cache_bytes_ -= it->bytes;
+  generation_cache_total_bytes_ -= it->bytes;
+  generation_cache_.erase(it);
+
+  // Generations made from this texture would otherwise keep it alive without it being counted
+  QVector<const Node*> dependents;
+
+  for (it=generation_cache_.begin(); it!=generation_cache_.end(); it++) {
+    foreach (const QVariant& input, it->inputs) {
+      if (TextureIdentity(input) == identity) {
+        dependents.append(it.key());
+        break;
+      }
+    }
+  }
+
+  foreach (const Node* d, dependents) {
+    RemoveCachedGeneration(d);
+  }
 }
 
 QVariant RenderWorker::GetCachedFrame(const Node* node, const rational& time)
@@ -281,9 +530,8 @@ QVariant RenderWorker::GetCachedFrame(const Node* node, const rational& time)
   if (node->id() == QStringLiteral("org.olivevideoeditor.Olive.videoinput")) {
     QByteArray hash = HashNode(node, video_params(), time);
 
-    QString fn = FrameHashCache::CachePathName(hash);
-
-    if (QFileInfo::exists(fn)) {
+    // Checked against the disk manager's index rather than the filesystem so this doesn't stat every frame
+    if (DiskManager::instance()->IsResident(hash)) {
       FramePtr f = FrameHashCache::LoadCacheFrame(hash);
 
       if (f) {
@@ -385,49 +633,47 @@ QVariant RenderWorker::ProcessAudioFootage(StreamPtr stream, const TimeRange &in
   if (decoder) {
     // See if we have a conformed version of this audio
     if (!decoder->HasConformedVersion(audio_params())) {
+      AudioStreamPtr as = std::static_pointer_cast<AudioStream>(stream);
 
-      // If not, check what audio mode we're in
-      if (audio_mode_is_preview_) {
+      bool created;
+      ConformProgressPtr progress = as->request_conform(audio_params(), &created);
 
-        // For preview, we report the conform is missing and finish the render without it
-        // temporarily. The backend that picks up this signal will recache this section once the
-        // conform is available.
-        emit AudioConformUnavailable(decoder->stream(),
-                                     audio_render_time_,
-                                     input_time.out(),
-                                     audio_params());
+      if (progress) {
+        if (!progress->IsClaimed()) {
+          if (audio_mode_is_preview_) {
 
-      } else {
+            // For preview, the backend that picks up this signal starts a task to conform in the background
+            if (created) {
+              emit AudioConformUnavailable(decoder->stream(),
+                                           audio_render_time_,
+                                           input_time.out(),
+                                           audio_params());
+            }
 
-        // For online rendering/export, it's a waste of time to render the audio until we have
-        // all we need, so we try to handle the conform ourselves
-        AudioStreamPtr as = std::static_pointer_cast<AudioStream>(stream);
+          } else {
 
-        // Check if any other threads are conforming this audio
-        if (as->try_start_conforming(audio_params())) {
+            // For online rendering/export, nothing can happen without the audio anyway, so we handle the conform
+            // ourselves
+            decoder->ConformAudio(&IsCancelled(), audio_params());
 
-          // If not, conform it ourselves
-          decoder->ConformAudio(&IsCancelled(), audio_params());
-
-        } else {
-
-          // If another thread is conforming already, hackily try to wait until it's done.
-          do {
-            QThread::msleep(1000);
-          } while (!as->has_conformed_version(audio_params()) && !IsCancelled());
+          }
+        }
 
+        // Conforms are usable chunk by chunk, so only wait for the part we need. Waiting also makes it the next part
+        // to be conformed.
+        if (!progress->WaitForRange(audio_params().time_to_samples(input_time.in()),
+                                    audio_params().time_to_samples(input_time.length()),
+                                    &IsCancelled())) {
+          return value;
         }
       }
-
     }
 
-    if (decoder->HasConformedVersion(audio_params())) {
-      SampleBufferPtr frame = decoder->RetrieveAudio(input_time.in(), input_time.length(),
-                                                     audio_params());
+    SampleBufferPtr frame = decoder->RetrieveAudio(input_time.in(), input_time.length(),
+                                                   audio_params());
 
-      if (frame) {
-        value = QVariant::fromValue(frame);
-      }
+    if (frame) {
+      value = QVariant::fromValue(frame);
     }
   }
 
@@ -21,6 +21,7 @@
 #ifndef RENDERWORKER_H
 #define RENDERWORKER_H
 
+#include <atomic>
 #include <QMatrix4x4>
 
 #include "decodercache.h"
@@ -38,6 +39,8 @@ class RenderWorker : public QObject, public NodeTraverser
 public:
   RenderWorker(RenderBackend* parent);
 
+  virtual ~RenderWorker() override;
+
   bool IsAvailable() const
   {
     return available_;
@@ -68,6 +71,16 @@ public:
     audio_mode_is_preview_ = audio_mode_is_preview;
   }
 
+  /**
+   * @brief Sets whether rendered frames are left on the GPU for display rather than downloaded
+   *
+   * Frames rendered this way are only downloaded if their data is accessed (see Frame::set_texture()).
+   */
+  void SetGPUResidentFrames(bool e)
+  {
+    gpu_resident_frames_ = e;
+  }
+
   void SetCopyMap(QHash<Node*, Node*>* copy_map)
   {
     copy_map_ = copy_map;
@@ -104,6 +117,13 @@ public:
 protected:
   virtual void TextureToFrame(const QVariant& texture, FramePtr frame, const QMatrix4x4 &mat) const = 0;
 
+  /**
+   * @brief Attach a texture to a frame that can be displayed without downloading it
+   *
+   * Returns false if that isn't possible, in which case the texture is downloaded with TextureToFrame() instead.
+   */
+  virtual bool TextureToSharedFrame(const QVariant& texture, FramePtr frame, const QMatrix4x4 &mat) const = 0;
+
   virtual QVariant FootageFrameToTexture(StreamPtr stream, FramePtr frame) const = 0;
 
   virtual QVariant CachedFrameToTexture(FramePtr frame) const = 0;
@@ -122,6 +142,52 @@ protected:
 
   virtual bool TextureHasAlpha(const QVariant& v) const = 0;
 
+  /**
+   * @brief Disables any layer of a compositing job that's covered by an opaque layer above it
+   *
+   * Every texture covers the whole frame, so a texture without an alpha channel hides everything below it. Returns
+   * the amount of layers still visible and sets `top_layer` to the top-most one.
+   */
+  int CullOccludedLayers(ShaderJob* job, QVariant* top_layer) const;
+
+  /**
+   * @brief Returns a pointer uniquely identifying the texture object referenced by this value
+   */
+  virtual const void* TextureIdentity(const QVariant& v) const = 0;
+
+  /**
+   * @brief Returns the amount of memory in bytes used by the texture referenced by this value
+   */
+  virtual qint64 TextureByteSize(const QVariant& v) const = 0;
+
+  /**
+   * @brief Create a key identifying the output of a generator job
+   *
+   * Generators (GenerateFrame() and shader jobs with no texture inputs) declare everything that affects their raster
+   * by inserting it into their job, so a job with the same values at the same video parameters always produces the
+   * same image. Textures are only accepted if they're cached results themselves (e.g. a stroke around static text),
+   * in which case they're hashed by identity and appended to `textures` so the cache can keep them alive.
+   *
+   * Returns an empty array if the job contains values that can't be hashed, in which case it must not be cached.
+   */
+  QByteArray HashGeneratorJob(const Node* node, const GenerateJob& job, const QByteArray& extra = QByteArray(),
+                              QVariantList* textures = nullptr) const;
+
+  /**
+   * @brief Retrieve a previously generated texture for this node if its key matches
+   */
+  bool GetCachedGeneration(const Node* node, const QByteArray& key, QVariant* texture);
+
+  /**
+   * @brief Store a generated texture so it can be reused for as long as the node's job doesn't change
+   *
+   * Every worker's generated textures share one budget, a share of the texture cache's so they count against the
+   * size the user configured. This worker's least recently used textures are released to make room, and the texture
+   * isn't cached if the other workers' textures already use the budget.
+   */
+  void SetCachedGeneration(const Node* node, const QByteArray& key, const QVariant& texture,
+                           const QVariantList& inputs = QVariantList());
+
   const VideoParams& video_params() const
   {
     return video_params_;
@@ -166,6 +232,38 @@ private:
 
   QHash<Stream*, CachedStill> still_image_cache_;
 
+  struct CachedGeneration {
+    QByteArray key;
+    QVariant texture;
+
+    // Held so their identities (which are part of the key) can't be reused by another texture
+    QVariantList inputs;
+
+    qint64 bytes;
+    quint64 last_used;
+  };
+
+  /**
+   * @brief Remove a generation and any generations that were made from it
+   */
+  void RemoveCachedGeneration(const Node* node);
+
+  QHash<const Node*, CachedGeneration> generation_cache_;
+
+  qint64 generation_cache_bytes_;
+
+  qint64 generation_cache_budget_;
+
+  // Total size of every worker's cached generations
+  static std::atomic<qint64> generation_cache_total_bytes_;
+
+  quint64 generation_cache_counter_;
+
+  static const int kMaxCachedGenerations;
+
+  /// Share of TextureCacheSize that generated textures may use
+  static const double kGenerationCacheShare;
+
   QMatrix4x4 video_download_matrix_;
 
   DecoderCache decoder_cache_;
@@ -182,6 +280,8 @@ private:
 
   RenderMode::Mode render_mode_;
 
+  bool gpu_resident_frames_;
+
 };
 
 OLIVE_NAMESPACE_EXIT
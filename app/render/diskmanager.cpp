@@ -35,6 +35,7 @@ OLIVE_NAMESPACE_ENTER
 DiskManager* DiskManager::instance_ = nullptr;
 
 DiskManager::DiskManager() :
+  next_sequence_(0),
   consumption_(0)
 {
   // Try to load any current cache index from file
@@ -51,9 +52,9 @@ DiskManager::DiskManager() :
       ds >> h.access_time;
       ds >> h.file_size;
 
+      // This is the only time we check the filesystem, from here on the index is kept up to date
       if (QFileInfo::exists(h.file_name)) {
-        consumption_ += h.file_size;
-        disk_data_.append(h);
+        Insert(h.file_name, h.hash, h.access_time, h.file_size);
       }
     }
   }
@@ -101,44 +102,24 @@ DiskManager *DiskManager::instance()
 
 void DiskManager::Accessed(const QByteArray &hash)
 {
-  lock_.lock();
-
-  for (int i=disk_data_.size()-1;i>=0;i--) {
-    const HashTime& h = disk_data_.at(i);
+  QMutexLocker locker(&lock_);
 
-    if (h.hash == hash) {
-      HashTime moved_hash = h;
+  QHash<QByteArray, quint64>::const_iterator it = hash_index_.constFind(hash);
 
-      moved_hash.access_time = QDateTime::currentMSecsSinceEpoch();
-
-      disk_data_.removeAt(i);
-      disk_data_.append(moved_hash);
-      break;
-    }
+  if (it != hash_index_.constEnd()) {
+    Touch(it.value());
   }
-
-  lock_.unlock();
 }
 
 void DiskManager::Accessed(const QString &filename)
 {
-  lock_.lock();
+  QMutexLocker locker(&lock_);
 
-  for (int i=disk_data_.size()-1;i>=0;i--) {
-    const HashTime& h = disk_data_.at(i);
+  QHash<QString, quint64>::const_iterator it = file_index_.constFind(filename);
 
-    if (h.file_name == filename) {
-      HashTime moved_hash = h;
-
-      moved_hash.access_time = QDateTime::currentMSecsSinceEpoch();
-
-      disk_data_.removeAt(i);
-      disk_data_.append(moved_hash);
-      break;
-    }
+  if (it != file_index_.constEnd()) {
+    Touch(it.value());
   }
-
-  lock_.unlock();
 }
 
 void DiskManager::CreatedFile(const QString &file_name, const QByteArray &hash)
@@ -147,59 +128,93 @@ void DiskManager::CreatedFile(const QString &file_name, const QByteArray &hash)
 
   qint64 file_size = QFile(file_name).size();
 
-  disk_data_.append({file_name, hash, QDateTime::currentMSecsSinceEpoch(), file_size});
-
-  consumption_ += file_size;
+  Insert(file_name, hash, QDateTime::currentMSecsSinceEpoch(), file_size);
 
   QList<QByteArray> deleted_hashes;
 
-  while (consumption_ > DiskLimit()) {
+  while (consumption_ > DiskLimit() && !disk_data_.isEmpty()) {
     deleted_hashes.append(DeleteLeastRecent());
   }
 
   lock_.unlock();
 
   foreach (const QByteArray& h, deleted_hashes) {
-    emit DeletedFrame(h);
+    if (!h.isEmpty()) {
+      emit DeletedFrame(h);
+    }
   }
 }
 
+bool DiskManager::IsResident(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  return hash_index_.contains(hash);
+}
+
 bool DiskManager::ClearDiskCache(bool quick_delete)
 {
   bool deleted_files;
 
+  QList<QByteArray> deleted_hashes;
+
   lock_.lock();
 
   if (quick_delete) {
     deleted_files = QDir(FileFunctions::GetMediaCacheLocation()).removeRecursively();
 
+    deleted_hashes = hash_index_.keys();
+
     disk_data_.clear();
+    file_index_.clear();
+    hash_index_.clear();
+    consumption_ = 0;
   } else {
     deleted_files = true;
 
-    for (int i=0;i<disk_data_.size();i++) {
-      const HashTime& ht = disk_data_.at(i);
+    QMap<quint64, HashTime>::iterator i = disk_data_.begin();
+
+    while (i != disk_data_.end()) {
+      const HashTime& ht = i.value();
 
       // We return a false result if any of the files fail to delete, but still try to delete as many as we can
       if (QFile::remove(ht.file_name) || !QFileInfo::exists(ht.file_name)) {
-        emit DeletedFrame(ht.hash);
-        disk_data_.removeAt(i);
-        i--;
+        if (!ht.hash.isEmpty()) {
+          deleted_hashes.append(ht.hash);
+          hash_index_.remove(ht.hash);
+        }
+
+        file_index_.remove(ht.file_name);
+        consumption_ -= ht.file_size;
+
+        i = disk_data_.erase(i);
       } else {
         qWarning() << "Failed to delete" << ht.file_name;
         deleted_files = false;
+        i++;
       }
     }
   }
 
   lock_.unlock();
 
+  // Signal outside the lock since receivers may call back into us
+  foreach (const QByteArray& h, deleted_hashes) {
+    emit DeletedFrame(h);
+  }
+
   return deleted_files;
 }
 
 QByteArray DiskManager::DeleteLeastRecent()
 {
-  HashTime h = disk_data_.takeFirst();
+  HashTime h = disk_data_.take(disk_data_.firstKey());
+
+  file_index_.remove(h.file_name);
+
+  if (!h.hash.isEmpty()) {
+    hash_index_.remove(h.hash);
+  }
 
   QFile::remove(h.file_name);
 
@@ -208,6 +223,50 @@ QByteArray DiskManager::DeleteLeastRecent()
   return h.hash;
 }
 
+void DiskManager::Insert(const QString &file_name, const QByteArray &hash, qint64 access_time, qint64 file_size)
+{
+  // Replace any existing entry for this file
+  QHash<QString, quint64>::iterator existing = file_index_.find(file_name);
+
+  if (existing != file_index_.end()) {
+    HashTime old = disk_data_.take(existing.value());
+
+    consumption_ -= old.file_size;
+
+    if (!old.hash.isEmpty()) {
+      hash_index_.remove(old.hash);
+    }
+  }
+
+  quint64 sequence = next_sequence_++;
+
+  disk_data_.insert(sequence, {file_name, hash, access_time, file_size});
+  file_index_.insert(file_name, sequence);
+
+  if (!hash.isEmpty()) {
+    hash_index_.insert(hash, sequence);
+  }
+
+  consumption_ += file_size;
+}
+
+void DiskManager::Touch(quint64 sequence)
+{
+  // Move to the most recently accessed end
+  HashTime h = disk_data_.take(sequence);
+
+  h.access_time = QDateTime::currentMSecsSinceEpoch();
+
+  quint64 new_sequence = next_sequence_++;
+
+  disk_data_.insert(new_sequence, h);
+  file_index_.insert(h.file_name, new_sequence);
+
+  if (!h.hash.isEmpty()) {
+    hash_index_.insert(h.hash, new_sequence);
+  }
+}
+
 qint64 DiskManager::DiskLimit()
 {
   double gigabytes = Config::Current()["DiskCacheSize"].toDouble();
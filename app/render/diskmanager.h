@@ -21,6 +21,8 @@
 #ifndef DISKMANAGER_H
 #define DISKMANAGER_H
 
+#include <QHash>
+#include <QMap>
 #include <QMutex>
 #include <QObject>
 
@@ -44,6 +46,14 @@ public:
 
   void CreatedFile(const QString& file_name, const QByteArray& hash);
 
+  /**
+   * @brief Returns whether a frame with this hash is currently in the disk cache
+   *
+   * Answered from memory, so this can be used per frame instead of checking the filesystem. Files are only removed
+   * from the cache through the DiskManager, which emits DeletedFrame() when it does.
+   */
+  bool IsResident(const QByteArray& hash);
+
   bool ClearDiskCache(bool quick_delete);
 
 signals:
@@ -58,6 +68,10 @@ private:
 
   QByteArray DeleteLeastRecent();
 
+  void Insert(const QString& file_name, const QByteArray& hash, qint64 access_time, qint64 file_size);
+
+  void Touch(quint64 sequence);
+
   qint64 DiskLimit();
 
   static QString GetCacheIndexFilename();
@@ -69,7 +83,14 @@ private:
     qint64 file_size;
   };
 
-  QList<HashTime> disk_data_;
+  // Files in least to most recently accessed order
+  QMap<quint64, HashTime> disk_data_;
+
+  // Lookups into disk_data_
+  QHash<QString, quint64> file_index_;
+  QHash<QByteArray, quint64> hash_index_;
+
+  quint64 next_sequence_;
 
   qint64 consumption_;
 
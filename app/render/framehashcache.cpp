@@ -20,6 +20,7 @@
 
 #include "framehashcache.h"
 
+#include <algorithm>
 #include <OpenEXR/ImfFloatAttribute.h>
 #include <OpenEXR/ImfInputFile.h>
 #include <OpenEXR/ImfOutputFile.h>
@@ -30,15 +31,39 @@
 #include "codec/frame.h"
 #include "common/filefunctions.h"
 #include "common/timecodefunctions.h"
+#include "common/trace.h"
 #include "render/diskmanager.h"
 
 OLIVE_NAMESPACE_ENTER
 
+const int FrameHashCache::kChunkSize = 4096;
+
+FrameHashCache::FrameHashCache(QObject *parent) :
+  PlaybackCache(parent)
+{
+  if (DiskManager::instance()) {
+    connect(DiskManager::instance(), &DiskManager::DeletedFrame, this, &FrameHashCache::HashDeleted);
+  }
+}
+
+FrameHashCache::~FrameHashCache()
+{
+  Clear();
+}
+
 QByteArray FrameHashCache::GetHash(const rational &time)
 {
   QMutexLocker locker(lock());
 
-  return time_hash_map_.value(time);
+  int64_t frame = timebase_.ToTicks(time);
+  int index = ChunkIndexContaining(frame);
+
+  if (index == -1) {
+    return QByteArray();
+  }
+
+  const Chunk* c = chunks_.at(index);
+  return c->digests.at(frame - c->start).toByteArray();
 }
 
 void FrameHashCache::SetHash(const rational &time, const QByteArray &hash, const qint64& job_time)
@@ -61,9 +86,9 @@ void FrameHashCache::SetHash(const rational &time, const QByteArray &hash, const
     return;
   }
 
-  time_hash_map_.insert(time, hash);
+  Store(timebase_.ToTicks(time), Digest::FromByteArray(hash));
 
-  TimeRange validated_range(time, time + timebase_);
+  TimeRange validated_range(time, time + timebase_.timebase());
 
   NoLockValidate(validated_range);
 
@@ -72,11 +97,41 @@ void FrameHashCache::SetHash(const rational &time, const QByteArray &hash, const
   emit Validated(validated_range);
 }
 
+void FrameHashCache::HashDeleted(const QByteArray &hash)
+{
+  TakeFramesWithHash(hash);
+}
+
 void FrameHashCache::SetTimebase(const rational &tb)
 {
   QMutexLocker locker(lock());
 
-  timebase_ = tb;
+  if (timebase_.timebase() == tb) {
+    return;
+  }
+
+  // Move any hashes that still land on a frame of the new timebase
+  TickTimebase old_timebase = timebase_;
+  QVector<Chunk*> old_chunks = chunks_;
+
+  chunks_.clear();
+  frames_with_hash_.clear();
+  timebase_ = TickTimebase(tb);
+
+  foreach (Chunk* c, old_chunks) {
+    if (timebase_.is_valid()) {
+      for (int i=0;i<c->digests.size();i++) {
+        const Digest& d = c->digests.at(i);
+        rational time = old_timebase.ToTime(c->start + i);
+
+        if (!d.isNull() && timebase_.IsExact(time)) {
+          Store(timebase_.ToTicks(time), d);
+        }
+      }
+    }
+
+    delete c;
+  }
 }
 
 QList<rational> FrameHashCache::GetFramesWithHash(const QByteArray &hash)
@@ -85,12 +140,8 @@ QList<rational> FrameHashCache::GetFramesWithHash(const QByteArray &hash)
 
   QList<rational> times;
 
-  QMap<rational, QByteArray>::const_iterator iterator;
-
-  for (iterator=time_hash_map_.begin();iterator!=time_hash_map_.end();iterator++) {
-    if (iterator.value() == hash) {
-      times.append(iterator.key());
-    }
+  foreach (const Slot& s, frames_with_hash_.value(Digest::FromByteArray(hash))) {
+    times.append(timebase_.ToTime(s.chunk->start + s.offset));
   }
 
   return times;
@@ -100,28 +151,41 @@ QList<rational> FrameHashCache::TakeFramesWithHash(const QByteArray &hash)
 {
   QMutexLocker locker(lock());
 
-  QList<rational> times;
+  SlotSet hash_slots = frames_with_hash_.take(Digest::FromByteArray(hash));
+
+  QVector<int64_t> frames;
+  frames.reserve(hash_slots.size());
+
+  foreach (const Slot& s, hash_slots) {
+    s.chunk->digests[s.offset] = Digest();
+
+    frames.append(s.chunk->start + s.offset);
+  }
 
-  QMap<rational, QByteArray>::iterator iterator = time_hash_map_.begin();
+  std::sort(frames.begin(), frames.end());
 
-  while (iterator != time_hash_map_.end()) {
-    if (iterator.value() == hash) {
-      times.append(iterator.key());
+  // Invalidate runs of adjacent frames together rather than one frame at a time
+  QList<rational> times;
+  QVector<TimeRange> ranges;
+
+  for (int i=0;i<frames.size();i++) {
+    times.append(timebase_.ToTime(frames.at(i)));
 
-      iterator = time_hash_map_.erase(iterator);
+    if (i == 0 || frames.at(i) != frames.at(i - 1) + 1) {
+      ranges.append(TimeRange(times.last(), timebase_.ToTime(frames.at(i) + 1)));
     } else {
-      iterator++;
+      ranges.last().set_out(timebase_.ToTime(frames.at(i) + 1));
     }
   }
 
-  foreach (const rational& r, times) {
-    NoLockInvalidate(TimeRange(r, r + timebase_));
+  foreach (const TimeRange& r, ranges) {
+    NoLockInvalidate(r);
   }
 
   locker.unlock();
 
-  foreach (const rational& r, times) {
-    emit Invalidated(TimeRange(r, r + timebase_));
+  foreach (const TimeRange& r, ranges) {
+    emit Invalidated(r);
   }
 
   return times;
@@ -131,7 +195,19 @@ QMap<rational, QByteArray> FrameHashCache::time_hash_map()
 {
   QMutexLocker locker(lock());
 
-  return time_hash_map_;
+  QMap<rational, QByteArray> map;
+
+  foreach (Chunk* c, chunks_) {
+    for (int i=0;i<c->digests.size();i++) {
+      const Digest& d = c->digests.at(i);
+
+      if (!d.isNull()) {
+        map.insert(timebase_.ToTime(c->start + i), d.toByteArray());
+      }
+    }
+  }
+
+  return map;
 }
 
 QString FrameHashCache::GetFormatExtension()
@@ -185,6 +261,9 @@ void FrameHashCache::SaveCacheFrame(const QByteArray& hash,
 {
   QString fn = CachePathName(hash);
 
+  // Only made when saving so looking up a path doesn't touch the filesystem
+  QDir().mkpath(QFileInfo(fn).path());
+
   if (SaveCacheFrame(fn, data, vparam, linesize_bytes)) {
     // Register frame with the disk manager
     DiskManager::instance()->CreatedFile(fn, hash);
@@ -194,6 +273,12 @@ void FrameHashCache::SaveCacheFrame(const QByteArray& hash,
 void FrameHashCache::SaveCacheFrame(const QByteArray &hash, FramePtr frame)
 {
   if (frame) {
+    if (!frame->has_valid_data()) {
+      // Saving this would serve a blank image for this hash from now on
+      qWarning() << "Skipped caching a frame that couldn't be read back from the GPU";
+      return;
+    }
+
     SaveCacheFrame(hash, frame->data(), frame->video_params(), frame->linesize_bytes());
   } else {
     qWarning() << "Attempted to save a NULL frame to the cache. This may or may not be desirable.";
@@ -207,6 +292,8 @@ FramePtr FrameHashCache::LoadCacheFrame(const QByteArray &hash)
 
 FramePtr FrameHashCache::LoadCacheFrame(const QString &fn)
 {
+  TRACE_SCOPE("cache", "LoadCacheFrame");
+
   FramePtr frame = nullptr;
 
   if (!fn.isEmpty() && QFileInfo::exists(fn)) {
@@ -263,70 +350,44 @@ FramePtr FrameHashCache::LoadCacheFrame(const QString &fn)
 void FrameHashCache::LengthChangedEvent(const rational &old, const rational &newlen)
 {
   if (newlen < old) {
-    QMap<rational, QByteArray>::iterator i = time_hash_map_.begin();
-
-    while (i != time_hash_map_.end()) {
-      if (i.key() >= newlen) {
-        i = time_hash_map_.erase(i);
-      } else {
-        i++;
-      }
-    }
+    RemoveFrames(FrameAtOrAfter(newlen), INT64_MAX);
   }
 }
 
 void FrameHashCache::InvalidateEvent(const TimeRange &r)
 {
-  QMap<rational, QByteArray>::iterator i = time_hash_map_.begin();
-
-  while (i != time_hash_map_.end()) {
-    if (i.key() >= r.in() && i.key() < r.out()) {
-      i = time_hash_map_.erase(i);
-    } else {
-      i++;
-    }
-  }
+  RemoveFrames(FrameAtOrAfter(r.in()), FrameAtOrAfter(r.out()));
 }
 
-struct HashTimePair {
-  rational time;
-  QByteArray hash;
-};
-
 void FrameHashCache::ShiftEvent(const rational &from, const rational &to)
 {
-  QMap<rational, QByteArray>::iterator i = time_hash_map_.begin();
-
   // POSITIVE if moving forward ->
   // NEGATIVE if moving backward <-
   rational diff = to - from;
-  bool diff_is_negative = (diff < rational());
-
-  QList<HashTimePair> shifted_times;
-
-  while (i != time_hash_map_.end()) {
-    if (diff_is_negative && i.key() >= to && i.key() < from) {
 
-      // This time will be removed in the shift so we just discard it
-      i = time_hash_map_.erase(i);
+  int64_t from_frame = FrameAtOrAfter(from);
 
-    } else if (i.key() >= from) {
+  if (!timebase_.IsExact(diff)) {
+    // Frames would no longer land on the timebase, so none of the shifted hashes would be usable
+    RemoveFrames(from_frame, INT64_MAX);
+    return;
+  }
 
-      // This time is after the from time and must be shifted
-      shifted_times.append({i.key() + diff, i.value()});
-      i = time_hash_map_.erase(i);
+  int64_t frame_diff = timebase_.ToTicks(diff);
 
-    } else {
+  if (frame_diff < 0) {
+    // These frames will be overwritten in the shift so we just discard them
+    RemoveFrames(FrameAtOrAfter(to), from_frame);
+  }
 
-      // Do nothing
-      i++;
+  SplitAt(from_frame);
 
+  // Only chunk start points need to move, the hashes inside them stay where they are
+  foreach (Chunk* c, chunks_) {
+    if (c->start >= from_frame) {
+      c->start += frame_diff;
     }
   }
-
-  foreach (const HashTimePair& p, shifted_times) {
-    time_hash_map_.insert(p.time, p.hash);
-  }
 }
 
 QString FrameHashCache::CachePathName(const QByteArray& hash)
@@ -334,7 +395,6 @@ QString FrameHashCache::CachePathName(const QByteArray& hash)
   QString ext = GetFormatExtension();
 
   QDir cache_dir(QDir(FileFunctions::GetMediaCacheLocation()).filePath(QString(hash.left(1).toHex())));
-  cache_dir.mkpath(".");
 
   QString filename = QStringLiteral("%1%2").arg(QString(hash.mid(1).toHex()), ext);
 
@@ -343,6 +403,8 @@ QString FrameHashCache::CachePathName(const QByteArray& hash)
 
 bool FrameHashCache::SaveCacheFrame(const QString &filename, char *data, const VideoParams &vparam, int linesize_bytes)
 {
+  TRACE_SCOPE("cache", "SaveCacheFrame");
+
   Q_ASSERT(PixelFormat::FormatIsFloat(vparam.format()));
 
   // Floating point types are stored in EXR
@@ -388,4 +450,220 @@ bool FrameHashCache::SaveCacheFrame(const QString &filename, char *data, const V
   return true;
 }
 
+FrameHashCache::Digest FrameHashCache::Digest::FromByteArray(const QByteArray &hash)
+{
+  Digest d = {0, 0};
+
+  memcpy(&d, hash.constData(), qMin(static_cast<size_t>(hash.size()), sizeof(Digest)));
+
+  return d;
+}
+
+QByteArray FrameHashCache::Digest::toByteArray() const
+{
+  if (isNull()) {
+    return QByteArray();
+  }
+
+  return QByteArray(reinterpret_cast<const char*>(this), sizeof(Digest));
+}
+
+int64_t FrameHashCache::FrameAtOrAfter(const rational &time) const
+{
+  if (time == RATIONAL_MAX) {
+    return INT64_MAX;
+  }
+
+  int64_t frame = timebase_.ToTicks(time);
+
+  if (!timebase_.IsExact(time)) {
+    frame++;
+  }
+
+  return frame;
+}
+
+int FrameHashCache::ChunkIndexContaining(int64_t frame) const
+{
+  // Find the last chunk that starts at or before this frame
+  QVector<Chunk*>::const_iterator it = std::upper_bound(chunks_.constBegin(), chunks_.constEnd(), frame,
+                                                        [](int64_t f, const Chunk* c) {
+    return f < c->start;
+  });
+
+  if (it == chunks_.constBegin()) {
+    return -1;
+  }
+
+  int index = static_cast<int>(it - chunks_.constBegin()) - 1;
+
+  if (frame < chunks_.at(index)->end()) {
+    return index;
+  }
+
+  return -1;
+}
+
+void FrameHashCache::Store(int64_t frame, const Digest &digest)
+{
+  if (!timebase_.is_valid()) {
+    return;
+  }
+
+  int index = ChunkIndexContaining(frame);
+
+  if (index == -1) {
+    // Start a new chunk here, as long as it can be without running into the next one
+    QVector<Chunk*>::iterator next = std::upper_bound(chunks_.begin(), chunks_.end(), frame,
+                                                      [](int64_t f, const Chunk* c) {
+      return f < c->start;
+    });
+
+    int64_t length = kChunkSize;
+    if (next != chunks_.end()) {
+      length = qMin(length, (*next)->start - frame);
+    }
+
+    Chunk* c = new Chunk();
+    c->start = frame;
+    c->digests.resize(static_cast<int>(length));
+
+    index = static_cast<int>(next - chunks_.begin());
+    chunks_.insert(index, c);
+  }
+
+  Chunk* c = chunks_.at(index);
+  int offset = static_cast<int>(frame - c->start);
+
+  ClearSlot(c, offset);
+
+  if (!digest.isNull()) {
+    c->digests[offset] = digest;
+    frames_with_hash_[digest].insert({c, offset});
+  }
+}
+
+void FrameHashCache::ClearSlot(Chunk *chunk, int offset)
+{
+  Digest& existing = chunk->digests[offset];
+
+  if (!existing.isNull()) {
+    QHash<Digest, SlotSet>::iterator it = frames_with_hash_.find(existing);
+
+    if (it != frames_with_hash_.end()) {
+      it->remove({chunk, offset});
+
+      if (it->isEmpty()) {
+        frames_with_hash_.erase(it);
+      }
+    }
+
+    existing = Digest();
+  }
+}
+
+void FrameHashCache::SplitAt(int64_t frame)
+{
+  int index = ChunkIndexContaining(frame);
+
+  if (index == -1 || chunks_.at(index)->start == frame) {
+    // Already a boundary here
+    return;
+  }
+
+  Chunk* original = chunks_.at(index);
+  int split = static_cast<int>(frame - original->start);
+
+  Chunk* after = new Chunk();
+  after->start = frame;
+  after->digests = original->digests.mid(split);
+
+  original->digests.resize(split);
+
+  // Point the hashes that moved at their new home, only looking each one up again when it changes since runs of the
+  // same hash are common
+  QHash<Digest, SlotSet>::iterator it = frames_with_hash_.end();
+
+  for (int i=0;i<after->digests.size();i++) {
+    const Digest& d = after->digests.at(i);
+
+    if (d.isNull()) {
+      continue;
+    }
+
+    if (it == frames_with_hash_.end() || !(it.key() == d)) {
+      it = frames_with_hash_.find(d);
+    }
+
+    if (it != frames_with_hash_.end() && it->remove({original, split + i})) {
+      it->insert({after, i});
+    }
+  }
+
+  chunks_.insert(index + 1, after);
+}
+
+void FrameHashCache::DeleteChunk(Chunk *chunk)
+{
+  QHash<Digest, SlotSet>::iterator it = frames_with_hash_.end();
+
+  for (int i=0;i<chunk->digests.size();i++) {
+    const Digest& d = chunk->digests.at(i);
+
+    if (d.isNull()) {
+      continue;
+    }
+
+    if (it == frames_with_hash_.end() || !(it.key() == d)) {
+      it = frames_with_hash_.find(d);
+    }
+
+    if (it != frames_with_hash_.end()) {
+      it->remove({chunk, i});
+
+      if (it->isEmpty()) {
+        frames_with_hash_.erase(it);
+        it = frames_with_hash_.end();
+      }
+    }
+  }
+
+  delete chunk;
+}
+
+void FrameHashCache::RemoveFrames(int64_t in, int64_t out)
+{
+  if (in >= out) {
+    return;
+  }
+
+  SplitAt(in);
+
+  if (out != INT64_MAX) {
+    SplitAt(out);
+  }
+
+  // After splitting, the frames in range are exactly the chunks in [first, last)
+  QVector<Chunk*>::iterator first = std::lower_bound(chunks_.begin(), chunks_.end(), in,
+                                                     [](const Chunk* c, int64_t f) {
+    return c->start < f;
+  });
+
+  QVector<Chunk*>::iterator last = first;
+
+  while (last != chunks_.end() && (*last)->end() <= out) {
+    DeleteChunk(*last);
+    last++;
+  }
+
+  chunks_.erase(first, last);
+}
+
+void FrameHashCache::Clear()
+{
+  qDeleteAll(chunks_);
+  chunks_.clear();
+  frames_with_hash_.clear();
+}
+
 OLIVE_NAMESPACE_EXIT
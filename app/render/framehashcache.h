@@ -22,8 +22,10 @@
 #define VIDEORENDERFRAMECACHE_H
 
 #include <QMutex>
+#include <QSet>
 
 #include "common/rational.h"
+#include "common/ticktime.h"
 #include "common/timerange.h"
 #include "render/pixelformat.h"
 #include "render/playbackcache.h"
@@ -31,14 +33,21 @@
 
 OLIVE_NAMESPACE_ENTER
 
+/**
+ * @brief Stores the hash of every frame of a sequence
+ *
+ * Hashes are kept in dense arrays indexed by frame, split into chunks that each cover a contiguous run of frames. A
+ * reverse index from hash to the frames using it makes looking up the frames for a hash proportional to the number of
+ * frames using it rather than the length of the sequence, and shifting frames only has to move chunk start points
+ * rather than every hash.
+ */
 class FrameHashCache : public PlaybackCache
 {
   Q_OBJECT
 public:
-  FrameHashCache(QObject* parent = nullptr) :
-    PlaybackCache(parent)
-  {
-  }
+  FrameHashCache(QObject* parent = nullptr);
+
+  virtual ~FrameHashCache() override;
 
   QByteArray GetHash(const rational& time);
 
@@ -76,6 +85,11 @@ public:
 public slots:
   void SetHash(const OLIVE_NAMESPACE::rational& time, const QByteArray& hash, const qint64 &job_time);
 
+  /**
+   * @brief Invalidates any frames using a hash whose cached frame no longer exists
+   */
+  void HashDeleted(const QByteArray& hash);
+
 protected:
   virtual void LengthChangedEvent(const rational& old, const rational& newlen) override;
 
@@ -84,9 +98,91 @@ protected:
   virtual void ShiftEvent(const rational& from, const rational& to) override;
 
 private:
-  QMap<rational, QByteArray> time_hash_map_;
+  /**
+   * @brief Fixed-size copy of a frame hash, all zeroes means no hash
+   */
+  struct Digest {
+    quint64 a;
+    quint64 b;
+
+    bool isNull() const
+    {
+      return !a && !b;
+    }
+
+    bool operator==(const Digest& rhs) const
+    {
+      return a == rhs.a && b == rhs.b;
+    }
+
+    static Digest FromByteArray(const QByteArray& hash);
+
+    QByteArray toByteArray() const;
+  };
+
+  friend uint qHash(const Digest& d, uint seed)
+  {
+    return ::qHash(d.a ^ d.b, seed);
+  }
+
+  /**
+   * @brief Hashes of a contiguous run of frames starting at `start`
+   */
+  struct Chunk {
+    int64_t start;
+    QVector<Digest> digests;
+
+    int64_t end() const
+    {
+      return start + digests.size();
+    }
+  };
+
+  struct Slot {
+    Chunk* chunk;
+    int offset;
+
+    bool operator==(const Slot& rhs) const
+    {
+      return chunk == rhs.chunk && offset == rhs.offset;
+    }
+  };
+
+  friend uint qHash(const Slot& s, uint seed)
+  {
+    return ::qHash(reinterpret_cast<quintptr>(s.chunk), seed) ^ ::qHash(s.offset, seed) * 31;
+  }
+
+  using SlotSet = QSet<Slot>;
+
+  int64_t FrameAtOrAfter(const rational& time) const;
+
+  int ChunkIndexContaining(int64_t frame) const;
+
+  void Store(int64_t frame, const Digest& digest);
+
+  void ClearSlot(Chunk* chunk, int offset);
+
+  void SplitAt(int64_t frame);
+
+  /**
+   * @brief Remove every slot of a chunk from the reverse index and delete it
+   */
+  void DeleteChunk(Chunk* chunk);
+
+  void RemoveFrames(int64_t in, int64_t out);
+
+  void Clear();
+
+  static const int kChunkSize;
+
+  // Chunks sorted by start, never overlapping
+  QVector<Chunk*> chunks_;
+
+  // Where each hash is used, sets since stills and generators can give thousands of frames the same hash
+  QHash<Digest, SlotSet> frames_with_hash_;
 
-  rational timebase_;
+  TickTimebase timebase_;
 
 };
 
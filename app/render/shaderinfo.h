@@ -150,6 +150,21 @@ public:
     return iterative_input_;
   }
 
+  /**
+   * @brief Values (bottom to top) that the shader composites over each other
+   *
+   * Allows the renderer to disable any layer that's covered by an opaque layer above it before running the job.
+   */
+  const QStringList& GetLayers() const
+  {
+    return layers_;
+  }
+
+  void SetLayers(const QStringList& layers)
+  {
+    layers_ = layers;
+  }
+
 private:
   QString id_;
 
@@ -157,6 +172,8 @@ private:
 
   NodeInput* iterative_input_;
 
+  QStringList layers_;
+
 };
 
 class ShaderCode {
@@ -1,7 +1,6 @@
 #version 150
 
 uniform sampler2D tex_in;
-uniform int method_in;
 uniform float radius_in;
 uniform bool horiz_in;
 uniform bool vert_in;
@@ -14,29 +13,20 @@ in vec2 ove_texcoord;
 
 out vec4 fragColor;
 
-// Gaussian function uses PI
-#define M_PI 3.1415926535897932384626433832795
+// Must match BlurFilterNode::kMaxTapRadius / 2 + 1
+#define MAX_SAMPLES 17
 
-// Methods
-#define METHOD_BOX_BLUR 0
-#define METHOD_GAUSSIAN_BLUR 1
+// Kernel precalculated by BlurFilterNode, adjacent taps are merged into single linearly interpolated samples
+uniform float kernel_offsets[MAX_SAMPLES];
+uniform float kernel_weights[MAX_SAMPLES];
+uniform int kernel_weights_count;
+uniform float kernel_step;
 
 // Mode
 #define MODE_NONE 0
 #define MODE_HORIZONTAL 1
 #define MODE_VERTICAL 2
 
-// Single gaussian formula (unused, mainly here for documentation/just in case)
-//float gaussian(float x, float sigma) {
-//    return (1.0/(sigma*sqrt(2.0*M_PI)))*exp(-0.5*pow(x/sigma, 2.0));
-//}
-
-// Double gaussian formula, actually used in the code below
-// Should be faster than the single gaussian above since it doesn't need sqrt()
-float gaussian2(float x, float y, float sigma) {
-    return (1.0/((sigma*sigma)*2.0*M_PI))*exp(-0.5*(((x*x) + (y*y))/(sigma*sigma)));
-}
-
 int determine_mode() {
     if (radius_in == 0.0) {
         return MODE_NONE;
@@ -63,6 +53,18 @@ int determine_mode() {
     }
 }
 
+vec4 sample_pixel(vec2 coord, float lod) {
+    if (repeat_edge_pixels_in
+        || (coord.x >= 0.0
+            && coord.x < 1.0
+            && coord.y >= 0.0
+            && coord.y < 1.0)) {
+        return textureLod(tex_in, coord, lod);
+    }
+
+    return vec4(0.0);
+}
+
 void main(void) {
     int mode = determine_mode();
 
@@ -71,56 +73,26 @@ void main(void) {
         return;
     }
 
-    // We only sample on hard pixels, so we don't accept decimal radii
-    float real_radius = ceil(radius_in);
-
-    vec4 composite = vec4(0.0);
-
-    float divider, sigma;
-
-    if (method_in == METHOD_BOX_BLUR) {
-
-        // Calculate the weight of each pixel based on the radius
-        divider = 1.0 / real_radius;
-
-    } else if (method_in == METHOD_GAUSSIAN_BLUR) {
+    // Direction of one kernel step in texture coordinates
+    vec2 step_coord;
+    float texels_per_step;
+    if (mode == MODE_HORIZONTAL) {
+        step_coord = vec2(kernel_step / ove_resolution.x, 0.0);
+        texels_per_step = kernel_step * float(textureSize(tex_in, 0).x) / ove_resolution.x;
+    } else {
+        step_coord = vec2(0.0, kernel_step / ove_resolution.y);
+        texels_per_step = kernel_step * float(textureSize(tex_in, 0).y) / ove_resolution.y;
+    }
 
-        // Using (radius = 3 * sigma) because 3 standard deviations covers 97% of the blur according to this document:
-        // http://chemaguerra.com/gaussian-filter-radius/
-        sigma = real_radius;
-        real_radius *= 3.0;
+    // Wide kernels are sampled from a smaller mipmap so the amount of samples never depends on the radius
+    float lod = max(0.0, log2(texels_per_step));
 
-        // Use gaussian formula to calculate the weight of all pixels
-        divider = 0.0;
-        for (float i = -real_radius + 0.5; i <= real_radius; i += 2.0) {
-            divider += gaussian2(i, 0.0, sigma);
-        }
+    vec4 composite = sample_pixel(ove_texcoord, lod) * kernel_weights[0];
 
-    }
+    for (int i = 1; i < kernel_weights_count; i++) {
+        vec2 offset = step_coord * kernel_offsets[i];
 
-    for (float i = -real_radius + 0.5; i <= real_radius; i += 2.0) {
-        float weight;
-
-        if (method_in == METHOD_BOX_BLUR) {
-            weight = divider;
-        } else if (method_in == METHOD_GAUSSIAN_BLUR) {
-            weight = gaussian2(i, 0.0, sigma) / divider;
-        }
-
-        vec2 pixel_coord = ove_texcoord;
-        if (mode == MODE_HORIZONTAL) {
-            pixel_coord.x += i / ove_resolution.x;
-        } else if (mode == MODE_VERTICAL) {
-            pixel_coord.y += i / ove_resolution.y;
-        }
-
-        if (repeat_edge_pixels_in
-            || (pixel_coord.x >= 0.0
-                && pixel_coord.x < 1.0
-                && pixel_coord.y >= 0.0
-                && pixel_coord.y < 1.0)) {
-            composite += texture(tex_in, pixel_coord) * weight;
-        }
+        composite += (sample_pixel(ove_texcoord + offset, lod) + sample_pixel(ove_texcoord - offset, lod)) * kernel_weights[i];
     }
 
     fragColor = composite;
@@ -0,0 +1,66 @@
+#version 150
+
+// Layers from bottom to top, must match CompositeNode::kMaxLayers
+uniform sampler2D layer_0;
+uniform sampler2D layer_1;
+uniform sampler2D layer_2;
+uniform sampler2D layer_3;
+uniform sampler2D layer_4;
+uniform sampler2D layer_5;
+uniform sampler2D layer_6;
+uniform sampler2D layer_7;
+uniform sampler2D layer_8;
+uniform sampler2D layer_9;
+uniform sampler2D layer_10;
+uniform sampler2D layer_11;
+uniform sampler2D layer_12;
+uniform sampler2D layer_13;
+uniform sampler2D layer_14;
+
+uniform bool layer_0_enabled;
+uniform bool layer_1_enabled;
+uniform bool layer_2_enabled;
+uniform bool layer_3_enabled;
+uniform bool layer_4_enabled;
+uniform bool layer_5_enabled;
+uniform bool layer_6_enabled;
+uniform bool layer_7_enabled;
+uniform bool layer_8_enabled;
+uniform bool layer_9_enabled;
+uniform bool layer_10_enabled;
+uniform bool layer_11_enabled;
+uniform bool layer_12_enabled;
+uniform bool layer_13_enabled;
+uniform bool layer_14_enabled;
+
+in vec2 ove_texcoord;
+
+out vec4 fragColor;
+
+// Each layer is sampled directly here (rather than inside over()) so layers computed by single pass shaders can be
+// fused into this one
+vec4 over(vec4 base, vec4 blend_col) {
+    return base * (1.0 - blend_col.a) + blend_col;
+}
+
+void main(void) {
+    vec4 composite = vec4(0.0);
+
+    if (layer_0_enabled) composite = over(composite, texture(layer_0, ove_texcoord));
+    if (layer_1_enabled) composite = over(composite, texture(layer_1, ove_texcoord));
+    if (layer_2_enabled) composite = over(composite, texture(layer_2, ove_texcoord));
+    if (layer_3_enabled) composite = over(composite, texture(layer_3, ove_texcoord));
+    if (layer_4_enabled) composite = over(composite, texture(layer_4, ove_texcoord));
+    if (layer_5_enabled) composite = over(composite, texture(layer_5, ove_texcoord));
+    if (layer_6_enabled) composite = over(composite, texture(layer_6, ove_texcoord));
+    if (layer_7_enabled) composite = over(composite, texture(layer_7, ove_texcoord));
+    if (layer_8_enabled) composite = over(composite, texture(layer_8, ove_texcoord));
+    if (layer_9_enabled) composite = over(composite, texture(layer_9, ove_texcoord));
+    if (layer_10_enabled) composite = over(composite, texture(layer_10, ove_texcoord));
+    if (layer_11_enabled) composite = over(composite, texture(layer_11, ove_texcoord));
+    if (layer_12_enabled) composite = over(composite, texture(layer_12, ove_texcoord));
+    if (layer_13_enabled) composite = over(composite, texture(layer_13, ove_texcoord));
+    if (layer_14_enabled) composite = over(composite, texture(layer_14, ove_texcoord));
+
+    fragColor = composite;
+}
@@ -7,6 +7,12 @@ uniform float radius_in;
 uniform float opacity_in;
 uniform bool inner_in;
 
+// Untouched copy of tex_in (tex_in is replaced by the distance field after the first iteration)
+uniform sampler2D src_in;
+
+// Amount of jump flood iterations between the seed and the composite iterations
+uniform int flood_passes;
+
 // Standard inputs
 uniform vec2 ove_resolution;
 uniform int ove_iteration;
@@ -15,8 +21,81 @@ in vec2 ove_texcoord;
 
 out vec4 fragColor;
 
-void main(void) {
-    vec4 pixel_here = texture(tex_in, ove_texcoord);
+// The distance field stores the offset from each pixel to its nearest seed pixel. Each axis is stored as a 16-bit
+// integer split across two channels so it survives any pixel format, including 8-bit.
+#define NO_SEED 32767
+
+vec4 encode_offset(ivec2 offset) {
+    ivec2 biased = offset + ivec2(32768);
+
+    return vec4(float(biased.x / 256), float(biased.x % 256), float(biased.y / 256), float(biased.y % 256)) / 255.0;
+}
+
+ivec2 decode_offset(vec4 encoded) {
+    ivec4 bytes = ivec4(round(encoded * 255.0));
+
+    return ivec2(bytes.r * 256 + bytes.g, bytes.b * 256 + bytes.a) - ivec2(32768);
+}
+
+bool is_seed(float alpha) {
+    // Inner strokes measure the distance to the nearest transparent pixel, outer strokes to the nearest opaque one
+    if (inner_in) {
+        return alpha < 0.5;
+    } else {
+        return alpha >= 0.5;
+    }
+}
+
+void seed() {
+    float alpha = texture(tex_in, ove_texcoord).a;
+
+    if (is_seed(alpha)) {
+        fragColor = encode_offset(ivec2(0));
+    } else {
+        fragColor = encode_offset(ivec2(NO_SEED));
+    }
+}
+
+void flood(int pass) {
+    ivec2 size = textureSize(tex_in, 0);
+    ivec2 here = ivec2(gl_FragCoord.xy);
+
+    // Step sizes halve every pass, converted from sequence pixels to texels of this (possibly divided) texture
+    float texel_scale = float(size.x) / ove_resolution.x;
+    int step = max(1, int(exp2(float(flood_passes - pass)) * texel_scale));
+
+    ivec2 best = ivec2(NO_SEED);
+    int best_dist = -1;
+
+    for (int x=-1; x<=1; x++) {
+        for (int y=-1; y<=1; y++) {
+            ivec2 neighbor = here + ivec2(x, y) * step;
+
+            if (neighbor.x < 0 || neighbor.y < 0 || neighbor.x >= size.x || neighbor.y >= size.y) {
+                continue;
+            }
+
+            ivec2 neighbor_offset = decode_offset(texelFetch(tex_in, neighbor, 0));
+
+            if (neighbor_offset.x == NO_SEED) {
+                continue;
+            }
+
+            ivec2 offset = neighbor - here + neighbor_offset;
+            int dist = offset.x * offset.x + offset.y * offset.y;
+
+            if (best_dist < 0 || dist < best_dist) {
+                best = offset;
+                best_dist = dist;
+            }
+        }
+    }
+
+    fragColor = encode_offset(best);
+}
+
+void composite() {
+    vec4 pixel_here = texture(src_in, ove_texcoord);
 
     // Detect no-op situations
     if (radius_in == 0.0
@@ -28,37 +107,16 @@ void main(void) {
         return;
     }
 
-    float radius = ceil(radius_in);
+    ivec2 offset = decode_offset(texelFetch(tex_in, ivec2(gl_FragCoord.xy), 0));
 
     float stroke_weight = 0.0;
 
-    // Loop over box
-    for (float i=-radius + 0.5; i<=radius; i += 2.0) {
-        float x_coord = i / ove_resolution.x;
-
-        for (float j=-radius + 0.5; j<=radius; j += 2.0) {
-            float y_coord = j / ove_resolution.y;
+    if (offset.x != NO_SEED) {
+        // Distance and radius in texels of this (possibly divided) texture
+        float radius = radius_in * float(textureSize(tex_in, 0).x) / ove_resolution.x;
+        float dist = length(vec2(offset));
 
-            if (abs(length(vec2(i, j))) < radius) {
-                // Get pixel here
-                float alpha = texture(tex_in, ove_texcoord + vec2(x_coord, y_coord)).a;
-
-                if (inner_in) {
-                    alpha = 1.0 - alpha;
-                }
-
-                stroke_weight += alpha;
-
-                if (stroke_weight >= 1.0) {
-                    break;
-                }
-            }
-        }
-
-        if (stroke_weight >= 1.0) {
-            stroke_weight = 1.0;
-            break;
-        }
+        stroke_weight = clamp(radius - dist + 0.5, 0.0, 1.0);
     }
 
     stroke_weight *= opacity_in;
@@ -80,3 +138,13 @@ void main(void) {
 
     fragColor = stroke_col;
 }
+
+void main(void) {
+    if (ove_iteration == 0) {
+        seed();
+    } else if (ove_iteration <= flood_passes) {
+        flood(ove_iteration);
+    } else {
+        composite();
+    }
+}
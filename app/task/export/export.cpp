@@ -20,6 +20,7 @@
 
 #include "export.h"
 
+#include "common/ticktime.h"
 #include "common/timecodefunctions.h"
 #include "render/colormanager.h"
 
@@ -32,7 +33,20 @@ ExportTask::ExportTask(ViewerOutput* viewer_node,
   color_manager_(color_manager),
   params_(params)
 {
-  SetTitle(tr("Exporting \"%1\"").arg(viewer_node->media_name()));
+  Init();
+}
+
+ExportTask::ExportTask(RenderBackend *backend, ColorManager *color_manager, const ExportParams &params) :
+  RenderTask(backend),
+  color_manager_(color_manager),
+  params_(params)
+{
+  Init();
+}
+
+void ExportTask::Init()
+{
+  SetTitle(tr("Exporting \"%1\"").arg(viewer()->media_name()));
 
   // Render highest quality
   backend()->SetRenderMode(RenderMode::kOnline);
@@ -64,6 +78,10 @@ bool ExportTask::Run()
 
   frame_time_ = Timecode::time_to_timestamp(range.in(), viewer()->video_params().time_base());
 
+  // Frames are written relative to the start of the range so that the video lines up with the audio (which is always
+  // written from 0) and each segment of a split export starts at 0
+  range_start_ = frame_time_;
+
   if (params_.video_enabled()) {
 
     // If a transformation matrix is applied to this video, create it here
@@ -105,7 +123,7 @@ bool ExportTask::Run()
 
   if (params_.audio_enabled()) {
     // Write audio data now
-    encoder_->WriteAudio(audio_params(), audio_data_.GetCacheFilename());
+    encoder_->WriteAudio(audio_params(), audio_data_.GetPCM());
   }
 
   encoder_->Close();
@@ -152,21 +170,20 @@ void ExportTask::FrameDownloaded(const QByteArray &hash, const std::list<rationa
 {
   FramePtr f = rendered_frame_.value(hash);
 
+  TickTimebase timebase(viewer()->video_params().time_base());
+
   foreach (const rational& t, times) {
-    time_map_.insert(t, f);
+    time_map_.insert(timebase.ToNearestTicks(t), f);
   }
 
   forever {
-    rational real_time = Timecode::timestamp_to_time(frame_time_,
-                                                     viewer()->video_params().time_base());
-
-    if (!time_map_.contains(real_time)) {
+    if (!time_map_.contains(frame_time_)) {
       break;
     }
 
     // Unfortunately this can't be done in another thread since the frames need to be sent
     // one after the other chronologically.
-    encoder_->WriteFrame(time_map_.take(real_time), real_time);
+    encoder_->WriteFrame(time_map_.take(frame_time_), timebase.ToTime(frame_time_ - range_start_));
 
     frame_time_++;
 
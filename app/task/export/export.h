@@ -35,6 +35,13 @@ class ExportTask : public RenderTask
 public:
   ExportTask(ViewerOutput *viewer_node, ColorManager *color_manager, const ExportParams &params);
 
+  /**
+   * @brief Export using an existing backend
+   *
+   * The backend's viewer node and parameters must already be set. Mainly for rendering without the OpenGL backend.
+   */
+  ExportTask(RenderBackend *backend, ColorManager *color_manager, const ExportParams &params);
+
 protected:
   virtual bool Run() override;
 
@@ -45,9 +52,12 @@ protected:
   virtual void AudioDownloaded(const TimeRange& range, SampleBufferPtr samples) override;
 
 private:
+  void Init();
+
   QHash<QByteArray, FramePtr> rendered_frame_;
 
-  QHash<rational, FramePtr> time_map_;
+  // Rendered frames waiting to be encoded, keyed by timestamp
+  QHash<int64_t, FramePtr> time_map_;
 
   ColorManager* color_manager_;
 
@@ -59,6 +69,8 @@ private:
 
   int64_t frame_time_;
 
+  int64_t range_start_;
+
   AudioPlaybackCache audio_data_;
 
 };
@@ -21,6 +21,7 @@
 #include "render.h"
 
 #include "common/timecodefunctions.h"
+#include "render/diskmanager.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -151,9 +152,9 @@ void RenderTask::Render(const TimeRangeList& video_range,
           // Check if this hash is in our "existing hashes" list
           hash_exists = (std::find(existing_hashes.begin(), existing_hashes.end(), p.hash) != existing_hashes.end());
 
-          // If not, check if it's in the filesystem
+          // If not, check if it's in the disk cache
           if (!hash_exists) {
-            hash_exists = QFileInfo::exists(viewer()->video_frame_cache()->CachePathName(p.hash));
+            hash_exists = DiskManager::instance()->IsResident(p.hash);
 
             // If so, add it to the list so we don't have to check the filesystem again later
             if (hash_exists) {
@@ -100,7 +100,7 @@ const rational &TimelineWorkArea::out() const
   return workarea_range_.out();
 }
 
-const rational &TimelineWorkArea::length() const
+rational TimelineWorkArea::length() const
 {
   return workarea_range_.length();
 }
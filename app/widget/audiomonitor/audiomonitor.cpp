@@ -63,18 +63,16 @@ void AudioMonitor::SetParams(const AudioParams &params)
   peaked_.fill(false);
 }
 
-void AudioMonitor::OutputDeviceSet(const QString &filename, qint64 offset, int playback_speed)
+void AudioMonitor::OutputDeviceSet(MappedPCMPtr pcm, qint64 offset, int playback_speed)
 {
   Stop();
 
-  file_.setFileName(filename);
-
-  if (!file_.open(QFile::ReadOnly)) {
-    qWarning() << "Failed to open" << filename;
+  if (!pcm) {
     return;
   }
 
-  file_.seek(offset);
+  pcm_ = pcm;
+  pcm_position_ = offset;
 
   playback_speed_ = playback_speed;
 
@@ -85,9 +83,7 @@ void AudioMonitor::OutputDeviceSet(const QString &filename, qint64 offset, int p
 
 void AudioMonitor::Stop()
 {
-  if (file_.isOpen()) {
-    file_.close();
-  }
+  pcm_ = nullptr;
 }
 
 void AudioMonitor::OutputPushed(const QByteArray &d)
@@ -215,8 +211,8 @@ void AudioMonitor::paintGL()
 
   QVector<double> v(params_.channel_count(), 0);
 
-  if (file_.isOpen()) {
-    UpdateValuesFromFile(v);
+  if (pcm_) {
+    UpdateValuesFromPCM(v);
   }
 
   PushValue(v);
@@ -258,7 +254,7 @@ void AudioMonitor::paintGL()
     }
   }
 
-  if (all_zeroes && !file_.isOpen()) {
+  if (all_zeroes && !pcm_) {
     // Optimize by disabling the update loop
     SetUpdateLoop(false);
   }
@@ -270,25 +266,27 @@ void AudioMonitor::mousePressEvent(QMouseEvent *)
   update();
 }
 
-void AudioMonitor::UpdateValuesFromFile(QVector<double>& v)
+void AudioMonitor::UpdateValuesFromPCM(QVector<double>& v)
 {
   // Determines how many milliseconds have passed since last update
   qint64 current_time = QDateTime::currentMSecsSinceEpoch();
   qint64 time_passed = current_time - last_time_;
 
-  // Convert ms to float seconds and determine how many bytes that is
-  qint64 bytes_to_read = params_.time_to_bytes(static_cast<double>(time_passed) * 0.001);
+  // Convert ms to float seconds and determine how many samples that is
+  qint64 samples_to_read = params_.time_to_samples(static_cast<double>(time_passed) * 0.001);
 
   if (playback_speed_ < 0) {
-    bytes_to_read = qMin(bytes_to_read, file_.pos());
-
-    file_.seek(file_.pos() - bytes_to_read);
+    samples_to_read = qMin(samples_to_read, pcm_position_);
+    pcm_position_ -= samples_to_read;
+  } else {
+    samples_to_read = qMax(qint64(0), qMin(samples_to_read, pcm_->length() - pcm_position_));
   }
 
-  QByteArray b = file_.read(bytes_to_read);
+  QByteArray b(params_.samples_to_bytes(samples_to_read), Qt::Uninitialized);
+  pcm_->ReadPacked(pcm_position_, b.data(), samples_to_read);
 
-  if (playback_speed_ < 0) {
-    file_.seek(file_.pos() - bytes_to_read);
+  if (playback_speed_ >= 0) {
+    pcm_position_ += samples_to_read;
   }
 
   int abs_speed = qAbs(playback_speed_);
@@ -21,10 +21,10 @@
 #ifndef AUDIOMONITORWIDGET_H
 #define AUDIOMONITORWIDGET_H
 
-#include <QFile>
 #include <QOpenGLWidget>
 #include <QTimer>
 
+#include "audio/mappedpcm.h"
 #include "common/define.h"
 #include "render/audioparams.h"
 
@@ -41,7 +41,7 @@ public:
 public slots:
   void SetParams(const AudioParams& params);
 
-  void OutputDeviceSet(const QString& filename, qint64 offset, int playback_speed);
+  void OutputDeviceSet(MappedPCMPtr pcm, qint64 offset, int playback_speed);
 
   void Stop();
 
@@ -56,7 +56,7 @@ protected:
 private:
   void SetUpdateLoop(bool e);
 
-  void UpdateValuesFromFile(QVector<double> &v);
+  void UpdateValuesFromPCM(QVector<double> &v);
 
   void PushValue(const QVector<double>& v);
 
@@ -66,7 +66,8 @@ private:
 
   AudioParams params_;
 
-  QFile file_;
+  MappedPCMPtr pcm_;
+  qint64 pcm_position_;
   qint64 last_time_;
 
   int playback_speed_;
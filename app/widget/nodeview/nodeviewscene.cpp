@@ -20,7 +20,6 @@
 
 #include "nodeviewscene.h"
 
-#include "common/functiontimer.h"
 #include "nodeviewedge.h"
 #include "nodeviewitem.h"
 #include "project/item/sequence/sequence.h"
@@ -32,6 +32,7 @@
 #include "dialog/footageproperties/footageproperties.h"
 #include "dialog/sequence/sequence.h"
 #include "task/cache/footagecache.h"
+#include "task/proxy/proxy.h"
 #include "task/taskmanager.h"
 #include "widget/menu/menu.h"
 #include "widget/menu/menushared.h"
@@ -333,6 +334,15 @@ void ProjectExplorer::ShowContextMenu()
 
         connect(proxy_menu, &Menu::triggered, this, &ProjectExplorer::ContextMenuStartProxy);
       }
+
+      Menu* create_proxy_menu = new Menu(tr("Create Proxy"), &menu);
+      menu.addMenu(create_proxy_menu);
+
+      create_proxy_menu->addAction(tr("1/2 Resolution"))->setData(2);
+      create_proxy_menu->addAction(tr("1/4 Resolution"))->setData(4);
+      create_proxy_menu->addAction(tr("1/8 Resolution"))->setData(8);
+
+      connect(create_proxy_menu, &Menu::triggered, this, &ProjectExplorer::ContextMenuCreateProxy);
     }
 
     Q_UNUSED(all_items_are_footage_or_sequence)
@@ -432,6 +442,20 @@ void ProjectExplorer::ContextMenuStartProxy(QAction *a)
   }
 }
 
+void ProjectExplorer::ContextMenuCreateProxy(QAction *a)
+{
+  int divider = a->data().toInt();
+
+  // To get here, the `context_menu_items_` must be all kFootage
+  foreach (Item* i, context_menu_items_) {
+    VideoStreamPtr s = std::static_pointer_cast<VideoStream>(static_cast<Footage*>(i)->get_first_stream_of_type(Stream::kVideo));
+
+    if (s) {
+      TaskManager::instance()->AddTask(new ProxyTask(s, divider));
+    }
+  }
+}
+
 Project *ProjectExplorer::project() const
 {
   return model_.project();
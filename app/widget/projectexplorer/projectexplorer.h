@@ -171,6 +171,8 @@ private slots:
 
   void ContextMenuStartProxy(QAction* a);
 
+  void ContextMenuCreateProxy(QAction* a);
+
 };
 
 OLIVE_NAMESPACE_EXIT
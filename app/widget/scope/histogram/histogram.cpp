@@ -24,7 +24,6 @@
 #include <QtMath>
 
 #include "common/clamp.h"
-#include "common/functiontimer.h"
 
 OLIVE_NAMESPACE_ENTER
 
@@ -1472,12 +1472,12 @@ struct SnapData {
   rational movement;
 };
 
+const qreal kSnapRange = 10; // FIXME: Hardcoded number
+
 QList<SnapData> AttemptSnap(const QList<double>& screen_pt,
                             double compare_pt,
                             const QList<rational>& start_times,
                             const rational& compare_time) {
-  const qreal kSnapRange = 10; // FIXME: Hardcoded number
-
   QList<SnapData> snap_data;
 
   for (int i=0;i<screen_pt.size();i++) {
@@ -1506,21 +1506,21 @@ bool TimelineWidget::SnapPoint(QList<rational> start_times, rational* movement,
     potential_snaps.append(AttemptSnap(screen_pt, playhead_pos, start_times, playhead_abs_time));
   }
 
-  if (snap_points & kSnapToClips) {
-    QMap<Block*, TimelineViewBlockItem*>::const_iterator i;
-
-    for (i=block_items_.constBegin(); i!=block_items_.constEnd(); i++) {
-      TimelineViewBlockItem* item = i.value();
+  if ((snap_points & kSnapToClips) && GetConnectedNode()) {
+    const QVector<TrackOutput*>& tracks = GetConnectedNode()->GetTracks();
 
-      if (item) {
-        qreal rect_left = item->x();
-        qreal rect_right = rect_left + item->rect().width();
+    for (int i=0;i<screen_pt.size();i++) {
+      // Only look at edit points that could be in range. SceneToTime() rounds down to the timebase, so pad the end by
+      // one unit to catch edit points that aren't on it (e.g. audio).
+      rational window_in = SceneToTime(screen_pt.at(i) - kSnapRange);
+      rational window_out = SceneToTime(screen_pt.at(i) + kSnapRange) + timebase();
 
-        // Attempt snapping to clip in point
-        potential_snaps.append(AttemptSnap(screen_pt, rect_left, start_times, item->block()->in()));
-
-        // Attempt snapping to clip out point
-        potential_snaps.append(AttemptSnap(screen_pt, rect_right, start_times, item->block()->out()));
+      foreach (TrackOutput* track, tracks) {
+        foreach (const rational& edit_point, track->EditPointsInRange(window_in, window_out)) {
+          if (InRange(screen_pt.at(i), TimeToScene(edit_point), kSnapRange)) {
+            potential_snaps.append({edit_point, edit_point - start_times.at(i)});
+          }
+        }
       }
     }
   }
@@ -20,7 +20,6 @@
 
 #include "audiowaveformview.h"
 
-#include <QFile>
 #include <QPainter>
 #include <QtMath>
 
@@ -63,11 +62,14 @@ void AudioWaveformView::paintEvent(QPaintEvent *event)
 {
   QWidget::paintEvent(event);
 
-  const AudioParams& params = playback_->GetParameters();
+  if (!playback_) {
+    return;
+  }
+
+  MappedPCMPtr pcm = playback_->GetPCM();
+  const AudioParams& params = pcm->params();
 
-  if (!playback_
-      || playback_->GetCacheFilename().isEmpty()
-      || !params.is_valid()) {
+  if (!params.is_valid()) {
     return;
   }
 
@@ -78,48 +80,37 @@ void AudioWaveformView::paintEvent(QPaintEvent *event)
     cached_waveform_ = QPixmap(size());
     cached_waveform_.fill(Qt::transparent);
 
-    QFile fs(playback_->GetCacheFilename());
-
-    if (fs.open(QFile::ReadOnly)) {
-
-      QPainter wave_painter(&cached_waveform_);
+    QPainter wave_painter(&cached_waveform_);
 
-      // FIXME: Hardcoded color
-      wave_painter.setPen(QColor(64, 255, 160));
+    // FIXME: Hardcoded color
+    wave_painter.setPen(QColor(64, 255, 160));
 
-      int drew = 0;
+    qint64 pcm_length = pcm->length();
+    qint64 sample_pos = ScreenToUnitRounded(0);
 
-      fs.seek(params.samples_to_bytes(ScreenToUnitRounded(0)));
+    QByteArray read_buffer;
 
-      for (int x=0; x<width() && !fs.atEnd(); x++) {
-        int samples_len = ScreenToUnitRounded(x+1) - ScreenToUnitRounded(x);
-        int max_read_size = params.samples_to_bytes(samples_len);
+    for (int x=0; x<width() && sample_pos < pcm_length; x++) {
+      qint64 next_pos = ScreenToUnitRounded(x+1);
 
-        QByteArray read_buffer = fs.read(max_read_size);
+      // Clamp to the end of the audio
+      int samples_len = static_cast<int>(qMin(next_pos, pcm_length) - sample_pos);
 
-        // Detect whether we've reached EOF and recalculate sample count if so
-        if (read_buffer.size() < max_read_size) {
-          samples_len = params.bytes_to_samples(read_buffer.size());
-        }
+      read_buffer.resize(params.samples_to_bytes(samples_len));
+      pcm->ReadPacked(sample_pos, read_buffer.data(), samples_len);
 
-        QVector<AudioVisualWaveform::SamplePerChannel> samples = AudioVisualWaveform::SumSamples(reinterpret_cast<const float*>(read_buffer.constData()),
-                                                                                       samples_len,
-                                                                                       params.channel_count());
+      QVector<AudioVisualWaveform::SamplePerChannel> samples = AudioVisualWaveform::SumSamples(reinterpret_cast<const float*>(read_buffer.constData()),
+                                                                                     samples_len,
+                                                                                     params.channel_count());
 
-        for (int i=0;i<params.channel_count();i++) {
-          AudioVisualWaveform::DrawSample(&wave_painter, samples, x, 0, height());
-
-          drew++;
-        }
-      }
-
-      cached_size_ = size();
-      cached_scale_ = GetScale();
-      cached_scroll_ = GetScroll();
-
-      fs.close();
+      AudioVisualWaveform::DrawSample(&wave_painter, samples, x, 0, height());
 
+      sample_pos = next_pos;
     }
+
+    cached_size_ = size();
+    cached_scale_ = GetScale();
+    cached_scroll_ = GetScroll();
   }
 
   QPainter p(this);
@@ -22,6 +22,19 @@
 
 OLIVE_NAMESPACE_ENTER
 
+NodeValueDatabase GizmoTraverser::GenerateGizmoDatabase(const Node *node, const TimeRange &range)
+{
+  NodeValueDatabase database;
+
+  foreach (NodeInput* input, node->GetGizmoInputs()) {
+    database.Insert(input, ProcessInput(input, node->InputTimeAdjustment(input, range)));
+  }
+
+  AddGlobalsToDatabase(database, range);
+
+  return database;
+}
+
 QVariant GizmoTraverser::ProcessVideoFootage(StreamPtr stream, const rational &input_time)
 {
   Q_UNUSED(input_time)
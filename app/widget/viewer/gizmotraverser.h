@@ -33,6 +33,13 @@ public:
   {
   }
 
+  /**
+   * @brief Equivalent to GenerateDatabase() but only evaluates the inputs the node's gizmos use
+   *
+   * @see Node::GetGizmoInputs()
+   */
+  NodeValueDatabase GenerateGizmoDatabase(const Node *node, const TimeRange &range);
+
 protected:
   virtual QVariant ProcessVideoFootage(StreamPtr stream, const rational &input_time);
 
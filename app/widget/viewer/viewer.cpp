@@ -37,6 +37,7 @@
 #include "config/config.h"
 #include "project/item/sequence/sequence.h"
 #include "project/project.h"
+#include "render/diskmanager.h"
 #include "render/pixelformat.h"
 #include "task/taskmanager.h"
 #include "widget/menu/menu.h"
@@ -114,6 +115,7 @@ ViewerWidget::ViewerWidget(QWidget *parent) :
   renderer_ = new OpenGLBackend(this);
   renderer_->SetUpdateWithGraph(true);
   renderer_->SetRenderMode(RenderMode::kOffline);
+  renderer_->SetGPUResidentFrames(true);
 
   // Setup cache wait timer (waits a few seconds of inactivity before caching)
   cache_wait_timer_.setInterval(Config::Current()["AutoCacheInterval"].toInt());
@@ -534,22 +536,19 @@ void ViewerWidget::PushScrubbedAudio()
 {
   if (!IsPlaying() && Config::Current()["AudioScrubbing"].toBool()) {
     // Get audio src device from renderer
-    QString audio_fn = GetConnectedNode()->audio_playback_cache()->GetCacheFilename();
-    QFile audio_src(audio_fn);
+    MappedPCMPtr audio_src = GetConnectedNode()->audio_playback_cache()->GetPCM();
+    const AudioParams& params = audio_src->params();
 
-    if (audio_src.open(QFile::ReadOnly)) {
-      const AudioParams& params = GetConnectedNode()->audio_playback_cache()->GetParameters();
-
-      // FIXME: Hardcoded scrubbing interval (20ms)
-      int size_of_sample = params.time_to_bytes(rational(20, 1000));
+    // FIXME: Hardcoded scrubbing interval (20ms)
+    qint64 start = params.time_to_samples(GetTime());
+    qint64 count = qMin(qint64(params.time_to_samples(rational(20, 1000))), audio_src->length() - start);
 
+    if (count > 0) {
       // Push audio
-      audio_src.seek(params.time_to_bytes(GetTime()));
-      QByteArray frame_audio = audio_src.read(size_of_sample);
+      QByteArray frame_audio(params.samples_to_bytes(count), Qt::Uninitialized);
+      audio_src->ReadPacked(start, frame_audio.data(), count);
       AudioManager::instance()->SetOutputParams(params);
       AudioManager::instance()->PushToOutput(frame_audio);
-
-      audio_src.close();
     }
   }
 }
@@ -592,7 +591,7 @@ QString ViewerWidget::GetCachedFilenameFromTime(const rational &time)
   if (FrameExistsAtTime(time)) {
     QByteArray hash = GetConnectedNode()->video_frame_cache()->GetHash(time);
 
-    if (!hash.isEmpty()) {
+    if (!hash.isEmpty() && DiskManager::instance()->IsResident(hash)) {
       return GetConnectedNode()->video_frame_cache()->CachePathName(hash);
     }
   }
@@ -638,7 +637,7 @@ PixelFormat::Format ViewerWidget::GetCurrentPixelFormat() const
 RenderTicketPtr ViewerWidget::GetFrame(const rational &t, bool clear_render_queue)
 {
   QByteArray cached_hash = GetConnectedNode()->video_frame_cache()->GetHash(t);
-  if (cached_hash.isEmpty()) {
+  if (cached_hash.isEmpty() || !DiskManager::instance()->IsResident(cached_hash)) {
     // Frame hasn't been cached, start render job
     if (clear_render_queue) {
       renderer_->ClearVideoQueue();
@@ -661,18 +660,20 @@ void ViewerWidget::FinishPlayPreprocess()
 {
   int64_t playback_start_time = ruler()->GetTime();
 
-  QString audio_fn = GetConnectedNode()->audio_playback_cache()->GetCacheFilename();
-  if (!audio_fn.isEmpty()) {
-    AudioManager::instance()->SetOutputParams(GetConnectedNode()->audio_playback_cache()->GetParameters());
-    AudioManager::instance()->StartOutput(audio_fn,
-                                          GetConnectedNode()->audio_playback_cache()->GetParameters().time_to_bytes(GetTime()),
+  MappedPCMPtr audio_src = GetConnectedNode()->audio_playback_cache()->GetPCM();
+  bool playing_audio = audio_src->params().is_valid();
+  if (playing_audio) {
+    AudioManager::instance()->SetOutputParams(audio_src->params());
+    AudioManager::instance()->StartOutput(audio_src,
+                                          audio_src->params().time_to_samples(GetTime()),
                                           playback_speed_);
   }
 
-  playback_timer_.Start(playback_start_time, playback_speed_, timebase_dbl());
+  // Video follows the audio device's clock when there's audio so the two can't drift apart
+  playback_timer_.Start(playback_start_time, playback_speed_, timebase_dbl(), playing_audio);
 
   foreach (ViewerWindow* window, windows_) {
-    window->Play(playback_start_time, playback_speed_, timebase());
+    window->Play(playback_start_time, playback_speed_, timebase(), playing_audio);
   }
 
   connect(display_widget_, &ViewerDisplayWidget::frameSwapped, this, &ViewerWidget::ForceUpdate);
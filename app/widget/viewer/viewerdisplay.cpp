@@ -30,7 +30,6 @@
 #include <QPainter>
 
 #include "common/define.h"
-#include "common/functiontimer.h"
 #include "gizmotraverser.h"
 #include "render/backend/opengl/openglrenderfunctions.h"
 #include "render/backend/opengl/openglshader.h"
@@ -67,8 +66,13 @@ void ViewerDisplayWidget::SetSignalCursorColorEnabled(bool e)
 void ViewerDisplayWidget::SetImage(FramePtr in_buffer)
 {
   last_loaded_buffer_ = in_buffer;
+  shared_texture_ = nullptr;
 
-  if (last_loaded_buffer_) {
+  if (last_loaded_buffer_
+      && last_loaded_buffer_->texture().canConvert<OpenGLSharedTexturePtr>()) {
+    // This frame never left the GPU so we can draw its texture directly
+    shared_texture_ = last_loaded_buffer_->texture().value<OpenGLSharedTexturePtr>();
+  } else if (last_loaded_buffer_) {
     makeCurrent();
 
     if (!texture_.IsCreated()
@@ -103,7 +107,16 @@ void ViewerDisplayWidget::SetSafeMargins(const ViewerSafeMarginInfo &safe_margin
 void ViewerDisplayWidget::SetGizmos(Node *node)
 {
   if (gizmos_ != node) {
+    if (gizmos_) {
+      disconnect(gizmos_, &Node::CacheInvalidated, this, &ViewerDisplayWidget::GizmoInvalidated);
+    }
+
     gizmos_ = node;
+    gizmo_db_cache_.clear();
+
+    if (gizmos_) {
+      connect(gizmos_, &Node::CacheInvalidated, this, &ViewerDisplayWidget::GizmoInvalidated);
+    }
 
     update();
   }
@@ -113,6 +126,9 @@ void ViewerDisplayWidget::SetVideoParams(const VideoParams &params)
 {
   gizmo_params_ = params;
 
+  // Gizmo values may depend on the sequence size
+  gizmo_db_cache_.clear();
+
   if (gizmos_) {
     update();
   }
@@ -210,7 +226,14 @@ void ViewerDisplayWidget::paintGL()
   if (last_loaded_buffer_ && color_service()) {
 
     // Bind retrieved texture
-    f->glBindTexture(GL_TEXTURE_2D, texture_.texture());
+    if (shared_texture_) {
+      // Make sure the other context has finished rendering it
+      shared_texture_->WaitForRender(context());
+
+      f->glBindTexture(GL_TEXTURE_2D, shared_texture_->texture()->texture());
+    } else {
+      f->glBindTexture(GL_TEXTURE_2D, texture_.texture());
+    }
 
     // Blit using the color service
     color_service()->ProcessOpenGL(true, matrix_);
@@ -222,11 +245,7 @@ void ViewerDisplayWidget::paintGL()
 
   // Draw gizmos if we have any
   if (gizmos_) {
-    GizmoTraverser gt(QSize(gizmo_params_.width(), gizmo_params_.height()));
-
-    rational node_time = GetGizmoTime();
-
-    gizmo_db_ = gt.GenerateDatabase(gizmos_, TimeRange(node_time, node_time));
+    gizmo_db_ = GetGizmoDatabase(GetGizmoTime());
 
     QPainter p(this);
     gizmos_->DrawGizmos(gizmo_db_, &p, QVector2D(GetTexturePosition(size())), size());
@@ -286,6 +305,39 @@ rational ViewerDisplayWidget::GetGizmoTime()
   return GetAdjustedTime(GetTimeTarget(), gizmos_, time_, NodeParam::kInput);
 }
 
+NodeValueDatabase ViewerDisplayWidget::GetGizmoDatabase(const rational &time)
+{
+  QMap<rational, NodeValueDatabase>::const_iterator cached = gizmo_db_cache_.constFind(time);
+
+  if (cached != gizmo_db_cache_.constEnd()) {
+    return cached.value();
+  }
+
+  GizmoTraverser gt(QSize(gizmo_params_.width(), gizmo_params_.height()));
+
+  NodeValueDatabase db = gt.GenerateGizmoDatabase(gizmos_, TimeRange(time, time));
+
+  // Playback visits every frame once, so don't let the cache grow forever
+  if (gizmo_db_cache_.size() >= kMaxCachedGizmoDatabases) {
+    gizmo_db_cache_.clear();
+  }
+
+  gizmo_db_cache_.insert(time, db);
+
+  return db;
+}
+
+void ViewerDisplayWidget::GizmoInvalidated(const TimeRange &range)
+{
+  QMap<rational, NodeValueDatabase>::iterator i = gizmo_db_cache_.lowerBound(range.in());
+
+  while (i != gizmo_db_cache_.end() && i.key() <= range.out()) {
+    i = gizmo_db_cache_.erase(i);
+  }
+
+  update();
+}
+
 void ViewerDisplayWidget::ContextCleanup()
 {
   makeCurrent();
@@ -27,6 +27,7 @@
 #include "render/backend/opengl/openglcolorprocessor.h"
 #include "render/backend/opengl/openglframebuffer.h"
 #include "render/backend/opengl/openglshader.h"
+#include "render/backend/opengl/openglsharedtexture.h"
 #include "render/backend/opengl/opengltexture.h"
 #include "render/color.h"
 #include "render/colormanager.h"
@@ -150,11 +151,21 @@ private:
 
   rational GetGizmoTime();
 
+  /**
+   * @brief Returns the gizmo node's values at this time, only traversing the graph if they aren't cached
+   */
+  NodeValueDatabase GetGizmoDatabase(const rational& time);
+
   /**
    * @brief Internal reference to the OpenGL texture to draw. Set in SetTexture() and used in paintGL().
    */
   OpenGLTexture texture_;
 
+  /**
+   * @brief Texture rendered in a shared context, drawn instead of texture_ if it's set
+   */
+  OpenGLSharedTexturePtr shared_texture_;
+
   /**
    * @brief Drawing matrix (defaults to identity)
    */
@@ -166,6 +177,8 @@ private:
 
   Node* gizmos_;
   NodeValueDatabase gizmo_db_;
+  QMap<rational, NodeValueDatabase> gizmo_db_cache_;
+  static const int kMaxCachedGizmoDatabases = 256;
   rational gizmo_drag_time_;
   VideoParams gizmo_params_;
   bool gizmo_click_;
@@ -180,6 +193,11 @@ private slots:
    */
   void ContextCleanup();
 
+  /**
+   * @brief Removes cached gizmo values that the gizmo node has invalidated
+   */
+  void GizmoInvalidated(const OLIVE_NAMESPACE::TimeRange& range);
+
 };
 
 OLIVE_NAMESPACE_EXIT
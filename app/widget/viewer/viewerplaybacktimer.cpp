@@ -20,25 +20,57 @@
 
 #include "viewerplaybacktimer.h"
 
-#include <QDateTime>
+#include "audio/audiomanager.h"
 
 OLIVE_NAMESPACE_ENTER
 
-void ViewerPlaybackTimer::Start(const int64_t &start_timestamp, const int &playback_speed, const double &timebase)
+const qint64 ViewerPlaybackTimer::kMaxDriftUSecs = 100000;
+
+void ViewerPlaybackTimer::Start(const int64_t &start_timestamp, const int &playback_speed, const double &timebase,
+                                bool follow_audio)
 {
-  start_msec_ = QDateTime::currentMSecsSinceEpoch();
+  timer_.start();
   start_timestamp_ = start_timestamp;
   playback_speed_ = playback_speed;
   timebase_ = timebase;
+  follow_audio_ = follow_audio;
+  correction_usecs_ = 0;
+  last_elapsed_usecs_ = 0;
 }
 
-int64_t ViewerPlaybackTimer::GetTimestampNow() const
+int64_t ViewerPlaybackTimer::GetTimestampNow()
 {
-  int64_t real_time = QDateTime::currentMSecsSinceEpoch() - start_msec_;
-
-  int64_t frames_since_start = qRound(static_cast<double>(real_time) / (timebase_ * 1000));
+  int64_t frames_since_start = qRound(static_cast<double>(GetElapsedUSecs()) / (timebase_ * 1000000));
 
   return start_timestamp_ + frames_since_start * playback_speed_;
 }
 
+qint64 ViewerPlaybackTimer::GetElapsedUSecs()
+{
+  qint64 elapsed = timer_.nsecsElapsed() / 1000 + correction_usecs_;
+
+  // The device clock only starts once it has consumed something, until then the system clock stands in
+  qint64 device_elapsed = (follow_audio_ && AudioManager::instance())
+      ? AudioManager::instance()->GetOutputPlayedUSecs() : -1;
+
+  if (device_elapsed > 0) {
+    qint64 drift = device_elapsed - elapsed;
+
+    if (qAbs(drift) > kMaxDriftUSecs) {
+      // Too far out to ease back (e.g. the device stalled or started late), jump straight to it
+      correction_usecs_ += drift;
+    } else {
+      // The device only reports in steps, so ease towards it rather than jittering along with it
+      correction_usecs_ += drift / 8;
+    }
+
+    elapsed = timer_.nsecsElapsed() / 1000 + correction_usecs_;
+  }
+
+  // Correction can pull the clock back, but playback mustn't step backwards
+  last_elapsed_usecs_ = qMax(last_elapsed_usecs_, elapsed);
+
+  return last_elapsed_usecs_;
+}
+
 OLIVE_NAMESPACE_EXIT
@@ -21,6 +21,7 @@
 #ifndef VIEWERPLAYBACKTIMER_H
 #define VIEWERPLAYBACKTIMER_H
 
+#include <QElapsedTimer>
 #include <QtGlobal>
 
 #include "common/define.h"
@@ -29,18 +30,37 @@ OLIVE_NAMESPACE_ENTER
 
 class ViewerPlaybackTimer {
 public:
-  void Start(const int64_t& start_timestamp, const int& playback_speed, const double& timebase);
+  /**
+   * @brief Start counting frames from `start_timestamp`
+   *
+   * If `follow_audio` is true, once AudioManager's output has started playing, time is taken from how much audio it
+   * has played rather than from the system clock so video stays in sync with what's heard.
+   */
+  void Start(const int64_t& start_timestamp, const int& playback_speed, const double& timebase,
+             bool follow_audio = false);
 
-  int64_t GetTimestampNow() const;
+  int64_t GetTimestampNow();
 
 private:
-  qint64 start_msec_;
+  qint64 GetElapsedUSecs();
+
+  QElapsedTimer timer_;
+
   int64_t start_timestamp_;
 
   int playback_speed_;
 
   double timebase_;
 
+  bool follow_audio_;
+
+  // Added to the system clock to bring it in line with the audio device
+  qint64 correction_usecs_;
+
+  qint64 last_elapsed_usecs_;
+
+  static const qint64 kMaxDriftUSecs;
+
 };
 
 OLIVE_NAMESPACE_EXIT
@@ -62,9 +62,10 @@ void ViewerWindow::SetResolution(int width, int height)
   display_widget_->SetMatrix(mat);
 }
 
-void ViewerWindow::Play(const int64_t& start_timestamp, const int& playback_speed, const rational &timebase)
+void ViewerWindow::Play(const int64_t& start_timestamp, const int& playback_speed, const rational &timebase,
+                        bool follow_audio)
 {
-  timer_.Start(start_timestamp, playback_speed, timebase.toDouble());
+  timer_.Start(start_timestamp, playback_speed, timebase.toDouble(), follow_audio);
 
   playback_timebase_ = timebase;
 
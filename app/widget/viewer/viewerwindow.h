@@ -45,7 +45,7 @@ public:
     return &queue_;
   }
 
-  void Play(const int64_t &start_timestamp, const int &playback_speed, const rational &timebase);
+  void Play(const int64_t &start_timestamp, const int &playback_speed, const rational &timebase, bool follow_audio);
 
   void Pause();
 
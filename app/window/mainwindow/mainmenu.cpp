@@ -21,9 +21,12 @@
 #include "mainmenu.h"
 
 #include <QEvent>
+#include <QFileDialog>
+#include <QMessageBox>
 #include <QStyleFactory>
 
 #include "common/timecodefunctions.h"
+#include "common/trace.h"
 #include "config/config.h"
 #include "core.h"
 #include "dialog/actionsearch/actionsearch.h"
@@ -266,6 +269,12 @@ MainMenu::MainMenu(MainWindow *parent) :
 
   tools_menu_->addSeparator();
 
+  tools_record_trace_item_ = tools_menu_->AddItem("recordtrace", this, &MainMenu::RecordTraceTriggered);
+  tools_record_trace_item_->setCheckable(true);
+  tools_save_trace_item_ = tools_menu_->AddItem("savetrace", this, &MainMenu::SaveTraceTriggered);
+
+  tools_menu_->addSeparator();
+
   tools_preferences_item_ = tools_menu_->AddItem("prefs", Core::instance(), &Core::DialogPreferencesShow, "Ctrl+,");
 
   //
@@ -363,6 +372,9 @@ void MainMenu::ToolsMenuAboutToShow()
 
   // Ensure snapping value is correct
   tools_snapping_item_->setChecked(Core::instance()->snapping());
+
+  // Tracing may have been started from the command line
+  tools_record_trace_item_->setChecked(Trace::IsEnabled());
 }
 
 void MainMenu::PlaybackMenuAboutToShow()
@@ -621,6 +633,38 @@ void MainMenu::SequenceCacheInOutTriggered()
   Core::instance()->CacheActiveSequence(true);
 }
 
+void MainMenu::RecordTraceTriggered(bool e)
+{
+  if (e) {
+    // Start a fresh recording
+    Trace::Clear();
+  }
+
+  Trace::SetEnabled(e);
+}
+
+void MainMenu::SaveTraceTriggered()
+{
+  QString fn = QFileDialog::getSaveFileName(Core::instance()->main_window(),
+                                            tr("Save Performance Trace"),
+                                            QString(),
+                                            tr("Chrome Trace (*.json)"));
+
+  if (fn.isEmpty()) {
+    return;
+  }
+
+  if (!fn.endsWith(QStringLiteral(".json"), Qt::CaseInsensitive)) {
+    fn.append(QStringLiteral(".json"));
+  }
+
+  if (!Trace::WriteChromeJSON(fn)) {
+    QMessageBox::critical(Core::instance()->main_window(),
+                          tr("Save Performance Trace"),
+                          tr("Failed to write trace to \"%1\".").arg(fn));
+  }
+}
+
 void MainMenu::Retranslate()
 {
   // MenuShared is not a QWidget and therefore does not receive a LanguageEvent, we use MainMenu's to update it
@@ -713,6 +757,8 @@ void MainMenu::Retranslate()
   tools_zoom_item_->setText(tr("Zoom Tool"));
   tools_transition_item_->setText(tr("Transition Tool"));
   tools_snapping_item_->setText(tr("Enable Snapping"));
+  tools_record_trace_item_->setText(tr("Record Performance Trace"));
+  tools_save_trace_item_->setText(tr("Save Performance Trace..."));
   tools_preferences_item_->setText(tr("Preferences"));
 
   // Help menu
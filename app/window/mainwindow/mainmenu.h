@@ -180,6 +180,9 @@ private slots:
   void SequenceCacheTriggered();
   void SequenceCacheInOutTriggered();
 
+  void RecordTraceTriggered(bool e);
+  void SaveTraceTriggered();
+
 private:
   /**
    * @brief Set strings based on the current application language.
@@ -272,6 +275,8 @@ private:
   QAction* tools_zoom_item_;
   QAction* tools_transition_item_;
   QAction* tools_snapping_item_;
+  QAction* tools_record_trace_item_;
+  QAction* tools_save_trace_item_;
   QAction* tools_preferences_item_;
 
   Menu* help_menu_;